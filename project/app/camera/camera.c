@@ -12,12 +12,18 @@
 #include <sys/ioctl.h>
 #include <sys/poll.h>
 #include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <time.h>
 
 #include <asm-generic/errno-base.h>
 #include <video/tcc/tcc_cam_ioctrl.h>
 
 #include "log.h"
 #include "klog.h"
+#include "latency.h"
+#include "frame_check.h"
 #include "message_queue.h"
 #include "v4l2.h"
 #include "list.h"
@@ -30,6 +36,21 @@
 #define MAX_HANDOVER_STEP	5
 #define DEVICES_TO_OPEN		5
 
+/* the recovery is checked if no frame is received in this interval */
+#define RECOVERY_CHECK_INTERVAL_MS	(50)
+#define MAX_EPOLL_EVENTS		(4)
+
+enum event_source {
+	EVENT_SOURCE_COMMAND,
+	EVENT_SOURCE_CAPTURE,
+	EVENT_SOURCE_TIMER,
+	EVENT_SOURCE_WRITER,
+	EVENT_SOURCE_RING,
+	EVENT_SOURCE_G2D,
+	EVENT_SOURCE_EXPORT_LISTEN,
+	EVENT_SOURCE_EXPORT,
+};
+
 enum CAMERA_CMD {
 	CAMERA_CMD_INIT,
 	CAMERA_CMD_HANDOVER,
@@ -40,6 +61,7 @@ enum CAMERA_CMD {
 	CAMERA_CMD_START_RECORD,
 	CAMERA_CMD_STOP_RECORD,
 	CAMERA_CMD_SNAPSHOT_RECORD,
+	CAMERA_CMD_BENCH_G2D,
 	CAMERA_CMD_KILL,
 };
 
@@ -74,11 +96,24 @@ void camera_init_parameters(struct camera *dev)
 	dev->vout.ovl.wmix_fovp	= -1;	/* the initial ovp must be -1 */
 	dev->vout.ovl.wmix_bovp	= -1;	/* the initial ovp must be -1 */
 	dev->recovery			= 1;
+	dev->standby			= 0;
+	dev->record_preroll_ms		= 3000;
+	dev->record_postroll_ms		= 2000;
+	dev->color_matrix		= (unsigned int)COLORCONV_MATRIX_BT601;
+	dev->color_range		= (unsigned int)COLORCONV_RANGE_LIMITED;
+	dev->sw.gpio_chip		= -1;
+	dev->sw.debounce_ms		= 20;
+	dev->epoll_fd			= -1;
+	dev->timer_fd			= -1;
 }
 
 void camera_show_parameters(const struct camera *dev)
 {
 	logi("%20s: %d\n", "Switch Device", dev->sw.id);
+	if (dev->sw.gpio_chip >= 0) {
+		logi("%20s: chip %d, line %u, active low: %u, debounce: %u ms\n", "Switch GPIO",
+			dev->sw.gpio_chip, dev->sw.gpio_line, dev->sw.active_low, dev->sw.debounce_ms);
+	}
 
 	logi("%20s: %d\n", "Video-Input Path", dev->vin.capture.id);
 
@@ -93,7 +128,8 @@ void camera_show_parameters(const struct camera *dev)
 		logi("%20s: %s\n", "IO Mode", "V4L2_MEMORY_MMAP");
 		break;
 	case (unsigned int)V4L2_MEMORY_USERPTR:
-		logi("%20s: %s\n", "IO Mode", "V4L2_MEMORY_USERPTR");
+		logi("%20s: %s (hugepage: %u)\n", "IO Mode", "V4L2_MEMORY_USERPTR",
+			dev->vin.use_hugepage);
 		break;
 	case (unsigned int)V4L2_MEMORY_DMABUF:
 		logi("%20s: %s\n", "IO Mode", "V4L2_MEMORY_DMABUF");
@@ -109,6 +145,12 @@ void camera_show_parameters(const struct camera *dev)
 
 	logi("%20s: %s\n", "Preview Format",
 		v4l2_get_format_name_by_v4l2_format(dev->preview_format));
+	if ((dev->display_format != 0U) && (dev->display_format != dev->preview_format)) {
+		logi("%20s: %s (%s, %s range)\n", "Display Format",
+			v4l2_get_format_name_by_v4l2_format(dev->display_format),
+			(dev->color_matrix == (unsigned int)COLORCONV_MATRIX_BT709) ? "BT.709" : "BT.601",
+			(dev->color_range == (unsigned int)COLORCONV_RANGE_FULL) ? "full" : "limited");
+	}
 
 #if defined(USE_G2D)
 	switch (dev->preview_rot) {
@@ -128,7 +170,14 @@ void camera_show_parameters(const struct camera *dev)
 		loge("preview_rot(%u) is wrong\n", dev->preview_rot);
 		break;
 	}
+#else
+	logi("%20s: %u\n", "Preview Rotation", dev->preview_rot);
 #endif//defined(USE_G2D)
+	if (dev->preview_mirror != (unsigned int)FRAME_ROTATE_MIRROR_NONE) {
+		logi("%20s: %s\n", "Preview Mirror",
+			(dev->preview_mirror == (unsigned int)FRAME_ROTATE_MIRROR_HORIZONTAL) ?
+			"horizontal" : "vertical");
+	}
 
 	logi("%20s: %d\n", "Video-Output Device", dev->vout.ovl.id);
 
@@ -144,6 +193,13 @@ void camera_show_parameters(const struct camera *dev)
 	logi("%20s: %u\n", "Ignore Ovp", dev->vout.ignore_ovp);
 
 	logi("%20s: %d\n", "Recovery", dev->recovery);
+	logi("%20s: %u frames (recovery: %u)\n", "Frozen Feed",
+		dev->frozen.window, dev->frozen_recovery);
+	logi("%20s: %u\n", "Buffer Pool", dev->vin.pool.enable);
+	logi("%20s: %u\n", "Standby", dev->standby);
+	logi("%20s: %d frames (record: %u)\n", "Capture", dev->cnt_to_capture, dev->capture_record);
+	logi("%20s: %u MiB (pre-roll: %u ms, post-roll: %u ms)\n", "Record Ring",
+		dev->record_budget_mb, dev->record_preroll_ms, dev->record_postroll_ms);
 }
 
 static int camera_open_switch(struct camera *dev)
@@ -153,9 +209,9 @@ static int camera_open_switch(struct camera *dev)
 
 	sw		= &dev->sw;
 
-	if (sw->id < 0) {
+	if (switch_is_enabled(sw) == 0) {
+		/* nothing to open */
 		logd("switch id is %d, run-by-command mode\n", sw->id);
-		ret = -1;
 	} else {
 		ret = switch_open_device(sw);
 		if (ret < 0) {
@@ -357,7 +413,7 @@ void camera_close_devices(const struct camera *dev)
 		loge("video_input_close_device, ret: %d\n", ret);
 	}
 
-	if (sw->id < 0) {
+	if (switch_is_enabled(sw) == 0) {
 		/* sw switch */
 		logd("switch id is %d, there is no device to close.\n", sw->id);
 	} else {
@@ -543,6 +599,151 @@ static void camera_show_video_output(struct camera *dev, unsigned int show)
 	logk("> after camera_show_video_output");
 }
 
+static int camera_add_event_source(const struct camera *dev, int fd, unsigned int source)
+{
+	struct epoll_event		event		= { 0, };
+	int				ret		= 0;
+
+	(void)memset((void *)&event, 0, sizeof(event));
+
+	event.events	= (unsigned int)EPOLLIN;
+	event.data.u32	= source;
+
+	ret = epoll_ctl(dev->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	if (ret < 0) {
+		loge("epoll_ctl(ADD, %d), errno: %d\n", fd, errno);
+		ret = -1;
+	}
+
+	return ret;
+}
+
+static int camera_arm_recovery_timer(const struct camera *dev, unsigned int enable)
+{
+	struct itimerspec		its		= { 0, };
+	int				ret		= 0;
+
+	(void)memset((void *)&its, 0, sizeof(its));
+
+	if (enable == 1U) {
+		/* a zero itimerspec disarms the timer */
+		its.it_value.tv_nsec	= (long)RECOVERY_CHECK_INTERVAL_MS * 1000L * 1000L;
+		its.it_interval		= its.it_value;
+	}
+
+	ret = timerfd_settime(dev->timer_fd, 0, &its, NULL);
+	if (ret < 0) {
+		loge("timerfd_settime, errno: %d\n", errno);
+		ret = -1;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Start or stop waiting for frames of the video-input path
+ *
+ * The capture fd is only registered while the stream is running because v4l2
+ * reports POLLERR on a queue which is not streaming.
+ *
+ * @param dev camera device instance
+ * @param enable 1 to watch the capture fd and the recovery timer, 0 to stop
+ */
+static void camera_watch_capture(struct camera *dev, unsigned int enable)
+{
+	int				ret		= 0;
+
+	if (enable == dev->is_capture_watched) {
+		logd("capture is already %s\n", (enable == 1U) ? "watched" : "unwatched");
+	} else if (enable == 1U) {
+		ret = camera_add_event_source(dev, dev->vin.capture.fd,
+			(unsigned int)EVENT_SOURCE_CAPTURE);
+		if (ret == 0) {
+			dev->is_capture_watched	= 1;
+			dev->is_frame_received	= 0;
+		}
+		frame_check_reset_freeze(&dev->frozen);
+		(void)camera_arm_recovery_timer(dev, 1U);
+	} else {
+		(void)epoll_ctl(dev->epoll_fd, EPOLL_CTL_DEL, dev->vin.capture.fd, NULL);
+		dev->is_capture_watched	= 0;
+		(void)camera_arm_recovery_timer(dev, 0U);
+	}
+}
+
+#if defined(USE_G2D)
+/*
+ * The device of G2D may be readable while it is idle, so it is watched for
+ * one event at a time, and watched again whenever a job is in flight.
+ *
+ * @param op EPOLL_CTL_ADD to register the device, EPOLL_CTL_MOD to watch again
+ */
+static int camera_watch_g2d(const struct camera *dev, int op)
+{
+	struct epoll_event		event		= { 0, };
+	int				ret		= 0;
+
+	(void)memset((void *)&event, 0, sizeof(event));
+
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	event.events	= (unsigned int)EPOLLIN | (unsigned int)EPOLLONESHOT;
+	event.data.u32	= (unsigned int)EVENT_SOURCE_G2D;
+
+	ret = epoll_ctl(dev->epoll_fd, op, g2d_get_fd(&dev->g2d), &event);
+	if (ret < 0) {
+		loge("epoll_ctl(%d, %d), errno: %d\n", op, g2d_get_fd(&dev->g2d), errno);
+		ret = -1;
+	}
+
+	return ret;
+}
+
+/* collect the job of G2D, and watch the device again if it has been reset */
+static int camera_reap_g2d(struct camera *dev, unsigned int *index)
+{
+	int				ret		= 0;
+
+	ret = g2d_rotation_reap(&dev->g2d, index);
+	if ((ret < 0) && (g2d_is_available(&dev->g2d) == 0)) {
+		/* the device is opened again */
+		(void)camera_watch_g2d(dev, EPOLL_CTL_ADD);
+	}
+
+	return ret;
+}
+
+/* 1 if the frames are rotated by G2D, and shown once they are rotated */
+static unsigned int camera_is_rotated_by_g2d(const struct camera *dev)
+{
+	return ((dev->preview_rot != (unsigned int)NOOP) && (dev->rotate.n_planes == 0U) &&
+		(dev->g2d.phy_addr != 0U)) ? 1U : 0U;
+}
+
+/* the job of G2D which rotates a frame as captured and converts it to be shown */
+static void camera_get_g2d_job(const struct camera *dev, struct g2d_job *job)
+{
+	g2d_job_init(job, dev->preview_format,
+		(unsigned int)dev->preview_width, (unsigned int)dev->preview_height);
+	job->angle = dev->preview_rot;
+	if (dev->display_format != 0U) {
+		/* converted by the same job */
+		job->dst_format = dev->display_format;
+	}
+}
+
+/* 1 if the job of the preview is done by a single pass of G2D */
+static unsigned int camera_is_fused_by_g2d(const struct camera *dev)
+{
+	struct g2d_job			job;
+	struct g2d_plan			plan;
+
+	camera_get_g2d_job(dev, &job);
+
+	return ((g2d_job_plan(&job, &plan) == 0) && (plan.n_passes == 1U) &&
+		(plan.passes[0].engine == G2D_ENGINE_G2D)) ? 1U : 0U;
+}
+#endif//defined(USE_G2D)
+
 static void handover_cm4_env(const struct camera *dev)
 {
 #if defined(CM4_MANAGER_SUPPORT)
@@ -617,7 +818,7 @@ static int set_lut(struct camera *dev)
 	return ret;
 }
 
-static int start_stream(struct camera *dev)
+static int start_vin_stream(struct camera *dev)
 {
 	struct video_input		*vin		= NULL;
 	int				ret		= 0;
@@ -628,9 +829,6 @@ static int start_stream(struct camera *dev)
 	vin->frame_height	= dev->preview_height;
 	vin->format		= dev->preview_format;
 
-	/* wait at least 3 frames is shown; 0.100 s (based on 60 fps) */
-	(void)usleep(100 * 1000);
-
 	ret = video_input_start_preview(vin);
 	if (ret < 0) {
 		loge("video_input_start_preview, ret: %d\n", ret);
@@ -640,6 +838,14 @@ static int start_stream(struct camera *dev)
 	return ret;
 }
 
+static int start_stream(struct camera *dev)
+{
+	/* wait at least 3 frames is shown; 0.100 s (based on 60 fps) */
+	(void)usleep(100 * 1000);
+
+	return start_vin_stream(dev);
+}
+
 static int unset_handover_flag(struct camera *dev)
 {
 	const struct video_input	*vin		= NULL;
@@ -663,6 +869,8 @@ static void show_vout(struct camera *dev)
 {
 	dev->status = MODE_PREVIEW_STARTED;
 
+	camera_watch_capture(dev, 1U);
+
 	camera_show_video_output(dev, 1U);
 }
 
@@ -694,6 +902,75 @@ static void handover_if_early_running(struct camera *dev)
 	}
 }
 
+static int prepare_g2d(const struct camera *dev)
+{
+#if defined(USE_G2D)
+	struct graphic2d		*g2d		= NULL;
+	struct g2d_job			job;
+#endif//defined(USE_G2D)
+	int				ret		= 0;
+
+#if defined(USE_G2D)
+	g2d		= &dev->g2d;
+
+	ret = g2d_is_available(g2d);
+	if (ret == 0) {
+		/* the ring is in the format the job converts the frames into */
+		camera_get_g2d_job(dev, &job);
+		ret = g2d_memory_allocate(g2d,
+			(unsigned int)dev->preview_width, (unsigned int)dev->preview_height,
+			(camera_is_fused_by_g2d(dev) == 1U) ? job.dst_format : dev->preview_format);
+		if (ret < 0) {
+			loge("g2d_memory_allocate, ret: %d\n", ret);
+			return ret;
+		}
+	}
+#else
+	(void)dev;
+#endif//defined(USE_G2D)
+
+	return ret;
+}
+
+/**
+ * @brief Start streaming the video-input path with the video-output hidden
+ *
+ * Frames are dequeued and queued back without being displayed, so starting
+ * preview afterwards only has to bring the video-output path to the front.
+ *
+ * @param dev camera device instance
+ * @return 0 if the path is streaming in standby or standby is disabled
+ */
+static int do_enter_standby(struct camera *dev)
+{
+	int				ret		= 0;
+
+	if (dev->standby != 1U) {
+		/* standby is disabled */
+		logd("standby is disabled\n");
+	} else if ((dev->status == MODE_PREVIEW_STARTED) ||
+		   (dev->status == MODE_PREVIEW_STANDBY)) {
+		logd("The video-input path is working already\n");
+	} else {
+		/* camera system is not initialized */
+		dev->initialized = 0;
+
+		if ((prepare_g2d(dev) == 0) &&
+			(set_lut(dev) == 0) &&
+			(start_vin_stream(dev) == 0)) {
+			dev->status = MODE_PREVIEW_STANDBY;
+			camera_watch_capture(dev, 1U);
+			logk("> standby is started");
+		} else {
+			/* error */
+			loge("Failed to start standby\n");
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
 static void do_handover(struct camera *dev)
 {
 	const struct switch_t		*sw		= NULL;
@@ -723,33 +1000,11 @@ static void do_handover(struct camera *dev)
 		/* handover */
 		handover_if_early_running(dev);
 	}
-}
-
-static int prepare_g2d(const struct camera *dev)
-{
-#if defined(USE_G2D)
-	struct graphic2d		*g2d		= NULL;
-#endif//defined(USE_G2D)
-	int				ret		= 0;
-
-#if defined(USE_G2D)
-	g2d		= &dev->g2d;
 
-	ret = g2d_is_available(g2d);
-	if (ret == 0) {
-		ret = g2d_memory_allocate(g2d,
-			(unsigned int)dev->preview_width, (unsigned int)dev->preview_height,
-			v4l2_get_color_depth_by_v4l2_format(dev->preview_format));
-		if (ret < 0) {
-			loge("g2d_memory_allocate, ret: %d\n", ret);
-			return ret;
-		}
+	if (dev->status != MODE_PREVIEW_STARTED) {
+		/* keep streaming hidden until the reverse gear is engaged */
+		(void)do_enter_standby(dev);
 	}
-#else
-	(void)dev;
-#endif//defined(USE_G2D)
-
-	return ret;
 }
 
 static int do_start_preview(struct camera *dev)
@@ -762,6 +1017,12 @@ static int do_start_preview(struct camera *dev)
 	if (dev->status == MODE_PREVIEW_STARTED) {
 		logd("The video-input path is working already\n");
 		ret = -1;
+	} else if (dev->status == MODE_PREVIEW_STANDBY) {
+		/*
+		 * the stream is running already, so only show video_output.
+		 * the frame held in buf_list is shown on the next dqbuf.
+		 */
+		show_vout(dev);
 	} else {
 		/* camera system is not initialized */
 		dev->initialized = 0;
@@ -779,12 +1040,13 @@ static int do_start_preview(struct camera *dev)
 	return ret;
 }
 
-static int do_stop_preview(struct camera *dev)
+static int stop_stream(struct camera *dev)
 {
 	struct video_input		*vin		= NULL;
 #if defined(USE_G2D)
 	struct graphic2d		*g2d		= NULL;
 #endif//defined(USE_G2D)
+	unsigned int			index		= 0;
 	int				ret		= 0;
 
 	vin		= &dev->vin;
@@ -792,76 +1054,142 @@ static int do_stop_preview(struct camera *dev)
 	g2d		= &dev->g2d;
 #endif//defined(USE_G2D)
 
-	if (dev->status != MODE_PREVIEW_STARTED) {
-		logd("The video-input path is not working already\n");
+	/* hide video_output */
+	camera_show_video_output(dev, 0U);
+
+	camera_watch_capture(dev, 0U);
+
+	/*
+	 * the buffers pinned by the frame writer, the ring and G2D are freed with
+	 * the stream, and the client keeps the fds of the frame it still reads
+	 */
+	frame_writer_wait_idle(&dev->writer);
+	while (frame_writer_reap(&dev->writer, &index) == 1) {
+		/* every buffer is queued again at the next start */
+		logd("buffer(%u) is written\n", index);
+	}
+	frame_ring_wait_idle(&dev->ring);
+	while (frame_ring_reap(&dev->ring, &index) == 1) {
+		/* every buffer is queued again at the next start */
+		logd("buffer(%u) is copied\n", index);
+	}
+	frame_export_cancel(&dev->exporter);
+#if defined(USE_G2D)
+	g2d_rotation_wait_idle(g2d);
+	while (camera_reap_g2d(dev, &index) != 0) {
+		/* every buffer is queued again at the next start */
+		logd("buffer(%u) is rotated\n", index);
+	}
+#endif//defined(USE_G2D)
+	(void)memset((void *)dev->pins, 0, sizeof(dev->pins));
+
+	ret = video_input_stop_preview(vin);
+	if (ret < 0) {
+		loge("video_input_stop_preview, ret: %d\n", ret);
 		ret = -1;
-	} else {
-		/* hide video_output */
-		camera_show_video_output(dev, 0U);
+	}
 
-		ret = video_input_stop_preview(vin);
+#if defined(USE_G2D)
+	ret = g2d_is_available(g2d);
+	if (ret == 0) {
+		ret = g2d_memory_deallocate(g2d);
 		if (ret < 0) {
-			loge("video_input_stop_preview, ret: %d\n", ret);
+			loge("g2d_memory_deallocate, ret: %d\n", ret);
 			ret = -1;
 		}
-
-#if defined(USE_G2D)
-		ret = g2d_is_available(g2d);
-		if (ret == 0) {
-			ret = g2d_memory_deallocate(g2d);
-			if (ret < 0) {
-				loge("g2d_memory_deallocate, ret: %d\n", ret);
-				ret = -1;
-			}
-		}
-#endif//defined(USE_G2D)
 	}
+#endif//defined(USE_G2D)
 
 	dev->status = MODE_PREVIEW_STOPPED;
 
 	return ret;
 }
 
+static int do_stop_preview(struct camera *dev)
+{
+	int				ret		= 0;
+
+	if (dev->status == MODE_PREVIEW_STANDBY) {
+		logd("The video-output path is hidden already\n");
+		ret = -1;
+	} else if (dev->status != MODE_PREVIEW_STARTED) {
+		logd("The video-input path is not working already\n");
+		dev->status = MODE_PREVIEW_STOPPED;
+		ret = -1;
+	} else if (dev->standby == 1U) {
+		/* hide video_output and keep streaming */
+		camera_show_video_output(dev, 0U);
+		dev->status = MODE_PREVIEW_STANDBY;
+	} else {
+		ret = stop_stream(dev);
+	}
+
+	return ret;
+}
+
+static int restart_stream(struct camera *dev)
+{
+	enum operation_status		status		= MODE_INITIALIZED;
+	int				ret		= 0;
+
+	status		= dev->status;
+
+	ret = stop_stream(dev);
+	if (ret != 0) {
+		/* error */
+		loge("stop_stream, ret: %d\n", ret);
+	}
+
+	if (status == MODE_PREVIEW_STANDBY) {
+		/* go back to standby not to show the recovered stream */
+		ret = do_enter_standby(dev);
+	} else {
+		ret = do_start_preview(dev);
+	}
+
+	return ret;
+}
+
+/* the result is left zeroed if the frame can not be analyzed */
 static int camera_check_buffer(const struct camera *dev,
-	const struct v4l2_buffer *buf)
+	const struct v4l2_buffer *buf, struct frame_check_result *result)
 {
 	const struct video_input	*vin		= NULL;
-	unsigned int			width		= 0;
-	unsigned int			height		= 0;
-	const unsigned char		*base_addr	= NULL;
-	const void			*ptr1		= NULL;
-	const void			*ptr2		= NULL;
-	int				ret_cmp		= 0;
+	const struct buffer_t		*vbuf		= NULL;
+	struct frame_check_plane	planes[VIDEO_MAX_PLANES];
+	unsigned int			n_planes	= 0;
+	unsigned int			idx		= 0;
 	int				ret		= 0;
 
 	vin		= &dev->vin;
-	width		= dev->preview_width;
-	height		= dev->preview_height;
+	vbuf		= &vin->buffers[buf->index];
 
 	logd("index: %u, paddr: %p, vaddr: %p\n",
-		buf->index,
-		vin->buffers[buf->index].paddrs[0].addr,
-		vin->buffers[buf->index].vaddrs[0].addr);
+		buf->index, vbuf->paddrs[0].addr, vbuf->vaddrs[0].addr);
 
-	if ((width  < (unsigned int)MAX_LIMIT_WIDTH) &&
-	    (height < (unsigned int)MAX_LIMIT_HEIGHT)) {
-		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
-		base_addr	= (const unsigned char *)(vin->buffers[buf->index].vaddrs[0].addr);
-		/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
-		ptr1		= (const void *)(base_addr + ((height / 4U * 1U) * width));
-		ptr2		= (const void *)(base_addr + ((height / 4U * 3U) * width));
-		logd("base_addr: %p, ptr1: %p, ptr2: %p\n", base_addr, ptr1, ptr2);
-	} else {
-		width  = (unsigned int)DISPLAY_SCREEN_WIDTH;
+	n_planes = v4l2_get_planes_by_v4l2_format(dev->preview_format);
+	if (n_planes > (unsigned int)VIDEO_MAX_PLANES) {
 		/* coverity[misra_c_2012_rule_2_2_violation : FALSE] */
-		height = (unsigned int)DISPLAY_SCREEN_HEIGHT;
-		loge("Using default size: %u * %u\n", width, height);
+		n_planes = (unsigned int)VIDEO_MAX_PLANES;
+	}
+	for (idx = 0; idx < n_planes; idx++) {
+		planes[idx].addr	= vbuf->vaddrs[idx].addr;
+		planes[idx].length	= vbuf->vaddrs[idx].length;
 	}
 
-	if (ptr1 != NULL) {
-		ret_cmp = memcmp(ptr1, ptr2, width);
-		if (ret_cmp == 0) {
-			logd("memcmp, ret: %d\n", ret_cmp);
+	(void)memset((void *)result, 0, sizeof(*result));
+	ret = frame_check_analyze(dev->preview_format, dev->preview_width,
+		dev->preview_height, planes, n_planes, result);
+	if (ret < 0) {
+		/* the frame can not be checked, so it is shown as before */
+		loge("frame_check_analyze, ret: %d\n", ret);
+		ret = 0;
+	} else {
+		logd("luma mean: %u, variance: %u, samples: %u, hash: 0x%016llx\n",
+			result->luma_mean, result->luma_variance, result->luma_samples,
+			(unsigned long long)result->hash);
+		if (frame_check_is_blank(result) == 1U) {
+			/* the source has not written the buffer yet */
 			ret = -1;
 		}
 	}
@@ -870,158 +1198,236 @@ static int camera_check_buffer(const struct camera *dev,
 }
 
 #if defined(USE_G2D)
-int camera_rotate_buffer(struct camera *dev,
+/*
+ * The frame is rotated, and converted if it is shown in another format, by
+ * a single job of G2D into the next buffer of its ring without waiting for
+ * the job, which is collected by handle_g2d_event() to show the frame. The
+ * buffer is pinned until G2D is done with it, and the frame is skipped if
+ * the frame before is still being rotated.
+ *
+ * @return 1 if the buffer is pinned by G2D, 0 otherwise
+ */
+static unsigned int camera_rotate_buffer(struct camera *dev,
 	const struct v4l2_buffer *buf)
 {
-	struct video_input		*vin		= NULL;
-	struct graphic2d		*g2d		= NULL;
-	struct video_output		*vout		= NULL;
+	const struct video_input	*vin		= NULL;
+	struct g2d_job			job;
 	unsigned int			src_addr0	= 0;
 	unsigned int			src_addr1	= 0;
 	unsigned int			src_addr2	= 0;
-	unsigned int			dst_addr0	= 0;
-	unsigned int			dst_addr1	= 0;
-	unsigned int			dst_addr2	= 0;
-	unsigned int			img_width	= 0;
-	unsigned int			img_height	= 0;
-	unsigned int			crop_offx	= 0;
-	unsigned int			crop_offy	= 0;
-	unsigned int			crop_imgx	= 0;
-	unsigned int			crop_imgy	= 0;
-	unsigned int			angle		= 0;
-	unsigned int			preview_width	= 0;
-	unsigned int			preview_height	= 0;
-
-	struct video_output_buffer	vout_buf	= { 0, };
+	unsigned int			is_pinned	= 0;
 	int				ret		= 0;
 
 	vin		= &dev->vin;
-	g2d		= &dev->g2d;
-	vout		= &dev->vout;
-
-	if (dev->preview_rot != 0U) {
-		src_addr0	= (unsigned int)vin->buffers[buf->index].paddrs[0].addr;
-		dst_addr0	= g2d_get_memory_address(g2d);
 
-		img_width	= (unsigned int)dev->preview_width;
-		img_height	= (unsigned int)dev->preview_height;
-		crop_imgx	= img_width;
-		crop_imgy	= img_height;
-		angle		= dev->preview_rot;
-
-		ret = g2d_rotation(g2d, src_addr0, 0, 0, dst_addr0, 0, 0,
-			img_width, img_height, crop_offx, crop_offy,
-			crop_imgx, crop_imgy, angle);
-
-		if ((angle == (unsigned int)ROTATE_90) || (angle == (unsigned int)ROTATE_270)) {
-			preview_width	= crop_imgy;
-			preview_height	= crop_imgx;
-		} else {
-			preview_width	= crop_imgx;
-			preview_height	= crop_imgy;
-		}
+	/* the planes as captured, in the order of preview_format */
+	/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+	/* coverity[cert_int36_c_violation : FALSE] */
+	/* coverity[pointer_conversion_loses_bits : FALSE] */
+	src_addr0	= (unsigned int)vin->buffers[buf->index].paddrs[0].addr;
+	/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+	/* coverity[cert_int36_c_violation : FALSE] */
+	/* coverity[pointer_conversion_loses_bits : FALSE] */
+	src_addr1	= (unsigned int)vin->buffers[buf->index].paddrs[1].addr;
+	/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+	/* coverity[cert_int36_c_violation : FALSE] */
+	/* coverity[pointer_conversion_loses_bits : FALSE] */
+	src_addr2	= (unsigned int)vin->buffers[buf->index].paddrs[2].addr;
+
+	camera_get_g2d_job(dev, &job);
+	job.dst_format = dev->g2d.format;
+	ret = g2d_job_submit(&dev->g2d, &job, src_addr0, src_addr1, src_addr2, buf->index);
+	if (ret == 0) {
+		/* read by G2D */
+		is_pinned = 1;
+		(void)camera_watch_g2d(dev, EPOLL_CTL_MOD);
 	}
-	logd("addr: 0x%08x, 0x%08x, 0x%08x\n",
-		dst_addr0, dst_addr1, dst_addr2);
-
-	(void)memset((void *)&vout_buf, 0, sizeof(vout_buf));
-	vout_buf.width		= preview_width;
-	vout_buf.height		= preview_height;
-	vout_buf.posx		= (dev->preview_posx == -1)
-		? (((unsigned int)DISPLAY_SCREEN_WIDTH  - preview_width)  / 2U)
-		: (unsigned int)dev->preview_posx;
-	vout_buf.posy		= (dev->preview_posy == -1)
-		? (((unsigned int)DISPLAY_SCREEN_HEIGHT - preview_height) / 2U)
-		: (unsigned int)dev->preview_posy;
-	vout_buf.format		= dev->preview_format;
-	vout_buf.addrs[0]	= dst_addr0;
-	vout_buf.addrs[1]	= dst_addr1;
-	vout_buf.addrs[2]	= dst_addr2;
 
-	return ret;
+	return is_pinned;
 }
 #endif//defined(USE_G2D)
 
-static int write_data(int fd, const char *buf, int buf_len)
+/* the header and the planes of the frame in the buffer to be written as is */
+static int camera_get_dump_planes(const struct camera *dev, const struct v4l2_buffer *buf,
+	struct frame_dump_header *header, struct iovec *planes)
 {
-	int size = 0;
-	int ret = 0;
-	int len;
+	const struct buffer_t		*vbuf		= NULL;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
 
-	for (;;) {
-		len = s64_to_s32(write(fd, &buf[size], s32_to_u64(buf_len - size)));
-		if (len > 0) {
-			size += len;
-			if (size == buf_len) {
-				ret = size;
-			} else {
-				continue;
-			}
-		} else if (len == 0) {
-			ret = size;
-		} else {
-			ret = -1;
-		}
+	vbuf		= &dev->vin.buffers[buf->index];
 
-		break;
+	ret = frame_dump_init_header(header, dev->preview_format,
+		dev->preview_width, dev->preview_height);
+	if (ret == 0) {
+		header->sequence	= buf->sequence;
+		header->timestamp_us	= ((uint64_t)buf->timestamp.tv_sec * 1000000U) +
+			(uint64_t)buf->timestamp.tv_usec;
+		for (idx = 0; idx < header->n_planes; idx++) {
+			planes[idx].iov_base	= vbuf->vaddrs[idx].addr;
+			planes[idx].iov_len	= (header->sizes[idx] < vbuf->vaddrs[idx].length) ?
+				header->sizes[idx] : vbuf->vaddrs[idx].length;
+		}
 	}
 
 	return ret;
 }
 
-static void camera_save_buffer(struct camera *dev, const struct v4l2_buffer *buf)
+/*
+ * The planes of the frame are written by the frame writer in its own
+ * thread, straight from the buffer of video-input, into a file after a
+ * header which describes them or into the recording with the header in its
+ * index. The buffer is pinned rather than requeued until the
+ * writer gives it back, and the frame is not counted if the writer is still
+ * busy with the frame before, so the next frame is tried instead.
+ *
+ * @return 1 if the buffer is pinned by the frame writer, 0 otherwise
+ */
+static unsigned int camera_save_buffer(struct camera *dev, const struct v4l2_buffer *buf)
 {
-	const struct video_input	*vin		= NULL;
+	struct frame_dump_header	header;
+	struct iovec			planes[FRAME_DUMP_MAX_PLANES];
 	char				fname[32]	= "";
-	int				fd		= 0;
 	static unsigned int		capture_idx;
+	unsigned int			is_pinned	= 0;
 	int				ret		= 0;
 
-	vin		= &dev->vin;
-
 	if (dev->cnt_to_capture > 0) {
+		ret = camera_get_dump_planes(dev, buf, &header, planes);
 		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
-		ret = snprintf(fname, 32, "video_capture.%u", capture_idx);
-		if (ret < 0) {
-			loge("snprintf, ret: %d\n", ret);
-			ret = -1;
+		if ((ret < 0) || (snprintf(fname, 32, "video_capture.%u", capture_idx) < 0)) {
+			loge("Failed to prepare the frame to capture\n");
+		} else {
+			ret = frame_writer_queue(&dev->writer, fname, &header,
+				planes, header.n_planes, buf->index);
+			if (ret < 0) {
+				/* dropped */
+				logd("the frame to capture is dropped\n");
+			} else {
+				dev->cnt_to_capture = dev->cnt_to_capture - 1;
+				/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
+				/* coverity[misra_c_2012_rule_12_1_violation : FALSE] */
+				capture_idx = add_u32(capture_idx, 1);
+				is_pinned = 1;
+			}
 		}
+	}
 
-		/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
-		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
-		fd = open(fname, O_RDWR | O_CREAT, 0755);
-		if (fd < 0) {
-			loge("Failed to open the file to capture\n");
-		} else {
-			unsigned int pixel_size = dev->preview_width * dev->preview_height * 4U;
+	return is_pinned;
+}
 
-			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
-			/* coverity[cert_exp37_c_violation : FALSE] */
-			if (pixel_size < (unsigned int)INT_MAX) {
-				/* write */
-				/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
-				/* coverity[cert_exp37_c_violation : FALSE] */
-				ret = write_data(fd, vin->buffers[buf->index].vaddrs[0].addr, (int)pixel_size);
-			} else {
-				/* error */
+/*
+ * The frame is copied into the pre-trigger ring by the thread of the ring
+ * after it is shown, so the copy does not delay preview. The buffer is
+ * pinned until the copy is done, and the frame is skipped if the frame
+ * before is still being copied.
+ *
+ * @return 1 if the buffer is pinned by the ring, 0 otherwise
+ */
+static unsigned int camera_keep_buffer(struct camera *dev, const struct v4l2_buffer *buf)
+{
+	struct frame_dump_header	header;
+	struct iovec			planes[FRAME_DUMP_MAX_PLANES];
+	unsigned int			is_pinned	= 0;
+	int				ret		= 0;
+
+	if ((dev->ring.is_started == 1U) && (dev->initialized == 1U)) {
+		ret = camera_get_dump_planes(dev, buf, &header, planes);
+		if (ret == 0) {
+			ret = frame_ring_queue(&dev->ring, &header, planes, header.n_planes,
+				buf->index);
+		}
+		if (ret == 0) {
+			/* copied by the ring */
+			is_pinned = 1;
+		}
+	}
+
+	return is_pinned;
+}
+
+/*
+ * The frame is handed to the client of the exported frames as the dma-buf
+ * fds of its planes, which it reads in its own process without a copy. The
+ * buffer is pinned until the client gives the frame back, and the frame is
+ * skipped if the client still reads the frame before.
+ *
+ * @return 1 if the buffer is pinned by the client, 0 otherwise
+ */
+static unsigned int camera_export_buffer(struct camera *dev, const struct v4l2_buffer *buf)
+{
+	struct frame_dump_header	header;
+	struct iovec			planes[FRAME_DUMP_MAX_PLANES];
+	int				fds[FRAME_DUMP_MAX_PLANES];
+	unsigned int			idx		= 0;
+	unsigned int			is_pinned	= 0;
+	int				ret		= 0;
+
+	if (frame_export_get_fd(&dev->exporter) >= 0) {
+		ret = camera_get_dump_planes(dev, buf, &header, planes);
+		for (idx = 0; (ret == 0) && (idx < header.n_planes); idx++) {
+			fds[idx] = video_input_get_buffer_fd(&dev->vin, buf->index, idx);
+			if (fds[idx] < 0) {
+				/* the plane is not exported */
 				ret = -1;
 			}
+		}
+		if (ret == 0) {
+			ret = frame_export_send(&dev->exporter, &header, fds, header.n_planes,
+				buf->index);
+		}
+		if (ret == 0) {
+			/* read by the client */
+			is_pinned = 1;
+		}
+	}
 
-			if (ret == 0) {
-				/* error */
-				loge("Failed to write file to %s\n", fname);
-			} else {
-				/* pass */
-				logd("data (%d) is written\n", ret);
-			}
-			(void)close(fd);
+	return is_pinned;
+}
+
+/*
+ * The frame is rotated, and then converted stripe by stripe, by the cpu into
+ * the next of the display buffers, and that buffer is shown instead. The
+ * buffer of video-input is done with once the frame is written.
+ */
+static int camera_process_buffer(struct camera *dev, const struct v4l2_buffer *buf)
+{
+	struct frame_dump_header	header;
+	struct iovec			planes[FRAME_DUMP_MAX_PLANES];
+	struct colorconv_image		src;
+	const struct colorconv_image	*rotated	= NULL;
+	unsigned int			next		= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	ret = camera_get_dump_planes(dev, buf, &header, planes);
+	if (ret == 0) {
+		(void)memset((void *)&src, 0, sizeof(src));
+		for (idx = 0; (idx < header.n_planes) && (idx < COLORCONV_MAX_PLANES); idx++) {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			src.planes[idx]		= (uint8_t *)planes[idx].iov_base;
+			src.strides[idx]	= header.strides[idx];
 		}
 
-		dev->cnt_to_capture = dev->cnt_to_capture - 1;
-		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
-		/* coverity[misra_c_2012_rule_12_1_violation : FALSE] */
-		capture_idx = add_u32(capture_idx, 1);
+		next	= (dev->display_idx + 1U) % CAMERA_DISPLAY_BUFS;
+		rotated	= &src;
+		if (dev->rotate.n_planes > 0U) {
+			/* into the frame to convert, or to show */
+			rotated	= (dev->convert.src != NULL) ? &dev->rotate_image :
+				&dev->display_images[next];
+			ret	= frame_rotate_run(&dev->rotate, &src, rotated);
+		}
+		if ((ret == 0) && (dev->convert.src != NULL)) {
+			/* to show */
+			ret = colorconv_convert(&dev->convert, rotated, &dev->display_images[next]);
+		}
+		if (ret == 0) {
+			/* to be shown */
+			dev->display_idx = next;
+		}
 	}
+
+	return ret;
 }
 
 static int camera_show_buffer(const struct camera *dev,
@@ -1037,8 +1443,23 @@ static int camera_show_buffer(const struct camera *dev,
 
 	(void)memset((void *)&vout_buf, 0, sizeof(vout_buf));
 
-	vout_buf.width		= dev->preview_width;
-	vout_buf.height		= dev->preview_height;
+	if (dev->rotate.n_planes > 0U) {
+		/* rotated by the cpu */
+		vout_buf.width		= dev->rotate.dst_width;
+		vout_buf.height		= dev->rotate.dst_height;
+	} else {
+		vout_buf.width		= dev->preview_width;
+		vout_buf.height		= dev->preview_height;
+	}
+#if defined(USE_G2D)
+	if ((camera_is_rotated_by_g2d(dev) == 1U) &&
+	    ((dev->preview_rot == (unsigned int)ROTATE_90) ||
+	     (dev->preview_rot == (unsigned int)ROTATE_270))) {
+		/* transposed by G2D */
+		vout_buf.width		= dev->preview_height;
+		vout_buf.height		= dev->preview_width;
+	}
+#endif//defined(USE_G2D)
 	if ((vout_buf.width  <= (unsigned int)DISPLAY_SCREEN_WIDTH) &&
 	    (vout_buf.height <= (unsigned int)DISPLAY_SCREEN_HEIGHT)) {
 		/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
@@ -1049,24 +1470,44 @@ static int camera_show_buffer(const struct camera *dev,
 		vout_buf.posy		= (dev->preview_posy == -1)
 			? (int)(((unsigned int)DISPLAY_SCREEN_HEIGHT - vout_buf.height) / 2U)
 			: dev->preview_posy;
-		vout_buf.format		= dev->preview_format;
-		/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
-		/* coverity[cert_int36_c_violation : FALSE] */
-		/* coverity[pointer_conversion_loses_bits : FALSE] */
-		vout_buf.addrs[0]	= (unsigned int)vin->buffers[buf->index].paddrs[0].addr;
-		/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
-		/* coverity[cert_int36_c_violation : FALSE] */
-		/* coverity[pointer_conversion_loses_bits : FALSE] */
-		vout_buf.addrs[1]	= (unsigned int)vin->buffers[buf->index].paddrs[1].addr;
-		/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
-		/* coverity[cert_int36_c_violation : FALSE] */
-		/* coverity[pointer_conversion_loses_bits : FALSE] */
-		vout_buf.addrs[2]	= (unsigned int)vin->buffers[buf->index].paddrs[2].addr;
+		if (dev->display_mem.vaddr != NULL) {
+			/* the frame written by the cpu */
+			vout_buf.format		= (dev->convert.src != NULL) ?
+				dev->display_format : dev->preview_format;
+			vout_buf.addrs[0]	= dev->display_addrs[dev->display_idx][0];
+			vout_buf.addrs[1]	= dev->display_addrs[dev->display_idx][1];
+			vout_buf.addrs[2]	= dev->display_addrs[dev->display_idx][2];
+		} else {
+			vout_buf.format		= dev->preview_format;
+			/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+			/* coverity[cert_int36_c_violation : FALSE] */
+			/* coverity[pointer_conversion_loses_bits : FALSE] */
+			vout_buf.addrs[0]	= (unsigned int)vin->buffers[buf->index].paddrs[0].addr;
+			/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+			/* coverity[cert_int36_c_violation : FALSE] */
+			/* coverity[pointer_conversion_loses_bits : FALSE] */
+			vout_buf.addrs[1]	= (unsigned int)vin->buffers[buf->index].paddrs[1].addr;
+			/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+			/* coverity[cert_int36_c_violation : FALSE] */
+			/* coverity[pointer_conversion_loses_bits : FALSE] */
+			vout_buf.addrs[2]	= (unsigned int)vin->buffers[buf->index].paddrs[2].addr;
+		}
+#if defined(USE_G2D)
+		if (camera_is_rotated_by_g2d(dev) == 1U) {
+			/* the last frame rotated by G2D, in the format of its ring */
+			vout_buf.format		= dev->g2d.format;
+			vout_buf.addrs[0]	= g2d_get_plane_address(&dev->g2d, 0);
+			vout_buf.addrs[1]	= g2d_get_plane_address(&dev->g2d, 1);
+			vout_buf.addrs[2]	= g2d_get_plane_address(&dev->g2d, 2);
+		}
+#endif//defined(USE_G2D)
 
 		ret = video_output_preview_buffer(vout, &vout_buf);
 		if (ret < 0) {
 			loge("Failed on video_output_preview_buffer\n");
 			ret = -1;
+		} else {
+			latency_mark((unsigned int)LATENCY_FIRST_OVERLAY_QBUF);
 		}
 	} else {
 		/* error */
@@ -1110,16 +1551,10 @@ static void check_recovery(struct camera *dev, int vin_path_status)
 
 				loge("It will be recovered soon.\n");
 
-				ret = do_stop_preview(dev);
-				if (ret != 0) {
-					/* error */
-					loge("do_stop_preview, ret: %d\n", ret);
-				}
-
-				ret = do_start_preview(dev);
+				ret = restart_stream(dev);
 				if (ret != 0) {
 					/* error */
-					loge("do_start_preview, ret: %d\n", ret);
+					loge("restart_stream, ret: %d\n", ret);
 				}
 			}
 
@@ -1128,16 +1563,38 @@ static void check_recovery(struct camera *dev, int vin_path_status)
 	}
 }
 
+/*
+ * The stream is restarted from the recovery timer rather than here, as the
+ * buffer being handled is still to be requeued.
+ */
+static void check_frozen_feed(struct camera *dev, const struct frame_check_result *result)
+{
+	unsigned int			is_frozen	= 0;
+
+	if ((dev->frozen.window > 0U) && (result->luma_samples > 0U)) {
+		is_frozen = frame_check_update_freeze(&dev->frozen, result);
+		if (is_frozen == 1U) {
+			loge("The video-input feed is frozen for %u frames (events: %llu)\n",
+				dev->frozen.repeats, dev->frozen.events);
+			logk("> frozen feed");
+		}
+	}
+}
+
 static void check_buffer_and_set_flag(struct camera *dev,
 	const struct v4l2_buffer *buf)
 {
+	struct frame_check_result	result;
 	int				ret_chk		= 0;
 
-	ret_chk = camera_check_buffer(dev, buf);
+	ret_chk = camera_check_buffer(dev, buf, &result);
+	check_frozen_feed(dev, &result);
 	if (ret_chk < 0) {
 		/* result of rotation */
 		logd("camera_check_buffer, ret: %d\n", ret_chk);
 	} else {
+		latency_mark((unsigned int)LATENCY_BUFFER_CHECKED);
+
 		if (dev->initialized == 0U) {
 			/* the path is initialized to display */
 			dev->initialized = 1;
@@ -1161,38 +1618,159 @@ static void release_buffer(const struct camera *dev, struct v4l2_buffer *buf)
 	}
 }
 
-static void handle_initialized(struct camera *dev, const struct v4l2_buffer *buf)
+/* requeue the buffer once neither the frame writer, the ring nor the client reads it */
+static void camera_unpin_buffer(struct camera *dev, unsigned int index)
 {
+	struct video_input		*vin		= NULL;
+
+	vin		= &dev->vin;
+
+	if ((index < (unsigned int)NUM_VIDBUF) && (dev->pins[index] > 0U)) {
+		dev->pins[index] = dev->pins[index] - 1U;
+		if (dev->pins[index] > 0U) {
+			/* still read */
+			logd("buffer(%u) is still pinned\n", index);
+		} else if ((dev->status == MODE_PREVIEW_STARTED) ||
+			   (dev->status == MODE_PREVIEW_STANDBY)) {
+			/* back to video-input */
+			release_buffer(dev, &vin->buffers[index].v4l2_buf);
+		} else {
+			/* every buffer is queued again at the next start */
+			logd("buffer(%u) is unpinned after the stream is stopped\n", index);
+		}
+	}
+}
+
+/* requeue the buffers which the frame writer has written */
+static void handle_writer_event(struct camera *dev)
+{
+	unsigned int			index		= 0;
+
+	while (frame_writer_reap(&dev->writer, &index) == 1) {
+		/* written */
+		camera_unpin_buffer(dev, index);
+	}
+}
+
+/* requeue the buffers which the pre-trigger ring has copied */
+static void handle_ring_event(struct camera *dev)
+{
+	unsigned int			index		= 0;
+
+	while (frame_ring_reap(&dev->ring, &index) == 1) {
+		/* copied */
+		camera_unpin_buffer(dev, index);
+	}
+}
+
+/* watch the client which connects to take the exported frames */
+static void handle_export_listen_event(struct camera *dev)
+{
+	int				fd		= -1;
+
+	fd = frame_export_accept(&dev->exporter);
+	if ((fd >= 0) && (camera_add_event_source(dev, fd, (unsigned int)EVENT_SOURCE_EXPORT) < 0)) {
+		/* stop exporting, as the frames given back would never be requeued */
+		frame_export_stop(&dev->exporter);
+	}
+}
+
+/* requeue the buffer which the client of the exported frames has given back */
+static void handle_export_event(struct camera *dev)
+{
+	unsigned int			index		= 0;
+
+	while (frame_export_reap(&dev->exporter, &index) == 1) {
+		/* read */
+		camera_unpin_buffer(dev, index);
+	}
+}
+
+#if defined(USE_G2D)
+/* show the frame which G2D has rotated and requeue the buffer it is read from */
+static void handle_g2d_event(struct camera *dev)
+{
+	unsigned int			index		= 0;
+	int				ret		= 0;
+
+	ret = camera_reap_g2d(dev, &index);
+	if (ret != 0) {
+		if ((ret == 1) && (dev->status == MODE_PREVIEW_STARTED)) {
+			ret = camera_show_buffer(dev, &dev->vin.buffers[index].v4l2_buf);
+			if (ret < 0) {
+				/* result of show */
+				logw("camera_show_buffer, ret: %d\n", ret);
+			}
+		}
+		camera_unpin_buffer(dev, index);
+	}
+	if (dev->g2d.is_busy == 1U) {
+		/* not done yet */
+		(void)camera_watch_g2d(dev, EPOLL_CTL_MOD);
+	}
+}
+#endif//defined(USE_G2D)
+
+/* return 1 if the buffer is pinned to be written and must not be requeued */
+static unsigned int handle_initialized(struct camera *dev, const struct v4l2_buffer *buf)
+{
+	unsigned int			is_rotating	= 0;
+	unsigned int			is_pinned	= 0;
 	int				ret		= 0;
 
-	if (dev->initialized == 1U) {
+	/* frames are only requeued in standby */
+	if ((dev->initialized == 1U) && (dev->status == MODE_PREVIEW_STARTED)) {
 #if defined(USE_G2D)
-		ret = camera_rotate_buffer(dev, buf);
-		if (ret < 0) {
-			/* result of rotation */
-			logw("camera_rotate_buffer, ret: %d\n", ret);
+		is_rotating = camera_is_rotated_by_g2d(dev);
+		if (is_rotating == 1U) {
+			/* shown by handle_g2d_event() once rotated */
+			is_pinned = camera_rotate_buffer(dev, buf);
 		}
 #endif//defined(USE_G2D)
 
-		camera_save_buffer(dev, buf);
-		ret = camera_show_buffer(dev, buf);
-		if (ret < 0) {
-			/* result of show */
-			logw("camera_show_buffer, ret: %d\n", ret);
+		is_pinned += camera_save_buffer(dev, buf);
+		is_pinned += camera_export_buffer(dev, buf);
+		if (dev->display_mem.vaddr != NULL) {
+			ret = camera_process_buffer(dev, buf);
+			if (ret < 0) {
+				/* the frame before is shown again */
+				logw("camera_process_buffer, ret: %d\n", ret);
+			}
+		}
+		if (is_rotating == 0U) {
+			ret = camera_show_buffer(dev, buf);
+			if (ret < 0) {
+				/* result of show */
+				logw("camera_show_buffer, ret: %d\n", ret);
+			}
 		}
 	}
+
+	return is_pinned;
 }
 
 static void release_preview_buffer(struct camera *dev,
 	struct v4l2_buffer *buf, struct buffer_t *fentry)
 {
+	unsigned int			pins		= 0;
+
 	list_del(&fentry->list);
 
+	/* the frames done in this wakeup are reaped not to skip this one */
+	handle_writer_event(dev);
+	handle_ring_event(dev);
+
 	buf = &fentry->v4l2_buf;
 	check_buffer_and_set_flag(dev, buf);
-	handle_initialized(dev, buf);
-
-	release_buffer(dev, buf);
+	pins = handle_initialized(dev, buf);
+	pins += camera_keep_buffer(dev, buf);
+	if (pins == 0U) {
+		/* requeue */
+		release_buffer(dev, buf);
+	} else {
+		/* requeued when the last of them is done with it */
+		dev->pins[buf->index] = pins;
+	}
 }
 
 static void handle_preview_buffer(struct camera *dev, int *vin_path_status)
@@ -1207,6 +1785,7 @@ static void handle_preview_buffer(struct camera *dev, int *vin_path_status)
 	ret = video_input_dqbuf(vin, &buf);
 	if (ret == 0) {
 		*vin_path_status = 1;
+		latency_mark((unsigned int)LATENCY_FIRST_DQBUF);
 
 		vin->buffers[buf.index].v4l2_buf = buf;
 		INIT_LIST_HEAD(&vin->buffers[buf.index].list);
@@ -1240,28 +1819,107 @@ static void handle_preview_buffer(struct camera *dev, int *vin_path_status)
 	}
 }
 
-static void camera_preview_buffer(struct camera *dev)
+static void handle_capture_event(struct camera *dev, unsigned int events)
 {
-	const struct video_input	*vin		= NULL;
-	int				pollin		= 0;
 	int				vin_path_status	= 0;
 
-	vin		= &dev->vin;
-
-	pollin = video_input_poll(vin);
-	if (pollin != 1) {
-		/* error */
-		logd("video_input_poll, ret: %d\n", pollin);
-	} else {
+	if ((events & (unsigned int)EPOLLIN) != 0U) {
 		/* handle buffer */
 		handle_preview_buffer(dev, &vin_path_status);
+		if (vin_path_status == 1) {
+			/* the recovery timer checks this flag */
+			dev->is_frame_received = 1;
+		}
+	} else if ((events & ((unsigned int)EPOLLERR | (unsigned int)EPOLLHUP)) != 0U) {
+		/*
+		 * stop watching the capture fd not to spin on the error, so the
+		 * restart of the stream watches it again. The recovery timer,
+		 * which restarts the video-input path, is kept armed.
+		 */
+		loge("capture events: 0x%08x\n", events);
+		camera_watch_capture(dev, 0U);
+		(void)camera_arm_recovery_timer(dev, 1U);
+	} else {
+		/* nothing to handle */
+		logd("capture events: 0x%08x\n", events);
 	}
+}
 
-	check_recovery(dev, vin_path_status);
+static void handle_timer_event(struct camera *dev)
+{
+	uint64_t			expirations	= 0;
+	int				vin_path_status	= 0;
+
+	if (read(dev->timer_fd, &expirations, sizeof(expirations)) < 0) {
+		/* spurious wakeup */
+		logd("read(timer_fd), errno: %d\n", errno);
+	} else if ((dev->status == MODE_PREVIEW_STARTED) ||
+		   (dev->status == MODE_PREVIEW_STANDBY)) {
+#if defined(USE_G2D)
+		/* the job of G2D which is never done is given up */
+		handle_g2d_event(dev);
+#endif//defined(USE_G2D)
+		vin_path_status = (dev->is_frame_received == 1U) ? 1 : 0;
+		dev->is_frame_received = 0;
+
+		if ((dev->frozen.is_frozen == 1U) && (dev->frozen_recovery == 1U)) {
+			loge("The frozen video-input feed will be recovered soon.\n");
+			if (restart_stream(dev) != 0) {
+				/* error */
+				loge("restart_stream for the frozen feed\n");
+			}
+		} else {
+			check_recovery(dev, vin_path_status);
+		}
+	} else {
+		/* preview is not running */
+		logd("timer expired: %llu\n", (unsigned long long)expirations);
+	}
+}
+
+/*
+ * G2D rotates the frames of every format from the start of its pmap, so it
+ * is timed only while the preview is not shown from the pmap, and it is
+ * done on the event loop not to race with the rotation of the preview. The
+ * passes of the job of the preview need no hardware, so they are dumped in
+ * any case.
+ */
+static int do_bench_g2d(struct camera *dev)
+{
+#if defined(USE_G2D)
+	struct g2d_job			job;
+#endif//defined(USE_G2D)
+	int				ret		= 0;
+
+#if defined(USE_G2D)
+	camera_get_g2d_job(dev, &job);
+	if (g2d_dump_plans(G2D_PLAN_PATH, &job) < 0) {
+		/* the bench is dumped anyway */
+		logw("g2d_dump_plans(%s) failed\n", G2D_PLAN_PATH);
+	}
+
+	if (dev->status == MODE_PREVIEW_STARTED) {
+		logw("G2D is timed only while preview is stopped\n");
+		ret = -1;
+	} else if (g2d_is_available(&dev->g2d) < 0) {
+		logw("G2D is not available\n");
+		ret = -1;
+	} else {
+		ret = g2d_dump_bench(&dev->g2d, G2D_BENCH_PATH,
+			dev->preview_width, dev->preview_height);
+	}
+#else
+	(void)dev;
+	logw("G2D is not built in\n");
+	ret = -1;
+#endif//defined(USE_G2D)
+
+	return ret;
 }
 
 static int handle_a_message(struct camera *dev, struct message *msg)
 {
+	uint64_t			start_ns	= 0;
 	int				ret		= 0;
 
 	if (message_queue_is_empty(&dev->msger.cmd) != 1) {
@@ -1275,11 +1933,16 @@ static int handle_a_message(struct camera *dev, struct message *msg)
 			logk("> after do_handover");
 			break;
 		case (unsigned int)CAMERA_CMD_START_PREVIEW:
+			latency_mark((unsigned int)LATENCY_COMMAND_DEQUEUED);
 			logk("> before do_start_preview");
+			start_ns = latency_get_time_ns();
 			ret = do_start_preview(dev);
 			if (ret != 0) {
 				/* error */
 				loge("do_start_preview, ret: %d\n", ret);
+			} else {
+				/* dumped by the 'latency' command */
+				latency_add_span((unsigned int)LATENCY_SPAN_START_PREVIEW, start_ns);
 			}
 			logk("> after do_start_preview");
 			break;
@@ -1292,6 +1955,22 @@ static int handle_a_message(struct camera *dev, struct message *msg)
 			}
 			logk("> after do_stop_preview");
 			break;
+		case (unsigned int)CAMERA_CMD_START_RECORD:
+			ret = frame_ring_trigger(&dev->ring, FRAME_RING_TRIGGER_START);
+			break;
+		case (unsigned int)CAMERA_CMD_STOP_RECORD:
+			ret = frame_ring_trigger(&dev->ring, FRAME_RING_TRIGGER_STOP);
+			break;
+		case (unsigned int)CAMERA_CMD_SNAPSHOT_RECORD:
+			ret = frame_ring_trigger(&dev->ring, FRAME_RING_TRIGGER_SNAPSHOT);
+			break;
+		case (unsigned int)CAMERA_CMD_BENCH_G2D:
+			ret = do_bench_g2d(dev);
+			break;
+		case (unsigned int)CAMERA_CMD_KILL:
+			/* leave the event loop after sending ack */
+			dev->is_message_handle_thread_enabled = 0;
+			break;
 		default:
 			logd("Nothing to handle ioctl cmd\n");
 			break;
@@ -1308,25 +1987,63 @@ static int handle_a_message(struct camera *dev, struct message *msg)
 static void *threadMessageHandle(void *param)
 {
 	struct camera			*dev		= NULL;
-	const struct video_input	*vin		= NULL;
+	struct epoll_event		events[MAX_EPOLL_EVENTS];
 	struct message			msg		= { 0, };
-	int				ret		= 0;
+	int				nevents		= 0;
+	int				idx		= 0;
 
 	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
 	dev	= (struct camera *)param;
-	vin	= &dev->vin;
 
 	while (dev->is_message_handle_thread_enabled == 1) {
-		(void)memset((void *)&msg, 0, sizeof(msg));
-
-		ret = handle_a_message(dev, &msg);
-
-		if (dev->status == MODE_PREVIEW_STARTED) {
-			/* buffer switch */
-			camera_preview_buffer(dev);
+		/* sleep until a frame, a command or the recovery timer is ready */
+		nevents = epoll_wait(dev->epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+		if (nevents < 0) {
+			if (errno != EINTR) {
+				/* error */
+				loge("epoll_wait, errno: %d\n", errno);
+			}
+			continue;
 		}
 
-		(void)usleep(16 * 1000);
+		for (idx = 0; idx < nevents; idx++) {
+			switch (events[idx].data.u32) {
+			case (unsigned int)EVENT_SOURCE_COMMAND:
+				(void)memset((void *)&msg, 0, sizeof(msg));
+				(void)handle_a_message(dev, &msg);
+				break;
+			case (unsigned int)EVENT_SOURCE_CAPTURE:
+				if ((dev->status == MODE_PREVIEW_STARTED) ||
+				    (dev->status == MODE_PREVIEW_STANDBY)) {
+					/* buffer switch */
+					handle_capture_event(dev, events[idx].events);
+				}
+				break;
+			case (unsigned int)EVENT_SOURCE_TIMER:
+				handle_timer_event(dev);
+				break;
+			case (unsigned int)EVENT_SOURCE_WRITER:
+				handle_writer_event(dev);
+				break;
+			case (unsigned int)EVENT_SOURCE_RING:
+				handle_ring_event(dev);
+				break;
+			case (unsigned int)EVENT_SOURCE_EXPORT_LISTEN:
+				handle_export_listen_event(dev);
+				break;
+			case (unsigned int)EVENT_SOURCE_EXPORT:
+				handle_export_event(dev);
+				break;
+#if defined(USE_G2D)
+			case (unsigned int)EVENT_SOURCE_G2D:
+				handle_g2d_event(dev);
+				break;
+#endif//defined(USE_G2D)
+			default:
+				loge("event source(%u) is wrong\n", events[idx].data.u32);
+				break;
+			}
+		}
 	}
 
 	return (void *)NULL;
@@ -1394,15 +2111,423 @@ int camera_stop_preview(const struct camera *dev)
 	return ret;
 }
 
+/**
+ * @brief Request to start or stop preview without waiting for the ack
+ *
+ * The ack is put into the ack queue, which can be waited on with the fd of
+ * camera_get_ack_fd() and received with camera_receive_acks().
+ *
+ * @param dev camera device instance
+ * @param show 1 to start preview, 0 to stop preview
+ * @return 0 if the command is queued
+ */
+int camera_request_preview(const struct camera *dev, unsigned int show)
+{
+	struct message			msg		= { 0, };
+	int				ret		= 0;
+
+	if (dev->is_message_handle_thread_enabled == 0) {
+		loge("Message Handling Thread is NOT active.");
+		ret = -1;
+	} else {
+		(void)memset((void *)&msg, 0, sizeof(msg));
+
+		msg.command = (show == 1U) ?
+			(unsigned int)CAMERA_CMD_START_PREVIEW : (unsigned int)CAMERA_CMD_STOP_PREVIEW;
+
+		if (show == 1U) {
+			/* marked before the camera thread can dequeue it */
+			latency_mark((unsigned int)LATENCY_COMMAND_ENQUEUED);
+		}
+		ret = message_queue_put(&dev->msger.cmd, &msg);
+		logd("tx command: 0x%08x, ret: %d\n", msg.command, ret);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Request to persist the frames of the pre-trigger ring
+ *
+ * The frames are persisted by the ring in the background, and the ack is
+ * put into the ack queue as soon as the ring is triggered.
+ *
+ * @param dev camera device instance
+ * @param trigger to take a snapshot, or to start or stop recording
+ * @return 0 if the command is queued
+ */
+int camera_request_record(const struct camera *dev, enum frame_ring_trigger trigger)
+{
+	struct message			msg		= { 0, };
+	int				ret		= 0;
+
+	if (dev->is_message_handle_thread_enabled == 0) {
+		loge("Message Handling Thread is NOT active.");
+		ret = -1;
+	} else {
+		(void)memset((void *)&msg, 0, sizeof(msg));
+
+		switch (trigger) {
+		case FRAME_RING_TRIGGER_START:
+			msg.command = (unsigned int)CAMERA_CMD_START_RECORD;
+			break;
+		case FRAME_RING_TRIGGER_STOP:
+			msg.command = (unsigned int)CAMERA_CMD_STOP_RECORD;
+			break;
+		default:
+			msg.command = (unsigned int)CAMERA_CMD_SNAPSHOT_RECORD;
+			break;
+		}
+
+		ret = message_queue_put(&dev->msger.cmd, &msg);
+		logd("tx command: 0x%08x, ret: %d\n", msg.command, ret);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Request the camera thread to dump the latency and the bandwidth of G2D
+ *
+ * The passes of the job of the preview between every two formats are dumped
+ * into G2D_PLAN_PATH along with them.
+ *
+ * @return 0 if the command is queued
+ */
+int camera_request_g2d_bench(const struct camera *dev)
+{
+	struct message			msg		= { 0, };
+	int				ret		= 0;
+
+	if (dev->is_message_handle_thread_enabled == 0) {
+		loge("Message Handling Thread is NOT active.");
+		ret = -1;
+	} else {
+		(void)memset((void *)&msg, 0, sizeof(msg));
+		msg.command = (unsigned int)CAMERA_CMD_BENCH_G2D;
+
+		ret = message_queue_put(&dev->msger.cmd, &msg);
+		logd("tx command: 0x%08x, ret: %d\n", msg.command, ret);
+	}
+
+	return ret;
+}
+
+int camera_get_ack_fd(const struct camera *dev)
+{
+	return message_queue_get_fd(&dev->msger.ack);
+}
+
+/* return the acks of the preview requests, the acks of the others are only drained */
+int camera_receive_acks(const struct camera *dev)
+{
+	struct message			msg		= { 0, };
+	int				ret		= 0;
+
+	while (message_queue_is_empty(&dev->msger.ack) != 1) {
+		(void)message_queue_get(&dev->msger.ack, &msg);
+		logd("rx command: 0x%08x\n", msg.command);
+		if (((msg.command & 0x7fffffffU) == (unsigned int)CAMERA_CMD_START_PREVIEW) ||
+		    ((msg.command & 0x7fffffffU) == (unsigned int)CAMERA_CMD_STOP_PREVIEW)) {
+			/* preview */
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+static int camera_create_event_loop(struct camera *dev)
+{
+	int				ret		= 0;
+
+	dev->is_capture_watched	= 0;
+
+	dev->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	dev->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if ((dev->epoll_fd < 0) || (dev->timer_fd < 0)) {
+		loge("epoll_fd: %d, timer_fd: %d\n", dev->epoll_fd, dev->timer_fd);
+		ret = -1;
+	} else if ((camera_add_event_source(dev, message_queue_get_fd(&dev->msger.cmd),
+			(unsigned int)EVENT_SOURCE_COMMAND) < 0) ||
+		   (camera_add_event_source(dev, dev->timer_fd,
+			(unsigned int)EVENT_SOURCE_TIMER) < 0)) {
+		loge("Failed to add event sources\n");
+		ret = -1;
+	} else {
+		/* pass */
+		logd("epoll_fd: %d, timer_fd: %d\n", dev->epoll_fd, dev->timer_fd);
+	}
+
+	return ret;
+}
+
+static void camera_destroy_event_loop(struct camera *dev)
+{
+	if (dev->timer_fd >= 0) {
+		/* close */
+		(void)close(dev->timer_fd);
+		dev->timer_fd = -1;
+	}
+
+	if (dev->epoll_fd >= 0) {
+		/* close */
+		(void)close(dev->epoll_fd);
+		dev->epoll_fd = -1;
+	}
+}
+
+static void camera_stop_display(struct camera *dev)
+{
+	colorconv_deinit(&dev->convert);
+	frame_arena_destroy(&dev->rotate_arena);
+	pmap_memory_unmap(&dev->display_mem);
+
+	(void)memset((void *)&dev->rotate, 0, sizeof(dev->rotate));
+	(void)memset((void *)&dev->rotate_arena, 0, sizeof(dev->rotate_arena));
+}
+
+/* preview_rot in degrees, which is kept as the rotation of G2D with it */
+static unsigned int camera_get_preview_angle(const struct camera *dev)
+{
+	unsigned int			ret		= dev->preview_rot;
+
+#if defined(USE_G2D)
+	switch (dev->preview_rot) {
+	case (unsigned int)ROTATE_90:
+		ret = 90;
+		break;
+	case (unsigned int)ROTATE_180:
+		ret = 180;
+		break;
+	case (unsigned int)ROTATE_270:
+		ret = 270;
+		break;
+	default:
+		ret = 0;
+		break;
+	}
+#endif//defined(USE_G2D)
+
+	return ret;
+}
+
+/*
+ * 1 if the frames are to be rotated or mirrored, which G2D does not, or
+ * rotated and converted by more than a single pass of G2D
+ */
+static unsigned int camera_is_rotated_by_cpu(struct camera *dev)
+{
+	unsigned int			ret		= 0;
+
+	if ((camera_get_preview_angle(dev) != 0U) ||
+	    (dev->preview_mirror != (unsigned int)FRAME_ROTATE_MIRROR_NONE)) {
+		ret = 1;
+#if defined(USE_G2D)
+		if ((dev->preview_mirror == (unsigned int)FRAME_ROTATE_MIRROR_NONE) &&
+		    (camera_is_fused_by_g2d(dev) == 1U) && (g2d_is_available(&dev->g2d) == 0)) {
+			/* rotated and converted by G2D */
+			ret = 0;
+		}
+#endif//defined(USE_G2D)
+	}
+
+	return ret;
+}
+
+/* the rotated frame is kept in a frame of its own to be converted */
+static int camera_start_rotate(struct camera *dev, unsigned int is_converted)
+{
+	size_t				size		= 0;
+	uint8_t				*base		= NULL;
+	int				ret		= 0;
+
+	ret = frame_rotate_init(&dev->rotate, dev->preview_format,
+		dev->preview_width, dev->preview_height, camera_get_preview_angle(dev),
+		(enum frame_rotate_mirror)dev->preview_mirror);
+	if ((ret == 0) && (is_converted == 1U)) {
+		size = (size_t)v4l2_get_v4l2_sizeimage(dev->preview_format,
+			dev->rotate.dst_width, dev->rotate.dst_height);
+		ret = frame_arena_create(&dev->rotate_arena, frame_arena_align(size), 0U);
+		if (ret == 0) {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			base = (uint8_t *)frame_arena_alloc(&dev->rotate_arena, size);
+			ret = (base == NULL) ? -1 : colorconv_init_image(&dev->rotate_image,
+				dev->preview_format, dev->rotate.dst_width, dev->rotate.dst_height, base);
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * The frames are rotated and mirrored by the cpu if G2D does not, and
+ * converted if video-output is to show another format than the one captured.
+ * The frames are written into the pmap for video-output to read them by
+ * their physical addresses.
+ */
+static int camera_start_display(struct camera *dev, unsigned int is_rotated,
+	unsigned int is_converted)
+{
+	size_t				size		= 0;
+	unsigned int			format		= 0;
+	unsigned int			width		= 0;
+	unsigned int			height		= 0;
+	unsigned int			n_planes	= 0;
+	unsigned int			idx		= 0;
+	unsigned int			plane		= 0;
+	uint8_t				*base		= NULL;
+	int				ret		= 0;
+
+	format	= (is_converted == 1U) ? dev->display_format : dev->preview_format;
+	width	= dev->preview_width;
+	height	= dev->preview_height;
+
+	if (is_rotated == 1U) {
+		ret = camera_start_rotate(dev, is_converted);
+		width	= dev->rotate.dst_width;
+		height	= dev->rotate.dst_height;
+	}
+	if ((ret == 0) && (is_converted == 1U)) {
+		ret = colorconv_init(&dev->convert, dev->preview_format, dev->display_format,
+			width, height, (enum colorconv_matrix)dev->color_matrix,
+			(enum colorconv_range)dev->color_range);
+	}
+
+	size = (size_t)v4l2_get_v4l2_sizeimage(format, width, height);
+	n_planes = v4l2_get_planes_by_v4l2_format(format);
+	if (ret == 0) {
+		/* the buffers one after another */
+		ret = pmap_memory_map(&dev->display_mem, CAMERA_DISPLAY_PMAP,
+			size * CAMERA_DISPLAY_BUFS);
+	}
+
+	for (idx = 0; (ret == 0) && (idx < CAMERA_DISPLAY_BUFS); idx++) {
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		base = &((uint8_t *)dev->display_mem.vaddr)[size * idx];
+		ret = colorconv_init_image(&dev->display_images[idx], format, width, height, base);
+		for (plane = 0; (ret == 0) && (plane < n_planes) &&
+				(plane < COLORCONV_MAX_PLANES); plane++) {
+			/* coverity[misra_c_2012_rule_18_2_violation : FALSE] */
+			dev->display_addrs[idx][plane] = dev->display_mem.paddr + (uint32_t)(size * idx) +
+				(uint32_t)(dev->display_images[idx].planes[plane] - base);
+		}
+	}
+
+	if (ret < 0) {
+		loge("Failed to rotate %u degrees or convert %s into %s, "
+			"the frames are shown as captured\n", camera_get_preview_angle(dev),
+			v4l2_get_format_name_by_v4l2_format(dev->preview_format),
+			v4l2_get_format_name_by_v4l2_format(format));
+		camera_stop_display(dev);
+	}
+	dev->display_idx = 0;
+
+	return ret;
+}
+
 int camera_create_camera_thread(struct camera *dev)
 {
+	unsigned int			is_rotated	= 0;
+	unsigned int			is_converted	= 0;
 	int				ret		= 0;
 
-	dev->is_message_handle_thread_enabled = 1;
-	ret = pthread_create(&dev->message_handle_thread, NULL, &threadMessageHandle, (void *)dev);
+	if (dev->cnt_to_capture > 0) {
+		/*
+		 * the frames to capture are written by the frame writer from the
+		 * buffers of video-input, so only one is pinned at a time not to
+		 * starve the capture
+		 */
+		if (dev->capture_record == 1U) {
+			/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
+			ret = frame_writer_start_record(&dev->writer, 1U, "video_capture.rec",
+				(unsigned int)dev->cnt_to_capture);
+		} else {
+			ret = frame_writer_start(&dev->writer, 1U);
+		}
+		if (ret < 0) {
+			loge("frame_writer_start, ret: %d\n", ret);
+			dev->cnt_to_capture = 0;
+		}
+	}
+
+	if (dev->record_budget_mb > 0U) {
+		/* the frames are kept in the ring to be persisted on the record commands */
+		ret = frame_ring_start(&dev->ring, (size_t)dev->record_budget_mb * 1024U * 1024U,
+			(size_t)v4l2_get_v4l2_sizeimage(dev->preview_format,
+				dev->preview_width, dev->preview_height),
+			dev->record_preroll_ms * dev->vin.framerate / 1000U,
+			dev->record_postroll_ms * dev->vin.framerate / 1000U);
+		if (ret < 0) {
+			/* the record commands fail */
+			loge("frame_ring_start, ret: %d\n", ret);
+		}
+	}
+
+	if (dev->export_frames == 1U) {
+		if (dev->vin.io_mode != (unsigned int)V4L2_MEMORY_DMABUF) {
+			/* only the buffers exported as dma-buf can be handed over */
+			logw("the frames are exported only with the dmabuf io-mode\n");
+		} else {
+			ret = frame_export_start(&dev->exporter, FRAME_EXPORT_PATH);
+			if (ret < 0) {
+				/* nobody can take the frames */
+				loge("frame_export_start, ret: %d\n", ret);
+			}
+		}
+	}
+
+	is_converted	= ((dev->display_format != 0U) &&
+		(dev->display_format != dev->preview_format)) ? 1U : 0U;
+	is_rotated	= camera_is_rotated_by_cpu(dev);
+#if defined(USE_G2D)
+	if ((is_rotated == 0U) && (camera_get_preview_angle(dev) != 0U)) {
+		/* converted by the job of G2D which rotates the frames */
+		is_converted = 0;
+	}
+#endif//defined(USE_G2D)
+	if ((is_rotated == 1U) || (is_converted == 1U)) {
+		ret = camera_start_display(dev, is_rotated, is_converted);
+		if (ret < 0) {
+			/* shown as captured */
+			logw("camera_start_display, ret: %d\n", ret);
+		}
+	}
+
+	ret = camera_create_event_loop(dev);
+	if ((ret == 0) && (dev->writer.is_started == 1U)) {
+		/* the written buffers are requeued by the event loop */
+		ret = camera_add_event_source(dev, frame_writer_get_fd(&dev->writer),
+			(unsigned int)EVENT_SOURCE_WRITER);
+	}
+	if ((ret == 0) && (dev->ring.is_started == 1U)) {
+		/* so are the copied buffers */
+		ret = camera_add_event_source(dev, frame_ring_get_fd(&dev->ring),
+			(unsigned int)EVENT_SOURCE_RING);
+	}
+	if ((ret == 0) && (dev->exporter.is_started == 1U)) {
+		/* and so are the frames the client gives back */
+		ret = camera_add_event_source(dev, frame_export_get_fd(&dev->exporter),
+			(unsigned int)EVENT_SOURCE_EXPORT_LISTEN);
+	}
+#if defined(USE_G2D)
+	if ((ret == 0) && (g2d_is_available(&dev->g2d) == 0)) {
+		/* the rotated frames are shown by the event loop */
+		ret = camera_watch_g2d(dev, EPOLL_CTL_ADD);
+	}
+#endif//defined(USE_G2D)
 	if (ret < 0) {
-		loge("pthread_create, ret: %d\n", ret);
-		ret = -1;
+		loge("camera_create_event_loop, ret: %d\n", ret);
+		camera_destroy_event_loop(dev);
+	} else {
+		dev->is_message_handle_thread_enabled = 1;
+		ret = pthread_create(&dev->message_handle_thread, NULL, &threadMessageHandle, (void *)dev);
+		if (ret != 0) {
+			loge("pthread_create, ret: %d\n", ret);
+			dev->is_message_handle_thread_enabled = 0;
+			ret = -1;
+		}
 	}
 
 	return ret;
@@ -1412,12 +2537,27 @@ int camera_destroy_camera_thread(struct camera *dev)
 {
 	int				ret		= 0;
 
-	dev->is_message_handle_thread_enabled = 0;
-	ret = pthread_join(dev->message_handle_thread, NULL);
-	if (ret != 0) {
-		loge("pthread_join, ret: %d\n", ret);
-		ret = -1;
+	if (dev->is_message_handle_thread_enabled == 1) {
+		/* wake up the event loop to terminate */
+		ret = message_queue_put_and_get_msg(dev, (unsigned int)CAMERA_CMD_KILL);
+		if (ret != 0) {
+			logd("message_queue_put_and_get_msg, ret: %d\n", ret);
+		}
+
+		ret = pthread_join(dev->message_handle_thread, NULL);
+		if (ret != 0) {
+			loge("pthread_join, ret: %d\n", ret);
+			ret = -1;
+		}
 	}
 
+	/* after the last frame to capture is queued */
+	frame_writer_stop(&dev->writer);
+	frame_ring_stop(&dev->ring);
+	frame_export_stop(&dev->exporter);
+	camera_stop_display(dev);
+
+	camera_destroy_event_loop(dev);
+
 	return ret;
 }
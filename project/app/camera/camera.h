@@ -13,6 +13,13 @@
 #include "switch.h"
 #include "video_input.h"
 #include "video_output.h"
+#include "frame_check.h"
+#include "frame_writer.h"
+#include "frame_ring.h"
+#include "frame_export.h"
+#include "colorconv.h"
+#include "frame_rotate.h"
+#include "pmap_memory.h"
 
 //#define USE_G2D
 #if defined(USE_G2D)
@@ -40,11 +47,21 @@
 #define MAX_LIMIT_WIDTH			(16384)
 #define MAX_LIMIT_HEIGHT		(16384)
 
+/*
+ * the frames rotated or converted by the cpu are shown in turn: one shown,
+ * one queued and one written
+ */
+#define CAMERA_DISPLAY_BUFS		(3U)
+/* the pmap they are written into, the one G2D rotates into */
+#define CAMERA_DISPLAY_PMAP		("overlay_rot")
+
 enum operation_status {
 	MODE_INITIALIZED		= 0,
 	MODE_PREVIEW_STARTED,
 	MODE_PREVIEW_STOPPED,
-	MODE_CAPTURE
+	MODE_CAPTURE,
+	/* streaming with the video-output hidden */
+	MODE_PREVIEW_STANDBY
 };
 
 enum {
@@ -63,6 +80,14 @@ struct camera {
 	/* 0: v4l2, 1: direct display */
 	unsigned int			preview_method;
 	unsigned int			preview_rot;
+	/* 0: none, 1: horizontal, 2: vertical, applied after the rotation */
+	unsigned int			preview_mirror;
+	/* format shown by video-output, 0 to show preview_format as captured */
+	unsigned int			display_format;
+	/* 0: BT.601, 1: BT.709 */
+	unsigned int			color_matrix;
+	/* 0: limited range, 1: full range */
+	unsigned int			color_range;
 	/* 0: normal preview, 1: unit test */
 	int				application_mode;
 
@@ -81,6 +106,13 @@ struct camera {
 
 	int				recovery;
 
+	/* frames repeating the same content, and 1 to restart the stream on it */
+	struct frame_freeze		frozen;
+	unsigned int			frozen_recovery;
+
+	/* 0: stop streaming when preview stops, 1: keep streaming hidden */
+	unsigned int			standby;
+
 	int				use_cm4;
 #if defined(CM4_MANAGER_SUPPORT)
 	struct cm4_manager              cm4mgr;
@@ -93,11 +125,47 @@ struct camera {
 
 	/* the number of frames to capture */
 	int				cnt_to_capture;
+	/* 1 to record the frames to capture into one file instead of a file each */
+	unsigned int			capture_record;
+	struct frame_writer		writer;
+
+	/* memory of the pre-trigger ring, 0 to disable the record commands */
+	unsigned int			record_budget_mb;
+	unsigned int			record_preroll_ms;
+	unsigned int			record_postroll_ms;
+	struct frame_ring		ring;
+
+	/* 1 to hand the frames to a client as dma-buf fds, with the dmabuf io-mode */
+	unsigned int			export_frames;
+	struct frame_export		exporter;
+
+	/*
+	 * the frames rotated if G2D does not, and converted into display_format,
+	 * by the cpu to be shown
+	 */
+	struct frame_rotate		rotate;
+	struct colorconv		convert;
+	/* the rotated frame to be converted */
+	struct frame_arena		rotate_arena;
+	struct colorconv_image		rotate_image;
+	struct pmap_memory		display_mem;
+	struct colorconv_image		display_images[CAMERA_DISPLAY_BUFS];
+	unsigned int			display_addrs[CAMERA_DISPLAY_BUFS][COLORCONV_MAX_PLANES];
+	unsigned int			display_idx;
+
+	/* the frame writer, the ring and the client of the exported frames which still read a buffer */
+	unsigned int			pins[NUM_VIDBUF];
 
 	struct messenger		msger;
 
 	pthread_t			message_handle_thread;
 	int				is_message_handle_thread_enabled;
+
+	/* event loop of the message handling thread */
+	int				epoll_fd;
+	int				timer_fd;
+	unsigned int			is_capture_watched;
+	unsigned int			is_frame_received;
 };
 
 extern void camera_init_parameters(struct camera *dev);
@@ -107,6 +175,11 @@ extern void camera_close_devices(const struct camera *dev);
 extern int camera_handover(const struct camera *dev);
 extern int camera_start_preview(const struct camera *dev);
 extern int camera_stop_preview(const struct camera *dev);
+extern int camera_request_preview(const struct camera *dev, unsigned int show);
+extern int camera_request_record(const struct camera *dev, enum frame_ring_trigger trigger);
+extern int camera_request_g2d_bench(const struct camera *dev);
+extern int camera_get_ack_fd(const struct camera *dev);
+extern int camera_receive_acks(const struct camera *dev);
 extern int camera_create_camera_thread(struct camera *dev);
 extern int camera_destroy_camera_thread(struct camera *dev);
 
@@ -70,9 +70,9 @@ static inline int s64_to_s32(long val)
 {
 	/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 	/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
-	return ((val < INT_MAX) && (val >= INT_MIN))
-		? 0
-		: (int)val;
+	return ((val <= INT_MAX) && (val >= INT_MIN))
+		? (int)val
+		: 0;
 }
 
 static inline unsigned int u64_to_u32(unsigned long val)
@@ -0,0 +1,836 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "log.h"
+#include "v4l2.h"
+#include "frame_dump.h"
+#include "colorconv.h"
+#include "colorconv_kernels.h"
+#include "latency.h"
+
+/* each conversion is timed over this many frames after one to warm up */
+#define COLORCONV_BENCH_FRAMES		(4U)
+
+/* coverity[misra_c_2012_rule_9_3_violation : FALSE] */
+static const struct colorconv_format colorconv_formats[V4L2_PIXEL_FORMAT_MAX] = {
+	[V4L2_PIXEL_FORMAT_RGB24] = {
+		.fourcc		= V4L2_PIX_FMT_RGB24,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_RGB,
+		.bpp		= 3,
+	},
+	[V4L2_PIXEL_FORMAT_RGB32] = {
+		.fourcc		= V4L2_PIX_FMT_RGB32,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_RGB,
+		.bpp		= 4,
+	},
+	[V4L2_PIXEL_FORMAT_UYVY] = {
+		.fourcc		= V4L2_PIX_FMT_UYVY,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PACKED,
+		.y_offset	= 1,
+	},
+	[V4L2_PIXEL_FORMAT_VYUY] = {
+		.fourcc		= V4L2_PIX_FMT_VYUY,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PACKED,
+		.y_offset	= 1,
+		.is_vu		= 1,
+	},
+	[V4L2_PIXEL_FORMAT_YUYV] = {
+		.fourcc		= V4L2_PIX_FMT_YUYV,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PACKED,
+	},
+	[V4L2_PIXEL_FORMAT_YVYU] = {
+		.fourcc		= V4L2_PIX_FMT_YVYU,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PACKED,
+		.is_vu		= 1,
+	},
+	[V4L2_PIXEL_FORMAT_YVU420] = {
+		.fourcc		= V4L2_PIX_FMT_YVU420,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PLANAR,
+		.is_420		= 1,
+		.is_vu		= 1,
+	},
+	[V4L2_PIXEL_FORMAT_YUV420] = {
+		.fourcc		= V4L2_PIX_FMT_YUV420,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PLANAR,
+		.is_420		= 1,
+	},
+	[V4L2_PIXEL_FORMAT_YUV422P] = {
+		.fourcc		= V4L2_PIX_FMT_YUV422P,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_PLANAR,
+	},
+	[V4L2_PIXEL_FORMAT_NV12] = {
+		.fourcc		= V4L2_PIX_FMT_NV12,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_SEMI_PLANAR,
+		.is_420		= 1,
+	},
+	[V4L2_PIXEL_FORMAT_NV21] = {
+		.fourcc		= V4L2_PIX_FMT_NV21,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_SEMI_PLANAR,
+		.is_420		= 1,
+		.is_vu		= 1,
+	},
+	[V4L2_PIXEL_FORMAT_NV16] = {
+		.fourcc		= V4L2_PIX_FMT_NV16,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_SEMI_PLANAR,
+	},
+	[V4L2_PIXEL_FORMAT_NV61] = {
+		.fourcc		= V4L2_PIX_FMT_NV61,
+		.layout		= (unsigned int)COLORCONV_LAYOUT_SEMI_PLANAR,
+		.is_vu		= 1,
+	},
+};
+
+static const char * const colorconv_isa_names[COLORCONV_ISA_MAX] = {
+	[COLORCONV_ISA_SCALAR]	= "scalar",
+	[COLORCONV_ISA_SSE2]	= "sse2",
+	[COLORCONV_ISA_AVX2]	= "avx2",
+	[COLORCONV_ISA_NEON]	= "neon",
+};
+
+static uint8_t colorconv_clamp(int32_t value)
+{
+	uint8_t				ret		= 0;
+
+	if (value > 255) {
+		/* saturate */
+		ret = 255U;
+	} else if (value > 0) {
+		/* in range */
+		ret = (uint8_t)value;
+	} else {
+		/* saturate */
+		ret = 0U;
+	}
+
+	return ret;
+}
+
+void colorconv_scalar_yuv_to_rgb32(const struct colorconv_coefs *k,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgb, unsigned int width)
+{
+	int32_t				yy		= 0;
+	int32_t				uu		= 0;
+	int32_t				vv		= 0;
+	unsigned int			x		= 0;
+
+	for (x = 0; x < width; x++) {
+		yy = ((int32_t)y[x] - k->y_offset) * k->ky;
+		uu = (int32_t)u[x] - 128;
+		vv = (int32_t)v[x] - 128;
+
+		rgb[(x * 4U) + 0U] = colorconv_clamp((yy + (k->kb_u * uu) + COLORCONV_ROUND) >>
+			COLORCONV_SHIFT);
+		rgb[(x * 4U) + 1U] = colorconv_clamp((yy + (k->kg_u * uu) + (k->kg_v * vv) +
+			COLORCONV_ROUND) >> COLORCONV_SHIFT);
+		rgb[(x * 4U) + 2U] = colorconv_clamp((yy + (k->kr_v * vv) + COLORCONV_ROUND) >>
+			COLORCONV_SHIFT);
+		rgb[(x * 4U) + 3U] = 0xFFU;
+	}
+}
+
+void colorconv_scalar_rgb32_to_yuv(const struct colorconv_coefs *k,
+	const uint8_t *rgb, uint8_t *y, uint8_t *u, uint8_t *v, unsigned int width)
+{
+	int32_t				b		= 0;
+	int32_t				g		= 0;
+	int32_t				r		= 0;
+	unsigned int			x		= 0;
+
+	for (x = 0; x < width; x++) {
+		b = (int32_t)rgb[(x * 4U) + 0U];
+		g = (int32_t)rgb[(x * 4U) + 1U];
+		r = (int32_t)rgb[(x * 4U) + 2U];
+
+		y[x] = colorconv_clamp((((k->ky_r * r) + (k->ky_g * g) + (k->ky_b * b) +
+			COLORCONV_ROUND) >> COLORCONV_SHIFT) + k->y_offset);
+		u[x] = colorconv_clamp((((k->ku_r * r) + (k->ku_g * g) + (k->ku_b * b) +
+			COLORCONV_ROUND) >> COLORCONV_SHIFT) + 128);
+		v[x] = colorconv_clamp((((k->kv_r * r) + (k->kv_g * g) + (k->kv_b * b) +
+			COLORCONV_ROUND) >> COLORCONV_SHIFT) + 128);
+	}
+}
+
+void colorconv_scalar_unpack_422(const uint8_t *src, uint8_t *y,
+	uint8_t *c0, uint8_t *c1, unsigned int y_offset, unsigned int width)
+{
+	const uint8_t			*pair		= NULL;
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + 1U) < width; x += 2U) {
+		pair		= &src[x * 2U];
+		y[x]		= pair[y_offset];
+		y[x + 1U]	= pair[y_offset + 2U];
+		c0[x]		= pair[1U - y_offset];
+		c0[x + 1U]	= c0[x];
+		c1[x]		= pair[3U - y_offset];
+		c1[x + 1U]	= c1[x];
+	}
+}
+
+static const struct colorconv_kernels colorconv_scalar_kernels = {
+	.isa		= (unsigned int)COLORCONV_ISA_SCALAR,
+	.yuv_to_rgb32	= colorconv_scalar_yuv_to_rgb32,
+	.rgb32_to_yuv	= colorconv_scalar_rgb32_to_yuv,
+	.unpack_422	= colorconv_scalar_unpack_422,
+};
+
+static const struct colorconv_kernels *colorconv_get_kernels(unsigned int isa)
+{
+	const struct colorconv_kernels	*ret		= NULL;
+
+	switch (isa) {
+	case (unsigned int)COLORCONV_ISA_SCALAR:
+		ret = &colorconv_scalar_kernels;
+		break;
+	case (unsigned int)COLORCONV_ISA_SSE2:
+		ret = colorconv_get_sse2_kernels();
+		break;
+	case (unsigned int)COLORCONV_ISA_AVX2:
+		ret = colorconv_get_avx2_kernels();
+		break;
+	case (unsigned int)COLORCONV_ISA_NEON:
+		ret = colorconv_get_neon_kernels();
+		break;
+	default:
+		loge("isa(%u) is wrong\n", isa);
+		break;
+	}
+
+	return ret;
+}
+
+/* the widest instruction set the cpu runs */
+enum colorconv_isa colorconv_get_best_isa(void)
+{
+	enum colorconv_isa		ret		= COLORCONV_ISA_SCALAR;
+
+	if (colorconv_get_avx2_kernels() != NULL) {
+		/* x86 */
+		ret = COLORCONV_ISA_AVX2;
+	} else if (colorconv_get_neon_kernels() != NULL) {
+		/* arm */
+		ret = COLORCONV_ISA_NEON;
+	} else if (colorconv_get_sse2_kernels() != NULL) {
+		/* x86 */
+		ret = COLORCONV_ISA_SSE2;
+	} else {
+		/* the compiler vectorizes what it can */
+		logd("no simd kernel\n");
+	}
+
+	return ret;
+}
+
+const char *colorconv_get_isa_name(unsigned int isa)
+{
+	return (isa < (unsigned int)COLORCONV_ISA_MAX) ? colorconv_isa_names[isa] : "unknown";
+}
+
+/* the description of a format of video_format_table, NULL if it is not one */
+const struct colorconv_format *colorconv_get_format(unsigned int fourcc)
+{
+	const struct colorconv_format	*ret		= NULL;
+	unsigned int			idx		= 0;
+
+	for (idx = 0; idx < (unsigned int)V4L2_PIXEL_FORMAT_MAX; idx++) {
+		if (colorconv_formats[idx].fourcc == fourcc) {
+			ret = &colorconv_formats[idx];
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static int16_t colorconv_fixed(double value)
+{
+	double				scaled		= 0.0;
+
+	scaled = value * (double)(1 << COLORCONV_SHIFT);
+
+	return (int16_t)((scaled < 0.0) ? (scaled - 0.5) : (scaled + 0.5));
+}
+
+/*
+ * limited range puts y in [16, 235] and u, v in [16, 240], full range puts
+ * them in [0, 255]
+ */
+static void colorconv_init_coefs(struct colorconv_coefs *k, enum colorconv_matrix matrix,
+	enum colorconv_range range)
+{
+	double				kr		= 0.0;
+	double				kb		= 0.0;
+	double				kg		= 0.0;
+	double				ys		= 1.0;
+	double				cs		= 1.0;
+
+	kr = (matrix == COLORCONV_MATRIX_BT709) ? 0.2126 : 0.299;
+	kb = (matrix == COLORCONV_MATRIX_BT709) ? 0.0722 : 0.114;
+	kg = 1.0 - kr - kb;
+	if (range == COLORCONV_RANGE_LIMITED) {
+		/* the span of y and of u, v over 255 */
+		ys = 219.0 / 255.0;
+		cs = 224.0 / 255.0;
+	}
+
+	k->y_offset	= (range == COLORCONV_RANGE_LIMITED) ? 16 : 0;
+
+	k->ky		= colorconv_fixed(1.0 / ys);
+	k->kr_v		= colorconv_fixed((2.0 * (1.0 - kr)) / cs);
+	k->kg_u		= colorconv_fixed((-2.0 * (1.0 - kb) * kb) / (kg * cs));
+	k->kg_v		= colorconv_fixed((-2.0 * (1.0 - kr) * kr) / (kg * cs));
+	k->kb_u		= colorconv_fixed((2.0 * (1.0 - kb)) / cs);
+
+	k->ky_r		= colorconv_fixed(kr * ys);
+	k->ky_g		= colorconv_fixed(kg * ys);
+	k->ky_b		= colorconv_fixed(kb * ys);
+	k->ku_r		= colorconv_fixed((-kr * cs) / (2.0 * (1.0 - kb)));
+	k->ku_g		= colorconv_fixed((-kg * cs) / (2.0 * (1.0 - kb)));
+	k->ku_b		= colorconv_fixed(0.5 * cs);
+	k->kv_r		= colorconv_fixed(0.5 * cs);
+	k->kv_g		= colorconv_fixed((-kg * cs) / (2.0 * (1.0 - kr)));
+	k->kv_b		= colorconv_fixed((-kb * cs) / (2.0 * (1.0 - kr)));
+}
+
+/**
+ * @brief Prepare a conversion of frames of a size
+ *
+ * The kernels of the widest instruction set the cpu runs are used.
+ *
+ * @return 0 on success, -1 if a format is not in video_format_table or the
+ * size can not be subsampled
+ */
+int colorconv_init(struct colorconv *cc, unsigned int src_format,
+	unsigned int dst_format, unsigned int width, unsigned int height,
+	enum colorconv_matrix matrix, enum colorconv_range range)
+{
+	size_t				stripe		= 0;
+	unsigned int			rows		= 0;
+	int				ret		= 0;
+
+	(void)memset(cc, 0, sizeof(*cc));
+
+	cc->src = colorconv_get_format(src_format);
+	cc->dst = colorconv_get_format(dst_format);
+	if ((cc->src == NULL) || (cc->dst == NULL) || (width == 0U) || (height == 0U) ||
+	    ((width % 2U) != 0U) ||
+	    (((cc->src->is_420 == 1U) || (cc->dst->is_420 == 1U)) && ((height % 2U) != 0U))) {
+		loge("0x%08x -> 0x%08x of %u * %u is not supported\n",
+			src_format, dst_format, width, height);
+		ret = -1;
+	} else {
+		/* pairs of rows for 4:2:0 */
+		rows = ((COLORCONV_STRIPE_BYTES / (3U * width)) / 2U) * 2U;
+		rows = (rows < 2U) ? 2U : rows;
+
+		cc->width	= width;
+		cc->height	= height;
+		cc->stripe_rows	= rows;
+		cc->kernels	= colorconv_get_kernels((unsigned int)colorconv_get_best_isa());
+		colorconv_init_coefs(&cc->coefs, matrix, range);
+
+		stripe = (size_t)width * rows;
+		ret = frame_arena_create(&cc->arena,
+			frame_arena_align(stripe) * 3U + frame_arena_align((size_t)width * 4U), 0U);
+		if (ret == 0) {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			cc->y	= (uint8_t *)frame_arena_alloc(&cc->arena, stripe);
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			cc->u	= (uint8_t *)frame_arena_alloc(&cc->arena, stripe);
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			cc->v	= (uint8_t *)frame_arena_alloc(&cc->arena, stripe);
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			cc->rgb	= (uint8_t *)frame_arena_alloc(&cc->arena, (size_t)width * 4U);
+		}
+	}
+
+	if (ret < 0) {
+		/* nothing to convert with */
+		(void)memset(cc, 0, sizeof(*cc));
+	} else {
+		logi("colorconv %s -> %s, %u * %u, stripe: %u rows, isa: %s\n",
+			v4l2_get_format_name_by_v4l2_format(src_format),
+			v4l2_get_format_name_by_v4l2_format(dst_format),
+			width, height, rows, colorconv_get_isa_name(cc->kernels->isa));
+	}
+
+	return ret;
+}
+
+void colorconv_deinit(struct colorconv *cc)
+{
+	frame_arena_destroy(&cc->arena);
+	(void)memset(cc, 0, sizeof(*cc));
+}
+
+/* @return 0 on success, -1 if the instruction set is not supported */
+int colorconv_set_isa(struct colorconv *cc, enum colorconv_isa isa)
+{
+	const struct colorconv_kernels	*kernels	= NULL;
+	int				ret		= 0;
+
+	kernels = colorconv_get_kernels((unsigned int)isa);
+	if (kernels == NULL) {
+		/* not supported */
+		ret = -1;
+	} else {
+		cc->kernels = kernels;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Lay the planes of a frame out one after another from base
+ *
+ * @return 0 on success, -1 if the format is not supported
+ */
+int colorconv_init_image(struct colorconv_image *image, unsigned int format,
+	unsigned int width, unsigned int height, uint8_t *base)
+{
+	struct frame_dump_header	header;
+	size_t				offset		= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	(void)memset((void *)image, 0, sizeof(*image));
+
+	ret = frame_dump_init_header(&header, format, width, height);
+	if (ret == 0) {
+		for (idx = 0; idx < header.n_planes; idx++) {
+			image->planes[idx]	= &base[offset];
+			image->strides[idx]	= header.strides[idx];
+			offset += header.sizes[idx];
+		}
+	}
+
+	return ret;
+}
+
+/* the chroma of each pair of pixels is repeated for both */
+static void colorconv_repeat_chroma(const uint8_t *src, unsigned int step, uint8_t *dst,
+	unsigned int width)
+{
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + 1U) < width; x += 2U) {
+		dst[x]		= src[(x / 2U) * step];
+		dst[x + 1U]	= dst[x];
+	}
+}
+
+static void colorconv_halve_chroma(const uint8_t *src, uint8_t *dst, unsigned int step,
+	unsigned int width)
+{
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + 1U) < width; x += 2U) {
+		/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
+		dst[(x / 2U) * step] = (uint8_t)(((unsigned int)src[x] + src[x + 1U] + 1U) / 2U);
+	}
+}
+
+static void colorconv_quarter_chroma(const uint8_t *src, const uint8_t *next, uint8_t *dst,
+	unsigned int step, unsigned int width)
+{
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + 1U) < width; x += 2U) {
+		/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
+		dst[(x / 2U) * step] = (uint8_t)(((unsigned int)src[x] + src[x + 1U] +
+			next[x] + next[x + 1U] + 2U) / 4U);
+	}
+}
+
+static void colorconv_pack_422(const uint8_t *y, const uint8_t *c0, const uint8_t *c1,
+	uint8_t *dst, unsigned int y_offset, unsigned int width)
+{
+	uint8_t				*pair		= NULL;
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + 1U) < width; x += 2U) {
+		pair			= &dst[x * 2U];
+		pair[y_offset]		= y[x];
+		pair[y_offset + 2U]	= y[x + 1U];
+		/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
+		pair[1U - y_offset]	= (uint8_t)(((unsigned int)c0[x] + c0[x + 1U] + 1U) / 2U);
+		/* coverity[misra_c_2012_rule_10_8_violation : FALSE] */
+		pair[3U - y_offset]	= (uint8_t)(((unsigned int)c1[x] + c1[x + 1U] + 1U) / 2U);
+	}
+}
+
+/* b, g, r to b, g, r, a and back */
+static void colorconv_swizzle_rgb(const uint8_t *src, unsigned int src_bpp,
+	uint8_t *dst, unsigned int dst_bpp, unsigned int width)
+{
+	unsigned int			x		= 0;
+
+	for (x = 0; x < width; x++) {
+		dst[(x * dst_bpp) + 0U] = src[(x * src_bpp) + 0U];
+		dst[(x * dst_bpp) + 1U] = src[(x * src_bpp) + 1U];
+		dst[(x * dst_bpp) + 2U] = src[(x * src_bpp) + 2U];
+		if (dst_bpp == 4U) {
+			/* opaque */
+			dst[(x * dst_bpp) + 3U] = 0xFFU;
+		}
+	}
+}
+
+/* the rows of the stripe from row into 4:4:4 */
+static void colorconv_read_rows(const struct colorconv *cc, const struct colorconv_image *src,
+	unsigned int row, unsigned int n_rows)
+{
+	const struct colorconv_format	*fmt		= cc->src;
+	const uint8_t			*line		= NULL;
+	const uint8_t			*chroma		= NULL;
+	uint8_t				*y		= NULL;
+	uint8_t				*c0		= NULL;
+	uint8_t				*c1		= NULL;
+	unsigned int			width		= cc->width;
+	unsigned int			crow		= 0;
+	unsigned int			idx		= 0;
+
+	for (idx = 0; idx < n_rows; idx++) {
+		y	= &cc->y[idx * width];
+		c0	= (fmt->is_vu == 1U) ? &cc->v[idx * width] : &cc->u[idx * width];
+		c1	= (fmt->is_vu == 1U) ? &cc->u[idx * width] : &cc->v[idx * width];
+		line	= &src->planes[0][(size_t)(row + idx) * src->strides[0]];
+		crow	= (fmt->is_420 == 1U) ? ((row + idx) / 2U) : (row + idx);
+
+		switch (fmt->layout) {
+		case (unsigned int)COLORCONV_LAYOUT_RGB:
+			if (fmt->bpp == 3U) {
+				/* to rgb32 first */
+				colorconv_swizzle_rgb(line, 3U, cc->rgb, 4U, width);
+				line = cc->rgb;
+			}
+			cc->kernels->rgb32_to_yuv(&cc->coefs, line, y,
+				&cc->u[idx * width], &cc->v[idx * width], width);
+			break;
+		case (unsigned int)COLORCONV_LAYOUT_PACKED:
+			cc->kernels->unpack_422(line, y, c0, c1, fmt->y_offset, width);
+			break;
+		case (unsigned int)COLORCONV_LAYOUT_PLANAR:
+			(void)memcpy(y, line, width);
+			colorconv_repeat_chroma(&src->planes[1][(size_t)crow * src->strides[1]], 1U,
+				c0, width);
+			colorconv_repeat_chroma(&src->planes[2][(size_t)crow * src->strides[2]], 1U,
+				c1, width);
+			break;
+		default:
+			(void)memcpy(y, line, width);
+			chroma = &src->planes[1][(size_t)crow * src->strides[1]];
+			colorconv_repeat_chroma(chroma, 2U, c0, width);
+			colorconv_repeat_chroma(&chroma[1], 2U, c1, width);
+			break;
+		}
+	}
+}
+
+/* the 4:4:4 rows of the stripe into the rows from row */
+static void colorconv_write_rows(const struct colorconv *cc, const struct colorconv_image *dst,
+	unsigned int row, unsigned int n_rows)
+{
+	const struct colorconv_format	*fmt		= cc->dst;
+	uint8_t				*line		= NULL;
+	uint8_t				*chroma		= NULL;
+	const uint8_t			*y		= NULL;
+	const uint8_t			*c0		= NULL;
+	const uint8_t			*c1		= NULL;
+	unsigned int			width		= cc->width;
+	unsigned int			crow		= 0;
+	unsigned int			idx		= 0;
+
+	for (idx = 0; idx < n_rows; idx++) {
+		y	= &cc->y[idx * width];
+		c0	= (fmt->is_vu == 1U) ? &cc->v[idx * width] : &cc->u[idx * width];
+		c1	= (fmt->is_vu == 1U) ? &cc->u[idx * width] : &cc->v[idx * width];
+		line	= &dst->planes[0][(size_t)(row + idx) * dst->strides[0]];
+		crow	= (fmt->is_420 == 1U) ? ((row + idx) / 2U) : (row + idx);
+
+		switch (fmt->layout) {
+		case (unsigned int)COLORCONV_LAYOUT_RGB:
+			if (fmt->bpp == 3U) {
+				cc->kernels->yuv_to_rgb32(&cc->coefs, y,
+					&cc->u[idx * width], &cc->v[idx * width], cc->rgb, width);
+				colorconv_swizzle_rgb(cc->rgb, 4U, line, 3U, width);
+			} else {
+				cc->kernels->yuv_to_rgb32(&cc->coefs, y,
+					&cc->u[idx * width], &cc->v[idx * width], line, width);
+			}
+			break;
+		case (unsigned int)COLORCONV_LAYOUT_PACKED:
+			colorconv_pack_422(y, c0, c1, line, fmt->y_offset, width);
+			break;
+		default:
+			(void)memcpy(line, y, width);
+			if ((fmt->is_420 == 1U) && ((idx % 2U) == 1U)) {
+				/* the chroma of the pair is written with its first row */
+				logd("row(%u) shares the chroma\n", row + idx);
+			} else if (fmt->layout == (unsigned int)COLORCONV_LAYOUT_PLANAR) {
+				if (fmt->is_420 == 1U) {
+					colorconv_quarter_chroma(c0, &c0[width],
+						&dst->planes[1][(size_t)crow * dst->strides[1]], 1U, width);
+					colorconv_quarter_chroma(c1, &c1[width],
+						&dst->planes[2][(size_t)crow * dst->strides[2]], 1U, width);
+				} else {
+					colorconv_halve_chroma(c0,
+						&dst->planes[1][(size_t)crow * dst->strides[1]], 1U, width);
+					colorconv_halve_chroma(c1,
+						&dst->planes[2][(size_t)crow * dst->strides[2]], 1U, width);
+				}
+			} else {
+				chroma = &dst->planes[1][(size_t)crow * dst->strides[1]];
+				if (fmt->is_420 == 1U) {
+					colorconv_quarter_chroma(c0, &c0[width], chroma, 2U, width);
+					colorconv_quarter_chroma(c1, &c1[width], &chroma[1], 2U, width);
+				} else {
+					colorconv_halve_chroma(c0, chroma, 2U, width);
+					colorconv_halve_chroma(c1, &chroma[1], 2U, width);
+				}
+			}
+			break;
+		}
+	}
+}
+
+/* the bytes of a row of a plane */
+static unsigned int colorconv_get_row_bytes(const struct colorconv_format *fmt,
+	unsigned int plane, unsigned int width)
+{
+	unsigned int			ret		= width;
+
+	if (fmt->layout == (unsigned int)COLORCONV_LAYOUT_RGB) {
+		/* pixels */
+		ret = width * fmt->bpp;
+	} else if (fmt->layout == (unsigned int)COLORCONV_LAYOUT_PACKED) {
+		/* pairs */
+		ret = width * 2U;
+	} else if ((fmt->layout == (unsigned int)COLORCONV_LAYOUT_PLANAR) && (plane > 0U)) {
+		/* subsampled */
+		ret = width / 2U;
+	} else {
+		/* luma, or u and v interleaved */
+		logd("plane(%u): %u bytes\n", plane, ret);
+	}
+
+	return ret;
+}
+
+/* between the same formats, or between rgb formats */
+static void colorconv_copy(const struct colorconv *cc, const struct colorconv_image *src,
+	const struct colorconv_image *dst)
+{
+	unsigned int			n_planes	= 0;
+	unsigned int			rows		= 0;
+	unsigned int			idx		= 0;
+	unsigned int			row		= 0;
+
+	if (cc->src->fourcc != cc->dst->fourcc) {
+		for (row = 0; row < cc->height; row++) {
+			/* rgb24 and rgb32 */
+			colorconv_swizzle_rgb(&src->planes[0][(size_t)row * src->strides[0]],
+				cc->src->bpp, &dst->planes[0][(size_t)row * dst->strides[0]],
+				cc->dst->bpp, cc->width);
+		}
+	} else {
+		n_planes = v4l2_get_planes_by_v4l2_format(cc->src->fourcc);
+		for (idx = 0; (idx < n_planes) && (idx < COLORCONV_MAX_PLANES); idx++) {
+			rows = ((idx > 0U) && (cc->src->is_420 == 1U)) ? (cc->height / 2U) : cc->height;
+			for (row = 0; row < rows; row++) {
+				/* copy */
+				(void)memcpy(&dst->planes[idx][(size_t)row * dst->strides[idx]],
+					&src->planes[idx][(size_t)row * src->strides[idx]],
+					colorconv_get_row_bytes(cc->src, idx, cc->width));
+			}
+		}
+	}
+}
+
+/**
+ * @brief Convert a frame
+ *
+ * @return 0 on success, -1 if the conversion is not initialized
+ */
+int colorconv_convert(const struct colorconv *cc, const struct colorconv_image *src,
+	const struct colorconv_image *dst)
+{
+	unsigned int			row		= 0;
+	unsigned int			n_rows		= 0;
+	int				ret		= 0;
+
+	if ((cc->src == NULL) || (cc->dst == NULL) || (cc->y == NULL) || (cc->rgb == NULL)) {
+		loge("the conversion is not initialized\n");
+		ret = -1;
+	} else if ((cc->src->fourcc == cc->dst->fourcc) ||
+		   ((cc->src->layout == (unsigned int)COLORCONV_LAYOUT_RGB) &&
+		    (cc->dst->layout == (unsigned int)COLORCONV_LAYOUT_RGB))) {
+		/* no color space to convert */
+		colorconv_copy(cc, src, dst);
+	} else {
+		for (row = 0; row < cc->height; row += n_rows) {
+			n_rows = ((cc->height - row) < cc->stripe_rows) ?
+				(cc->height - row) : cc->stripe_rows;
+			colorconv_read_rows(cc, src, row, n_rows);
+			colorconv_write_rows(cc, dst, row, n_rows);
+		}
+	}
+
+	return ret;
+}
+
+/* nanoseconds per frame */
+static uint64_t colorconv_bench_frames(const struct colorconv *cc,
+	const struct colorconv_image *src, const struct colorconv_image *dst)
+{
+	uint64_t			ts_start	= 0;
+	unsigned int			idx		= 0;
+
+	(void)colorconv_convert(cc, src, dst);
+
+	ts_start = latency_get_time_ns();
+	for (idx = 0; idx < COLORCONV_BENCH_FRAMES; idx++) {
+		/* timed */
+		(void)colorconv_convert(cc, src, dst);
+	}
+
+	return (latency_get_time_ns() - ts_start) / COLORCONV_BENCH_FRAMES;
+}
+
+/* every instruction set the cpu runs for one pair of formats */
+static void colorconv_bench_pair(int fd, unsigned int src_format, unsigned int dst_format,
+	unsigned int width, unsigned int height, uint8_t *const *frames)
+{
+	struct colorconv		cc;
+	struct colorconv_image		src;
+	struct colorconv_image		ref;
+	struct colorconv_image		out;
+	size_t				size		= 0;
+	uint64_t			bytes		= 0;
+	uint64_t			ns		= 0;
+	uint64_t			gbps_milli	= 0;
+	unsigned int			is_exact	= 1;
+	unsigned int			is_first	= 1;
+	unsigned int			isa		= 0;
+
+	size	= (size_t)v4l2_get_v4l2_sizeimage(dst_format, width, height);
+	bytes	= (uint64_t)v4l2_get_v4l2_sizeimage(src_format, width, height) + size;
+
+	if ((colorconv_init(&cc, src_format, dst_format, width, height,
+			COLORCONV_MATRIX_BT601, COLORCONV_RANGE_LIMITED) == 0) &&
+	    (colorconv_init_image(&src, src_format, width, height, frames[0]) == 0) &&
+	    (colorconv_init_image(&ref, dst_format, width, height, frames[1]) == 0) &&
+	    (colorconv_init_image(&out, dst_format, width, height, frames[2]) == 0)) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n  {\"src\": \"%s\", \"dst\": \"%s\", \"gbps\": {",
+			v4l2_get_format_name_by_v4l2_format(src_format),
+			v4l2_get_format_name_by_v4l2_format(dst_format));
+
+		for (isa = 0; isa < (unsigned int)COLORCONV_ISA_MAX; isa++) {
+			if (colorconv_set_isa(&cc, (enum colorconv_isa)isa) == 0) {
+				(void)memset(frames[2], 0, size);
+				ns = colorconv_bench_frames(&cc, &src,
+					(isa == (unsigned int)COLORCONV_ISA_SCALAR) ? &ref : &out);
+				/* bytes per nanosecond are gigabytes per second */
+				gbps_milli = (ns > 0U) ? ((bytes * 1000U) / ns) : 0U;
+				if ((isa != (unsigned int)COLORCONV_ISA_SCALAR) &&
+				    (memcmp(frames[1], frames[2], size) != 0)) {
+					/* not the bytes of the reference */
+					is_exact = 0;
+				}
+
+				/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+				(void)dprintf(fd, "%s\"%s\": %llu.%03llu", (is_first == 1U) ? "" : ", ",
+					colorconv_get_isa_name(isa),
+					(unsigned long long)(gbps_milli / 1000U),
+					(unsigned long long)(gbps_milli % 1000U));
+				is_first = 0;
+			}
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "}, \"exact\": %u}", is_exact);
+	}
+
+	colorconv_deinit(&cc);
+}
+
+/**
+ * @brief Time every conversion between the formats of video_format_table
+ *
+ * Each pair is converted by every instruction set the cpu runs, and its
+ * throughput is the bytes read and written per second. "exact" is 0 if an
+ * instruction set does not give the bytes of the scalar reference.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int colorconv_dump_bench(const char *path, unsigned int width, unsigned int height)
+{
+	struct frame_arena		arena;
+	uint8_t				*frames[3]	= { NULL, NULL, NULL };
+	size_t				size		= 0;
+	size_t				idx		= 0;
+	unsigned int			is_first	= 1;
+	unsigned int			src		= 0;
+	unsigned int			dst		= 0;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	/* rgb32 is the largest */
+	size = (size_t)width * height * 4U;
+	ret = frame_arena_create(&arena, frame_arena_align(size) * 3U, 0U);
+	if (ret == 0) {
+		for (idx = 0; idx < 3U; idx++) {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			frames[idx] = (uint8_t *)frame_arena_alloc(&arena, size);
+		}
+		for (idx = 0; idx < size; idx++) {
+			/* a pattern which is not flat in any format */
+			frames[0][idx] = (uint8_t)((idx * 7U) + (idx / 4096U));
+		}
+
+		/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			loge("Failed to open %s\n", path);
+			ret = -1;
+		}
+	}
+
+	if (fd >= 0) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"width\": %u, \"height\": %u, \"frames\": %u, \"isa\": \"%s\",\n"
+			" \"conversions\": [", width, height, COLORCONV_BENCH_FRAMES,
+			colorconv_get_isa_name((unsigned int)colorconv_get_best_isa()));
+
+		for (src = 0; src < (unsigned int)V4L2_PIXEL_FORMAT_MAX; src++) {
+			for (dst = 0; dst < (unsigned int)V4L2_PIXEL_FORMAT_MAX; dst++) {
+				if (is_first == 0U) {
+					/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+					(void)dprintf(fd, ",");
+				}
+				colorconv_bench_pair(fd, colorconv_formats[src].fourcc,
+					colorconv_formats[dst].fourcc, width, height, frames);
+				is_first = 0;
+			}
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+		(void)close(fd);
+	}
+
+	frame_arena_destroy(&arena);
+
+	return ret;
+}
@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef COLORCONV_H
+#define COLORCONV_H
+
+#include <stdint.h>
+
+#include "frame_arena.h"
+
+/* default file to dump the throughput of the conversions as json */
+#define COLORCONV_BENCH_PATH		("/tmp/camera_app_colorconv.json")
+
+#define COLORCONV_MAX_PLANES		(3U)
+/* the 4:4:4 rows a stripe is converted through are kept within this size */
+#define COLORCONV_STRIPE_BYTES		(64U * 1024U)
+
+/* the coefficients are fixed point numbers of this many fraction bits */
+#define COLORCONV_SHIFT			(12)
+#define COLORCONV_ROUND			(1 << (COLORCONV_SHIFT - 1))
+
+enum colorconv_matrix {
+	COLORCONV_MATRIX_BT601,
+	COLORCONV_MATRIX_BT709,
+};
+
+/* the quantization of the yuv formats, rgb is always full range */
+enum colorconv_range {
+	COLORCONV_RANGE_LIMITED,
+	COLORCONV_RANGE_FULL,
+};
+
+enum colorconv_isa {
+	COLORCONV_ISA_SCALAR,
+	COLORCONV_ISA_SSE2,
+	COLORCONV_ISA_AVX2,
+	COLORCONV_ISA_NEON,
+	COLORCONV_ISA_MAX,
+};
+
+enum colorconv_layout {
+	/* b, g, r (and a) bytes of each pixel */
+	COLORCONV_LAYOUT_RGB,
+	/* 4:2:2 pairs of pixels in 4 bytes */
+	COLORCONV_LAYOUT_PACKED,
+	/* y, u and v planes */
+	COLORCONV_LAYOUT_PLANAR,
+	/* y plane and a plane of interleaved chroma */
+	COLORCONV_LAYOUT_SEMI_PLANAR,
+};
+
+struct colorconv_format {
+	unsigned int			fourcc;
+	unsigned int			layout;
+	/* bytes per pixel of rgb */
+	unsigned int			bpp;
+	/* 1 if the chroma has half the rows of luma */
+	unsigned int			is_420;
+	/* the byte of the first luma in a packed pair */
+	unsigned int			y_offset;
+	/* 1 if v comes before u */
+	unsigned int			is_vu;
+};
+
+struct colorconv_coefs {
+	int16_t				y_offset;
+	/* yuv to rgb */
+	int16_t				ky;
+	int16_t				kr_v;
+	int16_t				kg_u;
+	int16_t				kg_v;
+	int16_t				kb_u;
+	/* rgb to yuv */
+	int16_t				ky_r;
+	int16_t				ky_g;
+	int16_t				ky_b;
+	int16_t				ku_r;
+	int16_t				ku_g;
+	int16_t				ku_b;
+	int16_t				kv_r;
+	int16_t				kv_g;
+	int16_t				kv_b;
+};
+
+/*
+ * the row kernels of an instruction set. The rgb pixels are b, g, r and a
+ * bytes, and the yuv rows are 4:4:4. Every kernel gives the same bytes as
+ * the scalar one.
+ */
+struct colorconv_kernels {
+	unsigned int			isa;
+	void				(*yuv_to_rgb32)(const struct colorconv_coefs *k,
+						const uint8_t *y, const uint8_t *u, const uint8_t *v,
+						uint8_t *rgb, unsigned int width);
+	void				(*rgb32_to_yuv)(const struct colorconv_coefs *k,
+						const uint8_t *rgb, uint8_t *y, uint8_t *u, uint8_t *v,
+						unsigned int width);
+	/* a packed 4:2:2 row into 4:4:4 rows, c0 and c1 in the order of the row */
+	void				(*unpack_422)(const uint8_t *src, uint8_t *y,
+						uint8_t *c0, uint8_t *c1, unsigned int y_offset,
+						unsigned int width);
+};
+
+struct colorconv_image {
+	uint8_t				*planes[COLORCONV_MAX_PLANES];
+	unsigned int			strides[COLORCONV_MAX_PLANES];
+};
+
+/*
+ * a conversion from one format of video_format_table to another. The frame
+ * is converted stripe by stripe: the rows of a stripe are read into 4:4:4
+ * rows which fit in the cache, and written from them, so each frame is read
+ * and written once.
+ */
+struct colorconv {
+	const struct colorconv_format	*src;
+	const struct colorconv_format	*dst;
+	unsigned int			width;
+	unsigned int			height;
+	unsigned int			stripe_rows;
+	struct colorconv_coefs		coefs;
+	const struct colorconv_kernels	*kernels;
+
+	struct frame_arena		arena;
+	uint8_t				*y;
+	uint8_t				*u;
+	uint8_t				*v;
+	/* a row of rgb32 pixels for rgb24 */
+	uint8_t				*rgb;
+};
+
+extern int colorconv_init(struct colorconv *cc, unsigned int src_format,
+	unsigned int dst_format, unsigned int width, unsigned int height,
+	enum colorconv_matrix matrix, enum colorconv_range range);
+extern void colorconv_deinit(struct colorconv *cc);
+extern int colorconv_set_isa(struct colorconv *cc, enum colorconv_isa isa);
+extern enum colorconv_isa colorconv_get_best_isa(void);
+extern const char *colorconv_get_isa_name(unsigned int isa);
+extern const struct colorconv_format *colorconv_get_format(unsigned int fourcc);
+extern int colorconv_init_image(struct colorconv_image *image, unsigned int format,
+	unsigned int width, unsigned int height, uint8_t *base);
+extern int colorconv_convert(const struct colorconv *cc, const struct colorconv_image *src,
+	const struct colorconv_image *dst);
+extern int colorconv_dump_bench(const char *path, unsigned int width, unsigned int height);
+
+#endif//COLORCONV_H
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef COLORCONV_KERNELS_H
+#define COLORCONV_KERNELS_H
+
+#include <stdint.h>
+
+#include "colorconv.h"
+
+/* the reference kernels, also used for the pixels left by the simd ones */
+extern void colorconv_scalar_yuv_to_rgb32(const struct colorconv_coefs *k,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgb, unsigned int width);
+extern void colorconv_scalar_rgb32_to_yuv(const struct colorconv_coefs *k,
+	const uint8_t *rgb, uint8_t *y, uint8_t *u, uint8_t *v, unsigned int width);
+extern void colorconv_scalar_unpack_422(const uint8_t *src, uint8_t *y,
+	uint8_t *c0, uint8_t *c1, unsigned int y_offset, unsigned int width);
+
+/* NULL if the kernels are not built in or the cpu does not support them */
+extern const struct colorconv_kernels *colorconv_get_sse2_kernels(void);
+extern const struct colorconv_kernels *colorconv_get_avx2_kernels(void);
+extern const struct colorconv_kernels *colorconv_get_neon_kernels(void);
+
+#endif//COLORCONV_KERNELS_H
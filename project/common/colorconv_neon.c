@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "colorconv_kernels.h"
+
+/* the pixels of an iteration of the simd kernels */
+#define COLORCONV_NEON_PIXELS		(16U)
+
+#if defined(__ARM_NEON)
+/* (a * ka + b * kb + c * kc + round) >> shift of 8 values, saturated to bytes */
+static inline uint8x8_t colorconv_neon_dot(int16x8_t a, int16x8_t b, int16x8_t c,
+	int16_t ka, int16_t kb, int16_t kc, int32x4_t offset)
+{
+	int32x4_t			lo;
+	int32x4_t			hi;
+
+	lo = vmlal_n_s16(vmlal_n_s16(vmull_n_s16(vget_low_s16(a), ka), vget_low_s16(b), kb),
+		vget_low_s16(c), kc);
+	hi = vmlal_n_s16(vmlal_n_s16(vmull_n_s16(vget_high_s16(a), ka), vget_high_s16(b), kb),
+		vget_high_s16(c), kc);
+	lo = vaddq_s32(vshrq_n_s32(vaddq_s32(lo, vdupq_n_s32(COLORCONV_ROUND)), COLORCONV_SHIFT),
+		offset);
+	hi = vaddq_s32(vshrq_n_s32(vaddq_s32(hi, vdupq_n_s32(COLORCONV_ROUND)), COLORCONV_SHIFT),
+		offset);
+
+	return vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+}
+
+static inline int16x8_t colorconv_neon_widen(uint8x8_t value, int16_t offset)
+{
+	return vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(value)), vdupq_n_s16(offset));
+}
+
+static void colorconv_neon_yuv_to_rgb32(const struct colorconv_coefs *k,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgb, unsigned int width)
+{
+	const int32x4_t			zero		= vdupq_n_s32(0);
+	uint8x16x4_t			px;
+	uint8x16_t			yy;
+	uint8x16_t			uu;
+	uint8x16_t			vv;
+	int16x8_t			y16[2];
+	int16x8_t			u16[2];
+	int16x8_t			v16[2];
+	unsigned int			x		= 0;
+
+	px.val[3] = vdupq_n_u8(0xFFU);
+	for (x = 0; (x + COLORCONV_NEON_PIXELS) <= width; x += COLORCONV_NEON_PIXELS) {
+		yy = vld1q_u8(&y[x]);
+		uu = vld1q_u8(&u[x]);
+		vv = vld1q_u8(&v[x]);
+
+		y16[0] = colorconv_neon_widen(vget_low_u8(yy), k->y_offset);
+		y16[1] = colorconv_neon_widen(vget_high_u8(yy), k->y_offset);
+		u16[0] = colorconv_neon_widen(vget_low_u8(uu), 128);
+		u16[1] = colorconv_neon_widen(vget_high_u8(uu), 128);
+		v16[0] = colorconv_neon_widen(vget_low_u8(vv), 128);
+		v16[1] = colorconv_neon_widen(vget_high_u8(vv), 128);
+
+		px.val[0] = vcombine_u8(
+			colorconv_neon_dot(y16[0], u16[0], v16[0], k->ky, k->kb_u, 0, zero),
+			colorconv_neon_dot(y16[1], u16[1], v16[1], k->ky, k->kb_u, 0, zero));
+		px.val[1] = vcombine_u8(
+			colorconv_neon_dot(y16[0], u16[0], v16[0], k->ky, k->kg_u, k->kg_v, zero),
+			colorconv_neon_dot(y16[1], u16[1], v16[1], k->ky, k->kg_u, k->kg_v, zero));
+		px.val[2] = vcombine_u8(
+			colorconv_neon_dot(y16[0], u16[0], v16[0], k->ky, 0, k->kr_v, zero),
+			colorconv_neon_dot(y16[1], u16[1], v16[1], k->ky, 0, k->kr_v, zero));
+
+		vst4q_u8(&rgb[x * 4U], px);
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_yuv_to_rgb32(k, &y[x], &u[x], &v[x], &rgb[x * 4U], width - x);
+	}
+}
+
+/* 16 pixels of r, g and b to 16 bytes */
+static inline uint8x16_t colorconv_neon_rgb_to(const int16x8_t *r, const int16x8_t *g,
+	const int16x8_t *b, int16_t kr, int16_t kg, int16_t kb, int32_t offset)
+{
+	const int32x4_t			off		= vdupq_n_s32(offset);
+
+	return vcombine_u8(colorconv_neon_dot(r[0], g[0], b[0], kr, kg, kb, off),
+		colorconv_neon_dot(r[1], g[1], b[1], kr, kg, kb, off));
+}
+
+static void colorconv_neon_rgb32_to_yuv(const struct colorconv_coefs *k,
+	const uint8_t *rgb, uint8_t *y, uint8_t *u, uint8_t *v, unsigned int width)
+{
+	uint8x16x4_t			px;
+	int16x8_t			b16[2];
+	int16x8_t			g16[2];
+	int16x8_t			r16[2];
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + COLORCONV_NEON_PIXELS) <= width; x += COLORCONV_NEON_PIXELS) {
+		px = vld4q_u8(&rgb[x * 4U]);
+
+		b16[0] = colorconv_neon_widen(vget_low_u8(px.val[0]), 0);
+		b16[1] = colorconv_neon_widen(vget_high_u8(px.val[0]), 0);
+		g16[0] = colorconv_neon_widen(vget_low_u8(px.val[1]), 0);
+		g16[1] = colorconv_neon_widen(vget_high_u8(px.val[1]), 0);
+		r16[0] = colorconv_neon_widen(vget_low_u8(px.val[2]), 0);
+		r16[1] = colorconv_neon_widen(vget_high_u8(px.val[2]), 0);
+
+		vst1q_u8(&y[x], colorconv_neon_rgb_to(r16, g16, b16,
+			k->ky_r, k->ky_g, k->ky_b, k->y_offset));
+		vst1q_u8(&u[x], colorconv_neon_rgb_to(r16, g16, b16,
+			k->ku_r, k->ku_g, k->ku_b, 128));
+		vst1q_u8(&v[x], colorconv_neon_rgb_to(r16, g16, b16,
+			k->kv_r, k->kv_g, k->kv_b, 128));
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_rgb32_to_yuv(k, &rgb[x * 4U], &y[x], &u[x], &v[x], width - x);
+	}
+}
+
+static void colorconv_neon_unpack_422(const uint8_t *src, uint8_t *y,
+	uint8_t *c0, uint8_t *c1, unsigned int y_offset, unsigned int width)
+{
+	uint8x16x4_t			pairs;
+	uint8x16x2_t			value;
+	unsigned int			x		= 0;
+
+	/* 32 pixels, each of the 4 bytes of 16 pairs in a register */
+	for (x = 0; (x + (COLORCONV_NEON_PIXELS * 2U)) <= width; x += COLORCONV_NEON_PIXELS * 2U) {
+		pairs = vld4q_u8(&src[x * 2U]);
+
+		value.val[0] = pairs.val[y_offset];
+		value.val[1] = pairs.val[y_offset + 2U];
+		vst2q_u8(&y[x], value);
+		value.val[0] = pairs.val[1U - y_offset];
+		value.val[1] = value.val[0];
+		vst2q_u8(&c0[x], value);
+		value.val[0] = pairs.val[3U - y_offset];
+		value.val[1] = value.val[0];
+		vst2q_u8(&c1[x], value);
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_unpack_422(&src[x * 2U], &y[x], &c0[x], &c1[x], y_offset, width - x);
+	}
+}
+
+static const struct colorconv_kernels colorconv_neon_kernels = {
+	.isa		= (unsigned int)COLORCONV_ISA_NEON,
+	.yuv_to_rgb32	= colorconv_neon_yuv_to_rgb32,
+	.rgb32_to_yuv	= colorconv_neon_rgb32_to_yuv,
+	.unpack_422	= colorconv_neon_unpack_422,
+};
+
+/* the build for neon only runs on the cpus which have it */
+const struct colorconv_kernels *colorconv_get_neon_kernels(void)
+{
+	return &colorconv_neon_kernels;
+}
+#else
+const struct colorconv_kernels *colorconv_get_neon_kernels(void)
+{
+	return NULL;
+}
+#endif//defined(__ARM_NEON)
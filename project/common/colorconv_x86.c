@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "colorconv_kernels.h"
+
+/* the pixels of an iteration of the simd kernels */
+#define COLORCONV_X86_PIXELS		(16U)
+
+#if defined(__SSE2__)
+/* a, b, a, b, ... for _mm_madd_epi16 */
+static inline __m128i colorconv_sse2_pair(int16_t a, int16_t b)
+{
+	return _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)b << 16) | (uint16_t)a));
+}
+
+/* (y * ka + u * kb) + (v * kc + 1 * kd), shifted down */
+static inline __m128i colorconv_sse2_dot(__m128i yu, __m128i v1, __m128i kyu, __m128i kv1)
+{
+	return _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu, kyu), _mm_madd_epi16(v1, kv1)),
+		COLORCONV_SHIFT);
+}
+
+/* 8 pixels of 16 bits to 8 pixels of b, g and r of 16 bits */
+static inline void colorconv_sse2_yuv_to_bgr(const struct colorconv_coefs *k,
+	__m128i y, __m128i u, __m128i v, __m128i *b, __m128i *g, __m128i *r)
+{
+	const __m128i			one		= _mm_set1_epi16(1);
+	__m128i				yu_lo;
+	__m128i				yu_hi;
+	__m128i				v1_lo;
+	__m128i				v1_hi;
+	__m128i				k_b;
+	__m128i				k_g;
+	__m128i				k_r;
+
+	yu_lo	= _mm_unpacklo_epi16(y, u);
+	yu_hi	= _mm_unpackhi_epi16(y, u);
+	v1_lo	= _mm_unpacklo_epi16(v, one);
+	v1_hi	= _mm_unpackhi_epi16(v, one);
+
+	k_b	= colorconv_sse2_pair(0, COLORCONV_ROUND);
+	k_g	= colorconv_sse2_pair(k->kg_v, COLORCONV_ROUND);
+	k_r	= colorconv_sse2_pair(k->kr_v, COLORCONV_ROUND);
+
+	*b = _mm_packs_epi32(
+		colorconv_sse2_dot(yu_lo, v1_lo, colorconv_sse2_pair(k->ky, k->kb_u), k_b),
+		colorconv_sse2_dot(yu_hi, v1_hi, colorconv_sse2_pair(k->ky, k->kb_u), k_b));
+	*g = _mm_packs_epi32(
+		colorconv_sse2_dot(yu_lo, v1_lo, colorconv_sse2_pair(k->ky, k->kg_u), k_g),
+		colorconv_sse2_dot(yu_hi, v1_hi, colorconv_sse2_pair(k->ky, k->kg_u), k_g));
+	*r = _mm_packs_epi32(
+		colorconv_sse2_dot(yu_lo, v1_lo, colorconv_sse2_pair(k->ky, 0), k_r),
+		colorconv_sse2_dot(yu_hi, v1_hi, colorconv_sse2_pair(k->ky, 0), k_r));
+}
+
+/* 16 pixels of b, g and r bytes to b, g, r, a */
+static inline void colorconv_sse2_store_bgra(uint8_t *rgb, __m128i b, __m128i g, __m128i r)
+{
+	const __m128i			a		= _mm_set1_epi8(-1);
+	__m128i				bg_lo;
+	__m128i				bg_hi;
+	__m128i				ra_lo;
+	__m128i				ra_hi;
+
+	bg_lo	= _mm_unpacklo_epi8(b, g);
+	bg_hi	= _mm_unpackhi_epi8(b, g);
+	ra_lo	= _mm_unpacklo_epi8(r, a);
+	ra_hi	= _mm_unpackhi_epi8(r, a);
+
+	_mm_storeu_si128((__m128i *)&rgb[0], _mm_unpacklo_epi16(bg_lo, ra_lo));
+	_mm_storeu_si128((__m128i *)&rgb[16], _mm_unpackhi_epi16(bg_lo, ra_lo));
+	_mm_storeu_si128((__m128i *)&rgb[32], _mm_unpacklo_epi16(bg_hi, ra_hi));
+	_mm_storeu_si128((__m128i *)&rgb[48], _mm_unpackhi_epi16(bg_hi, ra_hi));
+}
+
+static void colorconv_sse2_yuv_to_rgb32(const struct colorconv_coefs *k,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgb, unsigned int width)
+{
+	const __m128i			zero		= _mm_setzero_si128();
+	const __m128i			y_offset	= _mm_set1_epi16(k->y_offset);
+	const __m128i			c_offset	= _mm_set1_epi16(128);
+	__m128i				yy;
+	__m128i				uu;
+	__m128i				vv;
+	__m128i				b_lo;
+	__m128i				g_lo;
+	__m128i				r_lo;
+	__m128i				b_hi;
+	__m128i				g_hi;
+	__m128i				r_hi;
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + COLORCONV_X86_PIXELS) <= width; x += COLORCONV_X86_PIXELS) {
+		yy = _mm_loadu_si128((const __m128i *)&y[x]);
+		uu = _mm_loadu_si128((const __m128i *)&u[x]);
+		vv = _mm_loadu_si128((const __m128i *)&v[x]);
+
+		colorconv_sse2_yuv_to_bgr(k,
+			_mm_sub_epi16(_mm_unpacklo_epi8(yy, zero), y_offset),
+			_mm_sub_epi16(_mm_unpacklo_epi8(uu, zero), c_offset),
+			_mm_sub_epi16(_mm_unpacklo_epi8(vv, zero), c_offset),
+			&b_lo, &g_lo, &r_lo);
+		colorconv_sse2_yuv_to_bgr(k,
+			_mm_sub_epi16(_mm_unpackhi_epi8(yy, zero), y_offset),
+			_mm_sub_epi16(_mm_unpackhi_epi8(uu, zero), c_offset),
+			_mm_sub_epi16(_mm_unpackhi_epi8(vv, zero), c_offset),
+			&b_hi, &g_hi, &r_hi);
+
+		colorconv_sse2_store_bgra(&rgb[x * 4U], _mm_packus_epi16(b_lo, b_hi),
+			_mm_packus_epi16(g_lo, g_hi), _mm_packus_epi16(r_lo, r_hi));
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_yuv_to_rgb32(k, &y[x], &u[x], &v[x], &rgb[x * 4U], width - x);
+	}
+}
+
+/*
+ * 4 pixels of b, g, r, a bytes to 4 values of 32 bits. The b and r bytes
+ * are the low bytes of the 16 bit lanes and the g and a bytes the high ones.
+ */
+static inline __m128i colorconv_sse2_rgb_dot(__m128i px, __m128i k_br, __m128i k_ga,
+	__m128i offset)
+{
+	const __m128i			mask		= _mm_set1_epi16(0xFF);
+	const __m128i			round		= _mm_set1_epi32(COLORCONV_ROUND);
+	__m128i				sum;
+
+	sum = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(px, mask), k_br),
+		_mm_madd_epi16(_mm_srli_epi16(px, 8), k_ga));
+
+	return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum, round), COLORCONV_SHIFT), offset);
+}
+
+/* 16 pixels of b, g, r, a bytes to 16 bytes */
+static inline __m128i colorconv_sse2_rgb_to(const __m128i *px, int16_t kr, int16_t kg,
+	int16_t kb, int16_t offset)
+{
+	const __m128i			k_br		= colorconv_sse2_pair(kb, kr);
+	const __m128i			k_ga		= colorconv_sse2_pair(kg, 0);
+	const __m128i			off		= _mm_set1_epi32(offset);
+
+	return _mm_packus_epi16(
+		_mm_packs_epi32(colorconv_sse2_rgb_dot(px[0], k_br, k_ga, off),
+			colorconv_sse2_rgb_dot(px[1], k_br, k_ga, off)),
+		_mm_packs_epi32(colorconv_sse2_rgb_dot(px[2], k_br, k_ga, off),
+			colorconv_sse2_rgb_dot(px[3], k_br, k_ga, off)));
+}
+
+static void colorconv_sse2_rgb32_to_yuv(const struct colorconv_coefs *k,
+	const uint8_t *rgb, uint8_t *y, uint8_t *u, uint8_t *v, unsigned int width)
+{
+	__m128i				px[4];
+	unsigned int			x		= 0;
+	unsigned int			idx		= 0;
+
+	for (x = 0; (x + COLORCONV_X86_PIXELS) <= width; x += COLORCONV_X86_PIXELS) {
+		for (idx = 0; idx < 4U; idx++) {
+			/* 4 pixels each */
+			px[idx] = _mm_loadu_si128((const __m128i *)&rgb[(x + (idx * 4U)) * 4U]);
+		}
+
+		_mm_storeu_si128((__m128i *)&y[x],
+			colorconv_sse2_rgb_to(px, k->ky_r, k->ky_g, k->ky_b, k->y_offset));
+		_mm_storeu_si128((__m128i *)&u[x],
+			colorconv_sse2_rgb_to(px, k->ku_r, k->ku_g, k->ku_b, 128));
+		_mm_storeu_si128((__m128i *)&v[x],
+			colorconv_sse2_rgb_to(px, k->kv_r, k->kv_g, k->kv_b, 128));
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_rgb32_to_yuv(k, &rgb[x * 4U], &y[x], &u[x], &v[x], width - x);
+	}
+}
+
+/* c0, c1 of 16 bits in each 32 bits to 8 pairs of c0, c0 or c1, c1 */
+static inline __m128i colorconv_sse2_repeat(__m128i c, unsigned int is_high)
+{
+	__m128i				value;
+
+	value = (is_high == 1U) ? _mm_srli_epi32(c, 16) :
+		_mm_and_si128(c, _mm_set1_epi32(0xFFFF));
+
+	return _mm_or_si128(value, _mm_slli_epi32(value, 16));
+}
+
+static void colorconv_sse2_unpack_422(const uint8_t *src, uint8_t *y,
+	uint8_t *c0, uint8_t *c1, unsigned int y_offset, unsigned int width)
+{
+	const __m128i			mask		= _mm_set1_epi16(0xFF);
+	__m128i				p0;
+	__m128i				p1;
+	__m128i				c_lo;
+	__m128i				c_hi;
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + COLORCONV_X86_PIXELS) <= width; x += COLORCONV_X86_PIXELS) {
+		p0 = _mm_loadu_si128((const __m128i *)&src[x * 2U]);
+		p1 = _mm_loadu_si128((const __m128i *)&src[(x * 2U) + 16U]);
+
+		if (y_offset == 0U) {
+			/* y, c0, y, c1 */
+			_mm_storeu_si128((__m128i *)&y[x],
+				_mm_packus_epi16(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask)));
+			c_lo = _mm_srli_epi16(p0, 8);
+			c_hi = _mm_srli_epi16(p1, 8);
+		} else {
+			/* c0, y, c1, y */
+			_mm_storeu_si128((__m128i *)&y[x],
+				_mm_packus_epi16(_mm_srli_epi16(p0, 8), _mm_srli_epi16(p1, 8)));
+			c_lo = _mm_and_si128(p0, mask);
+			c_hi = _mm_and_si128(p1, mask);
+		}
+
+		_mm_storeu_si128((__m128i *)&c0[x], _mm_packus_epi16(
+			colorconv_sse2_repeat(c_lo, 0U), colorconv_sse2_repeat(c_hi, 0U)));
+		_mm_storeu_si128((__m128i *)&c1[x], _mm_packus_epi16(
+			colorconv_sse2_repeat(c_lo, 1U), colorconv_sse2_repeat(c_hi, 1U)));
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_unpack_422(&src[x * 2U], &y[x], &c0[x], &c1[x], y_offset, width - x);
+	}
+}
+
+static const struct colorconv_kernels colorconv_sse2_kernels = {
+	.isa		= (unsigned int)COLORCONV_ISA_SSE2,
+	.yuv_to_rgb32	= colorconv_sse2_yuv_to_rgb32,
+	.rgb32_to_yuv	= colorconv_sse2_rgb32_to_yuv,
+	.unpack_422	= colorconv_sse2_unpack_422,
+};
+
+const struct colorconv_kernels *colorconv_get_sse2_kernels(void)
+{
+	return &colorconv_sse2_kernels;
+}
+
+/*
+ * the avx2 kernels are built for the cpus which run them, whatever the
+ * compiler is told to build the rest for
+ */
+#define COLORCONV_AVX2			__attribute__((target("avx2")))
+
+COLORCONV_AVX2
+static inline __m256i colorconv_avx2_pair(int16_t a, int16_t b)
+{
+	return _mm256_set1_epi32((int32_t)(((uint32_t)(uint16_t)b << 16) | (uint16_t)a));
+}
+
+COLORCONV_AVX2
+static inline __m256i colorconv_avx2_dot(__m256i yu, __m256i v1, __m256i kyu, __m256i kv1)
+{
+	return _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yu, kyu),
+		_mm256_madd_epi16(v1, kv1)), COLORCONV_SHIFT);
+}
+
+/*
+ * 16 values of 16 bits to 16 bytes. The unpacks and the packs before are
+ * within the 128 bit lanes, so the values are in order.
+ */
+COLORCONV_AVX2
+static inline __m128i colorconv_avx2_pack(__m256i lo, __m256i hi)
+{
+	__m256i				value;
+
+	value = _mm256_packs_epi32(lo, hi);
+	value = _mm256_packus_epi16(value, value);
+
+	return _mm256_castsi256_si128(_mm256_permute4x64_epi64(value, 0x08));
+}
+
+COLORCONV_AVX2
+static void colorconv_avx2_yuv_to_rgb32(const struct colorconv_coefs *k,
+	const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgb, unsigned int width)
+{
+	const __m256i			one		= _mm256_set1_epi16(1);
+	const __m256i			y_offset	= _mm256_set1_epi16(k->y_offset);
+	const __m256i			c_offset	= _mm256_set1_epi16(128);
+	const __m256i			k_yb		= colorconv_avx2_pair(k->ky, k->kb_u);
+	const __m256i			k_yg		= colorconv_avx2_pair(k->ky, k->kg_u);
+	const __m256i			k_yr		= colorconv_avx2_pair(k->ky, 0);
+	const __m256i			k_b		= colorconv_avx2_pair(0, COLORCONV_ROUND);
+	const __m256i			k_g		= colorconv_avx2_pair(k->kg_v, COLORCONV_ROUND);
+	const __m256i			k_r		= colorconv_avx2_pair(k->kr_v, COLORCONV_ROUND);
+	__m256i				yy;
+	__m256i				uu;
+	__m256i				vv;
+	__m256i				yu_lo;
+	__m256i				yu_hi;
+	__m256i				v1_lo;
+	__m256i				v1_hi;
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + COLORCONV_X86_PIXELS) <= width; x += COLORCONV_X86_PIXELS) {
+		yy = _mm256_sub_epi16(_mm256_cvtepu8_epi16(
+			_mm_loadu_si128((const __m128i *)&y[x])), y_offset);
+		uu = _mm256_sub_epi16(_mm256_cvtepu8_epi16(
+			_mm_loadu_si128((const __m128i *)&u[x])), c_offset);
+		vv = _mm256_sub_epi16(_mm256_cvtepu8_epi16(
+			_mm_loadu_si128((const __m128i *)&v[x])), c_offset);
+
+		yu_lo	= _mm256_unpacklo_epi16(yy, uu);
+		yu_hi	= _mm256_unpackhi_epi16(yy, uu);
+		v1_lo	= _mm256_unpacklo_epi16(vv, one);
+		v1_hi	= _mm256_unpackhi_epi16(vv, one);
+
+		colorconv_sse2_store_bgra(&rgb[x * 4U],
+			colorconv_avx2_pack(colorconv_avx2_dot(yu_lo, v1_lo, k_yb, k_b),
+				colorconv_avx2_dot(yu_hi, v1_hi, k_yb, k_b)),
+			colorconv_avx2_pack(colorconv_avx2_dot(yu_lo, v1_lo, k_yg, k_g),
+				colorconv_avx2_dot(yu_hi, v1_hi, k_yg, k_g)),
+			colorconv_avx2_pack(colorconv_avx2_dot(yu_lo, v1_lo, k_yr, k_r),
+				colorconv_avx2_dot(yu_hi, v1_hi, k_yr, k_r)));
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_yuv_to_rgb32(k, &y[x], &u[x], &v[x], &rgb[x * 4U], width - x);
+	}
+}
+
+/* 8 pixels of b, g, r, a bytes to 8 values of 32 bits */
+COLORCONV_AVX2
+static inline __m256i colorconv_avx2_rgb_dot(__m256i px, __m256i k_br, __m256i k_ga,
+	__m256i offset)
+{
+	const __m256i			mask		= _mm256_set1_epi16(0xFF);
+	const __m256i			round		= _mm256_set1_epi32(COLORCONV_ROUND);
+	__m256i				sum;
+
+	sum = _mm256_add_epi32(_mm256_madd_epi16(_mm256_and_si256(px, mask), k_br),
+		_mm256_madd_epi16(_mm256_srli_epi16(px, 8), k_ga));
+
+	return _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(sum, round), COLORCONV_SHIFT),
+		offset);
+}
+
+/*
+ * 16 pixels to 16 bytes. The packs within the 128 bit lanes leave the
+ * values of pixels 0-3, 8-11, 4-7 and 12-15, which the permute puts back.
+ */
+COLORCONV_AVX2
+static inline __m128i colorconv_avx2_rgb_to(__m256i px0, __m256i px1, int16_t kr, int16_t kg,
+	int16_t kb, int16_t offset)
+{
+	const __m256i			k_br		= colorconv_avx2_pair(kb, kr);
+	const __m256i			k_ga		= colorconv_avx2_pair(kg, 0);
+	const __m256i			off		= _mm256_set1_epi32(offset);
+	__m256i				value;
+
+	value = _mm256_packs_epi32(colorconv_avx2_rgb_dot(px0, k_br, k_ga, off),
+		colorconv_avx2_rgb_dot(px1, k_br, k_ga, off));
+	value = _mm256_permute4x64_epi64(value, 0xD8);
+
+	return _mm_packus_epi16(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+}
+
+COLORCONV_AVX2
+static void colorconv_avx2_rgb32_to_yuv(const struct colorconv_coefs *k,
+	const uint8_t *rgb, uint8_t *y, uint8_t *u, uint8_t *v, unsigned int width)
+{
+	__m256i				px0;
+	__m256i				px1;
+	unsigned int			x		= 0;
+
+	for (x = 0; (x + COLORCONV_X86_PIXELS) <= width; x += COLORCONV_X86_PIXELS) {
+		px0 = _mm256_loadu_si256((const __m256i *)&rgb[x * 4U]);
+		px1 = _mm256_loadu_si256((const __m256i *)&rgb[(x * 4U) + 32U]);
+
+		_mm_storeu_si128((__m128i *)&y[x],
+			colorconv_avx2_rgb_to(px0, px1, k->ky_r, k->ky_g, k->ky_b, k->y_offset));
+		_mm_storeu_si128((__m128i *)&u[x],
+			colorconv_avx2_rgb_to(px0, px1, k->ku_r, k->ku_g, k->ku_b, 128));
+		_mm_storeu_si128((__m128i *)&v[x],
+			colorconv_avx2_rgb_to(px0, px1, k->kv_r, k->kv_g, k->kv_b, 128));
+	}
+
+	if (x < width) {
+		/* the pixels left */
+		colorconv_scalar_rgb32_to_yuv(k, &rgb[x * 4U], &y[x], &u[x], &v[x], width - x);
+	}
+}
+
+/* unpacking is bound by the stores, so it is the one of sse2 */
+static const struct colorconv_kernels colorconv_avx2_kernels = {
+	.isa		= (unsigned int)COLORCONV_ISA_AVX2,
+	.yuv_to_rgb32	= colorconv_avx2_yuv_to_rgb32,
+	.rgb32_to_yuv	= colorconv_avx2_rgb32_to_yuv,
+	.unpack_422	= colorconv_sse2_unpack_422,
+};
+
+const struct colorconv_kernels *colorconv_get_avx2_kernels(void)
+{
+	return (__builtin_cpu_supports("avx2") != 0) ? &colorconv_avx2_kernels : NULL;
+}
+#else
+const struct colorconv_kernels *colorconv_get_sse2_kernels(void)
+{
+	return NULL;
+}
+
+const struct colorconv_kernels *colorconv_get_avx2_kernels(void)
+{
+	return NULL;
+}
+#endif//defined(__SSE2__)
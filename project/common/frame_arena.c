@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "log.h"
+#include "frame_arena.h"
+
+#define FRAME_ARENA_HUGEPAGE_SIZE	(2UL * 1024UL * 1024UL)
+
+static size_t round_up(size_t size, size_t align)
+{
+	return (size + align - 1U) / align * align;
+}
+
+/* page size is a multiple of the cache line size */
+size_t frame_arena_align(size_t size)
+{
+	long				page_size	= 0;
+
+	page_size = sysconf(_SC_PAGESIZE);
+
+	return round_up(size, (page_size > 0) ? (size_t)page_size : 4096U);
+}
+
+static void *frame_arena_map(size_t size, unsigned int use_hugepage,
+	unsigned int *is_hugepage)
+{
+	void				*base		= MAP_FAILED;
+
+	*is_hugepage = 0;
+
+	if (use_hugepage == 1U) {
+		/* hugetlb pages must be reserved in advance */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB, -1, 0);
+		if (base == MAP_FAILED) {
+			logw("no hugetlb page is available, errno: %d\n", errno);
+		} else {
+			*is_hugepage = 1;
+		}
+	}
+
+	if (base == MAP_FAILED) {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+#if defined(MADV_HUGEPAGE)
+		if ((base != MAP_FAILED) && (use_hugepage == 1U)) {
+			/* fall back to transparent hugepages */
+			(void)madvise(base, size, MADV_HUGEPAGE);
+		}
+#endif//defined(MADV_HUGEPAGE)
+	}
+
+	return base;
+}
+
+int frame_arena_create(struct frame_arena *arena, size_t size,
+	unsigned int use_hugepage)
+{
+	size_t				map_size	= 0;
+	int				ret		= 0;
+
+	(void)memset(arena, 0, sizeof(*arena));
+
+	map_size = (use_hugepage == 1U) ?
+		round_up(size, FRAME_ARENA_HUGEPAGE_SIZE) : frame_arena_align(size);
+
+	arena->base = frame_arena_map(map_size, use_hugepage, &arena->is_hugepage);
+	if (arena->base == MAP_FAILED) {
+		loge("mmap(%zu), errno: %d\n", map_size, errno);
+		arena->base = NULL;
+		ret = -1;
+	} else {
+		arena->size = map_size;
+
+		/* MAP_POPULATE faults the pages in, mlock keeps them resident */
+		if (mlock(arena->base, arena->size) < 0) {
+			logw("mlock(%zu), errno: %d\n", arena->size, errno);
+		} else {
+			arena->is_locked = 1;
+		}
+
+		logi("frame arena: %zu bytes, hugepage: %u, locked: %u\n",
+			arena->size, arena->is_hugepage, arena->is_locked);
+	}
+
+	return ret;
+}
+
+/* the caller must forget the arena after destroying it */
+void frame_arena_destroy(const struct frame_arena *arena)
+{
+	if (arena->base != NULL) {
+		if (arena->is_locked == 1U) {
+			/* unlock */
+			(void)munlock(arena->base, arena->size);
+		}
+		(void)munmap(arena->base, arena->size);
+	}
+}
+
+/**
+ * @brief Slice a page aligned memory off the arena
+ *
+ * @param arena frame arena instance
+ * @param size size of the memory
+ * @return the address of the memory, or NULL if the arena is exhausted
+ */
+void *frame_arena_alloc(struct frame_arena *arena, size_t size)
+{
+	size_t				aligned		= 0;
+	void				*ret		= NULL;
+
+	aligned = frame_arena_align(size);
+
+	if ((arena->base == NULL) || (aligned > (arena->size - arena->used))) {
+		loge("frame arena is exhausted: %zu / %zu\n", arena->used, arena->size);
+	} else {
+		/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
+		ret = (void *)((unsigned char *)arena->base + arena->used);
+		arena->used += aligned;
+	}
+
+	return ret;
+}
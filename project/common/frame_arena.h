@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * one contiguous, page aligned and prefaulted memory to slice frame buffers
+ * from. The memory is populated and locked when it is created, so the first
+ * frames written into it do not take page faults.
+ */
+struct frame_arena {
+	void			*base;
+	size_t			size;
+	size_t			used;
+	unsigned int		is_hugepage;
+	unsigned int		is_locked;
+};
+
+extern int frame_arena_create(struct frame_arena *arena, size_t size,
+	unsigned int use_hugepage);
+extern void frame_arena_destroy(const struct frame_arena *arena);
+extern void *frame_arena_alloc(struct frame_arena *arena, size_t size);
+extern size_t frame_arena_align(size_t size);
+
+#endif//FRAME_ARENA_H
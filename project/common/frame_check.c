@@ -0,0 +1,445 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <linux/videodev2.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "log.h"
+#include "v4l2.h"
+#include "frame_check.h"
+
+#define FRAME_CHECK_BLOCK_SIZE		(16U)
+
+/*
+ * blocks sampled from the luma plane and from each of the other planes.
+ * 1024 blocks are 16 KiB of a 1920x720 frame, which is read in well under
+ * 0.2 ms even from an uncached buffer.
+ */
+#define FRAME_CHECK_LUMA_BLOCKS		(1024U)
+#define FRAME_CHECK_CHROMA_BLOCKS	(256U)
+
+#define FRAME_CHECK_HASH_SEED		(0xcbf29ce484222325ULL)
+#define FRAME_CHECK_HASH_PRIME		(0x9e3779b97f4a7c15ULL)
+
+enum luma_layout {
+	/* every byte of the luma plane */
+	LUMA_LAYOUT_PLANAR,
+	/* y0 and y1 of yuyv and yvyu */
+	LUMA_LAYOUT_EVEN,
+	/* y0 and y1 of uyvy and vyuy */
+	LUMA_LAYOUT_ODD,
+	/* g of rgb24 in a block starting at a pixel */
+	LUMA_LAYOUT_RGB24,
+	/* g of rgb32 */
+	LUMA_LAYOUT_RGB32,
+	LUMA_LAYOUT_MAX,
+};
+
+struct luma_format {
+	/* bytes of a pixel in the luma plane */
+	unsigned int			depth;
+	/* the blocks start at a multiple of this to keep the mask in phase */
+	unsigned int			align;
+	/* the luma bytes of a block */
+	unsigned int			samples;
+	uint8_t				mask[FRAME_CHECK_BLOCK_SIZE];
+};
+
+static const struct luma_format luma_formats[LUMA_LAYOUT_MAX] = {
+	[LUMA_LAYOUT_PLANAR] = {
+		1, 16, 16,
+		{ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }
+	},
+	[LUMA_LAYOUT_EVEN] = {
+		2, 16, 8,
+		{ 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0 }
+	},
+	[LUMA_LAYOUT_ODD] = {
+		2, 16, 8,
+		{ 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff }
+	},
+	[LUMA_LAYOUT_RGB24] = {
+		3, 48, 5,
+		{ 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0 }
+	},
+	[LUMA_LAYOUT_RGB32] = {
+		4, 16, 4,
+		{ 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0 }
+	},
+};
+
+/*
+ * sum and sum of squares of the masked bytes of the blocks, kept in vector
+ * registers across the blocks of a plane
+ */
+#if defined(__ARM_NEON)
+struct luma_acc {
+	uint32x4_t			sum;
+	uint32x4_t			sumsq;
+	uint8x16_t			mask;
+};
+
+static inline void luma_acc_init(struct luma_acc *acc, const uint8_t *mask)
+{
+	acc->sum	= vdupq_n_u32(0);
+	acc->sumsq	= vdupq_n_u32(0);
+	acc->mask	= vld1q_u8(mask);
+}
+
+static inline void luma_acc_add(struct luma_acc *acc, const uint8_t *block)
+{
+	uint8x16_t			v;
+
+	v		= vandq_u8(vld1q_u8(block), acc->mask);
+	acc->sum	= vpadalq_u16(acc->sum, vpaddlq_u8(v));
+	acc->sumsq	= vpadalq_u16(acc->sumsq, vmull_u8(vget_low_u8(v), vget_low_u8(v)));
+	acc->sumsq	= vpadalq_u16(acc->sumsq, vmull_u8(vget_high_u8(v), vget_high_u8(v)));
+}
+
+static inline void luma_acc_get(const struct luma_acc *acc, uint64_t *sum, uint64_t *sumsq)
+{
+	*sum	= (uint64_t)vgetq_lane_u32(acc->sum, 0) + vgetq_lane_u32(acc->sum, 1) +
+		  vgetq_lane_u32(acc->sum, 2) + vgetq_lane_u32(acc->sum, 3);
+	*sumsq	= (uint64_t)vgetq_lane_u32(acc->sumsq, 0) + vgetq_lane_u32(acc->sumsq, 1) +
+		  vgetq_lane_u32(acc->sumsq, 2) + vgetq_lane_u32(acc->sumsq, 3);
+}
+#elif defined(__SSE2__)
+struct luma_acc {
+	__m128i				sum;
+	__m128i				sumsq;
+	__m128i				mask;
+};
+
+static inline void luma_acc_init(struct luma_acc *acc, const uint8_t *mask)
+{
+	acc->sum	= _mm_setzero_si128();
+	acc->sumsq	= _mm_setzero_si128();
+	acc->mask	= _mm_loadu_si128((const __m128i *)mask);
+}
+
+static inline void luma_acc_add(struct luma_acc *acc, const uint8_t *block)
+{
+	const __m128i			zero		= _mm_setzero_si128();
+	__m128i				v;
+	__m128i				lo;
+	__m128i				hi;
+
+	v		= _mm_and_si128(_mm_loadu_si128((const __m128i *)block), acc->mask);
+	acc->sum	= _mm_add_epi64(acc->sum, _mm_sad_epu8(v, zero));
+	lo		= _mm_unpacklo_epi8(v, zero);
+	hi		= _mm_unpackhi_epi8(v, zero);
+	acc->sumsq	= _mm_add_epi32(acc->sumsq,
+		_mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+}
+
+static inline void luma_acc_get(const struct luma_acc *acc, uint64_t *sum, uint64_t *sumsq)
+{
+	uint64_t			sums[2]		= { 0, };
+	uint32_t			squares[4]	= { 0, };
+
+	_mm_storeu_si128((__m128i *)sums, acc->sum);
+	_mm_storeu_si128((__m128i *)squares, acc->sumsq);
+
+	*sum	= sums[0] + sums[1];
+	*sumsq	= (uint64_t)squares[0] + squares[1] + squares[2] + squares[3];
+}
+#else
+struct luma_acc {
+	uint64_t			sum;
+	uint64_t			sumsq;
+	const uint8_t			*mask;
+};
+
+static inline void luma_acc_init(struct luma_acc *acc, const uint8_t *mask)
+{
+	acc->sum	= 0;
+	acc->sumsq	= 0;
+	acc->mask	= mask;
+}
+
+static inline void luma_acc_add(struct luma_acc *acc, const uint8_t *block)
+{
+	unsigned int			idx		= 0;
+	unsigned int			value		= 0;
+
+	for (idx = 0; idx < FRAME_CHECK_BLOCK_SIZE; idx++) {
+		value		= (unsigned int)block[idx] & (unsigned int)acc->mask[idx];
+		acc->sum	+= value;
+		acc->sumsq	+= (uint64_t)value * value;
+	}
+}
+
+static inline void luma_acc_get(const struct luma_acc *acc, uint64_t *sum, uint64_t *sumsq)
+{
+	*sum	= acc->sum;
+	*sumsq	= acc->sumsq;
+}
+#endif
+
+static inline uint64_t hash_block(uint64_t hash, const uint8_t *block)
+{
+	uint64_t			words[2]	= { 0, };
+	uint64_t			ret		= hash;
+
+	(void)memcpy(words, block, sizeof(words));
+
+	ret = (ret ^ words[0]) * FRAME_CHECK_HASH_PRIME;
+	ret = (ret ^ words[1]) * FRAME_CHECK_HASH_PRIME;
+
+	return ret ^ (ret >> 29U);
+}
+
+static unsigned int get_luma_layout(unsigned int format)
+{
+	unsigned int			ret		= 0;
+
+	switch (format) {
+	case V4L2_PIX_FMT_RGB24:
+		ret = (unsigned int)LUMA_LAYOUT_RGB24;
+		break;
+	case V4L2_PIX_FMT_RGB32:
+		ret = (unsigned int)LUMA_LAYOUT_RGB32;
+		break;
+	case V4L2_PIX_FMT_YUYV:
+	case V4L2_PIX_FMT_YVYU:
+		ret = (unsigned int)LUMA_LAYOUT_EVEN;
+		break;
+	case V4L2_PIX_FMT_UYVY:
+	case V4L2_PIX_FMT_VYUY:
+		ret = (unsigned int)LUMA_LAYOUT_ODD;
+		break;
+	case V4L2_PIX_FMT_NV12:
+	case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV16:
+	case V4L2_PIX_FMT_NV61:
+	case V4L2_PIX_FMT_YUV420:
+	case V4L2_PIX_FMT_YVU420:
+	case V4L2_PIX_FMT_YUV422P:
+		ret = (unsigned int)LUMA_LAYOUT_PLANAR;
+		break;
+	default:
+		loge("v4l2 format (0x%08x) is not supported\n", format);
+		ret = (unsigned int)LUMA_LAYOUT_MAX;
+		break;
+	}
+
+	return ret;
+}
+
+/* the distance between n_blocks blocks spread evenly over length bytes */
+static size_t get_spacing(size_t length, unsigned int n_blocks, unsigned int align)
+{
+	size_t				spacing		= 0;
+
+	if (length >= ((size_t)n_blocks * align)) {
+		spacing = ((length - FRAME_CHECK_BLOCK_SIZE) / (n_blocks - 1U)) / align * align;
+	} else {
+		/* every aligned block */
+		spacing = align;
+	}
+
+	return spacing;
+}
+
+static void sample_luma(const uint8_t *base, size_t length, const struct luma_format *fmt,
+	struct frame_check_result *result, uint64_t *sum, uint64_t *sumsq)
+{
+	struct luma_acc			acc;
+	size_t				spacing		= 0;
+	size_t				offset		= 0;
+	unsigned int			n_blocks	= 0;
+	unsigned int			band		= 0;
+
+	luma_acc_init(&acc, fmt->mask);
+
+	for (band = 0; band < FRAME_CHECK_BANDS; band++) {
+		/* seeded apart so that equal bands do not hash the same */
+		result->band_hash[band] = FRAME_CHECK_HASH_SEED + band;
+	}
+
+	spacing = get_spacing(length, FRAME_CHECK_LUMA_BLOCKS, fmt->align);
+	for (offset = 0; ((offset + FRAME_CHECK_BLOCK_SIZE) <= length) &&
+			 (n_blocks < FRAME_CHECK_LUMA_BLOCKS); offset += spacing) {
+		band = n_blocks / (FRAME_CHECK_LUMA_BLOCKS / FRAME_CHECK_BANDS);
+		luma_acc_add(&acc, &base[offset]);
+		result->band_hash[band] = hash_block(result->band_hash[band], &base[offset]);
+		n_blocks++;
+	}
+
+	luma_acc_get(&acc, sum, sumsq);
+	result->luma_samples = n_blocks * fmt->samples;
+}
+
+static uint64_t sample_chroma(const uint8_t *base, size_t length, uint64_t hash)
+{
+	size_t				spacing		= 0;
+	size_t				offset		= 0;
+	unsigned int			n_blocks	= 0;
+	uint64_t			ret		= hash;
+
+	spacing = get_spacing(length, FRAME_CHECK_CHROMA_BLOCKS, FRAME_CHECK_BLOCK_SIZE);
+	for (offset = 0; ((offset + FRAME_CHECK_BLOCK_SIZE) <= length) &&
+			 (n_blocks < FRAME_CHECK_CHROMA_BLOCKS); offset += spacing) {
+		ret = hash_block(ret, &base[offset]);
+		n_blocks++;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Sample a sparse grid of a frame to tell blank frames and changes
+ *
+ * The luma statistics are taken from the first plane, limited to the luma
+ * of width * height pixels, and the hash covers every plane.
+ *
+ * @param format v4l2 pixel format of the frame
+ * @return 0 on success, -1 if the format is not supported or no plane is
+ * mapped
+ */
+int frame_check_analyze(unsigned int format, unsigned int width, unsigned int height,
+	const struct frame_check_plane *planes, unsigned int n_planes,
+	struct frame_check_result *result)
+{
+	const struct luma_format	*fmt		= NULL;
+	unsigned int			layout		= 0;
+	size_t				length		= 0;
+	uint64_t			sum		= 0;
+	uint64_t			sumsq		= 0;
+	uint64_t			mean		= 0;
+	uint64_t			hash		= FRAME_CHECK_HASH_SEED;
+	unsigned int			samples		= 0;
+	unsigned int			idx		= 0;
+	unsigned int			band		= 0;
+	int				ret		= 0;
+
+	layout = get_luma_layout(format);
+	if ((layout == (unsigned int)LUMA_LAYOUT_MAX) || (n_planes == 0U) ||
+	    (planes[0].addr == NULL)) {
+		loge("format(0x%08x) or planes(%u) is wrong\n", format, n_planes);
+		ret = -1;
+	} else {
+		fmt	= &luma_formats[layout];
+		length	= (size_t)width * height * fmt->depth;
+		if (length > planes[0].length) {
+			/* the plane is smaller than the format says */
+			length = planes[0].length;
+		}
+
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		sample_luma((const uint8_t *)planes[0].addr, length, fmt, result,
+			&sum, &sumsq);
+		samples = result->luma_samples;
+		for (band = 0; band < FRAME_CHECK_BANDS; band++) {
+			/* fold the bands into the hash of the frame */
+			hash = (hash ^ result->band_hash[band]) * FRAME_CHECK_HASH_PRIME;
+		}
+		for (idx = 1; idx < n_planes; idx++) {
+			if (planes[idx].addr != NULL) {
+				/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+				hash = sample_chroma((const uint8_t *)planes[idx].addr,
+					planes[idx].length, hash);
+			}
+		}
+
+		if (samples > 0U) {
+			mean = sum / samples;
+			result->luma_mean	= (unsigned int)mean;
+			result->luma_variance	= (unsigned int)((sumsq / samples) - (mean * mean));
+		} else {
+			result->luma_mean	= 0;
+			result->luma_variance	= 0;
+		}
+		result->hash		= hash;
+	}
+
+	return ret;
+}
+
+/* a uniform frame of any color, such as a buffer the source never wrote */
+unsigned int frame_check_is_blank(const struct frame_check_result *result)
+{
+	return (result->luma_variance < FRAME_CHECK_BLANK_VARIANCE) ? 1U : 0U;
+}
+
+/* the luma bands which differ between two frames */
+unsigned int frame_check_count_changed_bands(const struct frame_check_result *prev,
+	const struct frame_check_result *result)
+{
+	unsigned int			band		= 0;
+	unsigned int			ret		= 0;
+
+	for (band = 0; band < FRAME_CHECK_BANDS; band++) {
+		if (prev->band_hash[band] != result->band_hash[band]) {
+			/* changed */
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+void frame_check_reset_freeze(struct frame_freeze *freeze)
+{
+	freeze->repeats		= 0;
+	freeze->is_frozen	= 0;
+	freeze->has_last	= 0;
+}
+
+/**
+ * @brief Count the frames which repeat the previous one
+ *
+ * A frame repeats the previous one if its hash is the same, or if no more
+ * than FRAME_CHECK_FROZEN_BANDS of its luma bands changed.
+ *
+ * @return 1 when the feed has just become frozen, 0 otherwise
+ */
+unsigned int frame_check_update_freeze(struct frame_freeze *freeze,
+	const struct frame_check_result *result)
+{
+	unsigned int			changed		= FRAME_CHECK_BANDS;
+	unsigned int			ret		= 0;
+
+	/* the first frame has nothing to repeat */
+	if (freeze->has_last == 1U) {
+		changed = (result->hash == freeze->last.hash) ? 0U :
+			frame_check_count_changed_bands(&freeze->last, result);
+	}
+
+	if (changed <= FRAME_CHECK_FROZEN_BANDS) {
+		if (freeze->repeats < UINT_MAX) {
+			/* the same content */
+			freeze->repeats++;
+		}
+		if ((freeze->window > 0U) && (freeze->repeats >= freeze->window) &&
+		    (freeze->is_frozen == 0U)) {
+			freeze->is_frozen = 1;
+			freeze->events++;
+			ret = 1;
+		}
+	} else {
+		if (freeze->is_frozen == 1U) {
+			/* the feed is alive again */
+			logi("the feed is alive after %u repeated frames\n", freeze->repeats);
+		}
+		freeze->repeats		= 0;
+		freeze->is_frozen	= 0;
+	}
+
+	freeze->last		= *result;
+	freeze->has_last	= 1;
+
+	return ret;
+}
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_CHECK_H
+#define FRAME_CHECK_H
+
+#include <stdint.h>
+
+/* a frame whose sampled luma varies less than this is blank */
+#define FRAME_CHECK_BLANK_VARIANCE	(2U)
+
+/* the luma grid is hashed in horizontal bands to tell where a frame changed */
+#define FRAME_CHECK_BANDS		(32U)
+
+/*
+ * bands which may change in a frozen frame, as an on-screen clock or the
+ * counter of a serializer keeps running while the image is stuck
+ */
+#define FRAME_CHECK_FROZEN_BANDS	(1U)
+
+struct frame_check_plane {
+	const void			*addr;
+	unsigned int			length;
+};
+
+/*
+ * statistics of a sparse grid of 16-byte blocks sampled from every plane.
+ * The luma of rgb formats is approximated by the green channel.
+ */
+struct frame_check_result {
+	unsigned int			luma_mean;
+	unsigned int			luma_variance;
+	unsigned int			luma_samples;
+	/* of every sampled byte of every plane */
+	uint64_t			hash;
+	uint64_t			band_hash[FRAME_CHECK_BANDS];
+};
+
+/* consecutive frames with (nearly) the same content */
+struct frame_freeze {
+	/* frames in a row which make the feed frozen, 0 to disable */
+	unsigned int			window;
+
+	unsigned int			repeats;
+	unsigned int			is_frozen;
+	unsigned long long		events;
+	unsigned int			has_last;
+	struct frame_check_result	last;
+};
+
+extern int frame_check_analyze(unsigned int format, unsigned int width, unsigned int height,
+	const struct frame_check_plane *planes, unsigned int n_planes,
+	struct frame_check_result *result);
+extern unsigned int frame_check_is_blank(const struct frame_check_result *result);
+extern unsigned int frame_check_count_changed_bands(const struct frame_check_result *prev,
+	const struct frame_check_result *result);
+extern void frame_check_reset_freeze(struct frame_freeze *freeze);
+extern unsigned int frame_check_update_freeze(struct frame_freeze *freeze,
+	const struct frame_check_result *result);
+
+#endif//FRAME_CHECK_H
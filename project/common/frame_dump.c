@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "v4l2.h"
+#include "frame_dump.h"
+
+/**
+ * @brief Fill the layout of a frame in the header
+ *
+ * The planes are sized from v4l2_get_v4l2_sizeimage(): a single plane holds
+ * the whole image, and otherwise the luma plane is width * height bytes and
+ * the chroma planes share the rest. The sequence and the timestamp are left
+ * for the caller.
+ *
+ * @return 0 on success, -1 if the format is not supported
+ */
+int frame_dump_init_header(struct frame_dump_header *header, unsigned int format,
+	unsigned int width, unsigned int height)
+{
+	unsigned int			sizeimage	= 0;
+	unsigned int			n_planes	= 0;
+	unsigned int			luma		= 0;
+	unsigned int			chroma		= 0;
+	unsigned int			chroma_rows	= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	(void)memset(header, 0, sizeof(*header));
+
+	sizeimage	= v4l2_get_v4l2_sizeimage(format, width, height);
+	n_planes	= v4l2_get_planes_by_v4l2_format(format);
+	if ((sizeimage == 0U) || (n_planes == 0U) || (n_planes > FRAME_DUMP_MAX_PLANES) ||
+	    (height == 0U)) {
+		loge("format(0x%08x) or size(%u * %u) is wrong\n", format, width, height);
+		ret = -1;
+	} else {
+		header->magic		= FRAME_DUMP_MAGIC;
+		header->version		= (uint16_t)FRAME_DUMP_VERSION;
+		header->header_size	= (uint16_t)sizeof(*header);
+		header->fourcc		= format;
+		header->width		= width;
+		header->height		= height;
+		header->n_planes	= n_planes;
+
+		if (n_planes == 1U) {
+			header->sizes[0]	= sizeimage;
+			header->strides[0]	= sizeimage / height;
+		} else {
+			luma		= width * height;
+			chroma		= (sizeimage - luma) / (n_planes - 1U);
+			/* 4:2:0 has half the chroma rows of 4:2:2 */
+			chroma_rows	= (sizeimage == (luma * 2U)) ? height : (height / 2U);
+
+			header->sizes[0]	= luma;
+			header->strides[0]	= width;
+			for (idx = 1; idx < n_planes; idx++) {
+				header->sizes[idx]	= chroma;
+				header->strides[idx]	= (chroma_rows > 0U) ? (chroma / chroma_rows) : 0U;
+			}
+		}
+	}
+
+	return ret;
+}
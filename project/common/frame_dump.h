@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_DUMP_H
+#define FRAME_DUMP_H
+
+#include <stdint.h>
+
+/* "FDMP" */
+#define FRAME_DUMP_MAGIC		(0x504d4446U)
+#define FRAME_DUMP_VERSION		(1U)
+#define FRAME_DUMP_MAX_PLANES		(3U)
+
+/*
+ * header of a dumped frame, followed by its planes in order. It is
+ * little-endian and 64 bytes, so the tools can read it without knowing the
+ * options the frame was captured with.
+ */
+struct frame_dump_header {
+	uint32_t			magic;
+	uint16_t			version;
+	uint16_t			header_size;
+	/* v4l2 pixel format */
+	uint32_t			fourcc;
+	uint32_t			width;
+	uint32_t			height;
+	uint32_t			n_planes;
+	uint32_t			sequence;
+	uint32_t			reserved;
+	uint64_t			timestamp_us;
+	/* bytes per line and bytes of each plane */
+	uint32_t			strides[FRAME_DUMP_MAX_PLANES];
+	uint32_t			sizes[FRAME_DUMP_MAX_PLANES];
+};
+
+extern int frame_dump_init_header(struct frame_dump_header *header, unsigned int format,
+	unsigned int width, unsigned int height);
+
+#endif//FRAME_DUMP_H
@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "log.h"
+#include "frame_export.h"
+
+static void frame_export_close_client(struct frame_export *exp)
+{
+	if (exp->client_fd >= 0) {
+		/* also removed from the event loop */
+		(void)close(exp->client_fd);
+		exp->client_fd = -1;
+		logi("the client of the exported frames is gone\n");
+	}
+}
+
+/**
+ * @brief Listen for the client of the exported frames
+ *
+ * @param path unix socket to bind, replaced if it is left by a run before
+ * @return 0 if listening, -1 otherwise
+ */
+int frame_export_start(struct frame_export *exp, const char *path)
+{
+	struct sockaddr_un		addr;
+	int				ret		= 0;
+
+	(void)memset(exp, 0, sizeof(*exp));
+	exp->listen_fd	= -1;
+	exp->client_fd	= -1;
+
+	(void)memset(&addr, 0, sizeof(addr));
+	addr.sun_family	= AF_UNIX;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	ret = snprintf(exp->path, sizeof(exp->path), "%s", path);
+	if ((ret < 0) || ((size_t)ret >= sizeof(addr.sun_path))) {
+		loge("path(%s) is too long\n", path);
+		ret = -1;
+	} else {
+		(void)memcpy(addr.sun_path, exp->path, (size_t)ret);
+
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		exp->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+		if (exp->listen_fd < 0) {
+			loge("socket, errno: %d\n", errno);
+			ret = -1;
+		} else {
+			(void)unlink(exp->path);
+			/* coverity[misra_c_2012_rule_11_3_violation : FALSE] */
+			if ((bind(exp->listen_fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+			    (listen(exp->listen_fd, 1) < 0)) {
+				loge("Failed to listen on %s, errno: %d\n", exp->path, errno);
+				(void)close(exp->listen_fd);
+				exp->listen_fd = -1;
+				ret = -1;
+			} else {
+				logi("frames are exported on %s\n", exp->path);
+				exp->is_started = 1;
+				ret = 0;
+			}
+		}
+	}
+
+	return ret;
+}
+
+/* the frame in flight is left to the client, which keeps its own fds of it */
+void frame_export_stop(struct frame_export *exp)
+{
+	if (exp->is_started == 1U) {
+		logi("frames exported: %llu, skipped: %llu, failed: %llu\n",
+			exp->stats.sent, exp->stats.skipped, exp->stats.failed);
+
+		frame_export_close_client(exp);
+		(void)close(exp->listen_fd);
+		(void)unlink(exp->path);
+		(void)memset(exp, 0, sizeof(*exp));
+		exp->listen_fd	= -1;
+		exp->client_fd	= -1;
+	}
+}
+
+/**
+ * @brief Accept the client which connects to the socket
+ *
+ * A client which connects while another one is served is hung up.
+ *
+ * @return the fd of the client to watch, or -1 if none is accepted
+ */
+int frame_export_accept(struct frame_export *exp)
+{
+	int				fd		= -1;
+	int				ret		= -1;
+
+	if (exp->is_started == 1U) {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = accept4(exp->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+		if (fd < 0) {
+			/* the client may have given up */
+			logw("accept4, errno: %d\n", errno);
+		} else if (exp->client_fd >= 0) {
+			logw("a client is already served\n");
+			(void)close(fd);
+		} else {
+			logi("a client of the exported frames is connected\n");
+			exp->client_fd	= fd;
+			exp->is_busy	= 0;
+			ret = fd;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Send a frame to the client with the dma-buf fds of its planes
+ *
+ * The fds are duplicated into the client, so the frame stays readable by it
+ * even after the buffers are freed, but the buffer must not be requeued until
+ * frame_export_reap() gives the cookie back.
+ *
+ * @return 0 if sent, or -1 if there is no client, the client still reads the
+ * frame before, or the frame fails to be sent
+ */
+int frame_export_send(struct frame_export *exp, const struct frame_dump_header *header,
+	const int *fds, unsigned int n_fds, unsigned int cookie)
+{
+	union {
+		struct cmsghdr			align;
+		char				buf[CMSG_SPACE(sizeof(int) * FRAME_DUMP_MAX_PLANES)];
+	} control;
+	struct msghdr			msg;
+	struct iovec			iov		= { 0, };
+	struct cmsghdr			*cmsg		= NULL;
+	int				ret		= 0;
+
+	if ((exp->is_started == 0U) || (exp->client_fd < 0) ||
+	    (n_fds == 0U) || (n_fds > FRAME_DUMP_MAX_PLANES)) {
+		/* nobody to send to */
+		ret = -1;
+	} else if (exp->is_busy == 1U) {
+		exp->stats.skipped++;
+		ret = -1;
+	} else {
+		(void)memset(&control, 0, sizeof(control));
+		(void)memset(&msg, 0, sizeof(msg));
+
+		/* coverity[misra_c_2012_rule_11_8_violation : FALSE] */
+		iov.iov_base		= (void *)header;
+		iov.iov_len		= sizeof(*header);
+		msg.msg_iov		= &iov;
+		msg.msg_iovlen		= 1;
+		msg.msg_control		= control.buf;
+		msg.msg_controllen	= CMSG_SPACE(sizeof(int) * n_fds);
+
+		cmsg			= CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level	= SOL_SOCKET;
+		cmsg->cmsg_type		= SCM_RIGHTS;
+		cmsg->cmsg_len		= CMSG_LEN(sizeof(int) * n_fds);
+		(void)memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * n_fds);
+
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		if (sendmsg(exp->client_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+			/* a client which is gone is closed by frame_export_reap() */
+			logd("sendmsg, errno: %d\n", errno);
+			exp->stats.failed++;
+			ret = -1;
+		} else {
+			exp->is_busy	= 1;
+			exp->cookie	= cookie;
+			exp->sequence	= header->sequence;
+			exp->stats.sent++;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Take back the buffer of the frame the client is done with
+ *
+ * The frame is also given back when the client hangs up, which closes the
+ * connection.
+ *
+ * @return 1 if the cookie of the frame sent is returned, or 0 if none is
+ * given back
+ */
+int frame_export_reap(struct frame_export *exp, unsigned int *cookie)
+{
+	uint32_t			sequence	= 0;
+	ssize_t				len		= 0;
+	int				ret		= 0;
+
+	if ((exp->is_started == 1U) && (exp->client_fd >= 0)) {
+		len = recv(exp->client_fd, &sequence, sizeof(sequence), MSG_DONTWAIT);
+		if ((len < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+			/* nothing to read yet */
+			logd("recv, errno: %d\n", errno);
+		} else if (len == (ssize_t)sizeof(sequence)) {
+			if ((exp->is_busy == 1U) && (sequence == exp->sequence)) {
+				/* done */
+				exp->is_busy	= 0;
+				*cookie		= exp->cookie;
+				ret = 1;
+			} else {
+				/* a frame sent before the stream is stopped */
+				logw("sequence(%u) is not the frame sent\n", sequence);
+			}
+		} else {
+			if (len < 0) {
+				/* error */
+				loge("recv, errno: %d\n", errno);
+			}
+			frame_export_close_client(exp);
+			if (exp->is_busy == 1U) {
+				/* the client has no use for the frame any more */
+				exp->is_busy	= 0;
+				*cookie		= exp->cookie;
+				ret = 1;
+			}
+		}
+	}
+
+	return ret;
+}
+
+/* forget the frame in flight, as its buffer is freed with the stream */
+void frame_export_cancel(struct frame_export *exp)
+{
+	exp->is_busy = 0;
+}
+
+/* readable when a client connects */
+int frame_export_get_fd(const struct frame_export *exp)
+{
+	return (exp->is_started == 1U) ? exp->listen_fd : -1;
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include <stdint.h>
+
+#include "frame_dump.h"
+
+/* the unix socket the frames are exported through */
+#define FRAME_EXPORT_PATH		"/tmp/camera_app_frames.sock"
+#define FRAME_EXPORT_PATH_MAX		(108U)
+
+struct frame_export_stats {
+	unsigned long long		sent;
+	/* frames skipped because the client still reads the frame before */
+	unsigned long long		skipped;
+	unsigned long long		failed;
+};
+
+/*
+ * The captured frames are handed to another process as the dma-buf fds of
+ * their planes, so it reads them where they are captured instead of from a
+ * copy. A frame is sent as its struct frame_dump_header with the fds
+ * attached (SCM_RIGHTS), and the client sends the sequence of the header
+ * back when it is done with the frame. Until then the buffer must not be
+ * requeued, and the next frames are skipped.
+ *
+ * One client is served at a time, and every call is made by the thread of
+ * the event loop.
+ */
+struct frame_export {
+	unsigned int			is_started;
+	int				listen_fd;
+	int				client_fd;
+	char				path[FRAME_EXPORT_PATH_MAX];
+
+	/* the frame the client still reads */
+	unsigned int			is_busy;
+	unsigned int			cookie;
+	uint32_t			sequence;
+
+	struct frame_export_stats	stats;
+};
+
+extern int frame_export_start(struct frame_export *exp, const char *path);
+extern void frame_export_stop(struct frame_export *exp);
+extern int frame_export_accept(struct frame_export *exp);
+extern int frame_export_send(struct frame_export *exp, const struct frame_dump_header *header,
+	const int *fds, unsigned int n_fds, unsigned int cookie);
+extern int frame_export_reap(struct frame_export *exp, unsigned int *cookie);
+extern void frame_export_cancel(struct frame_export *exp);
+extern int frame_export_get_fd(const struct frame_export *exp);
+
+#endif//FRAME_EXPORT_H
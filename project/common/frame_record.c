@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "frame_record.h"
+
+static uint64_t frame_record_align(uint64_t size)
+{
+	return (size + ((uint64_t)FRAME_RECORD_ALIGN - 1U)) & ~((uint64_t)FRAME_RECORD_ALIGN - 1U);
+}
+
+static int frame_record_pwrite_all(int fd, const void *data, size_t length, uint64_t offset)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const unsigned char		*src		= (const unsigned char *)data;
+	size_t				size		= 0;
+	ssize_t				len		= 0;
+	int				ret		= 0;
+
+	while ((size < length) && (ret == 0)) {
+		len = pwrite(fd, &src[size], length - size, (off_t)(offset + size));
+		if (len > 0) {
+			/* written */
+			size += (size_t)len;
+		} else if ((len < 0) && (errno == EINTR)) {
+			/* again */
+			logd("pwrite is interrupted\n");
+		} else {
+			loge("pwrite(%zu / %zu), errno: %d\n", size, length, errno);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/* pwritev() until every vector is written, the vectors are consumed */
+static int frame_record_pwritev_all(int fd, struct iovec *iov, unsigned int n_iov,
+	uint64_t offset)
+{
+	struct iovec			*cur		= iov;
+	unsigned int			left		= n_iov;
+	uint64_t			pos		= offset;
+	ssize_t				len		= 0;
+	size_t				done		= 0;
+	int				ret		= 0;
+
+	while ((left > 0U) && (ret == 0)) {
+		len = pwritev(fd, cur, (int)left, (off_t)pos);
+		if (len > 0) {
+			pos	+= (uint64_t)len;
+			done	= (size_t)len;
+			while ((left > 0U) && (done >= cur->iov_len)) {
+				/* the vector is written */
+				done -= cur->iov_len;
+				cur++;
+				left--;
+			}
+			if (left > 0U) {
+				/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
+				cur->iov_base	= (void *)((unsigned char *)cur->iov_base + done);
+				cur->iov_len	-= done;
+			}
+		} else if ((len < 0) && (errno == EINTR)) {
+			/* again */
+			logd("pwritev is interrupted\n");
+		} else {
+			loge("pwritev(%u vectors left), errno: %d\n", left, errno);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/* reserve the extents up to end, a few frames at a time */
+static int frame_record_reserve(struct frame_record *record, uint64_t end, uint64_t frame_size)
+{
+	uint64_t			size		= 0;
+	int				ret		= 0;
+
+	if (end > record->allocated) {
+		size = frame_record_align(frame_size) * FRAME_RECORD_EXTENT_FRAMES;
+		if ((record->allocated + size) < end) {
+			/* a frame larger than the extent */
+			size = end - record->allocated;
+		}
+
+		ret = fallocate(record->fd, 0, (off_t)record->allocated, (off_t)size);
+		if (ret < 0) {
+			if (errno == EOPNOTSUPP) {
+				/* the file system allocates as it is written */
+				ret = 0;
+			} else {
+				loge("fallocate(%llu), errno: %d\n", (unsigned long long)size, errno);
+				ret = -1;
+			}
+		}
+		if (ret == 0) {
+			/* reserved */
+			record->allocated += size;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Create a recording with room for capacity frames in its index
+ *
+ * The header and the index are preallocated, and the frames are reserved in
+ * extents of FRAME_RECORD_EXTENT_FRAMES frames as they are appended.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int frame_record_create(struct frame_record *record, const char *path,
+	unsigned int capacity)
+{
+	struct frame_record_header	*header		= NULL;
+	int				ret		= 0;
+
+	(void)memset(record, 0, sizeof(*record));
+	header			= &record->header;
+
+	header->magic		= FRAME_RECORD_MAGIC;
+	header->version		= (uint16_t)FRAME_RECORD_VERSION;
+	header->header_size	= (uint16_t)sizeof(*header);
+	header->entry_size	= (uint32_t)sizeof(struct frame_record_entry);
+	header->capacity	= capacity;
+	header->align		= FRAME_RECORD_ALIGN;
+	header->index_offset	= FRAME_RECORD_ALIGN;
+	header->data_offset	= frame_record_align(header->index_offset +
+		((uint64_t)capacity * sizeof(struct frame_record_entry)));
+	header->data_end	= header->data_offset;
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	record->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+	if ((capacity == 0U) || (record->fd < 0)) {
+		loge("Failed to create %s(capacity: %u), errno: %d\n", path, capacity, errno);
+		ret = -1;
+	} else {
+		ret = frame_record_reserve(record, header->data_offset, 0U);
+		if (ret == 0) {
+			/* n_frames is 0, so the index is not read yet */
+			ret = frame_record_pwrite_all(record->fd, header, sizeof(*header), 0U);
+		}
+	}
+
+	if ((ret < 0) && (record->fd >= 0)) {
+		(void)close(record->fd);
+		record->fd = -1;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Append a frame at the next aligned offset and add it to the index
+ *
+ * @return 0 on success, -1 on failure or if the index is full
+ */
+int frame_record_append(struct frame_record *record,
+	const struct frame_dump_header *frame, const struct iovec *planes,
+	unsigned int n_planes)
+{
+	struct frame_record_header	*header		= NULL;
+	struct frame_record_entry	entry;
+	struct iovec			iov[FRAME_DUMP_MAX_PLANES];
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	header		= &record->header;
+
+	(void)memset((void *)&entry, 0, sizeof(entry));
+
+	if ((record->fd < 0) || (header->n_frames >= header->capacity) ||
+	    (n_planes > FRAME_DUMP_MAX_PLANES)) {
+		loge("the recording is full(%u) or planes(%u) is wrong\n", header->n_frames, n_planes);
+		ret = -1;
+	} else {
+		entry.offset	= frame_record_align(header->data_end);
+		entry.frame	= *frame;
+		for (idx = 0; idx < n_planes; idx++) {
+			/* the vectors are consumed by the partial writes */
+			iov[idx]	= planes[idx];
+			entry.length	+= planes[idx].iov_len;
+		}
+
+		ret = frame_record_reserve(record, entry.offset + entry.length, entry.length);
+		if (ret == 0) {
+			/* payload */
+			ret = frame_record_pwritev_all(record->fd, iov, n_planes, entry.offset);
+		}
+		if (ret == 0) {
+			/* index */
+			ret = frame_record_pwrite_all(record->fd, &entry, sizeof(entry),
+				header->index_offset + ((uint64_t)header->n_frames * sizeof(entry)));
+		}
+		if (ret == 0) {
+			header->n_frames	= header->n_frames + 1U;
+			header->data_end	= entry.offset + entry.length;
+			ret = frame_record_pwrite_all(record->fd, header, sizeof(*header), 0U);
+		}
+	}
+
+	return ret;
+}
+
+/* the extents reserved beyond the last frame are given back */
+int frame_record_close(struct frame_record *record)
+{
+	int				ret		= 0;
+
+	if (record->fd >= 0) {
+		if (ftruncate(record->fd, (off_t)record->header.data_end) < 0) {
+			loge("ftruncate, errno: %d\n", errno);
+			ret = -1;
+		}
+
+		logi("frames recorded: %u / %u, bytes: %llu\n",
+			record->header.n_frames, record->header.capacity,
+			(unsigned long long)record->header.data_end);
+
+		(void)close(record->fd);
+		record->fd = -1;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Map a recording to read its frames
+ *
+ * @return 0 on success, -1 if the file is not a complete recording
+ */
+int frame_record_map_file(struct frame_record_map *map, const char *path)
+{
+	const struct frame_record_header	*header	= NULL;
+	struct stat			st;
+	void				*base		= MAP_FAILED;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	(void)memset(map, 0, sizeof(*map));
+
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if ((fd < 0) || (fstat(fd, &st) < 0) ||
+	    ((size_t)st.st_size < sizeof(struct frame_record_header))) {
+		loge("Failed to open %s, errno: %d\n", path, errno);
+		ret = -1;
+	} else {
+		base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (base == MAP_FAILED) {
+			loge("mmap, errno: %d\n", errno);
+			ret = -1;
+		}
+	}
+
+	if (fd >= 0) {
+		/* the mapping keeps the file */
+		(void)close(fd);
+	}
+
+	if (ret == 0) {
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		header = (const struct frame_record_header *)base;
+		if ((header->magic != FRAME_RECORD_MAGIC) ||
+		    (header->version != (uint16_t)FRAME_RECORD_VERSION) ||
+		    (header->entry_size != (uint32_t)sizeof(struct frame_record_entry)) ||
+		    (header->n_frames > header->capacity) ||
+		    (header->data_end > (uint64_t)st.st_size) ||
+		    ((header->index_offset + ((uint64_t)header->capacity * header->entry_size)) >
+		     header->data_offset)) {
+			loge("%s is not a recording\n", path);
+			(void)munmap(base, (size_t)st.st_size);
+			ret = -1;
+		} else {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			map->base	= (const unsigned char *)base;
+			map->size	= (size_t)st.st_size;
+			map->header	= header;
+			/* coverity[misra_c_2012_rule_11_3_violation : FALSE] */
+			map->index	= (const struct frame_record_entry *)&map->base[header->index_offset];
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Look a frame up by its position in the recording
+ *
+ * @return the payload of the frame, or NULL if idx is out of the recording
+ */
+const void *frame_record_get_frame(const struct frame_record_map *map,
+	unsigned int idx, const struct frame_record_entry **entry)
+{
+	const struct frame_record_entry	*cur		= NULL;
+	const void			*ret		= NULL;
+
+	if ((map->header != NULL) && (idx < map->header->n_frames)) {
+		cur = &map->index[idx];
+		if ((cur->offset + cur->length) <= (uint64_t)map->size) {
+			/* in the mapping */
+			ret	= (const void *)&map->base[cur->offset];
+			*entry	= cur;
+		}
+	}
+
+	return ret;
+}
+
+void frame_record_unmap(struct frame_record_map *map)
+{
+	if (map->base != NULL) {
+		/* coverity[misra_c_2012_rule_11_8_violation : FALSE] */
+		(void)munmap((void *)map->base, map->size);
+	}
+	(void)memset(map, 0, sizeof(*map));
+}
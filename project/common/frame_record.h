@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_RECORD_H
+#define FRAME_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "frame_dump.h"
+
+/* "FREC" */
+#define FRAME_RECORD_MAGIC		(0x43455246U)
+#define FRAME_RECORD_VERSION		(1U)
+
+/* the index and every frame start at this alignment, so they can be mapped */
+#define FRAME_RECORD_ALIGN		(4096U)
+
+/* the payload is preallocated in extents of this many frames */
+#define FRAME_RECORD_EXTENT_FRAMES	(16U)
+
+/*
+ * A recording is one file of:
+ *   - this header, in the first FRAME_RECORD_ALIGN bytes
+ *   - the index, an array of capacity entries at index_offset
+ *   - the frames, each at an aligned offset from data_offset
+ *
+ * An entry is written before n_frames counts it, so a reader never sees an
+ * entry which is not complete. Everything is little-endian.
+ */
+struct frame_record_header {
+	uint32_t			magic;
+	uint16_t			version;
+	uint16_t			header_size;
+	uint32_t			entry_size;
+	uint32_t			capacity;
+	uint32_t			n_frames;
+	uint32_t			align;
+	uint64_t			index_offset;
+	uint64_t			data_offset;
+	/* the end of the last frame */
+	uint64_t			data_end;
+	uint8_t				reserved[16];
+};
+
+struct frame_record_entry {
+	uint64_t			offset;
+	uint64_t			length;
+	/* the format, the geometry, the sequence and the planes of the frame */
+	struct frame_dump_header	frame;
+};
+
+/* the writer of a recording, used by one thread */
+struct frame_record {
+	int				fd;
+	struct frame_record_header	header;
+	/* bytes reserved by fallocate() */
+	uint64_t			allocated;
+};
+
+/* a recording mapped read-only to look frames up by their index */
+struct frame_record_map {
+	const unsigned char		*base;
+	size_t				size;
+	const struct frame_record_header	*header;
+	const struct frame_record_entry	*index;
+};
+
+extern int frame_record_create(struct frame_record *record, const char *path,
+	unsigned int capacity);
+extern int frame_record_append(struct frame_record *record,
+	const struct frame_dump_header *frame, const struct iovec *planes,
+	unsigned int n_planes);
+extern int frame_record_close(struct frame_record *record);
+
+extern int frame_record_map_file(struct frame_record_map *map, const char *path);
+extern const void *frame_record_get_frame(const struct frame_record_map *map,
+	unsigned int idx, const struct frame_record_entry **entry);
+extern void frame_record_unmap(struct frame_record_map *map);
+
+#endif//FRAME_RECORD_H
@@ -0,0 +1,500 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+#include "log.h"
+#include "frame_ring.h"
+#include "latency.h"
+
+static uint64_t frame_ring_min(uint64_t a, uint64_t b)
+{
+	return (a < b) ? a : b;
+}
+
+static void frame_ring_begin_persist(struct frame_ring *ring, unsigned int trigger)
+{
+	uint64_t			preroll		= 0;
+	uint64_t			capacity	= 0;
+	int				ret		= 0;
+
+	/* the oldest slot is kept from being overwritten once persisting */
+	preroll		= frame_ring_min(frame_ring_min(ring->preroll, ring->n_slots), ring->written);
+	capacity	= preroll + ((trigger == (unsigned int)FRAME_RING_TRIGGER_SNAPSHOT) ?
+		ring->postroll : FRAME_RING_RECORD_FRAMES);
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	ret = snprintf(ring->path, sizeof(ring->path), "video_record.%u.rec", ring->record_idx);
+	if (ret > 0) {
+		/* the writer keeps as many frames in flight as it can */
+		ret = frame_writer_start_record(&ring->writer, FRAME_WRITER_SLOTS,
+			ring->path, (unsigned int)capacity);
+	}
+	if (ret < 0) {
+		/* error */
+		loge("Failed to start persisting %s\n", ring->path);
+	} else {
+		ring->persist_next	= ring->written - preroll;
+		ring->persist_reaped	= ring->persist_next;
+		ring->persist_end	= ring->persist_next + capacity;
+		ring->is_persisting	= 1;
+		ring->is_recording	= (trigger == (unsigned int)FRAME_RING_TRIGGER_START) ? 1U : 0U;
+		ring->record_idx	= ring->record_idx + 1U;
+
+		logi("persisting %s: pre-roll %llu frames, capacity %llu frames\n",
+			ring->path, (unsigned long long)preroll, (unsigned long long)capacity);
+	}
+}
+
+static void frame_ring_handle_triggers(struct frame_ring *ring)
+{
+	unsigned int			triggers	= 0;
+	unsigned int			trigger		= 0;
+
+	triggers = atomic_exchange(&ring->triggers, 0U);
+
+	/* a recording which is started and stopped at once still has its pre-roll */
+	for (trigger = 0; trigger <= (unsigned int)FRAME_RING_TRIGGER_STOP; trigger++) {
+		if ((triggers & (1U << trigger)) == 0U) {
+			/* not triggered */
+			continue;
+		}
+
+		if (trigger == (unsigned int)FRAME_RING_TRIGGER_STOP) {
+			if (ring->is_recording == 1U) {
+				ring->persist_end	= frame_ring_min(ring->persist_end,
+					ring->written + ring->postroll);
+				ring->is_recording	= 0;
+			} else {
+				/* nothing to stop */
+				logw("no recording is started\n");
+			}
+		} else if (ring->is_persisting == 1U) {
+			/* one recording at a time */
+			logw("%s is still being persisted\n", ring->path);
+		} else {
+			frame_ring_begin_persist(ring, trigger);
+		}
+	}
+}
+
+static void frame_ring_copy_input(struct frame_ring *ring)
+{
+	struct frame_ring_slot		*slot		= NULL;
+	const struct frame_ring_slot	*input		= &ring->input;
+	uint64_t			ts_begin	= 0;
+	uint64_t			duration_ns	= 0;
+	uint64_t			value		= 1;
+	unsigned int			head		= 0;
+	unsigned int			tail		= 0;
+	unsigned int			idx		= 0;
+	size_t				offset		= 0;
+
+	tail = atomic_load_explicit(&ring->input_tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->input_head, memory_order_acquire);
+
+	if (head != tail) {
+		if ((ring->is_persisting == 1U) &&
+		    ((ring->written - ring->persist_reaped) >= ring->n_slots)) {
+			/* the storage does not keep up */
+			atomic_fetch_add(&ring->stats.blocked, 1U);
+		} else {
+			slot = &ring->slots[ring->written % ring->n_slots];
+
+			ts_begin = latency_get_time_ns();
+			slot->header	= input->header;
+			slot->n_planes	= input->n_planes;
+			for (idx = 0; idx < input->n_planes; idx++) {
+				/* the planes are packed in the slot */
+				slot->planes[idx].iov_base	= (void *)&slot->data[offset];
+				slot->planes[idx].iov_len	= input->planes[idx].iov_len;
+				(void)memcpy(slot->planes[idx].iov_base, input->planes[idx].iov_base,
+					input->planes[idx].iov_len);
+				offset += input->planes[idx].iov_len;
+			}
+			ring->written = ring->written + 1U;
+
+			duration_ns = latency_get_time_ns() - ts_begin;
+			atomic_fetch_add(&ring->stats.copied, 1U);
+			atomic_fetch_add(&ring->stats.copy_sum_ns, duration_ns);
+			if (duration_ns > atomic_load(&ring->stats.copy_max_ns)) {
+				/* only the thread stores it */
+				atomic_store(&ring->stats.copy_max_ns, duration_ns);
+			}
+		}
+
+		/* the memory of the frame can be reused */
+		atomic_store_explicit(&ring->input_tail, head, memory_order_release);
+		if (write(ring->fd_done, &value, sizeof(value)) < 0) {
+			/* nobody is woken up to reap it */
+			loge("write(fd_done), errno: %d\n", errno);
+		}
+	}
+}
+
+static void frame_ring_persist(struct frame_ring *ring)
+{
+	const struct frame_ring_slot	*slot		= NULL;
+	unsigned int			cookie		= 0;
+	uint64_t			end		= 0;
+	int				ret		= 0;
+
+	if (ring->is_persisting == 1U) {
+		while (frame_writer_reap(&ring->writer, &cookie) == 1) {
+			/* the frames are written in order */
+			ring->persist_reaped = ring->persist_reaped + 1U;
+			atomic_fetch_add(&ring->stats.persisted, 1U);
+		}
+
+		end = frame_ring_min(ring->written, ring->persist_end);
+		while ((ret == 0) && (ring->persist_next < end) &&
+		       ((ring->persist_next - ring->persist_reaped) < FRAME_WRITER_SLOTS)) {
+			slot = &ring->slots[ring->persist_next % ring->n_slots];
+			ret = frame_writer_queue(&ring->writer, ring->path, &slot->header,
+				slot->planes, slot->n_planes, 0U);
+			if (ret == 0) {
+				/* queued */
+				ring->persist_next = ring->persist_next + 1U;
+			}
+		}
+
+		if (ring->persist_reaped == ring->persist_end) {
+			/* every frame is written, so this does not wait */
+			frame_writer_stop(&ring->writer);
+			ring->is_persisting = 0;
+			logi("%s is persisted\n", ring->path);
+		}
+	}
+}
+
+/* the frames to persist are bounded by the frames copied, and written out */
+static void frame_ring_finish_persist(struct frame_ring *ring)
+{
+	struct pollfd			pfd		= { 0, };
+
+	ring->persist_end	= frame_ring_min(ring->persist_end, ring->written);
+	ring->is_recording	= 0;
+
+	while (ring->is_persisting == 1U) {
+		frame_ring_persist(ring);
+		if (ring->is_persisting == 1U) {
+			/* the next frame is written, and reaped by frame_ring_persist() */
+			pfd.fd		= frame_writer_get_fd(&ring->writer);
+			pfd.events	= POLLIN;
+			if ((poll(&pfd, 1, -1) < 0) && (errno != EINTR)) {
+				loge("poll, errno: %d\n", errno);
+				frame_writer_wait_idle(&ring->writer);
+			}
+		}
+	}
+}
+
+static void *frame_ring_thread(void *arg)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	struct frame_ring		*ring		= (struct frame_ring *)arg;
+	struct pollfd			pfds[2];
+	uint64_t			value		= 0;
+	unsigned int			is_running	= 1;
+
+	(void)memset((void *)pfds, 0, sizeof(pfds));
+
+	while (is_running == 1U) {
+		pfds[0].fd	= ring->fd_event;
+		pfds[0].events	= POLLIN;
+		/* poll() ignores a negative fd while nothing is persisted */
+		pfds[1].fd	= frame_writer_get_fd(&ring->writer);
+		pfds[1].events	= POLLIN;
+
+		if (poll(pfds, 2, -1) < 0) {
+			if (errno != EINTR) {
+				loge("poll, errno: %d\n", errno);
+				is_running = 0;
+			}
+		} else {
+			if ((pfds[0].revents & POLLIN) != 0) {
+				/* the frames and the triggers are all handled below */
+				(void)read(ring->fd_event, &value, sizeof(value));
+			}
+
+			frame_ring_handle_triggers(ring);
+			frame_ring_copy_input(ring);
+			frame_ring_persist(ring);
+
+			if (atomic_load(&ring->is_stopping) == 1U) {
+				frame_ring_finish_persist(ring);
+				is_running = 0;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int frame_ring_init_slots(struct frame_ring *ring, size_t budget, size_t frame_size)
+{
+	size_t				slots_size	= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	ring->slot_size	= frame_arena_align(frame_size);
+	ring->n_slots	= (unsigned int)(budget / ring->slot_size);
+	slots_size	= frame_arena_align((size_t)ring->n_slots * sizeof(struct frame_ring_slot));
+
+	if (ring->n_slots < 2U) {
+		loge("the budget(%zu) holds less than 2 frames of %zu bytes\n", budget, frame_size);
+		ret = -1;
+	} else {
+		/* every slot is prefaulted here, not while the frames are copied */
+		ret = frame_arena_create(&ring->arena,
+			slots_size + ((size_t)ring->n_slots * ring->slot_size), 0U);
+	}
+
+	if (ret == 0) {
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		ring->slots = (struct frame_ring_slot *)frame_arena_alloc(&ring->arena, slots_size);
+		for (idx = 0; idx < ring->n_slots; idx++) {
+			(void)memset((void *)&ring->slots[idx], 0, sizeof(ring->slots[idx]));
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			ring->slots[idx].data = (unsigned char *)frame_arena_alloc(&ring->arena,
+				ring->slot_size);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Allocate the ring and start its thread
+ *
+ * @param budget the bytes of memory for the frames in the ring
+ * @param frame_size the largest frame to be copied
+ * @param preroll the frames before a trigger to persist, up to the slots
+ * @param postroll the frames after a trigger to persist
+ */
+int frame_ring_start(struct frame_ring *ring, size_t budget, size_t frame_size,
+	unsigned int preroll, unsigned int postroll)
+{
+	int				ret		= 0;
+
+	(void)memset(ring, 0, sizeof(*ring));
+	ring->fd_event	= -1;
+	ring->fd_done	= -1;
+	ring->preroll	= preroll;
+	ring->postroll	= postroll;
+
+	ret = frame_ring_init_slots(ring, budget, frame_size);
+	if (ret == 0) {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		ring->fd_event	= eventfd(0, EFD_CLOEXEC);
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		ring->fd_done	= eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if ((ring->fd_event < 0) || (ring->fd_done < 0)) {
+			loge("eventfd, errno: %d\n", errno);
+			ret = -1;
+		}
+	}
+	if (ret == 0) {
+		ret = pthread_create(&ring->thread, NULL, frame_ring_thread, (void *)ring);
+		if (ret != 0) {
+			loge("pthread_create, ret: %d\n", ret);
+			ret = -1;
+		} else {
+			/* started */
+			ring->is_started = 1;
+		}
+	}
+
+	if (ret < 0) {
+		if (ring->fd_event >= 0) {
+			/* close */
+			(void)close(ring->fd_event);
+		}
+		if (ring->fd_done >= 0) {
+			/* close */
+			(void)close(ring->fd_done);
+		}
+		frame_arena_destroy(&ring->arena);
+		(void)memset(ring, 0, sizeof(*ring));
+	} else {
+		logi("frame ring: %u slots of %zu bytes, pre-roll: %u, post-roll: %u frames\n",
+			ring->n_slots, ring->slot_size, preroll, postroll);
+		if (preroll > ring->n_slots) {
+			/* bounded by the budget */
+			logw("the pre-roll is cut to %u frames\n", ring->n_slots);
+		}
+	}
+
+	return ret;
+}
+
+/* the recording which is being persisted is closed after the frames copied */
+void frame_ring_stop(struct frame_ring *ring)
+{
+	uint64_t			value		= 1;
+
+	if (ring->is_started == 1U) {
+		atomic_store(&ring->is_stopping, 1U);
+		if (write(ring->fd_event, &value, sizeof(value)) < 0) {
+			/* the thread would never wake up */
+			loge("write(fd_event), errno: %d\n", errno);
+		} else {
+			(void)pthread_join(ring->thread, NULL);
+		}
+
+		logi("frames copied: %llu, skipped: %llu, blocked: %llu, persisted: %llu, "
+			"copy avg: %llu us, max: %llu us\n",
+			atomic_load(&ring->stats.copied), atomic_load(&ring->stats.skipped),
+			atomic_load(&ring->stats.blocked), atomic_load(&ring->stats.persisted),
+			(atomic_load(&ring->stats.copied) > 0U) ?
+				(atomic_load(&ring->stats.copy_sum_ns) / atomic_load(&ring->stats.copied) / 1000U) : 0U,
+			atomic_load(&ring->stats.copy_max_ns) / 1000U);
+
+		(void)close(ring->fd_event);
+		(void)close(ring->fd_done);
+		frame_arena_destroy(&ring->arena);
+		(void)memset(ring, 0, sizeof(*ring));
+	}
+}
+
+/**
+ * @brief Hand a frame over to be copied into the ring
+ *
+ * @return 0 if queued, or -1 if the frame is skipped because the frame
+ * before is not reaped yet
+ */
+int frame_ring_queue(struct frame_ring *ring, const struct frame_dump_header *header,
+	const struct iovec *planes, unsigned int n_planes, unsigned int cookie)
+{
+	struct frame_ring_slot		*input		= &ring->input;
+	unsigned int			head		= 0;
+	unsigned int			idx		= 0;
+	size_t				length		= 0;
+	uint64_t			value		= 1;
+	int				ret		= 0;
+
+	head = atomic_load_explicit(&ring->input_head, memory_order_relaxed);
+
+	if ((ring->is_started == 0U) || (n_planes > FRAME_DUMP_MAX_PLANES)) {
+		loge("planes(%u) is wrong or the ring is not started\n", n_planes);
+		ret = -1;
+	} else if (head != ring->input_reaped) {
+		/* still copying */
+		atomic_fetch_add(&ring->stats.skipped, 1U);
+		ret = -1;
+	} else {
+		for (idx = 0; idx < n_planes; idx++) {
+			/* the planes must fit in a slot */
+			length += planes[idx].iov_len;
+		}
+		if (length > ring->slot_size) {
+			loge("the frame(%zu) is larger than a slot(%zu)\n", length, ring->slot_size);
+			ret = -1;
+		} else {
+			input->header	= *header;
+			input->n_planes	= n_planes;
+			for (idx = 0; idx < n_planes; idx++) {
+				/* referenced, copied by the thread */
+				input->planes[idx] = planes[idx];
+			}
+			ring->input_cookie = cookie;
+
+			atomic_store_explicit(&ring->input_head, head + 1U, memory_order_release);
+			if (write(ring->fd_event, &value, sizeof(value)) < 0) {
+				/* copied with the next wakeup */
+				loge("write(fd_event), errno: %d\n", errno);
+			}
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Take back the memory of a copied frame
+ *
+ * @return 1 if the cookie of a copied frame is returned, or 0 if none is
+ * left to reap
+ */
+int frame_ring_reap(struct frame_ring *ring, unsigned int *cookie)
+{
+	uint64_t			value		= 0;
+	unsigned int			tail		= 0;
+	int				ret		= 0;
+
+	if (ring->is_started == 1U) {
+		/* drained before tail is loaded, so a frame copied after it rearms fd_done */
+		(void)read(ring->fd_done, &value, sizeof(value));
+
+		tail = atomic_load_explicit(&ring->input_tail, memory_order_acquire);
+		if (ring->input_reaped != tail) {
+			*cookie			= ring->input_cookie;
+			ring->input_reaped	= tail;
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * sleep until the frame handed over is copied, as before its memory is freed.
+ * fd_done is drained on the way, so the copied frame is to be reaped by the
+ * caller rather than by waiting on frame_ring_get_fd().
+ */
+void frame_ring_wait_idle(const struct frame_ring *ring)
+{
+	struct pollfd			pfd		= { 0, };
+	uint64_t			value		= 0;
+
+	pfd.fd		= ring->fd_done;
+	pfd.events	= POLLIN;
+
+	while ((ring->is_started == 1U) &&
+	       (atomic_load(&ring->input_tail) != atomic_load(&ring->input_head))) {
+		/* a frame copied after input_tail is loaded rearms fd_done */
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno != EINTR) {
+				loge("poll, errno: %d\n", errno);
+				break;
+			}
+		} else {
+			/* not to wake up again for the frames copied so far */
+			(void)read(ring->fd_done, &value, sizeof(value));
+		}
+	}
+}
+
+/* readable when there is a copied frame to reap */
+int frame_ring_get_fd(const struct frame_ring *ring)
+{
+	return (ring->is_started == 1U) ? ring->fd_done : -1;
+}
+
+/* the trigger is handled by the thread in the order of enum frame_ring_trigger */
+int frame_ring_trigger(struct frame_ring *ring, enum frame_ring_trigger trigger)
+{
+	uint64_t			value		= 1;
+	int				ret		= 0;
+
+	if (ring->is_started == 0U) {
+		loge("the frame ring is not started\n");
+		ret = -1;
+	} else {
+		(void)atomic_fetch_or(&ring->triggers, 1U << (unsigned int)trigger);
+		if (write(ring->fd_event, &value, sizeof(value)) < 0) {
+			/* handled with the next frame */
+			loge("write(fd_event), errno: %d\n", errno);
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "frame_arena.h"
+#include "frame_dump.h"
+#include "frame_writer.h"
+
+/* the index capacity of a recording which is started and not stopped */
+#define FRAME_RING_RECORD_FRAMES	(36000U)
+#define FRAME_RING_PATH_MAX		(32U)
+
+enum frame_ring_trigger {
+	/* persist the pre-roll and the post-roll */
+	FRAME_RING_TRIGGER_SNAPSHOT,
+	/* persist the pre-roll and every frame until it is stopped */
+	FRAME_RING_TRIGGER_START,
+	/* persist the post-roll and close the recording */
+	FRAME_RING_TRIGGER_STOP,
+};
+
+struct frame_ring_slot {
+	/* slot_size bytes in the arena, NULL for the frame to copy */
+	unsigned char			*data;
+	struct frame_dump_header	header;
+	struct iovec			planes[FRAME_DUMP_MAX_PLANES];
+	unsigned int			n_planes;
+};
+
+struct frame_ring_stats {
+	atomic_ullong			copied;
+	/* frames not copied because the copy of the frame before is not done */
+	atomic_ullong			skipped;
+	/* frames not copied because the oldest slot is not persisted yet */
+	atomic_ullong			blocked;
+	atomic_ullong			persisted;
+	atomic_ullong			copy_sum_ns;
+	atomic_ullong			copy_max_ns;
+};
+
+/*
+ * the last frames are kept in a ring of slots carved out of one arena, so
+ * a trigger can persist the frames from before it. The frames are copied
+ * into the ring by its own thread from the memory they are captured in,
+ * and persisted from the ring by a frame writer into a recording.
+ *
+ * A frame to copy is handed over like to the frame writer: its memory must
+ * be kept until frame_ring_reap() gives its cookie back. Only one frame is
+ * in flight, and a frame is skipped while the one before is being copied.
+ *
+ * The frames are numbered from 0 as they are copied, and frame n is kept in
+ * slot n % n_slots. The fields after the stats are only used by the thread.
+ */
+struct frame_ring {
+	pthread_t			thread;
+	unsigned int			is_started;
+	atomic_uint			is_stopping;
+	/* counts the frames to copy and the triggers */
+	int				fd_event;
+	/* readable when a frame is copied */
+	int				fd_done;
+
+	struct frame_arena		arena;
+	size_t				slot_size;
+	unsigned int			n_slots;
+	struct frame_ring_slot		*slots;
+	unsigned int			preroll;
+	unsigned int			postroll;
+
+	/* the frame to copy, a single-producer / single-consumer ring of 1 */
+	struct frame_ring_slot		input;
+	unsigned int			input_cookie;
+	atomic_uint			input_head;
+	atomic_uint			input_tail;
+	unsigned int			input_reaped;
+
+	/* a bit per enum frame_ring_trigger */
+	atomic_uint			triggers;
+
+	struct frame_ring_stats		stats;
+
+	uint64_t			written;
+	/* the frames [persist_reaped, persist_end) are to be persisted */
+	unsigned int			is_persisting;
+	unsigned int			is_recording;
+	uint64_t			persist_next;
+	uint64_t			persist_reaped;
+	uint64_t			persist_end;
+	unsigned int			record_idx;
+	char				path[FRAME_RING_PATH_MAX];
+	struct frame_writer		writer;
+};
+
+extern int frame_ring_start(struct frame_ring *ring, size_t budget, size_t frame_size,
+	unsigned int preroll, unsigned int postroll);
+extern void frame_ring_stop(struct frame_ring *ring);
+extern int frame_ring_queue(struct frame_ring *ring, const struct frame_dump_header *header,
+	const struct iovec *planes, unsigned int n_planes, unsigned int cookie);
+extern int frame_ring_reap(struct frame_ring *ring, unsigned int *cookie);
+extern void frame_ring_wait_idle(const struct frame_ring *ring);
+extern int frame_ring_get_fd(const struct frame_ring *ring);
+extern int frame_ring_trigger(struct frame_ring *ring, enum frame_ring_trigger trigger);
+
+#endif//FRAME_RING_H
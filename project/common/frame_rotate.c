@@ -0,0 +1,1040 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "log.h"
+#include "v4l2.h"
+#include "frame_arena.h"
+#include "colorconv.h"
+#include "frame_rotate.h"
+#include "latency.h"
+
+/* each rotation is timed over this many frames after one to warm up */
+#define FRAME_ROTATE_BENCH_FRAMES	(4U)
+
+/* the bytes of a row of a tile, which is transposed in the registers */
+#define FRAME_ROTATE_TILE_BYTES		(16U)
+
+/*
+ * inlined for each size of the elements, and the loops of a tile unrolled,
+ * so the rows of a tile stay in the registers
+ */
+#define FRAME_ROTATE_UNROLLED		__attribute__((always_inline))
+#define FRAME_ROTATE_UNROLL		_Pragma("GCC unroll 16")
+
+/*
+ * the interleaving stages of a transpose leave the rows of a tile in bit
+ * reversed order, so the register of a row is stored to this row of 16,
+ * divided by the bytes of an element for the tiles of fewer rows
+ */
+static const uint8_t frame_rotate_tile_rows[FRAME_ROTATE_TILE_BYTES] = {
+	0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15,
+};
+
+static const unsigned int frame_rotate_bench_formats[] = {
+	V4L2_PIX_FMT_RGB24,
+	V4L2_PIX_FMT_RGB32,
+	V4L2_PIX_FMT_UYVY,
+	V4L2_PIX_FMT_VYUY,
+	V4L2_PIX_FMT_YUYV,
+	V4L2_PIX_FMT_YVYU,
+	V4L2_PIX_FMT_YVU420,
+	V4L2_PIX_FMT_YUV420,
+	V4L2_PIX_FMT_YUV422P,
+	V4L2_PIX_FMT_NV12,
+	V4L2_PIX_FMT_NV21,
+	V4L2_PIX_FMT_NV16,
+	V4L2_PIX_FMT_NV61,
+};
+
+static const char * const frame_rotate_mirror_names[FRAME_ROTATE_MIRROR_MAX] = {
+	[FRAME_ROTATE_MIRROR_NONE]		= "none",
+	[FRAME_ROTATE_MIRROR_HORIZONTAL]	= "horizontal",
+	[FRAME_ROTATE_MIRROR_VERTICAL]		= "vertical",
+};
+
+/*
+ * a tile of 16 / elem_size rows of 16 bytes is transposed:
+ * the element k of the row i is written as the element i of the row k
+ */
+#if defined(__ARM_NEON)
+#define FRAME_ROTATE_ISA		("neon")
+
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_zip(uint8x16_t a, uint8x16_t b,
+	unsigned int bits, uint8x16_t *lo, uint8x16_t *hi)
+{
+	uint8x16x2_t			z8;
+	uint16x8x2_t			z16;
+	uint32x4x2_t			z32;
+	uint64x2_t			a64;
+	uint64x2_t			b64;
+
+	switch (bits) {
+	case 8U:
+		z8	= vzipq_u8(a, b);
+		*lo	= z8.val[0];
+		*hi	= z8.val[1];
+		break;
+	case 16U:
+		z16	= vzipq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b));
+		*lo	= vreinterpretq_u8_u16(z16.val[0]);
+		*hi	= vreinterpretq_u8_u16(z16.val[1]);
+		break;
+	case 32U:
+		z32	= vzipq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b));
+		*lo	= vreinterpretq_u8_u32(z32.val[0]);
+		*hi	= vreinterpretq_u8_u32(z32.val[1]);
+		break;
+	default:
+		a64	= vreinterpretq_u64_u8(a);
+		b64	= vreinterpretq_u64_u8(b);
+		*lo	= vreinterpretq_u8_u64(vcombine_u64(vget_low_u64(a64), vget_low_u64(b64)));
+		*hi	= vreinterpretq_u8_u64(vcombine_u64(vget_high_u64(a64), vget_high_u64(b64)));
+		break;
+	}
+}
+
+/* the rows in pairs, the lower halves into the first half of the rows */
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_zip_rows(uint8x16_t *rows,
+	unsigned int n_rows, unsigned int bits)
+{
+	uint8x16_t			zips[FRAME_ROTATE_TILE_BYTES];
+	unsigned int			idx		= 0;
+
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < (n_rows / 2U); idx++) {
+		/* a pair */
+		frame_rotate_zip(rows[idx * 2U], rows[(idx * 2U) + 1U], bits,
+			&zips[idx], &zips[idx + (n_rows / 2U)]);
+	}
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < n_rows; idx++) {
+		/* in place */
+		rows[idx] = zips[idx];
+	}
+}
+
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_tile(const uint8_t *src,
+	ptrdiff_t src_stride, uint8_t *dst, ptrdiff_t dst_stride, unsigned int elem_size)
+{
+	uint8x16_t			rows[FRAME_ROTATE_TILE_BYTES];
+	unsigned int			n_rows		= FRAME_ROTATE_TILE_BYTES / elem_size;
+	unsigned int			idx		= 0;
+
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < n_rows; idx++) {
+		/* load */
+		rows[idx] = vld1q_u8(&src[(ptrdiff_t)idx * src_stride]);
+	}
+	/* the rows interleaved in pairs of 8, 16, 32 and then 64 bits */
+	if (elem_size == 1U) {
+		frame_rotate_zip_rows(rows, n_rows, 8U);
+	}
+	if (elem_size <= 2U) {
+		frame_rotate_zip_rows(rows, n_rows, 16U);
+	}
+	frame_rotate_zip_rows(rows, n_rows, 32U);
+	frame_rotate_zip_rows(rows, n_rows, 64U);
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < n_rows; idx++) {
+		/* store */
+		vst1q_u8(&dst[(ptrdiff_t)(frame_rotate_tile_rows[idx] / elem_size) * dst_stride],
+			rows[idx]);
+	}
+}
+
+/* the elements of 16 bytes in reverse order */
+static inline void frame_rotate_reverse(const uint8_t *src, uint8_t *dst, unsigned int elem_size)
+{
+	uint8x16_t			value;
+
+	value = vld1q_u8(src);
+	if (elem_size == 4U) {
+		/* 32 bits */
+		value = vreinterpretq_u8_u32(vrev64q_u32(vreinterpretq_u32_u8(value)));
+	} else if (elem_size == 2U) {
+		/* 16 bits */
+		value = vreinterpretq_u8_u16(vrev64q_u16(vreinterpretq_u16_u8(value)));
+	} else {
+		/* bytes */
+		value = vrev64q_u8(value);
+	}
+	vst1q_u8(dst, vcombine_u8(vget_high_u8(value), vget_low_u8(value)));
+}
+#elif defined(__SSE2__)
+#define FRAME_ROTATE_ISA		("sse2")
+
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_zip(__m128i a, __m128i b, unsigned int bits,
+	__m128i *lo, __m128i *hi)
+{
+	switch (bits) {
+	case 8U:
+		*lo	= _mm_unpacklo_epi8(a, b);
+		*hi	= _mm_unpackhi_epi8(a, b);
+		break;
+	case 16U:
+		*lo	= _mm_unpacklo_epi16(a, b);
+		*hi	= _mm_unpackhi_epi16(a, b);
+		break;
+	case 32U:
+		*lo	= _mm_unpacklo_epi32(a, b);
+		*hi	= _mm_unpackhi_epi32(a, b);
+		break;
+	default:
+		*lo	= _mm_unpacklo_epi64(a, b);
+		*hi	= _mm_unpackhi_epi64(a, b);
+		break;
+	}
+}
+
+/* the rows in pairs, the lower halves into the first half of the rows */
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_zip_rows(__m128i *rows,
+	unsigned int n_rows, unsigned int bits)
+{
+	__m128i				zips[FRAME_ROTATE_TILE_BYTES];
+	unsigned int			idx		= 0;
+
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < (n_rows / 2U); idx++) {
+		/* a pair */
+		frame_rotate_zip(rows[idx * 2U], rows[(idx * 2U) + 1U], bits,
+			&zips[idx], &zips[idx + (n_rows / 2U)]);
+	}
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < n_rows; idx++) {
+		/* in place */
+		rows[idx] = zips[idx];
+	}
+}
+
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_tile(const uint8_t *src,
+	ptrdiff_t src_stride, uint8_t *dst, ptrdiff_t dst_stride, unsigned int elem_size)
+{
+	__m128i				rows[FRAME_ROTATE_TILE_BYTES];
+	unsigned int			n_rows		= FRAME_ROTATE_TILE_BYTES / elem_size;
+	unsigned int			idx		= 0;
+
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < n_rows; idx++) {
+		/* load */
+		rows[idx] = _mm_loadu_si128((const __m128i *)&src[(ptrdiff_t)idx * src_stride]);
+	}
+	/* the rows interleaved in pairs of 8, 16, 32 and then 64 bits */
+	if (elem_size == 1U) {
+		frame_rotate_zip_rows(rows, n_rows, 8U);
+	}
+	if (elem_size <= 2U) {
+		frame_rotate_zip_rows(rows, n_rows, 16U);
+	}
+	frame_rotate_zip_rows(rows, n_rows, 32U);
+	frame_rotate_zip_rows(rows, n_rows, 64U);
+	FRAME_ROTATE_UNROLL
+	for (idx = 0; idx < n_rows; idx++) {
+		/* store */
+		_mm_storeu_si128((__m128i *)&dst[(ptrdiff_t)(frame_rotate_tile_rows[idx] / elem_size) *
+			dst_stride], rows[idx]);
+	}
+}
+
+/* the elements of 16 bytes in reverse order */
+static inline void frame_rotate_reverse(const uint8_t *src, uint8_t *dst, unsigned int elem_size)
+{
+	__m128i				value;
+
+	value = _mm_loadu_si128((const __m128i *)src);
+	if (elem_size == 4U) {
+		/* 32 bits */
+		value = _mm_shuffle_epi32(value, 0x1B);
+	} else {
+		/* 16 bits, and then the bytes of each */
+		value = _mm_shufflelo_epi16(value, 0x1B);
+		value = _mm_shufflehi_epi16(value, 0x1B);
+		value = _mm_shuffle_epi32(value, 0x4E);
+		if (elem_size == 1U) {
+			/* bytes */
+			value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+		}
+	}
+	_mm_storeu_si128((__m128i *)dst, value);
+}
+#else
+#define FRAME_ROTATE_ISA		("scalar")
+
+static inline FRAME_ROTATE_UNROLLED void frame_rotate_tile(const uint8_t *src,
+	ptrdiff_t src_stride, uint8_t *dst, ptrdiff_t dst_stride, unsigned int elem_size)
+{
+	unsigned int			n_rows		= FRAME_ROTATE_TILE_BYTES / elem_size;
+	unsigned int			row		= 0;
+	unsigned int			col		= 0;
+
+	for (row = 0; row < n_rows; row++) {
+		for (col = 0; col < n_rows; col++) {
+			/* an element */
+			(void)memcpy(&dst[((ptrdiff_t)col * dst_stride) + (row * elem_size)],
+				&src[((ptrdiff_t)row * src_stride) + (col * elem_size)], elem_size);
+		}
+	}
+}
+
+/* the elements of 16 bytes in reverse order */
+static inline void frame_rotate_reverse(const uint8_t *src, uint8_t *dst, unsigned int elem_size)
+{
+	unsigned int			x		= 0;
+
+	for (x = 0; x < FRAME_ROTATE_TILE_BYTES; x += elem_size) {
+		/* an element */
+		(void)memcpy(&dst[x], &src[FRAME_ROTATE_TILE_BYTES - x - elem_size], elem_size);
+	}
+}
+#endif
+
+/* a plane of the source and of the rotated frame */
+struct frame_rotate_job {
+	const struct frame_rotate_plane	*plane;
+	const uint8_t			*src;
+	uint8_t				*dst;
+	ptrdiff_t			src_stride;
+	ptrdiff_t			dst_stride;
+};
+
+static void frame_rotate_set_plane(struct frame_rotate_plane *plane, unsigned int width,
+	unsigned int height, unsigned int elem_size)
+{
+	plane->width		= width;
+	plane->height		= height;
+	plane->elem_size	= elem_size;
+	plane->is_direct	= 1;
+}
+
+static void frame_rotate_set_chroma(struct frame_rotate_plane *plane, unsigned int pair_size,
+	unsigned int n_comps, unsigned int comp_offset, unsigned int comp_step)
+{
+	plane->is_resampled	= 1;
+	plane->pair_size	= pair_size;
+	plane->n_comps		= n_comps;
+	plane->comp_offset	= comp_offset;
+	plane->comp_step	= comp_step;
+}
+
+static void frame_rotate_init_planes(struct frame_rotate *rot, const struct colorconv_format *fmt)
+{
+	struct frame_rotate_plane	*plane		= NULL;
+	unsigned int			idx		= 0;
+
+	frame_rotate_set_plane(&rot->planes[0], rot->width, rot->height,
+		(fmt->layout == (unsigned int)COLORCONV_LAYOUT_RGB) ? fmt->bpp :
+		((fmt->layout == (unsigned int)COLORCONV_LAYOUT_PACKED) ? 2U : 1U));
+	rot->n_planes = v4l2_get_planes_by_v4l2_format(fmt->fourcc);
+
+	if (fmt->layout == (unsigned int)COLORCONV_LAYOUT_PACKED) {
+		if ((rot->is_transposed == 1U) || (rot->is_flip_x == 1U)) {
+			/* the chroma bytes of the pixels are u or v by their order */
+			frame_rotate_set_chroma(&rot->planes[0], 4U, 2U, 1U - fmt->y_offset, 2U);
+		}
+	} else if (fmt->layout != (unsigned int)COLORCONV_LAYOUT_RGB) {
+		for (idx = 1; (idx < rot->n_planes) && (idx < COLORCONV_MAX_PLANES); idx++) {
+			plane = &rot->planes[idx];
+			if (fmt->is_420 == 1U) {
+				/* a 2x2 block of pixels is rotated into another */
+				frame_rotate_set_plane(plane, rot->width / 2U, rot->height / 2U,
+					(fmt->layout == (unsigned int)COLORCONV_LAYOUT_PLANAR) ? 1U : 2U);
+			} else if (rot->is_transposed == 0U) {
+				/* so is a pair */
+				frame_rotate_set_plane(plane, rot->width / 2U, rot->height,
+					(fmt->layout == (unsigned int)COLORCONV_LAYOUT_PLANAR) ? 1U : 2U);
+			} else if (fmt->layout == (unsigned int)COLORCONV_LAYOUT_PLANAR) {
+				/* in the pixels of the luma */
+				plane->width		= rot->width;
+				plane->height		= rot->height;
+				plane->elem_size	= 1;
+				frame_rotate_set_chroma(plane, 1U, 1U, 0U, 1U);
+			} else {
+				/* u and v interleaved */
+				plane->width		= rot->width;
+				plane->height		= rot->height;
+				plane->elem_size	= 1;
+				frame_rotate_set_chroma(plane, 2U, 2U, 0U, 1U);
+			}
+		}
+	} else {
+		/* a pixel is an element */
+		logd("%u bytes a pixel\n", fmt->bpp);
+	}
+}
+
+/**
+ * @brief Initialize a rotation of the frames of a format
+ *
+ * @param angle clockwise rotation in degrees: 0, 90, 180 or 270
+ * @param mirror mirror applied after the rotation
+ * @return 0 on success, -1 if the format, the size or the angle is wrong
+ */
+int frame_rotate_init(struct frame_rotate *rot, unsigned int format,
+	unsigned int width, unsigned int height, unsigned int angle,
+	enum frame_rotate_mirror mirror)
+{
+	const struct colorconv_format	*fmt		= NULL;
+	int				ret		= 0;
+
+	(void)memset((void *)rot, 0, sizeof(*rot));
+
+	fmt = colorconv_get_format(format);
+	if ((fmt == NULL) || (width == 0U) || (height == 0U) ||
+	    ((unsigned int)mirror >= (unsigned int)FRAME_ROTATE_MIRROR_MAX)) {
+		loge("format(0x%08x), size(%u * %u) or mirror(%u) is wrong\n",
+			format, width, height, (unsigned int)mirror);
+		ret = -1;
+	} else if ((fmt->layout != (unsigned int)COLORCONV_LAYOUT_RGB) &&
+		   (((width | height) & 1U) != 0U)) {
+		loge("size(%u * %u) of %s is not even\n", width, height,
+			v4l2_get_format_name_by_v4l2_format(format));
+		ret = -1;
+	} else {
+		switch (angle) {
+		case 0U:
+			/* no rotation */
+			break;
+		case 90U:
+			rot->is_transposed	= 1;
+			rot->is_flip_y		= 1;
+			break;
+		case 180U:
+			rot->is_flip_x		= 1;
+			rot->is_flip_y		= 1;
+			break;
+		case 270U:
+			rot->is_transposed	= 1;
+			rot->is_flip_x		= 1;
+			break;
+		default:
+			loge("angle(%u) is wrong\n", angle);
+			ret = -1;
+			break;
+		}
+	}
+
+	if (ret == 0) {
+		/* the x of the rotated frame is the y of the source if it is transposed */
+		if (mirror == FRAME_ROTATE_MIRROR_HORIZONTAL) {
+			if (rot->is_transposed == 1U) {
+				/* rows */
+				rot->is_flip_y ^= 1U;
+			} else {
+				/* columns */
+				rot->is_flip_x ^= 1U;
+			}
+		} else if (mirror == FRAME_ROTATE_MIRROR_VERTICAL) {
+			if (rot->is_transposed == 1U) {
+				/* columns */
+				rot->is_flip_x ^= 1U;
+			} else {
+				/* rows */
+				rot->is_flip_y ^= 1U;
+			}
+		} else {
+			/* no mirror */
+			logd("no mirror\n");
+		}
+
+		rot->format		= format;
+		rot->width		= width;
+		rot->height		= height;
+		rot->dst_width		= (rot->is_transposed == 1U) ? height : width;
+		rot->dst_height		= (rot->is_transposed == 1U) ? width : height;
+		frame_rotate_init_planes(rot, fmt);
+	}
+
+	return ret;
+}
+
+/* 1 if the frame is not changed */
+unsigned int frame_rotate_is_identity(const struct frame_rotate *rot)
+{
+	return ((rot->is_transposed == 0U) && (rot->is_flip_x == 0U) && (rot->is_flip_y == 0U)) ?
+		1U : 0U;
+}
+
+const char *frame_rotate_get_isa_name(void)
+{
+	return FRAME_ROTATE_ISA;
+}
+
+/* the pixel of the source a pixel (x, y) of the rotated plane is */
+static inline void frame_rotate_map(const struct frame_rotate *rot,
+	const struct frame_rotate_plane *plane, unsigned int x, unsigned int y,
+	unsigned int *sx, unsigned int *sy)
+{
+	unsigned int			u		= 0;
+	unsigned int			v		= 0;
+
+	u	= (rot->is_transposed == 1U) ? y : x;
+	v	= (rot->is_transposed == 1U) ? x : y;
+	*sx	= (rot->is_flip_x == 1U) ? (plane->width - 1U - u) : u;
+	*sy	= (rot->is_flip_y == 1U) ? (plane->height - 1U - v) : v;
+}
+
+/* the elements of the rows y0 to y1 and the columns x0 to x1 one by one */
+static void frame_rotate_copy_pixels(const struct frame_rotate *rot,
+	const struct frame_rotate_job *job, unsigned int x0, unsigned int x1,
+	unsigned int y0, unsigned int y1)
+{
+	const unsigned int		elem_size	= job->plane->elem_size;
+	unsigned int			x		= 0;
+	unsigned int			y		= 0;
+	unsigned int			sx		= 0;
+	unsigned int			sy		= 0;
+
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x++) {
+			frame_rotate_map(rot, job->plane, x, y, &sx, &sy);
+			(void)memcpy(&job->dst[((ptrdiff_t)y * job->dst_stride) + (x * elem_size)],
+				&job->src[((ptrdiff_t)sy * job->src_stride) + (sx * elem_size)],
+				elem_size);
+		}
+	}
+}
+
+/*
+ * frame_rotate_copy_pixels walking the source: the next element of a row
+ * is the next row of the source if the plane is transposed, or the next
+ * element otherwise
+ */
+static void frame_rotate_copy_elems(const struct frame_rotate *rot,
+	const struct frame_rotate_job *job, unsigned int x0, unsigned int x1,
+	unsigned int y0, unsigned int y1)
+{
+	const unsigned int		elem_size	= job->plane->elem_size;
+	const uint8_t			*src		= job->src;
+	uint8_t				*dst		= job->dst;
+	ptrdiff_t			step		= 0;
+	ptrdiff_t			pos		= 0;
+	ptrdiff_t			end		= 0;
+	ptrdiff_t			from		= 0;
+	unsigned int			sx		= 0;
+	unsigned int			sy		= 0;
+	unsigned int			y		= 0;
+
+	if (rot->is_transposed == 1U) {
+		/* rows */
+		step = (rot->is_flip_y == 1U) ? -job->src_stride : job->src_stride;
+	} else {
+		/* elements */
+		step = (rot->is_flip_x == 1U) ? -(ptrdiff_t)elem_size : (ptrdiff_t)elem_size;
+	}
+
+	for (y = y0; y < y1; y++) {
+		frame_rotate_map(rot, job->plane, x0, y, &sx, &sy);
+		from	= ((ptrdiff_t)sy * job->src_stride) + ((ptrdiff_t)sx * (ptrdiff_t)elem_size);
+		pos	= ((ptrdiff_t)y * job->dst_stride) + ((ptrdiff_t)x0 * (ptrdiff_t)elem_size);
+		end	= ((ptrdiff_t)y * job->dst_stride) + ((ptrdiff_t)x1 * (ptrdiff_t)elem_size);
+		for (; pos < end; pos += (ptrdiff_t)elem_size) {
+			/* the bytes of an element */
+			dst[pos] = src[from];
+			if (elem_size > 1U) {
+				dst[pos + 1] = src[from + 1];
+			}
+			if (elem_size > 2U) {
+				dst[pos + 2] = src[from + 2];
+			}
+			if (elem_size > 3U) {
+				dst[pos + 3] = src[from + 3];
+			}
+			from += step;
+		}
+	}
+}
+
+/*
+ * The chroma of each pair of pixels of the rows y0 to y1 and the columns x0
+ * to x1 is the mean of the chroma of the two pixels of the source, which
+ * are of the same pair unless the plane is transposed.
+ */
+static void frame_rotate_resample_pixels(const struct frame_rotate *rot,
+	const struct frame_rotate_job *job, unsigned int x0, unsigned int x1,
+	unsigned int y0, unsigned int y1)
+{
+	const struct frame_rotate_plane	*plane		= job->plane;
+	const uint8_t			*src0		= NULL;
+	const uint8_t			*src1		= NULL;
+	uint8_t				*dst		= NULL;
+	unsigned int			x		= 0;
+	unsigned int			y		= 0;
+	unsigned int			sx[2]		= { 0, 0 };
+	unsigned int			sy[2]		= { 0, 0 };
+	unsigned int			comp		= 0;
+	unsigned int			offset		= 0;
+
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x += 2U) {
+			frame_rotate_map(rot, plane, x, y, &sx[0], &sy[0]);
+			frame_rotate_map(rot, plane, x + 1U, y, &sx[1], &sy[1]);
+			src0	= &job->src[((ptrdiff_t)sy[0] * job->src_stride) +
+				((sx[0] / 2U) * plane->pair_size) + plane->comp_offset];
+			src1	= &job->src[((ptrdiff_t)sy[1] * job->src_stride) +
+				((sx[1] / 2U) * plane->pair_size) + plane->comp_offset];
+			dst	= &job->dst[((ptrdiff_t)y * job->dst_stride) +
+				((x / 2U) * plane->pair_size) + plane->comp_offset];
+			for (comp = 0; comp < plane->n_comps; comp++) {
+				offset = comp * plane->comp_step;
+				dst[offset] = (uint8_t)(((unsigned int)src0[offset] +
+					(unsigned int)src1[offset] + 1U) >> 1);
+			}
+		}
+	}
+}
+
+/*
+ * frame_rotate_resample_pixels walking the source: the next pair of a row
+ * is two rows of the source away if the plane is transposed, or the pair
+ * next to it otherwise
+ */
+static void frame_rotate_resample(const struct frame_rotate *rot,
+	const struct frame_rotate_job *job, unsigned int x0, unsigned int x1,
+	unsigned int y0, unsigned int y1)
+{
+	const struct frame_rotate_plane	*plane		= job->plane;
+	const uint8_t			*src		= job->src;
+	uint8_t				*dst		= job->dst;
+	const ptrdiff_t			pair_size	= (ptrdiff_t)plane->pair_size;
+	const ptrdiff_t			comp_step	= (ptrdiff_t)plane->comp_step;
+	const unsigned int		n_comps		= plane->n_comps;
+	ptrdiff_t			src0		= 0;
+	ptrdiff_t			src1		= 0;
+	ptrdiff_t			step		= 0;
+	ptrdiff_t			pos		= 0;
+	unsigned int			x		= 0;
+	unsigned int			y		= 0;
+	unsigned int			sx[2]		= { 0, 0 };
+	unsigned int			sy[2]		= { 0, 0 };
+
+	if (rot->is_transposed == 1U) {
+		/* rows */
+		step = (rot->is_flip_y == 1U) ? (-2 * job->src_stride) : (2 * job->src_stride);
+	} else {
+		/* pairs */
+		step = (rot->is_flip_x == 1U) ? -pair_size : pair_size;
+	}
+
+	for (y = y0; y < y1; y++) {
+		frame_rotate_map(rot, plane, x0, y, &sx[0], &sy[0]);
+		frame_rotate_map(rot, plane, x0 + 1U, y, &sx[1], &sy[1]);
+		src0	= ((ptrdiff_t)sy[0] * job->src_stride) + ((ptrdiff_t)(sx[0] / 2U) * pair_size) +
+			(ptrdiff_t)plane->comp_offset;
+		src1	= ((ptrdiff_t)sy[1] * job->src_stride) + ((ptrdiff_t)(sx[1] / 2U) * pair_size) +
+			(ptrdiff_t)plane->comp_offset;
+		pos	= ((ptrdiff_t)y * job->dst_stride) + ((ptrdiff_t)(x0 / 2U) * pair_size) +
+			(ptrdiff_t)plane->comp_offset;
+		for (x = x0; x < x1; x += 2U) {
+			dst[pos] = (uint8_t)(((unsigned int)src[src0] + (unsigned int)src[src1] + 1U) >> 1);
+			if (n_comps == 2U) {
+				/* v after u */
+				dst[pos + comp_step] = (uint8_t)(((unsigned int)src[src0 + comp_step] +
+					(unsigned int)src[src1 + comp_step] + 1U) >> 1);
+			}
+			src0	+= step;
+			src1	+= step;
+			pos	+= pair_size;
+		}
+	}
+}
+
+/* a row of elements of 1, 2 or 4 bytes reversed, 16 bytes at a time from its end */
+static void frame_rotate_reverse_row(const uint8_t *src, uint8_t *dst, unsigned int width,
+	unsigned int elem_size)
+{
+	const unsigned int		bytes		= width * elem_size;
+	unsigned int			x		= 0;
+	unsigned int			byte		= 0;
+
+	for (x = 0; (x + FRAME_ROTATE_TILE_BYTES) <= bytes; x += FRAME_ROTATE_TILE_BYTES) {
+		/* 16 bytes */
+		frame_rotate_reverse(&src[bytes - x - FRAME_ROTATE_TILE_BYTES], &dst[x], elem_size);
+	}
+
+	for (; x < bytes; x += elem_size) {
+		for (byte = 0; byte < elem_size; byte++) {
+			/* the elements left */
+			dst[x + byte] = src[bytes - x - elem_size + byte];
+		}
+	}
+}
+
+/* the rows in order or reversed, each copied or reversed */
+static void frame_rotate_flip(const struct frame_rotate *rot, const struct frame_rotate_job *job)
+{
+	const struct frame_rotate_plane	*plane		= job->plane;
+	const uint8_t			*src		= NULL;
+	uint8_t				*dst		= NULL;
+	unsigned int			y		= 0;
+
+	for (y = 0; y < plane->height; y++) {
+		src = &job->src[(ptrdiff_t)((rot->is_flip_y == 1U) ? (plane->height - 1U - y) : y) *
+			job->src_stride];
+		dst = &job->dst[(ptrdiff_t)y * job->dst_stride];
+		if ((plane->is_direct == 1U) && (rot->is_flip_x == 1U) &&
+		    ((FRAME_ROTATE_TILE_BYTES % plane->elem_size) == 0U)) {
+			/* mirrored */
+			frame_rotate_reverse_row(src, dst, plane->width, plane->elem_size);
+		} else if ((plane->is_direct == 1U) && (rot->is_flip_x == 1U)) {
+			/* rgb24 */
+			frame_rotate_copy_elems(rot, job, 0, plane->width, y, y + 1U);
+		} else if (plane->is_direct == 1U) {
+			/* as is */
+			(void)memcpy(dst, src, (size_t)plane->width * plane->elem_size);
+		} else {
+			/* resampled only */
+		}
+		if (plane->is_resampled == 1U) {
+			/* the chroma of a pair mirrored */
+			frame_rotate_resample(rot, job, 0, plane->width, y, y + 1U);
+		}
+	}
+}
+
+/*
+ * The tiles of the rotated rows from y, from the column x0 to x1, are
+ * transposed from the source columns they map to. The rows of the source
+ * are read backwards to flip y, and the rows of a tile are written
+ * backwards to flip x.
+ *
+ * @return the column the tiles end at
+ */
+static inline FRAME_ROTATE_UNROLLED unsigned int frame_rotate_transpose_tiles(
+	const struct frame_rotate *rot, const struct frame_rotate_job *job,
+	unsigned int x0, unsigned int x1, unsigned int y, unsigned int elem_size)
+{
+	const struct frame_rotate_plane	*plane		= job->plane;
+	const unsigned int		n_rows		= FRAME_ROTATE_TILE_BYTES / elem_size;
+	const uint8_t			*src		= NULL;
+	uint8_t				*dst		= NULL;
+	ptrdiff_t			src_stride	= 0;
+	ptrdiff_t			dst_stride	= 0;
+	unsigned int			src_row		= 0;
+	unsigned int			src_col		= 0;
+	unsigned int			dst_row		= 0;
+	unsigned int			x		= 0;
+
+	src_col		= (rot->is_flip_x == 1U) ? (plane->width - y - n_rows) : y;
+	dst_row		= (rot->is_flip_x == 1U) ? (y + n_rows - 1U) : y;
+	src_stride	= (rot->is_flip_y == 1U) ? -job->src_stride : job->src_stride;
+	dst_stride	= (rot->is_flip_x == 1U) ? -job->dst_stride : job->dst_stride;
+	dst		= &job->dst[(ptrdiff_t)dst_row * job->dst_stride];
+
+	for (x = x0; (x + n_rows) <= x1; x += n_rows) {
+		src_row	= (rot->is_flip_y == 1U) ? (plane->height - 1U - x) : x;
+		src	= &job->src[((ptrdiff_t)src_row * job->src_stride) + (src_col * elem_size)];
+		frame_rotate_tile(src, src_stride, &dst[x * elem_size], dst_stride, elem_size);
+	}
+
+	return x;
+}
+
+/* a block of the rotated plane in tiles, and its edges one element at a time */
+static void frame_rotate_transpose_block(const struct frame_rotate *rot,
+	const struct frame_rotate_job *job, unsigned int x0, unsigned int x1,
+	unsigned int y0, unsigned int y1)
+{
+	const unsigned int		elem_size	= job->plane->elem_size;
+	unsigned int			n_rows		= 0;
+	unsigned int			x		= x0;
+	unsigned int			y		= y0;
+
+	if ((FRAME_ROTATE_TILE_BYTES % elem_size) == 0U) {
+		n_rows = FRAME_ROTATE_TILE_BYTES / elem_size;
+		for (y = y0; (y + n_rows) <= y1; y += n_rows) {
+			/* the tiles of each size unrolled */
+			switch (elem_size) {
+			case 1U:
+				x = frame_rotate_transpose_tiles(rot, job, x0, x1, y, 1U);
+				break;
+			case 2U:
+				x = frame_rotate_transpose_tiles(rot, job, x0, x1, y, 2U);
+				break;
+			default:
+				x = frame_rotate_transpose_tiles(rot, job, x0, x1, y, 4U);
+				break;
+			}
+			if (x < x1) {
+				/* the columns left */
+				frame_rotate_copy_elems(rot, job, x, x1, y, y + n_rows);
+			}
+		}
+	}
+
+	if (y < y1) {
+		/* the rows left */
+		frame_rotate_copy_elems(rot, job, x0, x1, y, y1);
+	}
+}
+
+/*
+ * The rotated plane is written block by block, each of which is read from
+ * one block of the source, so both stay in the cache while a block is
+ * transposed.
+ */
+static void frame_rotate_transpose(const struct frame_rotate *rot,
+	const struct frame_rotate_job *job)
+{
+	const struct frame_rotate_plane	*plane		= job->plane;
+	unsigned int			block		= 0;
+	unsigned int			x		= 0;
+	unsigned int			y		= 0;
+	unsigned int			x1		= 0;
+	unsigned int			y1		= 0;
+
+	/* even for the pairs of chroma, and a multiple of the tiles */
+	block = FRAME_ROTATE_BLOCK_BYTES / plane->elem_size;
+	block = block - (block % 2U);
+
+	for (y = 0; y < plane->width; y += block) {
+		y1 = ((plane->width - y) < block) ? plane->width : (y + block);
+		for (x = 0; x < plane->height; x += block) {
+			x1 = ((plane->height - x) < block) ? plane->height : (x + block);
+			if (plane->is_direct == 1U) {
+				/* the elements */
+				frame_rotate_transpose_block(rot, job, x, x1, y, y1);
+			}
+			if (plane->is_resampled == 1U) {
+				/* and the chroma of the pairs */
+				frame_rotate_resample(rot, job, x, x1, y, y1);
+			}
+		}
+	}
+}
+
+static int frame_rotate_check(const struct frame_rotate *rot, const struct colorconv_image *src,
+	const struct colorconv_image *dst)
+{
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	if (rot->n_planes == 0U) {
+		loge("the rotation is not initialized\n");
+		ret = -1;
+	}
+
+	for (idx = 0; (ret == 0) && (idx < rot->n_planes); idx++) {
+		if ((src->planes[idx] == NULL) || (dst->planes[idx] == NULL) ||
+		    (src->planes[idx] == dst->planes[idx])) {
+			loge("plane(%u) is not given, or rotated in place\n", idx);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Rotate a frame into another of dst_width * dst_height
+ *
+ * @return 0 on success, -1 if the rotation is not initialized
+ */
+int frame_rotate_run(const struct frame_rotate *rot, const struct colorconv_image *src,
+	const struct colorconv_image *dst)
+{
+	struct frame_rotate_job		job;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	ret = frame_rotate_check(rot, src, dst);
+	for (idx = 0; (ret == 0) && (idx < rot->n_planes); idx++) {
+		job.plane	= &rot->planes[idx];
+		job.src		= src->planes[idx];
+		job.dst		= dst->planes[idx];
+		job.src_stride	= (ptrdiff_t)src->strides[idx];
+		job.dst_stride	= (ptrdiff_t)dst->strides[idx];
+		if (rot->is_transposed == 1U) {
+			/* in blocks */
+			frame_rotate_transpose(rot, &job);
+		} else {
+			/* in rows */
+			frame_rotate_flip(rot, &job);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Rotate a frame pixel by pixel, the reference of frame_rotate_run
+ *
+ * @return 0 on success, -1 if the rotation is not initialized
+ */
+int frame_rotate_run_reference(const struct frame_rotate *rot,
+	const struct colorconv_image *src, const struct colorconv_image *dst)
+{
+	const struct frame_rotate_plane	*plane		= NULL;
+	struct frame_rotate_job		job;
+	unsigned int			width		= 0;
+	unsigned int			height		= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	ret = frame_rotate_check(rot, src, dst);
+	for (idx = 0; (ret == 0) && (idx < rot->n_planes); idx++) {
+		plane		= &rot->planes[idx];
+		job.plane	= plane;
+		job.src		= src->planes[idx];
+		job.dst		= dst->planes[idx];
+		job.src_stride	= (ptrdiff_t)src->strides[idx];
+		job.dst_stride	= (ptrdiff_t)dst->strides[idx];
+
+		width	= (rot->is_transposed == 1U) ? plane->height : plane->width;
+		height	= (rot->is_transposed == 1U) ? plane->width : plane->height;
+		if (plane->is_direct == 1U) {
+			/* the elements */
+			frame_rotate_copy_pixels(rot, &job, 0, width, 0, height);
+		}
+		if (plane->is_resampled == 1U) {
+			/* and the chroma of the pairs */
+			frame_rotate_resample_pixels(rot, &job, 0, width, 0, height);
+		}
+	}
+
+	return ret;
+}
+
+/* one rotation of a format timed, and compared with the reference */
+static void frame_rotate_bench_one(int fd, unsigned int format, unsigned int width,
+	unsigned int height, unsigned int angle, enum frame_rotate_mirror mirror,
+	uint8_t *const *frames)
+{
+	struct frame_rotate		rot;
+	struct colorconv_image		src;
+	struct colorconv_image		ref;
+	struct colorconv_image		out;
+	size_t				size		= 0;
+	uint64_t			ts_start	= 0;
+	uint64_t			ns		= 0;
+	uint64_t			gbps_milli	= 0;
+	unsigned int			is_exact	= 0;
+	unsigned int			idx		= 0;
+
+	size = (size_t)v4l2_get_v4l2_sizeimage(format, width, height);
+
+	if ((frame_rotate_init(&rot, format, width, height, angle, mirror) == 0) &&
+	    (colorconv_init_image(&src, format, width, height, frames[0]) == 0) &&
+	    (colorconv_init_image(&ref, format, rot.dst_width, rot.dst_height, frames[1]) == 0) &&
+	    (colorconv_init_image(&out, format, rot.dst_width, rot.dst_height, frames[2]) == 0)) {
+		(void)memset(frames[1], 0, size);
+		(void)memset(frames[2], 0, size);
+		(void)frame_rotate_run_reference(&rot, &src, &ref);
+		(void)frame_rotate_run(&rot, &src, &out);
+		is_exact = (memcmp(frames[1], frames[2], size) == 0) ? 1U : 0U;
+
+		ts_start = latency_get_time_ns();
+		for (idx = 0; idx < FRAME_ROTATE_BENCH_FRAMES; idx++) {
+			/* timed */
+			(void)frame_rotate_run(&rot, &src, &out);
+		}
+		ns = (latency_get_time_ns() - ts_start) / FRAME_ROTATE_BENCH_FRAMES;
+		/* bytes per nanosecond are gigabytes per second, read and written */
+		gbps_milli = (ns > 0U) ? (((uint64_t)size * 2U * 1000U) / ns) : 0U;
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n  {\"format\": \"%s\", \"angle\": %u, \"mirror\": \"%s\", "
+			"\"ms\": %llu.%03llu, \"gbps\": %llu.%03llu, \"exact\": %u}",
+			v4l2_get_format_name_by_v4l2_format(format), angle,
+			frame_rotate_mirror_names[mirror],
+			(unsigned long long)(ns / 1000000U),
+			(unsigned long long)((ns / 1000U) % 1000U),
+			(unsigned long long)(gbps_milli / 1000U),
+			(unsigned long long)(gbps_milli % 1000U), is_exact);
+	}
+}
+
+/**
+ * @brief Time every rotation and mirror of the formats of video_format_table
+ *
+ * Each is also rotated by frame_rotate_run_reference, and "exact" is 0 if
+ * frame_rotate_run does not give the same bytes.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int frame_rotate_dump_bench(const char *path, unsigned int width, unsigned int height)
+{
+	struct frame_arena		arena;
+	uint8_t				*frames[3]	= { NULL, NULL, NULL };
+	size_t				size		= 0;
+	size_t				idx		= 0;
+	unsigned int			is_first	= 1;
+	unsigned int			angle		= 0;
+	unsigned int			mirror		= 0;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	/* rgb32 is the largest */
+	size = (size_t)width * height * 4U;
+	ret = frame_arena_create(&arena, frame_arena_align(size) * 3U, 0U);
+	if (ret == 0) {
+		for (idx = 0; idx < 3U; idx++) {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			frames[idx] = (uint8_t *)frame_arena_alloc(&arena, size);
+		}
+		for (idx = 0; idx < size; idx++) {
+			/* a pattern which is not symmetric in any format */
+			frames[0][idx] = (uint8_t)((idx * 7U) + (idx / 4096U));
+		}
+
+		/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			loge("Failed to open %s\n", path);
+			ret = -1;
+		}
+	}
+
+	if (fd >= 0) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"width\": %u, \"height\": %u, \"frames\": %u, \"isa\": \"%s\",\n"
+			" \"rotations\": [", width, height, FRAME_ROTATE_BENCH_FRAMES,
+			FRAME_ROTATE_ISA);
+
+		for (idx = 0; idx < (sizeof(frame_rotate_bench_formats) /
+				sizeof(frame_rotate_bench_formats[0])); idx++) {
+			for (angle = 0; angle < 360U; angle += 90U) {
+				for (mirror = 0; mirror < (unsigned int)FRAME_ROTATE_MIRROR_MAX; mirror++) {
+					if ((angle == 0U) && (mirror == 0U)) {
+						/* not rotated */
+						logd("identity is not timed\n");
+					} else if (is_first == 0U) {
+						/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+						(void)dprintf(fd, ",");
+					} else {
+						/* the first */
+						is_first = 0;
+					}
+					if ((angle != 0U) || (mirror != 0U)) {
+						frame_rotate_bench_one(fd, frame_rotate_bench_formats[idx],
+							width, height, angle,
+							(enum frame_rotate_mirror)mirror, frames);
+					}
+				}
+			}
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+		(void)close(fd);
+	}
+
+	frame_arena_destroy(&arena);
+
+	return ret;
+}
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_ROTATE_H
+#define FRAME_ROTATE_H
+
+#include <stdint.h>
+
+#include "colorconv.h"
+
+/* default file to dump the throughput of the rotations as json */
+#define FRAME_ROTATE_BENCH_PATH		("/tmp/camera_app_rotate.json")
+
+/*
+ * the frame is transposed in blocks of about this many bytes a row, so the
+ * rows of a block of the source and of the rotated frame stay in the cache
+ */
+#define FRAME_ROTATE_BLOCK_BYTES	(64U)
+
+/* applied after the rotation, as seen on the screen */
+enum frame_rotate_mirror {
+	FRAME_ROTATE_MIRROR_NONE,
+	FRAME_ROTATE_MIRROR_HORIZONTAL,
+	FRAME_ROTATE_MIRROR_VERTICAL,
+	FRAME_ROTATE_MIRROR_MAX,
+};
+
+/*
+ * a plane rotated as elements of elem_size bytes, or the chroma of 4:2:2
+ * resampled for the pairs of the rotated pixels, as the pixels of a pair
+ * come from two rows of the source once it is transposed
+ */
+struct frame_rotate_plane {
+	/* of the source, in elements, or in pixels of the chroma resampled */
+	unsigned int			width;
+	unsigned int			height;
+	unsigned int			elem_size;
+	unsigned int			is_direct;
+	unsigned int			is_resampled;
+	/* bytes of the chroma of a pair, its components and their offsets */
+	unsigned int			pair_size;
+	unsigned int			n_comps;
+	unsigned int			comp_offset;
+	unsigned int			comp_step;
+};
+
+/*
+ * a rotation by 90, 180 or 270 degrees and a mirror of the frames of a
+ * format of video_format_table. A pixel (x, y) of the rotated frame is the
+ * pixel (x, y) of the source, or (y, x) if it is transposed, with its
+ * coordinates flipped.
+ */
+struct frame_rotate {
+	unsigned int			format;
+	unsigned int			width;
+	unsigned int			height;
+	unsigned int			dst_width;
+	unsigned int			dst_height;
+	unsigned int			is_transposed;
+	unsigned int			is_flip_x;
+	unsigned int			is_flip_y;
+	unsigned int			n_planes;
+	struct frame_rotate_plane	planes[COLORCONV_MAX_PLANES];
+};
+
+extern int frame_rotate_init(struct frame_rotate *rot, unsigned int format,
+	unsigned int width, unsigned int height, unsigned int angle,
+	enum frame_rotate_mirror mirror);
+extern unsigned int frame_rotate_is_identity(const struct frame_rotate *rot);
+extern const char *frame_rotate_get_isa_name(void);
+extern int frame_rotate_run(const struct frame_rotate *rot, const struct colorconv_image *src,
+	const struct colorconv_image *dst);
+extern int frame_rotate_run_reference(const struct frame_rotate *rot,
+	const struct colorconv_image *src, const struct colorconv_image *dst);
+extern int frame_rotate_dump_bench(const char *path, unsigned int width, unsigned int height);
+
+#endif//FRAME_ROTATE_H
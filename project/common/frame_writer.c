@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+#include "log.h"
+#include "frame_writer.h"
+#include "latency.h"
+
+#define FRAME_WRITER_MASK		(FRAME_WRITER_SLOTS - 1U)
+
+/* writev() until every vector is written, the vectors are consumed */
+static int frame_writer_writev_all(int fd, struct iovec *iov, unsigned int n_iov)
+{
+	struct iovec			*cur		= iov;
+	unsigned int			left		= n_iov;
+	ssize_t				len		= 0;
+	size_t				done		= 0;
+	int				ret		= 0;
+
+	while ((left > 0U) && (ret == 0)) {
+		len = writev(fd, cur, (int)left);
+		if (len > 0) {
+			done = (size_t)len;
+			while ((left > 0U) && (done >= cur->iov_len)) {
+				/* the vector is written */
+				done -= cur->iov_len;
+				cur++;
+				left--;
+			}
+			if (left > 0U) {
+				/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
+				cur->iov_base	= (void *)((unsigned char *)cur->iov_base + done);
+				cur->iov_len	-= done;
+			}
+		} else if ((len < 0) && (errno == EINTR)) {
+			/* again */
+			logd("writev is interrupted\n");
+		} else {
+			loge("writev(%u vectors left), errno: %d\n", left, errno);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+static int frame_writer_write_slot(struct frame_writer_slot *slot)
+{
+	int				fd		= -1;
+	int				ret		= 0;
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(slot->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+	if (fd < 0) {
+		loge("Failed to open %s, errno: %d\n", slot->path, errno);
+		ret = -1;
+	} else {
+		/* reserve the extents at once rather than growing the file write by write */
+		if ((fallocate(fd, 0, 0, (off_t)slot->length) < 0) && (errno != EOPNOTSUPP)) {
+			logw("fallocate(%zu), errno: %d\n", slot->length, errno);
+		}
+
+		ret = frame_writer_writev_all(fd, slot->iov, slot->n_iov);
+
+		if (close(fd) < 0) {
+			loge("Failed to close %s, errno: %d\n", slot->path, errno);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+static void frame_writer_account(struct frame_writer *writer, size_t length,
+	uint64_t duration_ns, int ret)
+{
+	struct frame_writer_stats	*stats		= &writer->stats;
+
+	if (ret < 0) {
+		/* error */
+		atomic_fetch_add(&stats->failed, 1U);
+	} else {
+		atomic_fetch_add(&stats->written, 1U);
+		atomic_fetch_add(&stats->bytes, length);
+	}
+	atomic_fetch_add(&stats->write_sum_ns, duration_ns);
+	if (duration_ns > atomic_load(&writer->stats.write_max_ns)) {
+		/* only the writer thread stores it */
+		atomic_store(&stats->write_max_ns, duration_ns);
+	}
+}
+
+static void frame_writer_write_pending(struct frame_writer *writer)
+{
+	struct frame_writer_slot	*slot		= NULL;
+	uint64_t			ts_begin	= 0;
+	uint64_t			value		= 1;
+	unsigned int			head		= 0;
+	unsigned int			tail		= 0;
+	int				ret		= 0;
+
+	tail = atomic_load_explicit(&writer->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&writer->head, memory_order_acquire);
+
+	while (head != tail) {
+		slot = &writer->slots[tail & FRAME_WRITER_MASK];
+
+		ts_begin = latency_get_time_ns();
+		if (writer->is_recording == 1U) {
+			/* the header of the frame goes to the index */
+			ret = frame_record_append(&writer->record, &slot->header,
+				&slot->iov[1], slot->n_iov - 1U);
+		} else {
+			ret = frame_writer_write_slot(slot);
+		}
+		frame_writer_account(writer, slot->length,
+			latency_get_time_ns() - ts_begin, ret);
+
+		/* the memory of the frame can be reused */
+		tail = tail + 1U;
+		atomic_store_explicit(&writer->tail, tail, memory_order_release);
+		if (write(writer->fd_done, &value, sizeof(value)) < 0) {
+			/* nobody is woken up to reap it */
+			loge("write(fd_done), errno: %d\n", errno);
+		}
+
+		head = atomic_load_explicit(&writer->head, memory_order_acquire);
+	}
+}
+
+/*
+ * Every wakeup writes all the queued slots, so the counts left in the
+ * eventfd by the slots written early only cause spurious wakeups.
+ */
+static void *frame_writer_thread(void *arg)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	struct frame_writer		*writer		= (struct frame_writer *)arg;
+	uint64_t			value		= 0;
+	unsigned int			is_running	= 1;
+
+	while (is_running == 1U) {
+		/* one count per queued slot, and one to stop */
+		if (read(writer->fd_event, &value, sizeof(value)) < 0) {
+			if (errno != EINTR) {
+				loge("read(fd_event), errno: %d\n", errno);
+				is_running = 0;
+			}
+		} else {
+			frame_writer_write_pending(writer);
+
+			if (atomic_load(&writer->is_stopping) == 1U) {
+				/* every slot is written */
+				is_running = 0;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Start the writer thread
+ *
+ * @param depth the frames which can be queued at once, as their memory is
+ * held until they are written
+ */
+int frame_writer_start(struct frame_writer *writer, unsigned int depth)
+{
+	int				ret		= 0;
+
+	(void)memset(writer, 0, sizeof(*writer));
+	writer->depth	= ((depth == 0U) || (depth > FRAME_WRITER_SLOTS)) ? FRAME_WRITER_SLOTS : depth;
+
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	writer->fd_event	= eventfd(0, EFD_CLOEXEC | EFD_SEMAPHORE);
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	writer->fd_done		= eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if ((writer->fd_event < 0) || (writer->fd_done < 0)) {
+		loge("eventfd, errno: %d\n", errno);
+		ret = -1;
+	} else {
+		ret = pthread_create(&writer->thread, NULL, frame_writer_thread, (void *)writer);
+		if (ret != 0) {
+			loge("pthread_create, ret: %d\n", ret);
+			ret = -1;
+		} else {
+			/* started */
+			writer->is_started = 1;
+		}
+	}
+
+	if (ret < 0) {
+		if (writer->fd_event >= 0) {
+			/* close */
+			(void)close(writer->fd_event);
+		}
+		if (writer->fd_done >= 0) {
+			/* close */
+			(void)close(writer->fd_done);
+		}
+		(void)memset(writer, 0, sizeof(*writer));
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Start the writer thread to append the frames to one recording
+ *
+ * @param capacity the frames which the index of the recording can hold
+ */
+int frame_writer_start_record(struct frame_writer *writer, unsigned int depth,
+	const char *path, unsigned int capacity)
+{
+	struct frame_record		record;
+	int				ret		= 0;
+
+	ret = frame_record_create(&record, path, capacity);
+	if (ret < 0) {
+		/* error */
+		loge("frame_record_create, ret: %d\n", ret);
+	} else {
+		ret = frame_writer_start(writer, depth);
+		if (ret < 0) {
+			/* nothing is recorded */
+			(void)frame_record_close(&record);
+		} else {
+			/* the thread reads it once the first slot is queued */
+			writer->record		= record;
+			writer->is_recording	= 1;
+		}
+	}
+
+	return ret;
+}
+
+/* the slots which are queued are written before the thread exits */
+void frame_writer_stop(struct frame_writer *writer)
+{
+	uint64_t			value		= 1;
+
+	if (writer->is_started == 1U) {
+		atomic_store(&writer->is_stopping, 1U);
+		if (write(writer->fd_event, &value, sizeof(value)) < 0) {
+			/* the thread would never wake up */
+			loge("write(fd_event), errno: %d\n", errno);
+		} else {
+			(void)pthread_join(writer->thread, NULL);
+		}
+
+		logi("frames written: %llu (%llu bytes), dropped: %llu, failed: %llu, "
+			"write avg: %llu us, max: %llu us\n",
+			atomic_load(&writer->stats.written), atomic_load(&writer->stats.bytes),
+			atomic_load(&writer->stats.dropped), atomic_load(&writer->stats.failed),
+			(atomic_load(&writer->stats.written) > 0U) ?
+				(atomic_load(&writer->stats.write_sum_ns) / atomic_load(&writer->stats.written) / 1000U) : 0U,
+			atomic_load(&writer->stats.write_max_ns) / 1000U);
+
+		if (writer->is_recording == 1U) {
+			/* after the last frame is appended */
+			(void)frame_record_close(&writer->record);
+		}
+
+		(void)close(writer->fd_event);
+		(void)close(writer->fd_done);
+		(void)memset(writer, 0, sizeof(*writer));
+	}
+}
+
+/**
+ * @brief Queue a frame to be written after its header
+ *
+ * The planes are written from where they are, so their memory must be kept
+ * until frame_writer_reap() gives the cookie back. The path is ignored when
+ * the frames are recorded.
+ *
+ * @return 0 if queued, or -1 if the frame is dropped because depth frames
+ * are not reaped yet
+ */
+int frame_writer_queue(struct frame_writer *writer, const char *path,
+	const struct frame_dump_header *header, const struct iovec *planes,
+	unsigned int n_planes, unsigned int cookie)
+{
+	struct frame_writer_slot	*slot		= NULL;
+	unsigned int			head		= 0;
+	unsigned int			idx		= 0;
+	uint64_t			value		= 1;
+	int				ret		= 0;
+
+	head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+
+	if ((writer->is_started == 0U) || (n_planes > FRAME_DUMP_MAX_PLANES)) {
+		loge("planes(%u) is wrong or the writer is not started\n", n_planes);
+		ret = -1;
+	} else if ((head - writer->reaped) >= writer->depth) {
+		/* unsigned wrap-around of the indexes is intended */
+		atomic_fetch_add(&writer->stats.dropped, 1U);
+		ret = -1;
+	} else {
+		slot = &writer->slots[head & FRAME_WRITER_MASK];
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		ret = snprintf(slot->path, sizeof(slot->path), "%s", path);
+		if ((ret < 0) || ((size_t)ret >= sizeof(slot->path))) {
+			loge("path(%s) is too long\n", path);
+			ret = -1;
+		} else {
+			slot->header		= *header;
+			slot->iov[0].iov_base	= (void *)&slot->header;
+			slot->iov[0].iov_len	= sizeof(slot->header);
+			slot->length		= sizeof(slot->header);
+			for (idx = 0; idx < n_planes; idx++) {
+				slot->iov[1U + idx]	= planes[idx];
+				slot->length		+= planes[idx].iov_len;
+			}
+			slot->n_iov		= 1U + n_planes;
+			slot->cookie		= cookie;
+
+			atomic_store_explicit(&writer->head, head + 1U, memory_order_release);
+			atomic_fetch_add(&writer->stats.queued, 1U);
+
+			if (write(writer->fd_event, &value, sizeof(value)) < 0) {
+				/* the slot is written with the next one */
+				loge("write(fd_event), errno: %d\n", errno);
+			}
+			ret = 0;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Take back the memory of a written frame
+ *
+ * @return 1 if the cookie of a written frame is returned, or 0 if none is
+ * left to reap
+ */
+int frame_writer_reap(struct frame_writer *writer, unsigned int *cookie)
+{
+	uint64_t			value		= 0;
+	unsigned int			tail		= 0;
+	int				ret		= 0;
+
+	if (writer->is_started == 1U) {
+		/* drained before tail is loaded, so a slot written after it rearms fd_done */
+		(void)read(writer->fd_done, &value, sizeof(value));
+
+		tail = atomic_load_explicit(&writer->tail, memory_order_acquire);
+		if (writer->reaped != tail) {
+			*cookie = writer->slots[writer->reaped & FRAME_WRITER_MASK].cookie;
+			writer->reaped++;
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * sleep until every queued frame is written, as before its memory is unmapped.
+ * fd_done is drained on the way, so the written frames are to be reaped by the
+ * caller rather than by waiting on frame_writer_get_fd().
+ */
+void frame_writer_wait_idle(const struct frame_writer *writer)
+{
+	struct pollfd			pfd		= { 0, };
+	uint64_t			value		= 0;
+
+	pfd.fd		= writer->fd_done;
+	pfd.events	= POLLIN;
+
+	while ((writer->is_started == 1U) &&
+	       (atomic_load(&writer->tail) != atomic_load(&writer->head))) {
+		/* a slot written after tail is loaded rearms fd_done */
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno != EINTR) {
+				loge("poll, errno: %d\n", errno);
+				break;
+			}
+		} else {
+			/* not to wake up again for the slots written so far */
+			(void)read(writer->fd_done, &value, sizeof(value));
+		}
+	}
+}
+
+/* readable when there are written frames to reap */
+int frame_writer_get_fd(const struct frame_writer *writer)
+{
+	return (writer->is_started == 1U) ? writer->fd_done : -1;
+}
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "frame_dump.h"
+#include "frame_record.h"
+
+/* the number of slots must be a power of 2 */
+#define FRAME_WRITER_SLOTS		(4U)
+#define FRAME_WRITER_PATH_MAX		(64U)
+
+/* the header and a vector per plane */
+#define FRAME_WRITER_IOVS		(1U + FRAME_DUMP_MAX_PLANES)
+
+struct frame_writer_slot {
+	char				path[FRAME_WRITER_PATH_MAX];
+	struct frame_dump_header	header;
+	struct iovec			iov[FRAME_WRITER_IOVS];
+	unsigned int			n_iov;
+	size_t				length;
+	/* given back by frame_writer_reap() when the slot is written */
+	unsigned int			cookie;
+};
+
+struct frame_writer_stats {
+	atomic_ullong			queued;
+	atomic_ullong			written;
+	/* frames dropped because every slot was still being written */
+	atomic_ullong			dropped;
+	atomic_ullong			failed;
+	atomic_ullong			bytes;
+	atomic_ullong			write_sum_ns;
+	atomic_ullong			write_max_ns;
+};
+
+/*
+ * frames are written to files, or appended to a recording, by the writer
+ * thread straight from the memory they are captured in, so a slow storage
+ * drops frames to dump instead of stalling preview. The memory of a queued
+ * frame must be kept until frame_writer_reap() gives its cookie back.
+ *
+ * The slots are a single-producer / single-consumer ring: head is only
+ * written by the queuing thread, tail only by the writer thread, and reaped
+ * only by the queuing thread.
+ */
+struct frame_writer {
+	pthread_t			thread;
+	unsigned int			is_started;
+	atomic_uint			is_stopping;
+	/* a semaphore eventfd counting the queued slots */
+	int				fd_event;
+	/* readable when a slot is written */
+	int				fd_done;
+
+	/* the slots in flight, up to FRAME_WRITER_SLOTS */
+	unsigned int			depth;
+	struct frame_writer_slot	slots[FRAME_WRITER_SLOTS];
+	atomic_uint			head;
+	atomic_uint			tail;
+	unsigned int			reaped;
+
+	/* 1 to append the frames to the recording instead of a file each */
+	unsigned int			is_recording;
+	struct frame_record		record;
+
+	struct frame_writer_stats	stats;
+};
+
+extern int frame_writer_start(struct frame_writer *writer, unsigned int depth);
+extern int frame_writer_start_record(struct frame_writer *writer, unsigned int depth,
+	const char *path, unsigned int capacity);
+extern void frame_writer_stop(struct frame_writer *writer);
+extern int frame_writer_queue(struct frame_writer *writer, const char *path,
+	const struct frame_dump_header *header, const struct iovec *planes,
+	unsigned int n_planes, unsigned int cookie);
+extern int frame_writer_reap(struct frame_writer *writer, unsigned int *cookie);
+extern void frame_writer_wait_idle(const struct frame_writer *writer);
+extern int frame_writer_get_fd(const struct frame_writer *writer);
+
+#endif//FRAME_WRITER_H
@@ -0,0 +1,368 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include "log.h"
+#include "ioctl_trace.h"
+#include "latency.h"
+
+/* the threads which can have their own table at a time */
+#define IOCTL_TRACE_MAX_THREADS		(8U)
+
+/* bucket n counts the calls in [2^(n-1), 2^n) us, bucket 0 under 1 us */
+#define IOCTL_TRACE_BUCKETS		(20U)
+
+/* the first bucket of the calls taking 16 ms or more */
+#define IOCTL_TRACE_SLOW_BUCKET		(15U)
+
+struct ioctl_trace_stat {
+	atomic_ullong			count;
+	atomic_ullong			errors;
+	atomic_ullong			total_ns;
+	atomic_ullong			max_ns;
+	atomic_int			last_errno;
+	atomic_ullong			buckets[IOCTL_TRACE_BUCKETS];
+};
+
+struct ioctl_trace_table {
+	int				tid;
+	/* set while a thread owns the table */
+	atomic_uint			in_use;
+	/* set after the table is claimed */
+	atomic_uint			ready;
+	struct ioctl_trace_stat		stats[IOCTL_TRACE_ID_MAX];
+};
+
+static const char * const ioctl_names[IOCTL_TRACE_ID_MAX] = {
+	"VIDIOC_QUERYCAP",
+	"VIDIOC_S_FMT",
+	"VIDIOC_REQBUFS",
+	"VIDIOC_QUERYBUF",
+	"VIDIOC_QBUF",
+	"VIDIOC_EXPBUF",
+	"VIDIOC_DQBUF",
+	"VIDIOC_STREAMON",
+	"VIDIOC_STREAMOFF",
+	"VIDIOC_ENUMINPUT",
+	"VIDIOC_G_INPUT",
+	"VIDIOC_S_SELECTION",
+	"VIDIOC_G_PARM",
+	"VIDIOC_S_PARM",
+	"VIDIOC_ENUM_FRAMESIZES",
+	"VIDIOC_ENUM_FRAMEINTERVALS",
+	"VIDIOC_CHECK_PATH_STATUS",
+	"VIDIOC_G_LASTFRAME_ADDRS",
+	"VIDIOC_CREATE_LASTFRAME",
+	"VIDIOC_S_HANDOVER",
+	"VIDIOC_S_LUT",
+	"OVERLAY_GET_LAYER",
+	"OVERLAY_PUSH_VIDEO_BUFFER",
+	"OVERLAY_GET_OVP",
+	"OVERLAY_SET_OVP",
+	"OVERLAY_DISABLE_LAYER",
+};
+
+/*
+ * Every thread claims a table on its first ioctl and is the only writer of
+ * it, so the counters are updated with relaxed loads and stores instead of
+ * locked read-modify-writes. The dump may read a call half counted, which
+ * is fine for statistics. When the thread exits, its counts are added into
+ * exited_table and the table is given back to be claimed by another.
+ */
+static struct ioctl_trace_table		tables[IOCTL_TRACE_MAX_THREADS];
+static struct ioctl_trace_table		exited_table;
+static atomic_ullong			n_untraced;
+
+static pthread_key_t			table_key;
+static pthread_once_t			table_key_once	= PTHREAD_ONCE_INIT;
+
+static _Thread_local struct ioctl_trace_table	*thread_table;
+
+static void stat_add(atomic_ullong *counter, uint64_t value)
+{
+	atomic_store_explicit(counter,
+		atomic_load_explicit(counter, memory_order_relaxed) + value,
+		memory_order_relaxed);
+}
+
+/* the threads exiting at the same time add into exited_table together */
+static void stat_merge(struct ioctl_trace_stat *dst, struct ioctl_trace_stat *src)
+{
+	uint64_t			max_ns		= 0;
+	uint64_t			cur_ns		= 0;
+	unsigned int			idx		= 0;
+
+	(void)atomic_fetch_add(&dst->count, atomic_exchange(&src->count, 0U));
+	(void)atomic_fetch_add(&dst->errors, atomic_exchange(&src->errors, 0U));
+	(void)atomic_fetch_add(&dst->total_ns, atomic_exchange(&src->total_ns, 0U));
+	for (idx = 0; idx < IOCTL_TRACE_BUCKETS; idx++) {
+		/* every bucket */
+		(void)atomic_fetch_add(&dst->buckets[idx], atomic_exchange(&src->buckets[idx], 0U));
+	}
+
+	max_ns = atomic_exchange(&src->max_ns, 0U);
+	cur_ns = atomic_load(&dst->max_ns);
+	while ((max_ns > cur_ns) &&
+	       (atomic_compare_exchange_weak(&dst->max_ns, &cur_ns, max_ns) == false)) {
+		/* cur_ns is reloaded by the failed exchange */
+		logd("max_ns is raced\n");
+	}
+	if (atomic_load(&src->last_errno) != 0) {
+		/* the last of the exited threads */
+		atomic_store(&dst->last_errno, atomic_exchange(&src->last_errno, 0));
+	}
+}
+
+/* destructor of table_key, run when a thread which has a table exits */
+static void ioctl_trace_release_table(void *param)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	struct ioctl_trace_table	*table		= (struct ioctl_trace_table *)param;
+	unsigned int			id		= 0;
+
+	atomic_store(&table->ready, 0U);
+	for (id = 0; id < (unsigned int)IOCTL_TRACE_ID_MAX; id++) {
+		/* and the counts are zeroed for the next owner */
+		stat_merge(&exited_table.stats[id], &table->stats[id]);
+	}
+	atomic_store(&table->in_use, 0U);
+}
+
+static void ioctl_trace_create_key(void)
+{
+	if (pthread_key_create(&table_key, &ioctl_trace_release_table) != 0) {
+		/* the tables are never given back */
+		loge("pthread_key_create: %s\n", strerror(errno));
+	}
+}
+
+static struct ioctl_trace_table *ioctl_trace_get_table(void)
+{
+	unsigned int			in_use		= 0;
+	unsigned int			idx		= 0;
+
+	if (thread_table == NULL) {
+		(void)pthread_once(&table_key_once, &ioctl_trace_create_key);
+		for (idx = 0; (thread_table == NULL) && (idx < IOCTL_TRACE_MAX_THREADS); idx++) {
+			in_use = 0;
+			if (atomic_compare_exchange_strong(&tables[idx].in_use, &in_use, 1U) == true) {
+				/* claimed */
+				thread_table = &tables[idx];
+			}
+		}
+		if (thread_table != NULL) {
+			thread_table->tid = (int)syscall(SYS_gettid);
+			(void)pthread_setspecific(table_key, (void *)thread_table);
+			atomic_store(&thread_table->ready, 1U);
+		}
+	}
+
+	return thread_table;
+}
+
+static unsigned int get_bucket(uint64_t duration_ns)
+{
+	uint64_t			us		= duration_ns / 1000U;
+	unsigned int			bucket		= 0;
+
+	while ((us != 0U) && (bucket < (IOCTL_TRACE_BUCKETS - 1U))) {
+		us >>= 1U;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void ioctl_trace_record(unsigned int id, uint64_t duration_ns, int ret, int err)
+{
+	struct ioctl_trace_table	*table		= NULL;
+	struct ioctl_trace_stat		*stat		= NULL;
+
+	table = ioctl_trace_get_table();
+	if ((table == NULL) || (id >= (unsigned int)IOCTL_TRACE_ID_MAX)) {
+		/* no table left */
+		(void)atomic_fetch_add(&n_untraced, 1U);
+	} else {
+		stat = &table->stats[id];
+
+		stat_add(&stat->count, 1U);
+		stat_add(&stat->total_ns, duration_ns);
+		stat_add(&stat->buckets[get_bucket(duration_ns)], 1U);
+		if (duration_ns > atomic_load_explicit(&stat->max_ns, memory_order_relaxed)) {
+			/* the longest call */
+			atomic_store_explicit(&stat->max_ns, duration_ns, memory_order_relaxed);
+		}
+		if (ret < 0) {
+			stat_add(&stat->errors, 1U);
+			atomic_store_explicit(&stat->last_errno, err, memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * @brief ioctl() which records its duration and result
+ *
+ * @param id the statistics the call is counted in
+ * @return the return value of ioctl(), errno is kept as well
+ */
+int ioctl_trace_call(unsigned int id, int fd, unsigned long request, void *arg)
+{
+	uint64_t			ts_begin	= 0;
+	uint64_t			ts_end		= 0;
+	int				err		= 0;
+	int				ret		= 0;
+
+	ts_begin	= latency_get_time_ns();
+	ret		= ioctl(fd, request, arg);
+	err		= errno;
+	ts_end		= latency_get_time_ns();
+
+	ioctl_trace_record(id, ts_end - ts_begin, ret, err);
+
+	errno = err;
+
+	return ret;
+}
+
+/* the upper bound of the bucket the nearest-rank percentile falls in */
+static uint64_t bucket_percentile(const struct ioctl_trace_stat *stat,
+	uint64_t count, unsigned int pct)
+{
+	uint64_t			rank		= 0;
+	uint64_t			sum		= 0;
+	unsigned int			idx		= 0;
+
+	rank = ((count * pct) + 99U) / 100U;
+	for (idx = 0; idx < IOCTL_TRACE_BUCKETS; idx++) {
+		sum += atomic_load_explicit(&stat->buckets[idx], memory_order_relaxed);
+		if (sum >= rank) {
+			/* found */
+			break;
+		}
+	}
+
+	return (idx < IOCTL_TRACE_BUCKETS) ? (1ULL << idx) : 0ULL;
+}
+
+static void write_stat(int fd, unsigned int id, const struct ioctl_trace_stat *stat,
+	unsigned int first)
+{
+	uint64_t			count		= 0;
+	uint64_t			slow		= 0;
+	unsigned int			idx		= 0;
+
+	count = atomic_load_explicit(&stat->count, memory_order_relaxed);
+	for (idx = IOCTL_TRACE_SLOW_BUCKET; idx < IOCTL_TRACE_BUCKETS; idx++) {
+		/* 16 ms or more */
+		slow += atomic_load_explicit(&stat->buckets[idx], memory_order_relaxed);
+	}
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "%s\n    {\"name\": \"%s\", \"count\": %llu, \"errors\": %llu, "
+		"\"last_errno\": %d, \"avg_us\": %llu, \"max_us\": %llu, "
+		"\"p50_us\": %llu, \"p99_us\": %llu, \"over_16ms\": %llu, \"buckets\": [",
+		(first == 1U) ? "" : ",", ioctl_names[id], (unsigned long long)count,
+		(unsigned long long)atomic_load_explicit(&stat->errors, memory_order_relaxed),
+		atomic_load_explicit(&stat->last_errno, memory_order_relaxed),
+		(unsigned long long)(atomic_load_explicit(&stat->total_ns,
+			memory_order_relaxed) / (count * 1000U)),
+		(unsigned long long)(atomic_load_explicit(&stat->max_ns,
+			memory_order_relaxed) / 1000U),
+		(unsigned long long)bucket_percentile(stat, count, 50U),
+		(unsigned long long)bucket_percentile(stat, count, 99U),
+		(unsigned long long)slow);
+	for (idx = 0; idx < IOCTL_TRACE_BUCKETS; idx++) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "%s%llu", (idx == 0U) ? "" : ", ",
+			(unsigned long long)atomic_load_explicit(&stat->buckets[idx],
+				memory_order_relaxed));
+	}
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "]}");
+}
+
+static void write_table(int fd, const struct ioctl_trace_table *table, unsigned int first)
+{
+	unsigned int			id		= 0;
+	unsigned int			is_first	= 1;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "%s\n  {\"tid\": %d, \"ioctls\": [", (first == 1U) ? "" : ",",
+		table->tid);
+	for (id = 0; id < (unsigned int)IOCTL_TRACE_ID_MAX; id++) {
+		if (atomic_load_explicit(&table->stats[id].count, memory_order_relaxed) > 0U) {
+			write_stat(fd, id, &table->stats[id], is_first);
+			is_first = 0;
+		}
+	}
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "\n  ]}");
+}
+
+/**
+ * @brief Write the ioctl statistics of every thread as json
+ *
+ * The durations are in us, and the percentiles are the upper bounds of the
+ * log2 histogram buckets they fall in. The calls of the threads which have
+ * exited are summed up under tid 0.
+ */
+int ioctl_trace_dump(const char *path)
+{
+	unsigned int			count		= 0;
+	unsigned int			idx		= 0;
+	unsigned int			first		= 1;
+	int				enabled		= 0;
+	int				fd		= -1;
+	int				ret		= 0;
+
+#if defined(USE_IOCTL_TRACE)
+	enabled = 1;
+#endif//defined(USE_IOCTL_TRACE)
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		loge("Failed to open %s\n", path);
+		ret = -1;
+	} else {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"enabled\": %d, \"untraced\": %llu,\n \"threads\": [",
+			enabled, (unsigned long long)atomic_load(&n_untraced));
+		for (idx = 0; idx < IOCTL_TRACE_MAX_THREADS; idx++) {
+			if (atomic_load(&tables[idx].ready) == 1U) {
+				write_table(fd, &tables[idx], first);
+				first = 0;
+				count++;
+			}
+		}
+		for (idx = 0; idx < (unsigned int)IOCTL_TRACE_ID_MAX; idx++) {
+			if (atomic_load(&exited_table.stats[idx].count) > 0U) {
+				/* once if any of them has called */
+				write_table(fd, &exited_table, first);
+				break;
+			}
+		}
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+
+		(void)close(fd);
+
+		logi("ioctl statistics of %u threads are written to %s\n", count, path);
+	}
+
+	return ret;
+}
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef IOCTL_TRACE_H
+#define IOCTL_TRACE_H
+
+#include <sys/ioctl.h>
+
+//#define USE_IOCTL_TRACE
+
+/* default file to dump the ioctl statistics as json */
+#define IOCTL_TRACE_DUMP_PATH		("/tmp/camera_app_ioctl.json")
+
+/* ioctls issued by the v4l2 capture and overlay hal */
+enum ioctl_trace_id {
+	IOCTL_TRACE_VIDIOC_QUERYCAP,
+	IOCTL_TRACE_VIDIOC_S_FMT,
+	IOCTL_TRACE_VIDIOC_REQBUFS,
+	IOCTL_TRACE_VIDIOC_QUERYBUF,
+	IOCTL_TRACE_VIDIOC_QBUF,
+	IOCTL_TRACE_VIDIOC_EXPBUF,
+	IOCTL_TRACE_VIDIOC_DQBUF,
+	IOCTL_TRACE_VIDIOC_STREAMON,
+	IOCTL_TRACE_VIDIOC_STREAMOFF,
+	IOCTL_TRACE_VIDIOC_ENUMINPUT,
+	IOCTL_TRACE_VIDIOC_G_INPUT,
+	IOCTL_TRACE_VIDIOC_S_SELECTION,
+	IOCTL_TRACE_VIDIOC_G_PARM,
+	IOCTL_TRACE_VIDIOC_S_PARM,
+	IOCTL_TRACE_VIDIOC_ENUM_FRAMESIZES,
+	IOCTL_TRACE_VIDIOC_ENUM_FRAMEINTERVALS,
+	IOCTL_TRACE_VIDIOC_CHECK_PATH_STATUS,
+	IOCTL_TRACE_VIDIOC_G_LASTFRAME_ADDRS,
+	IOCTL_TRACE_VIDIOC_CREATE_LASTFRAME,
+	IOCTL_TRACE_VIDIOC_S_HANDOVER,
+	IOCTL_TRACE_VIDIOC_S_LUT,
+	IOCTL_TRACE_OVERLAY_GET_LAYER,
+	IOCTL_TRACE_OVERLAY_PUSH_VIDEO_BUFFER,
+	IOCTL_TRACE_OVERLAY_GET_OVP,
+	IOCTL_TRACE_OVERLAY_SET_OVP,
+	IOCTL_TRACE_OVERLAY_DISABLE_LAYER,
+	IOCTL_TRACE_ID_MAX,
+};
+
+/*
+ * trace_ioctl() is a plain ioctl() unless USE_IOCTL_TRACE is defined, so
+ * the tracing costs nothing in production builds.
+ */
+#if defined(USE_IOCTL_TRACE)
+#define trace_ioctl(id, fd, request, arg)	\
+	ioctl_trace_call((id), (fd), (unsigned long)(request), (arg))
+#else
+#define trace_ioctl(id, fd, request, arg)	\
+	ioctl((fd), (request), (arg))
+#endif//defined(USE_IOCTL_TRACE)
+
+extern int ioctl_trace_call(unsigned int id, int fd, unsigned long request, void *arg);
+extern int ioctl_trace_dump(const char *path);
+
+#endif//IOCTL_TRACE_H
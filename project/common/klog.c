@@ -4,50 +4,108 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <sys/types.h>
-#include <sys/wait.h>
+#include <sys/syscall.h>
 #include <limits.h>
 
 #include "klog.h"
 #include "log.h"
 #include "basic_operation.h"
 
+#define KLOG_RING_ENTRIES		(128U)
+#define KLOG_MSG_LEN			(64U)
+
+#define KLOG_MARKER_BEGIN		("> before ")
+#define KLOG_MARKER_END			("> after ")
+
+struct klog_entry {
+	struct timespec			ts;
+	int				tid;
+	char				msg[KLOG_MSG_LEN];
+	/* set after the entry is filled */
+	atomic_uint			ready;
+};
+
 int	g_log_level		= 0;
 
+/*
+ * The timeline is preallocated and only grows: markers are recorded from the
+ * start of the application and the boot profile needs the earliest ones, so
+ * the markers which come after the ring is full are counted and dropped.
+ */
+static struct klog_entry	klog_ring[KLOG_RING_ENTRIES];
+static atomic_uint		klog_count;
+static atomic_uint		klog_dropped;
+
+static int			kmsg_fd		= -1;
+static pthread_once_t		kmsg_once	= PTHREAD_ONCE_INIT;
+
+static void open_kmsg_node(void)
+{
+	kmsg_fd = open("/dev/kmsg", O_WRONLY | O_CLOEXEC);
+	if (kmsg_fd < 0) {
+		loge("Failed to open /dev/kmsg file\n");
+	}
+}
+
 static int print_to_kmsg_node(const char *msg)
 {
-	pid_t				child		= { 0, };
-	int				fd		= 0;
+	char				line[KLOG_MSG_LEN + 1U]	= "";
+	size_t				len		= 0;
 	int				ret		= 0;
 
-	child = fork();
-	if (child == 0) {
-		fd = open("/dev/kmsg", O_WRONLY);
-		if (fd < 0) {
-			loge("Failed to open /dev/kmsg file\n");
+	(void)pthread_once(&kmsg_once, &open_kmsg_node);
+
+	if (kmsg_fd < 0) {
+		ret = -1;
+	} else {
+		len = strnlen(msg, KLOG_MSG_LEN - 1U);
+		(void)memcpy(line, msg, len);
+		line[len] = '\n';
+
+		/* a record of /dev/kmsg must be written at once */
+		if (write(kmsg_fd, line, len + 1U) < 0) {
+			loge("Failed to write /dev/kmsg file\n");
 			ret = -1;
-		} else {
-			(void)dup2(fd, 1);
-			ret = execl("/bin/echo", "/bin/echo", msg, NULL);
-			if (ret < 0) {
-				loge("Failed on execl(/bin/echo)\n");
-				ret = -1;
-			}
-			(void)close(fd);
 		}
 	}
-	(void)wait(NULL);
 
 	return ret;
 }
 
+static void record_marker(const char *msg)
+{
+	struct klog_entry		*entry		= NULL;
+	unsigned int			idx		= 0;
+
+	idx = atomic_fetch_add(&klog_count, 1U);
+	if (idx < KLOG_RING_ENTRIES) {
+		entry = &klog_ring[idx];
+
+		(void)clock_gettime(CLOCK_MONOTONIC, &entry->ts);
+		entry->tid = (int)syscall(SYS_gettid);
+		(void)strncpy(entry->msg, msg, KLOG_MSG_LEN - 1U);
+		entry->msg[KLOG_MSG_LEN - 1U] = '\0';
+
+		atomic_store(&entry->ready, 1U);
+	} else {
+		(void)atomic_fetch_add(&klog_dropped, 1U);
+	}
+}
+
 /* coverity[HIS_metric_violation : FALSE] */
 int klog_printl(const char *msg)
 {
 	int				ret		= 0;
 
+	record_marker(msg);
+
 	if (g_log_level == 1) {
 		/* print */
 		ret = print_to_kmsg_node(msg);
@@ -55,3 +113,98 @@ int klog_printl(const char *msg)
 
 	return ret;
 }
+
+static void escape_json(char *dst, size_t dst_len, const char *src)
+{
+	size_t				pos		= 0;
+	size_t				idx		= 0;
+
+	for (idx = 0; (src[idx] != '\0') && ((pos + 2U) < dst_len); idx++) {
+		if ((src[idx] == '"') || (src[idx] == '\\')) {
+			dst[pos] = '\\';
+			pos++;
+		}
+		dst[pos] = ((unsigned char)src[idx] < 0x20U) ? ' ' : src[idx];
+		pos++;
+	}
+	dst[pos] = '\0';
+}
+
+/*
+ * "> before X" and "> after X" become a duration event X, and the other
+ * markers become instant events.
+ */
+static void write_trace_event(int fd, const struct klog_entry *entry, unsigned int first)
+{
+	char				name[(KLOG_MSG_LEN * 2U) + 1U]	= "";
+	const char			*phase		= "i";
+	const char			*label		= entry->msg;
+	size_t				len_begin	= 0;
+	size_t				len_end		= 0;
+
+	len_begin	= strlen(KLOG_MARKER_BEGIN);
+	len_end		= strlen(KLOG_MARKER_END);
+
+	if (strncmp(label, KLOG_MARKER_BEGIN, len_begin) == 0) {
+		phase	= "B";
+		label	= &label[len_begin];
+	} else if (strncmp(label, KLOG_MARKER_END, len_end) == 0) {
+		phase	= "E";
+		label	= &label[len_end];
+	} else {
+		/* instant event */
+		logd("instant event: %s\n", label);
+	}
+
+	escape_json(name, sizeof(name), label);
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "%s\n  {\"name\": \"%s\", \"cat\": \"rvc\", \"ph\": \"%s\", "
+		"\"ts\": %lld.%03ld, \"pid\": %d, \"tid\": %d%s}",
+		(first == 1U) ? "" : ",", name, phase,
+		((long long)entry->ts.tv_sec * 1000000LL) + (entry->ts.tv_nsec / 1000L),
+		entry->ts.tv_nsec % 1000L, (int)getpid(), entry->tid,
+		(phase[0] == 'i') ? ", \"s\": \"p\"" : "");
+}
+
+int klog_dump_trace(const char *path)
+{
+	unsigned int			count		= 0;
+	unsigned int			idx		= 0;
+	unsigned int			first		= 1;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		loge("Failed to open %s\n", path);
+		ret = -1;
+	} else {
+		count = atomic_load(&klog_count);
+		if (count > KLOG_RING_ENTRIES) {
+			/* the ring is full */
+			count = KLOG_RING_ENTRIES;
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"traceEvents\": [");
+		for (idx = 0; idx < count; idx++) {
+			if (atomic_load(&klog_ring[idx].ready) == 1U) {
+				write_trace_event(fd, &klog_ring[idx], first);
+				first = 0;
+			}
+		}
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n], \"displayTimeUnit\": \"ms\", "
+			"\"otherData\": {\"dropped\": %u}}\n",
+			atomic_load(&klog_dropped));
+
+		(void)close(fd);
+
+		logi("%u markers are written to %s\n", count, path);
+	}
+
+	return ret;
+}
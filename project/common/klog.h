@@ -8,8 +8,12 @@
 
 #define	logk			(void)klog_printl
 
+/* default file to dump the boot timeline as chrome trace json */
+#define KLOG_TRACE_PATH		("/tmp/camera_app_trace.json")
+
 extern int g_log_level;
 
 extern int klog_printl(const char *msg);
+extern int klog_dump_trace(const char *path);
 
 #endif//KLOG_H
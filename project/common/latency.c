@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "log.h"
+#include "latency.h"
+
+/* the number of engages the percentiles are taken from */
+#define LATENCY_HISTORY			(64U)
+
+struct latency_record {
+	/* CLOCK_MONOTONIC, 0 if the milestone is not reached */
+	uint64_t			ts_ns[LATENCY_MILESTONE_MAX];
+};
+
+static const char * const milestone_names[LATENCY_MILESTONE_MAX] = {
+	"switch_edge",
+	"command_enqueued",
+	"command_dequeued",
+	"start_preview_init_format",
+	"start_preview_init_framerate",
+	"start_preview_init_buffers",
+	"start_preview_init_selection",
+	"start_preview_enable_stream",
+	"streamon",
+	"first_dqbuf",
+	"buffer_checked",
+	"first_overlay_qbuf",
+};
+
+static const char * const span_names[LATENCY_SPAN_MAX] = {
+	"switch_edge_to_ack",
+	"start_preview",
+};
+
+/* the last durations of a span, in ns */
+struct latency_span_history {
+	uint64_t			ns[LATENCY_HISTORY];
+	unsigned int			count;
+	unsigned int			idx;
+};
+
+/*
+ * The current engage is begun by the supervisor and marked by both the
+ * supervisor and the camera thread. A re-engage may begin a new one while
+ * the camera thread is still marking the one before, so every milestone is
+ * atomic and taken once by a compare-exchange, and the engage is committed
+ * once by whoever clears is_active. The history shared with the dump is
+ * under a lock.
+ */
+static atomic_uint_least64_t	current[LATENCY_MILESTONE_MAX];
+static atomic_uint		is_active;
+
+static struct latency_record	history[LATENCY_HISTORY];
+static unsigned int		n_history;
+static unsigned int		idx_history;
+static struct latency_span_history	spans[LATENCY_SPAN_MAX];
+
+static pthread_mutex_t		history_lock	= PTHREAD_MUTEX_INITIALIZER;
+
+/* CLOCK_MONOTONIC, the clock of the switch edges */
+uint64_t latency_get_time_ns(void)
+{
+	struct timespec			ts		= { 0, };
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const uint64_t			*lhs		= (const uint64_t *)a;
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const uint64_t			*rhs		= (const uint64_t *)b;
+
+	return (*lhs > *rhs) ? 1 : ((*lhs < *rhs) ? -1 : 0);
+}
+
+/* nearest-rank percentile of the sorted samples */
+static uint64_t percentile(const uint64_t *sorted, unsigned int count, unsigned int pct)
+{
+	unsigned int			rank		= 0;
+
+	rank = ((count * pct) + 99U) / 100U;
+
+	return (rank == 0U) ? 0U : sorted[rank - 1U];
+}
+
+/* the caller must hold history_lock */
+static unsigned int collect_samples(unsigned int milestone, uint64_t *samples)
+{
+	unsigned int			idx		= 0;
+	unsigned int			count		= 0;
+	const struct latency_record	*rec		= NULL;
+
+	for (idx = 0; idx < n_history; idx++) {
+		rec = &history[idx];
+		if (rec->ts_ns[milestone] != 0U) {
+			/* the delay from the switch edge */
+			samples[count] = rec->ts_ns[milestone] - rec->ts_ns[LATENCY_SWITCH_EDGE];
+			count++;
+		}
+	}
+
+	qsort(samples, count, sizeof(samples[0]), &compare_u64);
+
+	return count;
+}
+
+static void latency_commit(void)
+{
+	struct latency_record		rec;
+	uint64_t			samples[LATENCY_HISTORY];
+	unsigned int			idx		= 0;
+	unsigned int			count		= 0;
+
+	for (idx = 0; idx < (unsigned int)LATENCY_MILESTONE_MAX; idx++) {
+		/* a snapshot of the engage */
+		rec.ts_ns[idx] = atomic_load(&current[idx]);
+	}
+
+	(void)pthread_mutex_lock(&history_lock);
+
+	history[idx_history] = rec;
+	idx_history = (idx_history + 1U) % LATENCY_HISTORY;
+	if (n_history < LATENCY_HISTORY) {
+		/* not full yet */
+		n_history++;
+	}
+
+	count = collect_samples((unsigned int)LATENCY_FIRST_OVERLAY_QBUF, samples);
+
+	(void)pthread_mutex_unlock(&history_lock);
+
+	logi("reverse latency: %llu us (p50: %llu, p95: %llu, p99: %llu us over %u)\n",
+		(unsigned long long)((rec.ts_ns[LATENCY_FIRST_OVERLAY_QBUF] -
+			rec.ts_ns[LATENCY_SWITCH_EDGE]) / 1000U),
+		(unsigned long long)(percentile(samples, count, 50U) / 1000U),
+		(unsigned long long)(percentile(samples, count, 95U) / 1000U),
+		(unsigned long long)(percentile(samples, count, 99U) / 1000U),
+		count);
+	/* only the log uses the samples */
+	(void)count;
+}
+
+/**
+ * @brief Start measuring an engage of the reverse gear
+ *
+ * An engage which is not finished yet is dropped.
+ *
+ * @param edge_ns CLOCK_MONOTONIC timestamp of the switch edge, 0 for now
+ */
+void latency_begin(uint64_t edge_ns)
+{
+	unsigned int			idx		= 0;
+
+	/* the engage before is abandoned, and no longer committed */
+	atomic_store(&is_active, 0U);
+
+	for (idx = 0; idx < (unsigned int)LATENCY_MILESTONE_MAX; idx++) {
+		/* not reached */
+		atomic_store(&current[idx], 0U);
+	}
+	atomic_store(&current[LATENCY_SWITCH_EDGE],
+		(edge_ns != 0U) ? edge_ns : latency_get_time_ns());
+
+	atomic_store(&is_active, 1U);
+}
+
+/**
+ * @brief Record the first time a milestone is reached in the current engage
+ *
+ * The engage is finished when the first frame is queued to the overlay.
+ *
+ * @param milestone one of enum latency_milestone
+ */
+void latency_mark(unsigned int milestone)
+{
+	uint_least64_t			expected	= 0;
+
+	if ((milestone < (unsigned int)LATENCY_MILESTONE_MAX) &&
+	    (atomic_load(&is_active) == 1U) &&
+	    (atomic_compare_exchange_strong(&current[milestone], &expected,
+		latency_get_time_ns()) == true)) {
+		if ((milestone == (unsigned int)LATENCY_FIRST_OVERLAY_QBUF) &&
+		    (atomic_exchange(&is_active, 0U) == 1U)) {
+			/* finished */
+			latency_commit();
+		}
+	}
+}
+
+/**
+ * @brief Record the duration of a span from its start to now
+ *
+ * @param span one of enum latency_span
+ * @param start_ns CLOCK_MONOTONIC timestamp of the start of the span
+ */
+void latency_add_span(unsigned int span, uint64_t start_ns)
+{
+	uint64_t			now_ns		= 0;
+	struct latency_span_history	*hist		= NULL;
+
+	now_ns = latency_get_time_ns();
+	if ((span < (unsigned int)LATENCY_SPAN_MAX) && (start_ns <= now_ns)) {
+		(void)pthread_mutex_lock(&history_lock);
+
+		hist = &spans[span];
+		hist->ns[hist->idx] = now_ns - start_ns;
+		hist->idx = (hist->idx + 1U) % LATENCY_HISTORY;
+		if (hist->count < LATENCY_HISTORY) {
+			/* not full yet */
+			hist->count++;
+		}
+
+		(void)pthread_mutex_unlock(&history_lock);
+	}
+}
+
+/* the caller must hold history_lock */
+static void latency_dump_spans(int fd)
+{
+	uint64_t			samples[LATENCY_HISTORY];
+	const struct latency_span_history	*hist	= NULL;
+	unsigned int			idx		= 0;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "\n ],\n \"spans\": [");
+	for (idx = 0; idx < (unsigned int)LATENCY_SPAN_MAX; idx++) {
+		hist = &spans[idx];
+		(void)memcpy(samples, hist->ns, sizeof(samples[0]) * hist->count);
+		qsort(samples, hist->count, sizeof(samples[0]), &compare_u64);
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "%s\n  {\"name\": \"%s\", \"count\": %u, "
+			"\"last_us\": %llu, \"p50_us\": %llu, \"p95_us\": %llu, \"p99_us\": %llu}",
+			(idx == 0U) ? "" : ",", span_names[idx], hist->count,
+			(unsigned long long)((hist->count == 0U) ? 0U :
+				(hist->ns[(hist->idx + LATENCY_HISTORY - 1U) % LATENCY_HISTORY] / 1000U)),
+			(unsigned long long)(percentile(samples, hist->count, 50U) / 1000U),
+			(unsigned long long)(percentile(samples, hist->count, 95U) / 1000U),
+			(unsigned long long)(percentile(samples, hist->count, 99U) / 1000U));
+	}
+}
+
+int latency_dump(const char *path)
+{
+	uint64_t			samples[LATENCY_HISTORY];
+	unsigned int			count		= 0;
+	unsigned int			idx		= 0;
+	unsigned int			idxrec		= 0;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		loge("Failed to open %s\n", path);
+		ret = -1;
+	} else {
+		(void)pthread_mutex_lock(&history_lock);
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"engages\": %u,\n \"milestones\": [", n_history);
+		for (idx = 0; idx < (unsigned int)LATENCY_MILESTONE_MAX; idx++) {
+			count = collect_samples(idx, samples);
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			(void)dprintf(fd, "%s\n  {\"name\": \"%s\", \"count\": %u, "
+				"\"p50_us\": %llu, \"p95_us\": %llu, \"p99_us\": %llu}",
+				(idx == 0U) ? "" : ",", milestone_names[idx], count,
+				(unsigned long long)(percentile(samples, count, 50U) / 1000U),
+				(unsigned long long)(percentile(samples, count, 95U) / 1000U),
+				(unsigned long long)(percentile(samples, count, 99U) / 1000U));
+		}
+
+		latency_dump_spans(fd);
+
+		/* the delay of each milestone from the edge, -1 if not reached */
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ],\n \"records_us\": [");
+		for (idxrec = 0; idxrec < n_history; idxrec++) {
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			(void)dprintf(fd, "%s\n  [", (idxrec == 0U) ? "" : ",");
+			for (idx = 0; idx < (unsigned int)LATENCY_MILESTONE_MAX; idx++) {
+				/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+				(void)dprintf(fd, "%s%lld", (idx == 0U) ? "" : ", ",
+					(history[idxrec].ts_ns[idx] == 0U) ? -1LL :
+					(long long)((history[idxrec].ts_ns[idx] -
+						history[idxrec].ts_ns[LATENCY_SWITCH_EDGE]) / 1000U));
+			}
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			(void)dprintf(fd, "]");
+		}
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+
+		(void)pthread_mutex_unlock(&history_lock);
+
+		(void)close(fd);
+	}
+
+	return ret;
+}
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+/* default file to dump the reverse latency as json */
+#define LATENCY_DUMP_PATH		("/tmp/camera_app_latency.json")
+
+/* milestones from the reverse switch edge to the first frame shown */
+enum latency_milestone {
+	LATENCY_SWITCH_EDGE,
+	LATENCY_COMMAND_ENQUEUED,
+	LATENCY_COMMAND_DEQUEUED,
+	/* each step of video_input_start_preview in order */
+	LATENCY_START_PREVIEW_STEP,
+	LATENCY_STREAMON		= LATENCY_START_PREVIEW_STEP + 5,
+	LATENCY_FIRST_DQBUF,
+	LATENCY_BUFFER_CHECKED,
+	LATENCY_FIRST_OVERLAY_QBUF,
+	LATENCY_MILESTONE_MAX,
+};
+
+/* durations measured apart from the milestones of an engage */
+enum latency_span {
+	/* from a switch edge to the ack of the command it sends */
+	LATENCY_SPAN_SWITCH_EDGE_TO_ACK,
+	/* do_start_preview of a start preview command */
+	LATENCY_SPAN_START_PREVIEW,
+	LATENCY_SPAN_MAX,
+};
+
+extern uint64_t latency_get_time_ns(void);
+extern void latency_begin(uint64_t edge_ns);
+extern void latency_mark(unsigned int milestone);
+extern void latency_add_span(unsigned int span, uint64_t start_ns);
+extern int latency_dump(const char *path);
+
+#endif//LATENCY_H
@@ -10,12 +10,90 @@
 #include <poll.h>
 #include <errno.h>
 #include <limits.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
 #include "log.h"
 #include "message_queue.h"
 #include "basic_operation.h"
+
+#define MESSAGE_QUEUE_MASK	(MESSAGE_QUEUE_SLOTS - 1U)
+
+static void message_queue_ring_doorbell(const struct message_queue *msgq)
+{
+	uint64_t			value		= 1;
+
+	if (write(msgq->fd_event, &value, sizeof(value)) < 0) {
+		/* the counter can only overflow if nobody reads it */
+		loge("write(fd_event): %s\n", strerror(errno));
+	}
+}
+
+static void message_queue_drain_doorbell(const struct message_queue *msgq)
+{
+	uint64_t			value		= 0;
+
+	/* fd_event is non-blocking, so this never sleeps */
+	(void)read(msgq->fd_event, &value, sizeof(value));
+}
+
+static void message_queue_wait_doorbell(const struct message_queue *msgq)
+{
+	struct pollfd			pfd		= { 0, };
+
+	(void)memset((void *)&pfd, 0, sizeof(pfd));
+
+	pfd.fd		= msgq->fd_event;
+	pfd.events	= POLLIN;
+
+	if ((poll(&pfd, 1, -1) == -1) && (errno != EINTR)) {
+		loge("poll(): %s\n", strerror(errno));
+	}
+
+	message_queue_drain_doorbell(msgq);
+}
+
+/**
+ * @brief Pop a message from the ring without blocking
+ *
+ * If the ring becomes empty, the doorbell is drained so that an epoll on
+ * fd_event sleeps again. A message put between the drain and the re-check
+ * rings the doorbell again not to lose the wakeup.
+ *
+ * @return 1 if a message is popped, 0 if the ring is empty
+ */
+static int message_queue_try_get(const struct message_queue *msgq,
+	struct message *msg)
+{
+	struct message_ring		*ring		= msgq->ring;
+	unsigned int			head		= 0;
+	unsigned int			tail		= 0;
+	int				ret		= 0;
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	if (head != tail) {
+		*msg = ring->slots[tail & MESSAGE_QUEUE_MASK];
+		/* unsigned wrap-around of the indexes is intended */
+		tail = tail + 1U;
+		atomic_store(&ring->tail, tail);
+
+		if (atomic_load(&ring->head) == tail) {
+			message_queue_drain_doorbell(msgq);
+			if (atomic_load(&ring->head) != tail) {
+				/* a message is put while draining */
+				message_queue_ring_doorbell(msgq);
+			}
+		}
+		ret = 1;
+	}
+
+	return ret;
+}
+
 int message_queue_open(struct message_queue *msgq)
 {
-	int				fds[2]		= { -1, -1 };
+	void				*ring		= NULL;
 	int				ret		= 0;
 
 	if (msgq == NULL) {
@@ -23,10 +101,27 @@ int message_queue_open(struct message_queue *msgq)
 		loge("msgq is NULL\n");
 		ret = -1;
 	} else {
-		ret = pipe(fds);
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		ring = mmap(NULL, sizeof(struct message_ring), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (ring == MAP_FAILED) {
+			loge("mmap: %s\n", strerror(errno));
+			ret = -1;
+		} else {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			msgq->ring = (struct message_ring *)ring;
+			atomic_init(&msgq->ring->head, 0U);
+			atomic_init(&msgq->ring->tail, 0U);
 
-		msgq->fd_read	= fds[0];
-		msgq->fd_write	= fds[1];
+			/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+			msgq->fd_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+			if (msgq->fd_event < 0) {
+				loge("eventfd: %s\n", strerror(errno));
+				(void)munmap(ring, sizeof(struct message_ring));
+				msgq->ring = NULL;
+				ret = -1;
+			}
+		}
 	}
 
 	return (int)ret;
@@ -40,15 +135,15 @@ int message_queue_close(const struct message_queue *msgq)
 		loge("msgq is NULL\n");
 		ret = -1;
 	} else {
-		ret = close(msgq->fd_read);
+		ret = close(msgq->fd_event);
 		if (ret < 0) {
 			/* error */
-			loge("close(fd_read), ret: %d\n", ret);
+			loge("close(fd_event), ret: %d\n", ret);
 		}
-		ret = close(msgq->fd_write);
+		ret = munmap((void *)msgq->ring, sizeof(struct message_ring));
 		if (ret < 0) {
 			/* error */
-			loge("close(fd_write), ret: %d\n", ret);
+			loge("munmap(ring), ret: %d\n", ret);
 		}
 	}
 
@@ -58,25 +153,15 @@ int message_queue_close(const struct message_queue *msgq)
 int message_queue_get(const struct message_queue *msgq,
 	struct message *msg)
 {
-	char				*p		= (char *)msg;
-	size_t				read_bytes	= 0;
 	int				ret		= 0;
 
 	if (msgq == NULL) {
 		loge("msgq is NULL\n");
 		ret = -1;
 	} else {
-		while (read_bytes < sizeof(*msg)) {
-			/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
-			ssize_t bytes = read(msgq->fd_read, p + read_bytes, sizeof(*msg) - read_bytes);
-
-			if (bytes < 0) {
-				loge("read_size(%lu - %lu)\n", sizeof(*msg), read_bytes);
-				ret = -1;
-			} else {
-				/* increase */
-				read_bytes += (size_t)bytes;
-			}
+		while (message_queue_try_get(msgq, msg) == 0) {
+			/* sleep until the producer rings the doorbell */
+			message_queue_wait_doorbell(msgq);
 		}
 	}
 
@@ -85,24 +170,31 @@ int message_queue_get(const struct message_queue *msgq,
 
 int message_queue_put(const struct message_queue *msgq, const struct message *msg)
 {
-	const char			*p		= (const char *)msg;
-	size_t				write_bytes	= 0;
+	struct message_ring		*ring		= NULL;
+	unsigned int			head		= 0;
+	unsigned int			tail		= 0;
 	int				ret		= 0;
 
 	if (msgq == NULL) {
 		loge("msgq is NULL\n");
 		ret = -1;
 	} else {
-		while (write_bytes < sizeof(*msg)) {
-			/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
-			ssize_t bytes = write(msgq->fd_write, p + write_bytes, sizeof(*msg) - write_bytes);
+		ring = msgq->ring;
 
-			if (bytes < 0) {
-				loge("write_size(%lu - %lu)\n", sizeof(*msg), write_bytes);
-				ret = -1;
-			} else {
-				/* increase */
-				write_bytes += (size_t)bytes;
+		head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+		/* unsigned wrap-around of the indexes is intended */
+		if ((head - tail) >= MESSAGE_QUEUE_SLOTS) {
+			loge("ring is full(head: %u, tail: %u)\n", head, tail);
+			ret = -1;
+		} else {
+			ring->slots[head & MESSAGE_QUEUE_MASK] = *msg;
+			atomic_store(&ring->head, head + 1U);
+
+			if (atomic_load(&ring->tail) == head) {
+				/* the ring was empty, so the consumer may sleep */
+				message_queue_ring_doorbell(msgq);
 			}
 		}
 	}
@@ -112,23 +204,34 @@ int message_queue_put(const struct message_queue *msgq, const struct message *ms
 
 int message_queue_is_empty(const struct message_queue *msgq)
 {
-	struct pollfd			pfd		= { 0, };
+	unsigned int			head		= 0;
+	unsigned int			tail		= 0;
 	int				ret		= 0;
 
 	if (msgq == NULL) {
 		loge("msgq is NULL\n");
 		ret = -1;
 	} else {
-		(void)memset((void *)&pfd, 0, sizeof(pfd));
+		/* no syscall is needed to check the ring */
+		head = atomic_load_explicit(&msgq->ring->head, memory_order_acquire);
+		tail = atomic_load_explicit(&msgq->ring->tail, memory_order_relaxed);
 
-		pfd.fd		= msgq->fd_read;
-		pfd.events	= POLLIN;
+		ret = (head == tail) ? 1 : 0;
+	}
 
-		if (poll(&pfd, 1, 0) == -1) {
-			loge("poll(): %s\n", strerror(errno));
-		}
+	return ret;
+}
 
-		ret = ((s16_to_u32(pfd.revents) & (unsigned int)POLLIN) == 0U) ? 1 : 0;
+int message_queue_get_fd(const struct message_queue *msgq)
+{
+	int				ret		= 0;
+
+	if (msgq == NULL) {
+		loge("msgq is NULL\n");
+		ret = -1;
+	} else {
+		/* the doorbell is readable while the ring is not empty */
+		ret = msgq->fd_event;
 	}
 
 	return ret;
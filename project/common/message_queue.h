@@ -7,6 +7,10 @@
 #define MESSAGE_QUEUE_H
 
 #include <stdint.h>
+#include <stdatomic.h>
+
+/* the number of slots must be a power of 2 */
+#define MESSAGE_QUEUE_SLOTS	(16U)
 
 struct message {
 	unsigned int		command;
@@ -16,9 +20,22 @@ struct message {
 	void			*arg4;
 };
 
+/*
+ * single-producer / single-consumer ring
+ *
+ * head is only written by the producer and tail only by the consumer. The
+ * eventfd doorbell is rung only when the ring goes from empty to non-empty,
+ * which is the only case the consumer can be sleeping on it.
+ */
+struct message_ring {
+	atomic_uint		head;
+	atomic_uint		tail;
+	struct message		slots[MESSAGE_QUEUE_SLOTS];
+};
+
 struct message_queue {
-	int			fd_read;
-	int			fd_write;
+	struct message_ring	*ring;
+	int			fd_event;
 };
 
 struct messenger {
@@ -31,6 +48,7 @@ extern int message_queue_close(const struct message_queue *msgq);
 extern int message_queue_get(const struct message_queue *msgq, struct message *msg);
 extern int message_queue_put(const struct message_queue *msgq, const struct message *msg);
 extern int message_queue_is_empty(const struct message_queue *msgq);
+extern int message_queue_get_fd(const struct message_queue *msgq);
 
 extern int message_queue_init(struct messenger *msger);
 extern int message_queue_deinit(const struct messenger *msger);
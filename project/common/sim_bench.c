@@ -0,0 +1,443 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "log.h"
+#include "message_queue.h"
+#include "frame_arena.h"
+#include "latency.h"
+#include "sim_bench.h"
+
+/*
+ * The benchmark echoes the messages from another thread, as the camera
+ * thread acks the commands, through the ring and through a pair of pipes
+ * which carry the messages as the queue did before the ring.
+ */
+struct message_queue_bench {
+	struct messenger	msger;
+	int			cmd_pipe[2];
+	int			ack_pipe[2];
+	unsigned int		is_pipe;
+	unsigned int		count;
+};
+
+static int message_queue_pipe_put(int fd, const struct message *msg)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const char			*p		= (const char *)msg;
+	size_t				write_bytes	= 0;
+	ssize_t				bytes		= 0;
+	int				ret		= 0;
+
+	while ((ret == 0) && (write_bytes < sizeof(*msg))) {
+		/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
+		bytes = write(fd, p + write_bytes, sizeof(*msg) - write_bytes);
+		if (bytes < 0) {
+			loge("write: %s\n", strerror(errno));
+			ret = -1;
+		} else {
+			/* increase */
+			write_bytes += (size_t)bytes;
+		}
+	}
+
+	return ret;
+}
+
+static int message_queue_pipe_get(int fd, struct message *msg)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	char				*p		= (char *)msg;
+	size_t				read_bytes	= 0;
+	ssize_t				bytes		= 0;
+	int				ret		= 0;
+
+	while ((ret == 0) && (read_bytes < sizeof(*msg))) {
+		/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
+		bytes = read(fd, p + read_bytes, sizeof(*msg) - read_bytes);
+		if (bytes <= 0) {
+			loge("read: %s\n", strerror(errno));
+			ret = -1;
+		} else {
+			/* increase */
+			read_bytes += (size_t)bytes;
+		}
+	}
+
+	return ret;
+}
+
+static void *message_queue_bench_echo(void *param)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	struct message_queue_bench	*bench		= (struct message_queue_bench *)param;
+	struct pollfd			pfd		= { 0, };
+	struct message			msg		= { 0, };
+	unsigned int			count		= 0;
+	int				ret		= 0;
+
+	pfd.fd		= message_queue_get_fd(&bench->msger.cmd);
+	pfd.events	= POLLIN;
+
+	while ((ret == 0) && (count < bench->count)) {
+		if (bench->is_pipe == 1U) {
+			ret = message_queue_pipe_get(bench->cmd_pipe[0], &msg);
+			msg.command |= 0x80000000U;
+			ret |= message_queue_pipe_put(bench->ack_pipe[1], &msg);
+			count++;
+		} else {
+			/* sleep on the doorbell as the camera thread does */
+			(void)poll(&pfd, 1, -1);
+			while ((ret == 0) && (message_queue_is_empty(&bench->msger.cmd) != 1)) {
+				ret = message_queue_get(&bench->msger.cmd, &msg);
+				msg.command |= 0x80000000U;
+				ret |= message_queue_put(&bench->msger.ack, &msg);
+				count++;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* nanoseconds a message of the rounds of a burst each, and the lost acks */
+static uint64_t message_queue_bench_run(struct message_queue_bench *bench,
+	unsigned int burst, unsigned int *lost)
+{
+	pthread_t			thread;
+	struct message			msg		= { 0, };
+	uint64_t			ts_start	= 0;
+	uint64_t			ns		= 0;
+	unsigned int			round		= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	bench->count = MESSAGE_QUEUE_BENCH_ROUNDS * burst;
+	ret = pthread_create(&thread, NULL, message_queue_bench_echo, (void *)bench);
+	if (ret != 0) {
+		loge("pthread_create, ret: %d\n", ret);
+	} else {
+		ts_start = latency_get_time_ns();
+		for (round = 0; (ret == 0) && (round < MESSAGE_QUEUE_BENCH_ROUNDS); round++) {
+			for (idx = 0; (ret == 0) && (idx < burst); idx++) {
+				msg.command = (round * burst) + idx;
+				ret = (bench->is_pipe == 1U) ?
+					message_queue_pipe_put(bench->cmd_pipe[1], &msg) :
+					message_queue_put(&bench->msger.cmd, &msg);
+			}
+			for (idx = 0; (ret == 0) && (idx < burst); idx++) {
+				ret = (bench->is_pipe == 1U) ?
+					message_queue_pipe_get(bench->ack_pipe[0], &msg) :
+					message_queue_get(&bench->msger.ack, &msg);
+				if (msg.command != (((round * burst) + idx) | 0x80000000U)) {
+					/* out of order or lost */
+					(*lost)++;
+				}
+			}
+		}
+		ns = (latency_get_time_ns() - ts_start) /
+			((uint64_t)MESSAGE_QUEUE_BENCH_ROUNDS * burst);
+
+		if (ret != 0) {
+			/* the echo thread waits for the rest forever */
+			(void)pthread_cancel(thread);
+			(*lost)++;
+		}
+		(void)pthread_join(thread, NULL);
+	}
+
+	return ns;
+}
+
+/* nanoseconds to check an empty queue, as the capture loop did every frame */
+static uint64_t message_queue_bench_is_empty(const struct message_queue_bench *bench)
+{
+	struct pollfd			pfd		= { 0, };
+	uint64_t			ts_start	= 0;
+	unsigned int			idx		= 0;
+
+	pfd.fd		= bench->cmd_pipe[0];
+	pfd.events	= POLLIN;
+
+	ts_start = latency_get_time_ns();
+	for (idx = 0; idx < MESSAGE_QUEUE_BENCH_ROUNDS; idx++) {
+		if (bench->is_pipe == 1U) {
+			/* the check of the pipe */
+			(void)poll(&pfd, 1, 0);
+		} else {
+			/* and of the ring */
+			(void)message_queue_is_empty(&bench->msger.cmd);
+		}
+	}
+
+	return (latency_get_time_ns() - ts_start) / MESSAGE_QUEUE_BENCH_ROUNDS;
+}
+
+static void message_queue_bench_one(int fd, struct message_queue_bench *bench,
+	unsigned int is_pipe)
+{
+	uint64_t			empty_ns	= 0;
+	uint64_t			rtt_ns		= 0;
+	uint64_t			burst_ns	= 0;
+	uint64_t			msgs_per_s	= 0;
+	unsigned int			lost		= 0;
+
+	bench->is_pipe	= is_pipe;
+	empty_ns	= message_queue_bench_is_empty(bench);
+	rtt_ns		= message_queue_bench_run(bench, 1U, &lost);
+	burst_ns	= message_queue_bench_run(bench, MESSAGE_QUEUE_SLOTS, &lost);
+	msgs_per_s	= (burst_ns > 0U) ? (1000000000U / burst_ns) : 0U;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "\n  {\"name\": \"%s\", \"is_empty_ns\": %llu, "
+		"\"round_trip_us\": %llu.%03llu, \"burst_msgs_per_s\": %llu, \"lost\": %u}",
+		(is_pipe == 1U) ? "pipe" : "ring", (unsigned long long)empty_ns,
+		(unsigned long long)(rtt_ns / 1000U),
+		(unsigned long long)(rtt_ns % 1000U),
+		(unsigned long long)msgs_per_s, lost);
+}
+
+/**
+ * @brief Time the round trips of a message through the ring and the pipes
+ *
+ * A message is put and its ack is got back from a thread which echoes it,
+ * one at a time for "round_trip_us", and in bursts as many as the slots of
+ * the ring for "burst_msgs_per_s". "is_empty_ns" is the check of an empty
+ * queue, and "lost" counts the acks which do not come back in order.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int message_queue_dump_bench(const char *path)
+{
+	struct message_queue_bench	bench;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	(void)memset((void *)&bench, 0, sizeof(bench));
+	bench.cmd_pipe[0]	= -1;
+	bench.cmd_pipe[1]	= -1;
+	bench.ack_pipe[0]	= -1;
+	bench.ack_pipe[1]	= -1;
+
+	ret = message_queue_init(&bench.msger);
+	if (ret == 0) {
+		ret = pipe(bench.cmd_pipe);
+		ret |= pipe(bench.ack_pipe);
+		if (ret != 0) {
+			loge("pipe: %s\n", strerror(errno));
+			ret = -1;
+		}
+	}
+
+	if (ret == 0) {
+		/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			loge("Failed to open %s\n", path);
+			ret = -1;
+		}
+	}
+
+	if (fd >= 0) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"message_bytes\": %zu, \"rounds\": %u, \"burst\": %u,\n"
+			" \"queues\": [", sizeof(struct message), MESSAGE_QUEUE_BENCH_ROUNDS,
+			MESSAGE_QUEUE_SLOTS);
+		message_queue_bench_one(fd, &bench, 1U);
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, ",");
+		message_queue_bench_one(fd, &bench, 0U);
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+		(void)close(fd);
+	}
+
+	(void)close(bench.cmd_pipe[0]);
+	(void)close(bench.cmd_pipe[1]);
+	(void)close(bench.ack_pipe[0]);
+	(void)close(bench.ack_pipe[1]);
+	(void)message_queue_deinit(&bench.msger);
+
+	return ret;
+}
+
+enum frame_arena_backing {
+	/* mapped as the buffers of the capture device, faulted on first touch */
+	FRAME_ARENA_BACKING_MMAP,
+	FRAME_ARENA_BACKING_USERPTR,
+	FRAME_ARENA_BACKING_USERPTR_HUGEPAGE,
+	FRAME_ARENA_BACKING_MAX,
+};
+
+static const char * const frame_arena_backing_names[FRAME_ARENA_BACKING_MAX] = {
+	"mmap",
+	"userptr",
+	"userptr_hugepage",
+};
+
+/* the minor and major faults the calling thread has taken */
+static uint64_t frame_arena_get_faults(void)
+{
+	struct rusage			usage;
+
+	(void)memset((void *)&usage, 0, sizeof(usage));
+	(void)getrusage(RUSAGE_THREAD, &usage);
+
+	return (uint64_t)usage.ru_minflt + (uint64_t)usage.ru_majflt;
+}
+
+/* the buffers of a stream written and copied out once, and then timed */
+static void frame_arena_bench_one(int fd, enum frame_arena_backing backing,
+	size_t size, uint8_t *dst)
+{
+	struct frame_arena		arena;
+	uint8_t				*bufs[FRAME_ARENA_BENCH_BUFFERS];
+	void				*base		= MAP_FAILED;
+	size_t				map_size	= 0;
+	uint64_t			faults		= 0;
+	uint64_t			ts_start	= 0;
+	uint64_t			first_ns	= 0;
+	uint64_t			ns		= 0;
+	uint64_t			gbps_milli	= 0;
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	(void)memset((void *)&arena, 0, sizeof(arena));
+	map_size = frame_arena_align(size) * FRAME_ARENA_BENCH_BUFFERS;
+
+	if (backing == FRAME_ARENA_BACKING_MMAP) {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		base = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED) {
+			loge("mmap(%zu), errno: %d\n", map_size, errno);
+			ret = -1;
+		}
+	} else {
+		ret = frame_arena_create(&arena, map_size,
+			(backing == FRAME_ARENA_BACKING_USERPTR_HUGEPAGE) ? 1U : 0U);
+		base = arena.base;
+	}
+
+	if (ret == 0) {
+		for (idx = 0; idx < FRAME_ARENA_BENCH_BUFFERS; idx++) {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			/* coverity[misra_c_2012_rule_18_4_violation : FALSE] */
+			bufs[idx] = (uint8_t *)base + (frame_arena_align(size) * idx);
+		}
+
+		/* the first frame of each buffer, written by the capture and read */
+		faults = frame_arena_get_faults();
+		ts_start = latency_get_time_ns();
+		for (idx = 0; idx < FRAME_ARENA_BENCH_BUFFERS; idx++) {
+			(void)memset(bufs[idx], (int)idx, size);
+			(void)memcpy(dst, bufs[idx], size);
+		}
+		first_ns = (latency_get_time_ns() - ts_start) / FRAME_ARENA_BENCH_BUFFERS;
+		faults = (frame_arena_get_faults() - faults) / FRAME_ARENA_BENCH_BUFFERS;
+
+		ts_start = latency_get_time_ns();
+		for (idx = 0; idx < FRAME_ARENA_BENCH_FRAMES; idx++) {
+			/* timed */
+			(void)memcpy(dst, bufs[idx % FRAME_ARENA_BENCH_BUFFERS], size);
+		}
+		ns = (latency_get_time_ns() - ts_start) / FRAME_ARENA_BENCH_FRAMES;
+		/* bytes per nanosecond are gigabytes per second, read and written */
+		gbps_milli = (ns > 0U) ? (((uint64_t)size * 2U * 1000U) / ns) : 0U;
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n  {\"backing\": \"%s\", \"hugepage\": %u, \"locked\": %u, "
+			"\"first_frame_faults\": %llu, \"first_frame_ms\": %llu.%03llu, "
+			"\"copy_gbps\": %llu.%03llu}",
+			frame_arena_backing_names[backing], arena.is_hugepage, arena.is_locked,
+			(unsigned long long)faults,
+			(unsigned long long)(first_ns / 1000000U),
+			(unsigned long long)((first_ns / 1000U) % 1000U),
+			(unsigned long long)(gbps_milli / 1000U),
+			(unsigned long long)(gbps_milli % 1000U));
+	}
+
+	if (backing == FRAME_ARENA_BACKING_MMAP) {
+		if (base != MAP_FAILED) {
+			/* unmap */
+			(void)munmap(base, map_size);
+		}
+	} else {
+		/* the arena */
+		frame_arena_destroy(&arena);
+	}
+}
+
+/**
+ * @brief Compare the frames of the mmap and the userptr io-modes
+ *
+ * The buffers of a stream are written once and copied out, as the first
+ * frames after STREAMON are, and "first_frame_faults" is the page faults a
+ * frame takes. "copy_gbps" is the throughput of copying the frames out of
+ * them afterwards. The mmap buffers are shared memory faulted in on first
+ * touch, as the buffers of the fake capture are.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int frame_arena_dump_bench(const char *path, unsigned int width, unsigned int height)
+{
+	struct frame_arena		arena;
+	uint8_t				*dst		= NULL;
+	size_t				size		= 0;
+	unsigned int			backing		= 0;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	/* rgb32 is the largest */
+	size = (size_t)width * height * 4U;
+	ret = frame_arena_create(&arena, frame_arena_align(size), 0U);
+	if (ret == 0) {
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		dst = (uint8_t *)frame_arena_alloc(&arena, size);
+
+		/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			loge("Failed to open %s\n", path);
+			ret = -1;
+		}
+	}
+
+	if (fd >= 0) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"width\": %u, \"height\": %u, \"buffers\": %u, "
+			"\"frames\": %u,\n \"backings\": [", width, height,
+			FRAME_ARENA_BENCH_BUFFERS, FRAME_ARENA_BENCH_FRAMES);
+
+		for (backing = 0; backing < (unsigned int)FRAME_ARENA_BACKING_MAX; backing++) {
+			if (backing > 0U) {
+				/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+				(void)dprintf(fd, ",");
+			}
+			frame_arena_bench_one(fd, (enum frame_arena_backing)backing, size, dst);
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+		(void)close(fd);
+	}
+
+	frame_arena_destroy(&arena);
+
+	return ret;
+}
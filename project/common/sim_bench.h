@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef SIM_BENCH_H
+#define SIM_BENCH_H
+
+/*
+ * benchmarks of the camera_app_sim build, run by the commands of its stdin.
+ * They only time the modules through their interfaces, so they are kept out
+ * of camera_app.
+ */
+
+/* default file to dump the round trips of the queue as json */
+#define MESSAGE_QUEUE_BENCH_PATH	("/tmp/camera_app_msgq.json")
+
+/* the round trips timed by the benchmark, one message or a burst each */
+#define MESSAGE_QUEUE_BENCH_ROUNDS	(20000U)
+
+/* default file to dump the faults and the copy throughput of the frames */
+#define FRAME_ARENA_BENCH_PATH		("/tmp/camera_app_userptr.json")
+
+/* the buffers of a stream, and the frames copied out of them to be timed */
+#define FRAME_ARENA_BENCH_BUFFERS	(4U)
+#define FRAME_ARENA_BENCH_FRAMES	(60U)
+
+extern int message_queue_dump_bench(const char *path);
+extern int frame_arena_dump_bench(const char *path, unsigned int width, unsigned int height);
+
+#endif//SIM_BENCH_H
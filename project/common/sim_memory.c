@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "sim_memory.h"
+
+/*
+ * Every region gets a fixed window of the address space, so an address is
+ * its window and the offset in it, and the windows are reused as soon as
+ * they are unregistered.
+ */
+#define SIM_MEMORY_BASE			(0x40000000U)
+#define SIM_MEMORY_WINDOW_SIZE		(0x02000000U)
+#define SIM_MEMORY_WINDOWS		(96U)
+
+struct sim_memory_region {
+	void				*vaddr;
+	size_t				length;
+};
+
+static struct sim_memory_region	regions[SIM_MEMORY_WINDOWS];
+static pthread_mutex_t			regions_lock	= PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Give a memory a physical address
+ *
+ * @return the physical address, 0 if the memory is too large or no window
+ * is left
+ */
+uint32_t sim_memory_register(void *vaddr, size_t length)
+{
+	unsigned int			idx		= 0;
+	uint32_t			paddr		= 0;
+
+	if ((vaddr == NULL) || (length == 0U) || (length > (size_t)SIM_MEMORY_WINDOW_SIZE)) {
+		/* error */
+		loge("memory(%p, %zu) can not be registered\n", vaddr, length);
+	} else {
+		(void)pthread_mutex_lock(&regions_lock);
+		for (idx = 0; idx < SIM_MEMORY_WINDOWS; idx++) {
+			if (regions[idx].vaddr == NULL) {
+				regions[idx].vaddr	= vaddr;
+				regions[idx].length	= length;
+				paddr = SIM_MEMORY_BASE + (idx * SIM_MEMORY_WINDOW_SIZE);
+				break;
+			}
+		}
+		(void)pthread_mutex_unlock(&regions_lock);
+
+		if (paddr == 0U) {
+			/* full */
+			loge("no window is left for %zu bytes\n", length);
+		}
+	}
+
+	return paddr;
+}
+
+void sim_memory_unregister(uint32_t paddr)
+{
+	unsigned int			idx		= 0;
+
+	if (paddr >= SIM_MEMORY_BASE) {
+		idx = (paddr - SIM_MEMORY_BASE) / SIM_MEMORY_WINDOW_SIZE;
+		if (idx < SIM_MEMORY_WINDOWS) {
+			(void)pthread_mutex_lock(&regions_lock);
+			regions[idx].vaddr	= NULL;
+			regions[idx].length	= 0;
+			(void)pthread_mutex_unlock(&regions_lock);
+		}
+	}
+}
+
+/**
+ * @brief Get the virtual address of a physical address
+ *
+ * @param length the number of bytes which must be accessible from paddr
+ * @return the virtual address, NULL if the range is not registered
+ */
+void *sim_memory_lookup(uint32_t paddr, size_t length)
+{
+	unsigned char			*vaddr		= NULL;
+	unsigned int			idx		= 0;
+	size_t				offset		= 0;
+
+	if (paddr >= SIM_MEMORY_BASE) {
+		idx	= (paddr - SIM_MEMORY_BASE) / SIM_MEMORY_WINDOW_SIZE;
+		offset	= (paddr - SIM_MEMORY_BASE) % SIM_MEMORY_WINDOW_SIZE;
+		if (idx < SIM_MEMORY_WINDOWS) {
+			(void)pthread_mutex_lock(&regions_lock);
+			if ((regions[idx].vaddr != NULL) && ((offset + length) <= regions[idx].length)) {
+				/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+				vaddr = (unsigned char *)regions[idx].vaddr;
+				vaddr = &vaddr[offset];
+			}
+			(void)pthread_mutex_unlock(&regions_lock);
+		}
+	}
+
+	return vaddr;
+}
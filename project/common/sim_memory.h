@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef SIM_MEMORY_H
+#define SIM_MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * physical address space of the camera_app_sim build. The emulated devices
+ * pass buffers by 32-bit physical addresses as the real ones do, so the
+ * fake capture device registers its buffers here and the fake overlay
+ * looks the addresses it is given up.
+ */
+extern uint32_t sim_memory_register(void *vaddr, size_t length);
+extern void sim_memory_unregister(uint32_t paddr);
+extern void *sim_memory_lookup(uint32_t paddr, size_t length);
+
+#endif//SIM_MEMORY_H
@@ -144,6 +144,41 @@ static struct video_format video_format_table[V4L2_PIXEL_FORMAT_MAX] = {
 	}
 };
 
+static const struct v4l2_memory_name {
+	const char	*name;
+	unsigned int	memory;
+} v4l2_memory_table[] = {
+	{ "mmap",	(unsigned int)V4L2_MEMORY_MMAP		},
+	{ "userptr",	(unsigned int)V4L2_MEMORY_USERPTR	},
+	{ "dmabuf",	(unsigned int)V4L2_MEMORY_DMABUF	},
+};
+
+/*
+ * The memory is named, or given by its value of enum v4l2_memory as the
+ * option used to be. 0 is returned for any other name.
+ */
+unsigned int v4l2_get_v4l2_memory_by_name(const char *name)
+{
+	unsigned int	nEntry		=
+		u64_to_u32(sizeof(v4l2_memory_table) / sizeof(v4l2_memory_table[0]));
+	unsigned int	idxEntry	= 0;
+	unsigned int	ret		= 0;
+	char		value[16]	= "";
+
+	for (/*idxEntry = 0*/; idxEntry < nEntry; idxEntry++) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)snprintf(value, sizeof(value), "%u", v4l2_memory_table[idxEntry].memory);
+		if ((strcmp(name, v4l2_memory_table[idxEntry].name) == 0) ||
+		    (strcmp(name, value) == 0)) {
+			ret = v4l2_memory_table[idxEntry].memory;
+			logd("name: %s, v4l2 memory: %u\n", name, ret);
+			break;
+		}
+	}
+
+	return ret;
+}
+
 unsigned int v4l2_get_v4l2_format_by_name(const char *name)
 {
 	unsigned int	nEntry		=
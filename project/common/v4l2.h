@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 extern unsigned int v4l2_get_v4l2_format_by_name(const char *name);
+extern unsigned int v4l2_get_v4l2_memory_by_name(const char *name);
 extern const char *v4l2_get_format_name_by_v4l2_format(unsigned int format);
 extern unsigned int v4l2_convert_format_from_v4l2_to_vioc(unsigned int format);
 extern unsigned int v4l2_get_color_depth_by_v4l2_format(unsigned int format);
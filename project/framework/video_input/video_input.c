@@ -18,6 +18,7 @@
 
 #include "log.h"
 #include "klog.h"
+#include "latency.h"
 #include "v4l2.h"
 #include "video_input.h"
 #include "basic_operation.h"
@@ -35,10 +36,29 @@ int video_input_open_device(struct video_input *dev)
 	return ret;
 }
 
+static void video_input_free_buffers(const struct video_input *dev,
+	unsigned int io_mode);
+
+/*
+ * In V4L2_MEMORY_DMABUF io_mode, the buffers are allocated by the capture
+ * driver and exported as dma-buf fds, so the queue itself works in
+ * V4L2_MEMORY_MMAP.
+ */
+static unsigned int video_input_get_queue_memory(unsigned int io_mode)
+{
+	return (io_mode == (unsigned int)V4L2_MEMORY_DMABUF) ?
+		(unsigned int)V4L2_MEMORY_MMAP : io_mode;
+}
+
 int video_input_close_device(const struct video_input *dev)
 {
 	int				ret		= 0;
 
+	if (dev->pool.is_allocated == 1U) {
+		/* release the buffers kept by the buffer pool */
+		video_input_free_buffers(dev, dev->pool.io_mode);
+	}
+
 	ret = v4l2_capture_close_device(&dev->capture);
 	if (ret < 0) {
 		loge("v4l2_capture_close_device, ret: %d\n", ret);
@@ -171,7 +191,7 @@ int video_input_dqbuf(const struct video_input *dev, struct v4l2_buffer *pbuf)
 	(void)memset((void *)planes, 0, sizeof(planes));
 
 	buf.type	= (unsigned int)VIDEO_CAPTURE_BUF_TYPE;
-	buf.memory	= dev->io_mode;
+	buf.memory	= video_input_get_queue_memory(dev->io_mode);
 	buf.m.planes	= planes;
 	buf.length	= v4l2_get_planes_by_v4l2_format(dev->format);
 	logd("type: %d, memory: %d, length: 0x%x\n",
@@ -182,7 +202,14 @@ int video_input_dqbuf(const struct video_input *dev, struct v4l2_buffer *pbuf)
 		logd("[VIN %d] v4l2_capture_dqbuf, errno: %d\n",
 			dev->capture.id, errno);
 		ret = -1;
+	} else if (buf.index >= dev->n_allocated_buf) {
+		loge("[VIN %d] index(%u) is wrong\n", dev->capture.id, buf.index);
+		ret = -1;
 	} else {
+		/* planes must outlive this call to queue the buffer again */
+		(void)memcpy(dev->buffers[buf.index].planes, planes, sizeof(planes));
+		buf.m.planes = dev->buffers[buf.index].planes;
+
 		/* return buf */
 		*pbuf = buf;
 	}
@@ -218,6 +245,8 @@ int video_input_start_stream(const struct video_input *dev)
 			dev->capture.id, ret);
 		ret = -1;
 	} else {
+		latency_mark((unsigned int)LATENCY_STREAMON);
+
 		/* wait until the video-input driver write some video data
 		 * to the memory
 		 */
@@ -723,9 +752,11 @@ int video_input_enum_frameinfo(const struct video_input *dev,
 static int video_input_allocate_buffers(struct video_input *dev,
 	unsigned int io_mode)
 {
+	unsigned int			idxBuf		= 0;
+	unsigned int			idxpln		= 0;
 	int				ret		= 0;
 
-	ret = video_input_request_buffers(dev, io_mode, NUM_VIDBUF);
+	ret = video_input_request_buffers(dev, video_input_get_queue_memory(io_mode), NUM_VIDBUF);
 	if (ret <= 0) {
 		loge("video_input_request_buffers, ret: %d\n", ret);
 		ret = -1;
@@ -740,21 +771,60 @@ static int video_input_allocate_buffers(struct video_input *dev,
 		if (dev->buffers == NULL) {
 			loge("allocate buffer memory\n");
 			ret = -1;
+		} else {
+			(void)memset(dev->buffers, 0, sizeof(struct buffer_t) * dev->n_allocated_buf);
+			for (idxBuf = 0U; idxBuf < dev->n_allocated_buf; idxBuf++) {
+				for (idxpln = 0U; idxpln < (unsigned int)VIDEO_MAX_PLANES; idxpln++) {
+					/* not exported */
+					dev->buffers[idxBuf].fd[idxpln] = -1;
+				}
+			}
 		}
 	}
 
 	return ret;
 }
 
+static int video_input_export_plane(const struct video_input *dev,
+	unsigned int idxBuf, unsigned int idxpln, int *fd)
+{
+	struct v4l2_exportbuffer	expbuf		= { 0, };
+	int				ret		= 0;
+
+	(void)memset(&expbuf, 0, sizeof(expbuf));
+
+	expbuf.type	= (unsigned int)VIDEO_CAPTURE_BUF_TYPE;
+	expbuf.index	= idxBuf;
+	expbuf.plane	= idxpln;
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	expbuf.flags	= (unsigned int)(O_RDWR | O_CLOEXEC);
+
+	ret = video_input_expbuf(dev, &expbuf);
+	if (ret < 0) {
+		loge("video_input_expbuf(%u, %u), ret: %d\n", idxBuf, idxpln, ret);
+		ret = -1;
+	} else {
+		*fd = expbuf.fd;
+		logd("buffer[%u].plane[%u] is exported as fd %d\n", idxBuf, idxpln, *fd);
+	}
+
+	return ret;
+}
+
 static int video_input_init_plane_addr(const struct video_input *dev,
 	struct buf_addr *paddrs, struct buf_addr *vaddrs,
-	const struct v4l2_plane *pln)
+	const struct v4l2_plane *pln, int fd)
 {
 	int				ret		= 0;
 
-	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
-	vaddrs->addr = (void *)mmap(NULL, pln->length, PROT_READ | PROT_WRITE, MAP_SHARED,
-				dev->capture.fd, (off_t)pln->m.mem_offset);
+	if (fd < 0) {
+		vaddrs->addr = v4l2_capture_mmap(&dev->capture, pln->length, pln->m.mem_offset);
+	} else {
+		/* map the exported buffer not to depend on the capture node */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		vaddrs->addr = (void *)mmap(NULL, pln->length, PROT_READ | PROT_WRITE, MAP_SHARED,
+					fd, 0);
+	}
 
 	logd("vaddrs->addr = %p\n", vaddrs->addr);
 
@@ -782,7 +852,7 @@ static void video_input_init_vidbuf(struct v4l2_buffer *vid_buf,
 {
 	vid_buf->index		= idxBuf;
 	vid_buf->type		= (unsigned int)VIDEO_CAPTURE_BUF_TYPE;
-	vid_buf->memory		= io_mode;
+	vid_buf->memory		= video_input_get_queue_memory(io_mode);
 	vid_buf->m.planes	= planes;
 	vid_buf->length		= v4l2_get_planes_by_v4l2_format(format);
 	logd("num_planes: %d\n", vid_buf->length);
@@ -796,11 +866,13 @@ static int video_input_init_buf_addr(const struct video_input *dev,
 	struct v4l2_plane		planes[VIDEO_MAX_PLANES];
 	struct buf_addr			*vaddrs		= NULL;
 	struct buf_addr			*paddrs		= NULL;
+	int				*fds		= NULL;
 	unsigned int			idxpln		= 0;
 	int				ret		= 0;
 
 	vaddrs = dev->buffers[idxBuf].vaddrs;
 	paddrs = dev->buffers[idxBuf].paddrs;
+	fds    = dev->buffers[idxBuf].fd;
 
 	(void)memset(&vid_buf, 0, sizeof(vid_buf));
 	(void)memset(&planes, 0,  sizeof(planes));
@@ -814,15 +886,25 @@ static int video_input_init_buf_addr(const struct video_input *dev,
 		loge("video_input_query_buffer, ret: %d\n", ret);
 		ret = -1;
 	} else {
-		for (idxpln = 0; idxpln < vid_buf.length; idxpln++) {
-			ret = video_input_init_plane_addr(dev, &paddrs[idxpln],
-							  &vaddrs[idxpln], &planes[idxpln]);
-			if (ret < 0) {
-				/* error */
-				loge("video_input_init_plane_addr, ret: %d\n", ret);
+		for (idxpln = 0; (ret == 0) && (idxpln < vid_buf.length); idxpln++) {
+			if (io_mode == (unsigned int)V4L2_MEMORY_DMABUF) {
+				/* export the plane as a dma-buf fd */
+				ret = video_input_export_plane(dev, idxBuf, idxpln, &fds[idxpln]);
+			}
+
+			if (ret == 0) {
+				ret = video_input_init_plane_addr(dev, &paddrs[idxpln],
+								  &vaddrs[idxpln], &planes[idxpln],
+								  fds[idxpln]);
+				if (ret < 0) {
+					/* error */
+					loge("video_input_init_plane_addr, ret: %d\n", ret);
+				}
 			}
 		}
+	}
 
+	if (ret == 0) {
 		ret = video_input_qbuf(dev, &vid_buf);
 		if (ret < 0) {
 			loge("[VIN %d] video_input_qbuf, ret: %d\n",
@@ -834,6 +916,120 @@ static int video_input_init_buf_addr(const struct video_input *dev,
 	return ret;
 }
 
+static void video_input_init_userptr_planes(const struct video_input *dev,
+	unsigned int idxBuf, struct v4l2_plane *planes, unsigned int num_planes)
+{
+	const struct buf_addr		*vaddrs		= NULL;
+	unsigned int			idxpln		= 0;
+
+	vaddrs = dev->buffers[idxBuf].vaddrs;
+
+	for (idxpln = 0; idxpln < num_planes; idxpln++) {
+		/* coverity[misra_c_2012_rule_11_6_violation : FALSE] */
+		planes[idxpln].m.userptr	= (unsigned long)vaddrs[idxpln].addr;
+		planes[idxpln].length		= vaddrs[idxpln].length;
+	}
+}
+
+static int video_input_query_userptr_buffers(const struct video_input *dev,
+	unsigned int format, unsigned int io_mode, size_t *size)
+{
+	struct v4l2_buffer		vid_buf		= { 0, };
+	struct v4l2_plane		planes[VIDEO_MAX_PLANES];
+	struct buf_addr			*vaddrs		= NULL;
+	struct buf_addr			*paddrs		= NULL;
+	unsigned int			idxBuf		= 0;
+	unsigned int			idxpln		= 0;
+	int				ret		= 0;
+
+	*size = 0;
+
+	for (idxBuf = 0U; idxBuf < dev->n_allocated_buf; idxBuf++) {
+		vaddrs = dev->buffers[idxBuf].vaddrs;
+		paddrs = dev->buffers[idxBuf].paddrs;
+
+		(void)memset(&vid_buf, 0, sizeof(vid_buf));
+		(void)memset(&planes, 0,  sizeof(planes));
+
+		video_input_init_vidbuf(&vid_buf, format, io_mode, idxBuf, planes);
+
+		/* the driver reports the size of each plane */
+		ret = video_input_query_buffer(dev, &vid_buf);
+		if (ret < 0) {
+			loge("video_input_query_buffer, ret: %d\n", ret);
+			ret = -1;
+			break;
+		}
+
+		for (idxpln = 0; idxpln < vid_buf.length; idxpln++) {
+			vaddrs[idxpln].length	= planes[idxpln].length;
+			paddrs[idxpln].length	= planes[idxpln].length;
+			*size += frame_arena_align(planes[idxpln].length);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Slice the buffers of V4L2_MEMORY_USERPTR io_mode off one arena
+ *
+ * Every plane starts on a page boundary of one contiguous memory which is
+ * populated and locked in advance, so streaming does not take page faults.
+ *
+ * @param dev video-input device instance
+ * @param format v4l2 pixel format
+ * @param io_mode V4L2_MEMORY_USERPTR
+ * @return 0 if all the buffers are queued
+ */
+static int video_input_init_userptr_buffers(struct video_input *dev,
+	unsigned int format, unsigned int io_mode)
+{
+	struct v4l2_buffer		vid_buf		= { 0, };
+	struct v4l2_plane		planes[VIDEO_MAX_PLANES];
+	struct buf_addr			*vaddrs		= NULL;
+	unsigned int			idxBuf		= 0;
+	unsigned int			idxpln		= 0;
+	size_t				size		= 0;
+	int				ret		= 0;
+
+	ret = video_input_query_userptr_buffers(dev, format, io_mode, &size);
+	if (ret == 0) {
+		ret = frame_arena_create(&dev->arena, size, dev->use_hugepage);
+	}
+
+	for (idxBuf = 0U; (ret == 0) && (idxBuf < dev->n_allocated_buf); idxBuf++) {
+		vaddrs = dev->buffers[idxBuf].vaddrs;
+
+		(void)memset(&vid_buf, 0, sizeof(vid_buf));
+		(void)memset(&planes, 0,  sizeof(planes));
+
+		video_input_init_vidbuf(&vid_buf, format, io_mode, idxBuf, planes);
+
+		for (idxpln = 0; idxpln < vid_buf.length; idxpln++) {
+			vaddrs[idxpln].addr = frame_arena_alloc(&dev->arena, vaddrs[idxpln].length);
+			if (vaddrs[idxpln].addr == NULL) {
+				loge("[VIN %d] no memory of the arena for buffer(%u) plane(%u)\n",
+					dev->capture.id, idxBuf, idxpln);
+				ret = -1;
+			}
+		}
+
+		if (ret == 0) {
+			video_input_init_userptr_planes(dev, idxBuf, planes, vid_buf.length);
+
+			ret = video_input_qbuf(dev, &vid_buf);
+			if (ret < 0) {
+				loge("[VIN %d] video_input_qbuf, ret: %d\n",
+					dev->capture.id, ret);
+				ret = -1;
+			}
+		}
+	}
+
+	return ret;
+}
+
 int video_input_init_buffers(struct video_input *dev,
 				 unsigned int format, unsigned int io_mode)
 {
@@ -843,7 +1039,9 @@ int video_input_init_buffers(struct video_input *dev,
 	if (dev == NULL) {
 		loge("dev is NULL\n");
 		ret = -1;
-	} else if (io_mode != (unsigned int)V4L2_MEMORY_MMAP) {
+	} else if ((io_mode != (unsigned int)V4L2_MEMORY_MMAP) &&
+		   (io_mode != (unsigned int)V4L2_MEMORY_USERPTR) &&
+		   (io_mode != (unsigned int)V4L2_MEMORY_DMABUF)) {
 		loge("memory type (0x%08x) is not supported\n", io_mode);
 		ret = -1;
 	} else {
@@ -855,6 +1053,9 @@ int video_input_init_buffers(struct video_input *dev,
 		if (ret < 0) {
 			loge("Failed to allocate buffers\n");
 			ret = -1;
+		} else if (io_mode == (unsigned int)V4L2_MEMORY_USERPTR) {
+			/* slice the buffers off the frame arena */
+			ret = video_input_init_userptr_buffers(dev, format, io_mode);
 		} else {
 			for (idxBuf = 0U;
 			     idxBuf < dev->n_allocated_buf; idxBuf++) {
@@ -868,40 +1069,74 @@ int video_input_init_buffers(struct video_input *dev,
 				}
 			}
 		}
+
+		if ((ret < 0) && (dev->n_allocated_buf > 0U)) {
+			/*
+			 * release the buffers requested, close the fds exported, and
+			 * unmap the planes mapped or destroy the arena made so far
+			 */
+			video_input_free_buffers(dev, io_mode);
+			dev->buffers		= NULL;
+			dev->n_allocated_buf	= 0;
+			(void)memset(&dev->arena, 0, sizeof(dev->arena));
+		}
 	}
 
 	return ret;
 }
 
-static int video_input_deallocate_buffers(struct video_input *dev,
-					   unsigned int io_mode)
+static void video_input_free_buffers(const struct video_input *dev,
+	unsigned int io_mode)
 {
 	unsigned int			idxBuf		= 0;
 	int				idxpln		= 0;
 	int				ret		= 0;
 
-	for (idxBuf = 0; idxBuf < dev->n_allocated_buf; idxBuf++) {
+	for (idxBuf = 0; (dev->buffers != NULL) && (idxBuf < dev->n_allocated_buf); idxBuf++) {
 		for (idxpln = 0; idxpln < VIDEO_MAX_PLANES; idxpln++) {
-			if (dev->buffers[idxBuf].vaddrs[idxpln].addr != NULL) {
+			if (io_mode == (unsigned int)V4L2_MEMORY_USERPTR) {
+				/* the planes are slices of the frame arena */
+				dev->buffers[idxBuf].vaddrs[idxpln].addr = NULL;
+			} else if (dev->buffers[idxBuf].vaddrs[idxpln].addr != NULL) {
 				(void)munmap(dev->buffers[idxBuf].vaddrs[idxpln].addr,
 					dev->buffers[idxBuf].vaddrs[idxpln].length);
 				dev->buffers[idxBuf].vaddrs[idxpln].addr = NULL;
 			}
+			if (dev->buffers[idxBuf].fd[idxpln] >= 0) {
+				/* the driver frees the buffer after the last fd is closed */
+				(void)close(dev->buffers[idxBuf].fd[idxpln]);
+				dev->buffers[idxBuf].fd[idxpln] = -1;
+			}
 		}
 	}
 
-	ret = video_input_request_buffers(dev, io_mode, 0);
+	ret = video_input_request_buffers(dev, video_input_get_queue_memory(io_mode), 0);
 	if (ret < 0) {
+		/* error */
 		loge("video_input_request_buffers, ret: %d\n", ret);
-		ret = -1;
-	} else {
-		dev->n_allocated_buf = s32_to_u32(ret);
-		logd("The number of the allocated buffer: %d\n",
-			dev->n_allocated_buf);
-		/* coverity[misra_c_2012_rule_21_3_violation : FALSE] */
-		free(dev->buffers);
 	}
 
+	/* the driver does not touch the user memory after releasing the buffers */
+	frame_arena_destroy(&dev->arena);
+
+	/* coverity[misra_c_2012_rule_21_3_violation : FALSE] */
+	free(dev->buffers);
+}
+
+static int video_input_deallocate_buffers(struct video_input *dev,
+					   unsigned int io_mode)
+{
+	int				ret		= 0;
+
+	video_input_free_buffers(dev, io_mode);
+
+	dev->buffers		= NULL;
+	dev->n_allocated_buf	= 0;
+	dev->pool.is_allocated	= 0;
+	(void)memset(&dev->arena, 0, sizeof(dev->arena));
+	logd("The number of the allocated buffer: %d\n",
+		dev->n_allocated_buf);
+
 	return ret;
 }
 
@@ -913,7 +1148,9 @@ int video_input_uninit_buffers(struct video_input *dev,
 	if (dev == NULL) {
 		loge("dev is NULL\n");
 		ret = -1;
-	} else if (io_mode != (unsigned int)V4L2_MEMORY_MMAP) {
+	} else if ((io_mode != (unsigned int)V4L2_MEMORY_MMAP) &&
+		   (io_mode != (unsigned int)V4L2_MEMORY_USERPTR) &&
+		   (io_mode != (unsigned int)V4L2_MEMORY_DMABUF)) {
 		loge("memory type (0x%08x) is not supported\n", io_mode);
 		ret = -1;
 	} else {
@@ -924,16 +1161,71 @@ int video_input_uninit_buffers(struct video_input *dev,
 	return ret;
 }
 
-static int start_preview_init_format(const struct video_input *dev)
+/**
+ * @brief Check if the buffers of the pool can be used for the next stream
+ *
+ * @param dev video-input device instance
+ * @return int 1 if the buffers are allocated with the current configuration
+ */
+static int video_input_is_pool_reusable(const struct video_input *dev)
+{
+	return ((dev->pool.enable	== 1U) &&
+		(dev->pool.is_allocated	== 1U) &&
+		(dev->pool.width	== dev->frame_width) &&
+		(dev->pool.height	== dev->frame_height) &&
+		(dev->pool.format	== dev->format) &&
+		(dev->pool.io_mode	== dev->io_mode)) ? 1 : 0;
+}
+
+static int video_input_requeue_buffers(const struct video_input *dev)
+{
+	struct v4l2_buffer		vid_buf		= { 0, };
+	struct v4l2_plane		planes[VIDEO_MAX_PLANES];
+	unsigned int			idxBuf		= 0;
+	int				ret		= 0;
+
+	for (idxBuf = 0U; idxBuf < dev->n_allocated_buf; idxBuf++) {
+		(void)memset(&vid_buf, 0, sizeof(vid_buf));
+		(void)memset(&planes, 0,  sizeof(planes));
+
+		video_input_init_vidbuf(&vid_buf, dev->format, dev->io_mode, idxBuf, planes);
+		if (dev->io_mode == (unsigned int)V4L2_MEMORY_USERPTR) {
+			/* queue the same slices of the arena again */
+			video_input_init_userptr_planes(dev, idxBuf, planes, vid_buf.length);
+		}
+
+		ret = video_input_qbuf(dev, &vid_buf);
+		if (ret < 0) {
+			loge("[VIN %d] video_input_qbuf(%u), ret: %d\n",
+				dev->capture.id, idxBuf, ret);
+			ret = -1;
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static int start_preview_init_format(struct video_input *dev)
 {
 	unsigned int			fmt		= 0;
 	int				ret		= 0;
 
-	fmt = dev->format;
-	ret = video_input_set_format(dev, dev->frame_width, dev->frame_height, fmt);
-	if (ret < 0) {
-		loge("video_input_set_format, ret: %d\n", ret);
-		ret = -1;
+	if (video_input_is_pool_reusable(dev) == 1) {
+		/* the format can not be changed while the buffers are allocated */
+		logd("The format of the buffer pool is not changed\n");
+	} else {
+		if (dev->pool.is_allocated == 1U) {
+			/* the configuration is changed */
+			(void)video_input_deallocate_buffers(dev, dev->pool.io_mode);
+		}
+
+		fmt = dev->format;
+		ret = video_input_set_format(dev, dev->frame_width, dev->frame_height, fmt);
+		if (ret < 0) {
+			loge("video_input_set_format, ret: %d\n", ret);
+			ret = -1;
+		}
 	}
 
 	return ret;
@@ -965,22 +1257,41 @@ static int start_preview_init_framerate(struct video_input *dev)
 	return ret;
 }
 
-static int start_preview_init_buffers(const struct video_input *dev)
+static int start_preview_init_buffers(struct video_input *dev)
 {
 	int				ret		= 0;
 
-	/* coverity[misra_c_2012_rule_11_8_violation : FALSE] */
-	/* coverity[cert_exp40_c_violation : FALSE] */
-	ret = video_input_init_buffers(dev, dev->format, dev->io_mode);
-	if (ret < 0) {
-		loge("video_input_init_buffers, ret: %d\n", ret);
-		ret = -1;
+	if (video_input_is_pool_reusable(dev) == 1) {
+		/* the buffers are still mapped, so just queue them again */
+		INIT_LIST_HEAD(&dev->buf_list);
+
+		ret = video_input_requeue_buffers(dev);
+		if (ret < 0) {
+			loge("video_input_requeue_buffers, ret: %d\n", ret);
+			ret = -1;
+		}
+	} else {
+		ret = video_input_init_buffers(dev, dev->format, dev->io_mode);
+		if (ret < 0) {
+			loge("video_input_init_buffers, ret: %d\n", ret);
+			ret = -1;
+		} else if (dev->pool.enable == 1U) {
+			/* remember the configuration of the buffer pool */
+			dev->pool.is_allocated	= 1;
+			dev->pool.width		= dev->frame_width;
+			dev->pool.height	= dev->frame_height;
+			dev->pool.format	= dev->format;
+			dev->pool.io_mode	= dev->io_mode;
+		} else {
+			/* pass */
+			logd("The buffer pool is disabled\n");
+		}
 	}
 
 	return ret;
 }
 
-static int start_preview_init_selection(const struct video_input *dev)
+static int start_preview_init_selection(struct video_input *dev)
 {
 	int				ret		= 0;
 
@@ -993,7 +1304,7 @@ static int start_preview_init_selection(const struct video_input *dev)
 	return ret;
 }
 
-static int start_preview_enable_stream(const struct video_input *dev)
+static int start_preview_enable_stream(struct video_input *dev)
 {
 	int				ret		= 0;
 
@@ -1007,16 +1318,15 @@ static int start_preview_enable_stream(const struct video_input *dev)
 }
 
 static int (*func_to_start_preview[START_PREVIEW_STEPS_MAX])(
-	const struct video_input *dev) = {
+	struct video_input *dev) = {
 	start_preview_init_format,
-	/* coverity[misra_c_2012_rule_11_1_violation : FALSE] */
 	start_preview_init_framerate,
 	start_preview_init_buffers,
 	start_preview_init_selection,
 	start_preview_enable_stream,
 };
 
-int video_input_start_preview(const struct video_input *dev)
+int video_input_start_preview(struct video_input *dev)
 {
 	int				idx		= 0;
 	int				ret		= 0;
@@ -1027,6 +1337,7 @@ int video_input_start_preview(const struct video_input *dev)
 			loge("Failed to start stream(%dth function)\n", idx);
 			break;
 		}
+		latency_mark((unsigned int)LATENCY_START_PREVIEW_STEP + (unsigned int)idx);
 	}
 
 	return ret;
@@ -1041,10 +1352,42 @@ int video_input_stop_preview(struct video_input *dev)
 		loge("video_input_stop_stream, ret: %d\n", ret);
 	}
 
-	ret = video_input_uninit_buffers(dev, dev->io_mode);
-	if (ret != 0) {
-		/* error */
-		loge("video_input_uninit_buffers, ret: %d\n", ret);
+	if (dev->pool.is_allocated == 1U) {
+		/* streamoff returns all the buffers, keep them mapped */
+		INIT_LIST_HEAD(&dev->buf_list);
+	} else {
+		ret = video_input_uninit_buffers(dev, dev->io_mode);
+		if (ret != 0) {
+			/* error */
+			loge("video_input_uninit_buffers, ret: %d\n", ret);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Get the dma-buf fd of a plane of a capture buffer
+ *
+ * The fd is owned by video_input and stays valid until the buffers are
+ * freed, so the consumer must dup() it to keep the buffer longer.
+ *
+ * @param dev video-input device instance
+ * @param index index of the buffer
+ * @param plane index of the plane
+ * @return the dma-buf fd, or -1 if the plane is not exported
+ */
+int video_input_get_buffer_fd(const struct video_input *dev,
+	unsigned int index, unsigned int plane)
+{
+	int				ret		= -1;
+
+	if ((dev->buffers == NULL) ||
+	    (index >= dev->n_allocated_buf) ||
+	    (plane >= (unsigned int)VIDEO_MAX_PLANES)) {
+		loge("buffer[%u].plane[%u] is wrong\n", index, plane);
+	} else {
+		ret = dev->buffers[index].fd[plane];
 	}
 
 	return ret;
@@ -10,6 +10,7 @@
 #include <linux/videodev2.h>
 
 #include "v4l2_capture.h"
+#include "frame_arena.h"
 #include "list.h"
 
 #define	VIDEO_CAPTURE_CAP		V4L2_CAP_VIDEO_CAPTURE_MPLANE
@@ -38,9 +39,12 @@ struct buf_addr {
 
 struct buffer_t {
 	struct v4l2_buffer		v4l2_buf;
+	/* v4l2_buf.m.planes points here after dqbuf */
+	struct v4l2_plane		planes[VIDEO_MAX_PLANES];
 	struct buf_addr			paddrs[VIDEO_MAX_PLANES];
 	struct buf_addr			vaddrs[VIDEO_MAX_PLANES];
-	unsigned int			fd[VIDEO_MAX_PLANES];
+	/* dma-buf fds exported in V4L2_MEMORY_DMABUF io_mode, -1 if not exported */
+	int				fd[VIDEO_MAX_PLANES];
 	struct list_head		list;
 };
 
@@ -60,6 +64,18 @@ enum start_preview_steps {
 	START_PREVIEW_STEPS_MAX,
 };
 
+struct buffer_pool {
+	/* keep the buffers allocated and mapped across stop/start preview */
+	unsigned int			enable;
+	unsigned int			is_allocated;
+
+	/* the configuration which the buffers are allocated with */
+	unsigned int			width;
+	unsigned int			height;
+	unsigned int			format;
+	unsigned int			io_mode;
+};
+
 struct lookup_table {
 	unsigned int enable[LUT_COLOR_MAX];
 	unsigned char table[LUT_COLOR_MAX][256];
@@ -85,6 +101,11 @@ struct video_input {
 	unsigned int			n_allocated_buf;
 	struct buffer_t			*buffers;
 	struct list_head		buf_list;
+	struct buffer_pool		pool;
+
+	/* backing memory of the buffers in V4L2_MEMORY_USERPTR io_mode */
+	struct frame_arena		arena;
+	unsigned int			use_hugepage;
 };
 
 extern int video_input_open_device(struct video_input *dev);
@@ -135,7 +156,9 @@ extern int video_input_init_buffers(struct video_input *dev,
 	unsigned int format, unsigned int io_mode);
 extern int video_input_uninit_buffers(struct video_input *dev,
 	unsigned int io_mode);
-extern int video_input_start_preview(const struct video_input *dev);
+extern int video_input_start_preview(struct video_input *dev);
 extern int video_input_stop_preview(struct video_input *dev);
+extern int video_input_get_buffer_fd(const struct video_input *dev,
+	unsigned int index, unsigned int plane);
 
 #endif//VIDEO_INPUT_H
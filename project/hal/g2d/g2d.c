@@ -11,19 +11,112 @@
 #include <poll.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <linux/videodev2.h>
 
 #include "log.h"
 #include "pmap.h"
+#include "v4l2.h"
 #include "g2d.h"
+#include "latency.h"
 
 #define GRAPHIC_DEVICE		("/dev/g2d")
 #define GRAPHIC_PMAP		("overlay_rot")
 
+#define G2D_BENCH_FRAMES	(8U)
+
+/* order of the bytes of a packed yuv pixel, from Y0 U Y1 V */
+#define G2D_SWAP_NONE		(0U)
+#define G2D_SWAP_YC		(1U)
+
+/* order of the chroma of a packed or an interleaved pixel */
+#define G2D_UV_ORDER_UV		(0U)
+#define G2D_UV_ORDER_VU		(1U)
+
+/*
+ * a format of video_format_table as G2D reads and writes it. The chroma
+ * planes of a planar format are passed as U and V, so the ones stored as V
+ * and U are swapped instead.
+ */
+struct g2d_format {
+	uint32_t	fourcc;
+	uint32_t	format;
+	uint32_t	data_swap;
+	uint32_t	uv_order;
+	uint32_t	n_planes;
+	/* 1 if a chroma plane is a quarter of the luma, not a half */
+	uint32_t	is_420;
+	/* 1 if the plane of V is stored before the plane of U */
+	uint32_t	is_vu;
+};
+
+static const struct g2d_format g2d_format_table[] = {
+	/* RGB */
+	{ V4L2_PIX_FMT_RGB24,	(uint32_t)GE_RGB888,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 1, 0, 0 },
+	{ V4L2_PIX_FMT_RGB32,	(uint32_t)GE_ARGB8888,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 1, 0, 0 },
+	/* sequential (YUV packed) */
+	{ V4L2_PIX_FMT_YUYV,	(uint32_t)GE_YUV422_sq,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 1, 0, 0 },
+	{ V4L2_PIX_FMT_YVYU,	(uint32_t)GE_YUV422_sq,	G2D_SWAP_NONE,	G2D_UV_ORDER_VU, 1, 0, 0 },
+	{ V4L2_PIX_FMT_UYVY,	(uint32_t)GE_YUV422_sq,	G2D_SWAP_YC,	G2D_UV_ORDER_UV, 1, 0, 0 },
+	{ V4L2_PIX_FMT_VYUY,	(uint32_t)GE_YUV422_sq,	G2D_SWAP_YC,	G2D_UV_ORDER_VU, 1, 0, 0 },
+	/* separated (Y, U, V planar) */
+	{ V4L2_PIX_FMT_YUV420,	(uint32_t)GE_YUV420_sp,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 3, 1, 0 },
+	{ V4L2_PIX_FMT_YVU420,	(uint32_t)GE_YUV420_sp,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 3, 1, 1 },
+	{ V4L2_PIX_FMT_YUV422P,	(uint32_t)GE_YUV422_sp,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 3, 0, 0 },
+	/* interleaved (Y planar, UV planar) */
+	{ V4L2_PIX_FMT_NV12,	(uint32_t)GE_YUV420_in,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 2, 1, 0 },
+	{ V4L2_PIX_FMT_NV21,	(uint32_t)GE_YUV420_in,	G2D_SWAP_NONE,	G2D_UV_ORDER_VU, 2, 1, 0 },
+	{ V4L2_PIX_FMT_NV16,	(uint32_t)GE_YUV422_in,	G2D_SWAP_NONE,	G2D_UV_ORDER_UV, 2, 0, 0 },
+	{ V4L2_PIX_FMT_NV61,	(uint32_t)GE_YUV422_in,	G2D_SWAP_NONE,	G2D_UV_ORDER_VU, 2, 0, 0 },
+};
+
+static const struct g2d_format *g2d_get_format(uint32_t format)
+{
+	const struct g2d_format	*ret	= NULL;
+	uint32_t		idx	= 0;
+
+	for (idx = 0; idx < (sizeof(g2d_format_table) / sizeof(g2d_format_table[0])); idx++) {
+		if (g2d_format_table[idx].fourcc == format) {
+			/* found */
+			ret = &g2d_format_table[idx];
+			break;
+		}
+	}
+
+	return ret;
+}
+
+/* return 0 if G2D reads and writes the v4l2 format, -1 otherwise */
+int32_t g2d_is_format_supported(uint32_t format)
+{
+	return (g2d_get_format(format) != NULL) ? 0 : -1;
+}
+
+/* the planes of a frame stored one after another, in the order of the format */
+static void g2d_get_plane_addrs(const struct g2d_format *fmt, uint32_t base,
+	uint32_t width, uint32_t height, uint32_t *addrs)
+{
+	uint32_t	luma	= width * height;
+	uint32_t	chroma	= (fmt->is_420 == 1U) ? (luma / 4U) : (luma / 2U);
+
+	addrs[0] = base;
+	addrs[1] = (fmt->n_planes > 1U) ? (base + luma) : 0U;
+	addrs[2] = (fmt->n_planes > 2U) ? (base + luma + chroma) : 0U;
+}
+
 int32_t g2d_memory_allocate(struct graphic2d *dev,
-	uint32_t width, uint32_t height, uint32_t depth)
+	uint32_t width, uint32_t height, uint32_t format)
 {
-	struct pmap	g2d_pmap;
-	int32_t		ret	= 0;
+	struct pmap		g2d_pmap;
+	const struct g2d_format	*fmt	= NULL;
+	uint32_t		size	= 0;
+	uint32_t		idx	= 0;
+	int32_t			ret	= 0;
+
+	fmt = g2d_get_format(format);
+	if (fmt == NULL) {
+		loge("format(0x%08x) is not supported by g2d\n", format);
+		return -1;
+	}
 
 	// get pmap info
 	(void)memset((void *)&g2d_pmap, 0, sizeof(g2d_pmap)); 
@@ -35,8 +128,26 @@ int32_t g2d_memory_allocate(struct graphic2d *dev,
 	logd("g2d - base: 0x%08x, size: 0x%08x, arange: 0x%08x - 0x%08x\n",
 		g2d_pmap.base, g2d_pmap.size, g2d_pmap.base + g2d_pmap.size);
 
-	dev->phy_addr = g2d_pmap.base + ((width * height * depth) * (uint32_t)dev->id);
-	logd("%10s%d: 0x%08x\n", "g2d", dev->id, dev->phy_addr);
+	// the ring of every device one after another, sized by the planes of the format
+	size = v4l2_get_v4l2_sizeimage(format, width, height);
+	if ((size * G2D_DST_BUFS * ((uint32_t)dev->id + 1U)) > g2d_pmap.size) {
+		loge("g2d%d - %u buffers of 0x%08x do not fit in 0x%08x\n",
+			dev->id, G2D_DST_BUFS, size, g2d_pmap.size);
+		ret = -1;
+	} else {
+		for (idx = 0; idx < G2D_DST_BUFS; idx++) {
+			/* the planes keep their sizes once rotated */
+			g2d_get_plane_addrs(fmt, g2d_pmap.base +
+				(size * ((G2D_DST_BUFS * (uint32_t)dev->id) + idx)),
+				width, height, dev->dst_addrs[idx]);
+		}
+		dev->format	= format;
+		dev->phy_addr	= dev->dst_addrs[0][0];
+		dev->shown_idx	= 0;
+		dev->dst_idx	= 0;
+		dev->is_busy	= 0;
+		logd("%10s%d: 0x%08x, %u buffers\n", "g2d", dev->id, dev->phy_addr, G2D_DST_BUFS);
+	}
 
 	return ret;
 }
@@ -55,17 +166,47 @@ int32_t g2d_memory_deallocate(struct graphic2d *dev)
 	return ret;
 }
 
-uint32_t g2d_get_memory_address(struct graphic2d *dev)
+/* a plane of the buffer the last job has rotated the frame into, 0 if none */
+uint32_t g2d_get_plane_address(const struct graphic2d *dev, uint32_t plane)
 {
-	logd("%10s%d: 0x%08x\n", "g2d", dev->id, dev->phy_addr);
-	return dev->phy_addr;
+	return (plane < G2D_MAX_PLANES) ? dev->dst_addrs[dev->shown_idx][plane] : 0U;
 }
 
-int32_t g2d_rotation_do(struct graphic2d *dev, G2D_COMMON_TYPE *grp_arg)
+uint32_t g2d_get_memory_address(const struct graphic2d *dev)
+{
+	logd("%10s%d: 0x%08x\n", "g2d", dev->id, g2d_get_plane_address(dev, 0));
+	return g2d_get_plane_address(dev, 0);
+}
+
+/* return 1 if the job is done, 0 if it is not done in timeout_ms, -1 on error */
+static int32_t g2d_rotation_poll(const struct graphic2d *dev, int32_t timeout_ms)
 {
 	struct pollfd	poll_event;
 	int32_t		ret		= 0;
 
+	(void)memset(&poll_event, 0, sizeof(poll_event));
+	poll_event.fd		= dev->fd;
+	poll_event.events	= POLLIN;
+	ret = poll(&poll_event, 1, timeout_ms);
+	if (ret < 0) {
+		loge("POLLIN, ret: %d\n", ret);
+		ret = -1;
+	} else if ((ret > 0) && (((uint32_t)poll_event.revents & (uint32_t)POLLERR) != 0U)) {
+		loge("g2d poll POLLERR\n");
+		ret = -1;
+	} else {
+		/* done or not yet */
+		ret = (ret > 0) ? 1 : 0;
+	}
+
+	return ret;
+}
+
+/* the job is started, and done when the device is readable */
+static int32_t g2d_rotation_issue(const struct graphic2d *dev, G2D_COMMON_TYPE *grp_arg)
+{
+	int32_t		ret		= 0;
+
 	if (dev->fd <= 0) {
 		loge("device: '%s', fd: %d\n", GRAPHIC_DEVICE, dev->fd);
 		goto G2D_ERROR;
@@ -91,35 +232,249 @@ int32_t g2d_rotation_do(struct graphic2d *dev, G2D_COMMON_TYPE *grp_arg)
 		grp_arg->src0, grp_arg->src1, grp_arg->src2,
 		grp_arg->tgt0, grp_arg->tgt1, grp_arg->tgt2);
 
-	if (grp_arg->responsetype == (uint32_t)G2D_INTERRUPT) {
-		(void)memset(&poll_event, 0, sizeof(poll_event));
-		poll_event.fd		= dev->fd;
-		poll_event.events	= POLLIN;
-		ret = poll(&poll_event, 1, 400);
-		if (ret < 0) {
-			loge("POLLIN, ret: %d\n", ret);
-			return -1;
-		} else if (ret == 0) {
+	return 0;
+
+G2D_ERROR:
+	return -1;
+}
+
+int32_t g2d_rotation_do(struct graphic2d *dev, G2D_COMMON_TYPE *grp_arg)
+{
+	int32_t		ret		= 0;
+
+	ret = g2d_rotation_issue(dev, grp_arg);
+	if ((ret == 0) && (grp_arg->responsetype == (uint32_t)G2D_INTERRUPT)) {
+		ret = g2d_rotation_poll(dev, G2D_TIMEOUT_MS);
+		if (ret == 0) {
 			loge("g2d poll timeout\n");
-			goto G2D_ERROR;
+			ret = -1;
 		} else {
-			if (((uint32_t)poll_event.revents &
-			     (uint32_t)POLLERR) != 0U) {
-				loge("g2d poll POLLERR\n");
-				return -1;
-			} else {
-				// normal situcation
-				// do nothing
-			}
+			/* done or failed */
+			ret = (ret == 1) ? 0 : -1;
 		}
 	}
-	return 0;
 
-G2D_ERROR:
-	return -1;
+	return ret;
+}
+
+/* the steps each engine does in a pass, by enum g2d_engine */
+static const uint32_t g2d_engine_steps[G2D_ENGINE_MAX] = {
+	G2D_STEP_CROP | G2D_STEP_ROTATE | G2D_STEP_CONVERT,
+	G2D_STEP_CROP | G2D_STEP_SCALE | G2D_STEP_CONVERT,
+};
+
+static const char *const g2d_engine_names[G2D_ENGINE_MAX] = { "g2d", "scaler" };
+
+static const char *const g2d_step_names[G2D_STEP_MAX] = { "crop", "scale", "rotate", "convert" };
+
+/* a job of a whole frame, which is not scaled, rotated nor converted */
+void g2d_job_init(struct g2d_job *job, uint32_t format, uint32_t width, uint32_t height)
+{
+	(void)memset((void *)job, 0, sizeof(*job));
+
+	job->src_format		= format;
+	job->src_width		= width;
+	job->src_height		= height;
+	job->crop_imgx		= width;
+	job->crop_imgy		= height;
+	job->scale_imgx		= width;
+	job->scale_imgy		= height;
+	job->angle		= (uint32_t)NOOP;
+	job->dst_format		= format;
 }
 
-int32_t g2d_rotation(struct graphic2d *dev,
+static int32_t g2d_job_check(const struct g2d_job *job)
+{
+	int32_t		ret	= 0;
+
+	if ((g2d_get_format(job->src_format) == NULL) ||
+	    (g2d_get_format(job->dst_format) == NULL)) {
+		loge("format(0x%08x -> 0x%08x) is not supported by g2d\n",
+			job->src_format, job->dst_format);
+		ret = -1;
+	} else if ((job->crop_imgx == 0U) || (job->crop_imgy == 0U) ||
+		   ((job->crop_offx + job->crop_imgx) > job->src_width) ||
+		   ((job->crop_offy + job->crop_imgy) > job->src_height)) {
+		loge("crop(%u, %u ~ %u x %u) is out of %u x %u\n",
+			job->crop_offx, job->crop_offy, job->crop_imgx, job->crop_imgy,
+			job->src_width, job->src_height);
+		ret = -1;
+	} else if ((job->scale_imgx == 0U) || (job->scale_imgy == 0U)) {
+		loge("scale(%u x %u) is wrong\n", job->scale_imgx, job->scale_imgy);
+		ret = -1;
+	} else if ((job->angle != (uint32_t)NOOP) && (job->angle != (uint32_t)ROTATE_90) &&
+		   (job->angle != (uint32_t)ROTATE_180) && (job->angle != (uint32_t)ROTATE_270)) {
+		loge("angle(%u) is wrong\n", job->angle);
+		ret = -1;
+	} else {
+		/* valid */
+		ret = 0;
+	}
+
+	return ret;
+}
+
+/* the steps a job needs, as G2D_STEP_* */
+static uint32_t g2d_job_get_steps(const struct g2d_job *job)
+{
+	uint32_t	steps	= 0;
+
+	if ((job->crop_imgx != job->src_width) || (job->crop_imgy != job->src_height)) {
+		/* a part of the frame */
+		steps |= G2D_STEP_CROP;
+	}
+	if ((job->scale_imgx != job->crop_imgx) || (job->scale_imgy != job->crop_imgy)) {
+		/* resized */
+		steps |= G2D_STEP_SCALE;
+	}
+	if (job->angle != (uint32_t)NOOP) {
+		/* rotated */
+		steps |= G2D_STEP_ROTATE;
+	}
+	if (job->dst_format != job->src_format) {
+		/* converted */
+		steps |= G2D_STEP_CONVERT;
+	}
+
+	return steps;
+}
+
+/* the number of the steps left an engine does in a row from the step first */
+static uint32_t g2d_job_get_run(enum g2d_engine engine, uint32_t steps, uint32_t first)
+{
+	uint32_t	run	= 0;
+	uint32_t	step	= 0;
+
+	for (step = first; step < G2D_STEP_MAX; step++) {
+		if ((steps & (1U << step)) == 0U) {
+			/* not needed */
+		} else if ((g2d_engine_steps[engine] & (1U << step)) != 0U) {
+			/* done in the same pass */
+			run++;
+		} else {
+			break;
+		}
+	}
+
+	return run;
+}
+
+/**
+ * @brief Split a job into the fewest passes over the memory
+ *
+ * A pass is done by the engine which does the most of the steps left in a
+ * row, and G2D if both do as many. The first pass reads the crop only, and
+ * every pass after it reads the frame the pass before has written.
+ *
+ * @return 0 on success, -1 if the job is wrong
+ */
+int32_t g2d_job_plan(const struct g2d_job *job, struct g2d_plan *plan)
+{
+	struct g2d_pass		*pass	= NULL;
+	enum g2d_engine		engine	= G2D_ENGINE_G2D;
+	uint32_t		format	= 0;
+	uint32_t		width	= 0;
+	uint32_t		height	= 0;
+	uint32_t		step	= 0;
+	uint32_t		tmp	= 0;
+	int32_t			ret	= 0;
+
+	(void)memset((void *)plan, 0, sizeof(*plan));
+
+	ret = g2d_job_check(job);
+	if (ret == 0) {
+		plan->steps	= g2d_job_get_steps(job);
+		format		= job->src_format;
+		width		= job->crop_imgx;
+		height		= job->crop_imgy;
+	}
+
+	for (step = 0; (ret == 0) && (step < G2D_STEP_MAX); step++) {
+		if ((plan->steps & (1U << step)) == 0U) {
+			/* not needed */
+			continue;
+		}
+
+		if ((pass == NULL) || ((g2d_engine_steps[pass->engine] & (1U << step)) == 0U)) {
+			engine = (g2d_job_get_run(G2D_ENGINE_SCALER, plan->steps, step) >
+				  g2d_job_get_run(G2D_ENGINE_G2D, plan->steps, step)) ?
+				G2D_ENGINE_SCALER : G2D_ENGINE_G2D;
+			pass			= &plan->passes[plan->n_passes];
+			pass->engine		= engine;
+			pass->read_bytes	= v4l2_get_v4l2_sizeimage(format, width, height);
+			plan->n_passes++;
+		}
+		pass->steps |= (1U << step);
+
+		if ((1U << step) == G2D_STEP_SCALE) {
+			width	= job->scale_imgx;
+			height	= job->scale_imgy;
+		} else if (((1U << step) == G2D_STEP_ROTATE) &&
+			   ((job->angle == (uint32_t)ROTATE_90) || (job->angle == (uint32_t)ROTATE_270))) {
+			tmp	= width;
+			width	= height;
+			height	= tmp;
+		} else if ((1U << step) == G2D_STEP_CONVERT) {
+			format	= job->dst_format;
+		} else {
+			/* the crop is read by the first pass */
+		}
+		pass->written_bytes = v4l2_get_v4l2_sizeimage(format, width, height);
+	}
+
+	return ret;
+}
+
+/* a job of a single pass of G2D, with the planes in the order they are stored in */
+static void g2d_job_fill(G2D_COMMON_TYPE *grp_arg, const struct g2d_job *job,
+	uint32_t src_y, uint32_t src_u, uint32_t src_v,
+	uint32_t dst_y, uint32_t dst_u, uint32_t dst_v)
+{
+	const struct g2d_format	*src	= g2d_get_format(job->src_format);
+	const struct g2d_format	*dst	= g2d_get_format(job->dst_format);
+
+	// clear structure
+	(void)memset((void *)grp_arg, 0, sizeof(*grp_arg));
+
+	grp_arg->responsetype		= (uint32_t)G2D_INTERRUPT;
+	grp_arg->src0			= src_y;
+	grp_arg->src1			= (src->is_vu == 1U) ? src_v : src_u;
+	grp_arg->src2			= (src->is_vu == 1U) ? src_u : src_v;
+	grp_arg->srcfm.format		= src->format;
+	grp_arg->srcfm.data_swap	= src->data_swap;
+	grp_arg->srcfm.uv_order		= src->uv_order;
+	grp_arg->src_imgx		= job->src_width;
+	grp_arg->src_imgy		= job->src_height;
+	grp_arg->crop_offx		= job->crop_offx;
+	grp_arg->crop_offy		= job->crop_offy;
+	grp_arg->crop_imgx		= job->crop_imgx;
+	grp_arg->crop_imgy		= job->crop_imgy;
+	grp_arg->tgt0			= dst_y;
+	grp_arg->tgt1			= (dst->is_vu == 1U) ? dst_v : dst_u;
+	grp_arg->tgt2			= (dst->is_vu == 1U) ? dst_u : dst_v;
+	grp_arg->tgtfm.format		= dst->format;
+	grp_arg->tgtfm.data_swap	= dst->data_swap;
+	grp_arg->tgtfm.uv_order		= dst->uv_order;
+	grp_arg->ch_mode		= job->angle;
+	if ((grp_arg->ch_mode == (uint32_t)ROTATE_90) ||
+	    (grp_arg->ch_mode == (uint32_t)ROTATE_270)) {
+		grp_arg->dst_imgx	= grp_arg->crop_imgy;
+		grp_arg->dst_imgy	= grp_arg->crop_imgx;
+	} else {
+		grp_arg->dst_imgx	= grp_arg->crop_imgx;
+		grp_arg->dst_imgy	= grp_arg->crop_imgy;
+	}
+}
+
+/**
+ * @brief Rotate a frame of a v4l2 format and wait for it
+ *
+ * The planes are passed in the order they are stored in, so the planes of
+ * the chroma of YVU420 are V and U.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int32_t g2d_rotation(struct graphic2d *dev, uint32_t format,
 	uint32_t src_y, uint32_t src_u, uint32_t src_v,
 	uint32_t dst_y, uint32_t dst_u, uint32_t dst_v,
 	uint32_t width, uint32_t height,
@@ -127,46 +482,188 @@ int32_t g2d_rotation(struct graphic2d *dev,
 	uint32_t crop_imgx, uint32_t crop_imgy,
 	uint32_t angle)
 {
-	G2D_COMMON_TYPE	grp_arg;
-	int32_t		ret	= 0;
+	G2D_COMMON_TYPE		grp_arg;
+	struct g2d_job		job;
+	int32_t			ret	= 0;
 
 	logd("src - y: 0x%08x, u: 0x%08x, v: 0x%08x\n", src_y, src_u, src_v);
 	logd("dst - y: 0x%08x, u: 0x%08x, v: 0x%08x\n", dst_y, dst_u, dst_v);
 	logd("width: %d, height: %d, angle: %u\n", width, height, angle);
 
-	// clear structure
-	(void)memset((void *)&grp_arg, 0, sizeof(grp_arg));
-
-	grp_arg.responsetype		= (uint32_t)G2D_INTERRUPT;
-	grp_arg.src0			= src_y;
-	grp_arg.src1			= src_u;
-	grp_arg.src2			= src_v;
-	grp_arg.srcfm.format		= (uint32_t)GE_ARGB8888;
-	grp_arg.src_imgx		= (uint32_t)width;
-	grp_arg.src_imgy		= (uint32_t)height;
-	grp_arg.crop_offx		= crop_offx;
-	grp_arg.crop_offy		= crop_offy;
-	grp_arg.crop_imgx		= crop_imgx;
-	grp_arg.crop_imgy		= crop_imgy;
-	grp_arg.tgt0			= dst_y;
-	grp_arg.tgt1			= dst_u;
-	grp_arg.tgt2			= dst_v;
-	grp_arg.tgtfm.format		= grp_arg.srcfm.format;
-	grp_arg.ch_mode			= angle;
-	if ((grp_arg.ch_mode == (uint32_t)ROTATE_90) ||
-	    (grp_arg.ch_mode == (uint32_t)ROTATE_270)) {
-		grp_arg.dst_imgx	= grp_arg.crop_imgy;
-		grp_arg.dst_imgy	= grp_arg.crop_imgx;
+	g2d_job_init(&job, format, width, height);
+	job.crop_offx	= crop_offx;
+	job.crop_offy	= crop_offy;
+	job.crop_imgx	= crop_imgx;
+	job.crop_imgy	= crop_imgy;
+	job.scale_imgx	= crop_imgx;
+	job.scale_imgy	= crop_imgy;
+	job.angle	= angle;
+
+	ret = g2d_job_check(&job);
+	if (ret == 0) {
+		g2d_job_fill(&grp_arg, &job, src_y, src_u, src_v, dst_y, dst_u, dst_v);
+
+		ret = g2d_rotation_do(dev, &grp_arg);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Start a job into the next buffer of the ring
+ *
+ * The crop, the rotation and the conversion into the format the ring is
+ * allocated for are done by a single TCC_GRP_COMMON_IOCTRL, so a job which
+ * g2d_job_plan() splits into more passes, or into a pass of the scaler, is
+ * refused. The job is not waited for. It is done when the device is
+ * readable, and g2d_rotation_reap() makes its buffer the one to show.
+ *
+ * @param tag returned by g2d_rotation_reap() once the source is done with
+ * @return 0 on success, -1 if a job is still in flight or on failure
+ */
+int32_t g2d_job_submit(struct graphic2d *dev, const struct g2d_job *job,
+	uint32_t src_y, uint32_t src_u, uint32_t src_v, uint32_t tag)
+{
+	G2D_COMMON_TYPE	grp_arg;
+	struct g2d_plan	plan;
+	uint32_t	next	= 0;
+	int32_t		ret	= 0;
+
+	ret = g2d_job_plan(job, &plan);
+	if (ret < 0) {
+		/* the job is wrong */
+		ret = -1;
+	} else if ((plan.n_passes > 1U) ||
+		   ((plan.n_passes == 1U) && (plan.passes[0].engine != G2D_ENGINE_G2D))) {
+		loge("g2d%d - the job needs %u passes, the first of %s\n", dev->id,
+			plan.n_passes, g2d_engine_names[plan.passes[0].engine]);
+		ret = -1;
+	} else if (job->dst_format != dev->format) {
+		loge("g2d%d - format(0x%08x) is not the one of the ring(0x%08x)\n", dev->id,
+			job->dst_format, dev->format);
+		ret = -1;
+	} else if (dev->is_busy == 1U) {
+		/* the frame is not rotated */
+		logd("g2d%d is busy\n", dev->id);
+		ret = -1;
+	} else if (dev->phy_addr == 0U) {
+		loge("g2d%d has no memory\n", dev->id);
+		ret = -1;
 	} else {
-		grp_arg.dst_imgx	= grp_arg.crop_imgx;
-		grp_arg.dst_imgy	= grp_arg.crop_imgy;
+		next = (dev->shown_idx + 1U) % G2D_DST_BUFS;
+		g2d_job_fill(&grp_arg, job, src_y, src_u, src_v,
+			dev->dst_addrs[next][0], dev->dst_addrs[next][1], dev->dst_addrs[next][2]);
+
+		ret = g2d_rotation_issue(dev, &grp_arg);
+		if (ret == 0) {
+			dev->dst_idx		= next;
+			dev->tag		= tag;
+			dev->submitted_ns	= latency_get_time_ns();
+			dev->is_busy		= 1;
+		}
 	}
 
-	ret = g2d_rotation_do(dev, &grp_arg);
+	return ret;
+}
+
+/* start rotating a frame of the format of the ring, as g2d_job_submit() */
+int32_t g2d_rotation_submit(struct graphic2d *dev,
+	uint32_t src_y, uint32_t src_u, uint32_t src_v,
+	uint32_t width, uint32_t height,
+	uint32_t crop_offx, uint32_t crop_offy,
+	uint32_t crop_imgx, uint32_t crop_imgy,
+	uint32_t angle, uint32_t tag)
+{
+	struct g2d_job	job;
+
+	g2d_job_init(&job, dev->format, width, height);
+	job.crop_offx	= crop_offx;
+	job.crop_offy	= crop_offy;
+	job.crop_imgx	= crop_imgx;
+	job.crop_imgy	= crop_imgy;
+	job.scale_imgx	= crop_imgx;
+	job.scale_imgy	= crop_imgy;
+	job.angle	= angle;
+
+	return g2d_job_submit(dev, &job, src_y, src_u, src_v, tag);
+}
+
+/*
+ * The engine of a job which fails or does not finish may still read its
+ * source and write dst_addrs[dst_idx]. Closing the device stops it, so the
+ * device is opened again before the source is given back.
+ */
+static int32_t g2d_reset(struct graphic2d *dev)
+{
+	int32_t		ret	= 0;
+
+	ret = g2d_close(dev);
+	if (ret == 0) {
+		/* the memory of the ring is kept */
+		ret = g2d_open(dev);
+	}
+	if (ret < 0) {
+		/* error */
+		loge("g2d%d is not reset, ret: %d\n", dev->id, ret);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Collect the job in flight if it is done
+ *
+ * The device is reset if the job has failed or timed out, so its fd is not
+ * the one before.
+ *
+ * @param tag the tag of the source of the job collected
+ * @return 1 if the job is done and its buffer is to be shown, -1 if it has
+ * failed or timed out, 0 if it is still running or there is none
+ */
+int32_t g2d_rotation_reap(struct graphic2d *dev, uint32_t *tag)
+{
+	int32_t		ret	= 0;
+
+	if (dev->is_busy == 1U) {
+		ret = g2d_rotation_poll(dev, 0);
+		if ((ret == 0) &&
+		    ((latency_get_time_ns() - dev->submitted_ns) > ((uint64_t)G2D_TIMEOUT_MS * 1000000U))) {
+			loge("g2d poll timeout\n");
+			ret = -1;
+		}
+		if (ret == 1) {
+			/* the newest rotated */
+			dev->shown_idx = dev->dst_idx;
+		} else if (ret < 0) {
+			/* stop the engine before the source is requeued */
+			(void)g2d_reset(dev);
+		} else {
+			/* still running */
+			logd("g2d%d is busy\n", dev->id);
+		}
+		if (ret != 0) {
+			*tag		= dev->tag;
+			dev->is_busy	= 0;
+		}
+	}
 
 	return ret;
 }
 
+/* wait for the job in flight, which is collected by g2d_rotation_reap() */
+void g2d_rotation_wait_idle(const struct graphic2d *dev)
+{
+	if (dev->is_busy == 1U) {
+		/* done or given up by the reap */
+		(void)g2d_rotation_poll(dev, G2D_TIMEOUT_MS);
+	}
+}
+
+int32_t g2d_get_fd(const struct graphic2d *dev)
+{
+	return dev->fd;
+}
+
 int32_t g2d_is_available(struct graphic2d *dev)
 {
 	int32_t		ret = 0;
@@ -196,8 +693,10 @@ int32_t g2d_open(struct graphic2d *dev)
 			sprintf(name, "%s%d", GRAPHIC_DEVICE, dev->id);
 		}
 		dev->fd = open(name, O_RDWR);
-		if (dev->fd == 0) {
+		if (dev->fd < 0) {
 			loge("open(%s), ret: %d\n", name, dev->fd);
+			/* g2d_is_available() takes 0 as not opened */
+			dev->fd = 0;
 			ret = -1;
 		}
 	}
@@ -220,3 +719,257 @@ int32_t g2d_close(struct graphic2d *dev)
 	return ret;
 }
 
+
+/* time the jobs of a format rotated by an angle, and dump them as json */
+static void g2d_bench_one(struct graphic2d *dev, int fd, const struct g2d_format *fmt,
+	uint32_t src, uint32_t dst, uint32_t width, uint32_t height,
+	uint32_t angle, uint32_t degree)
+{
+	G2D_COMMON_TYPE	grp_arg;
+	struct g2d_job	job;
+	uint32_t	src_addrs[G2D_MAX_PLANES];
+	uint32_t	dst_addrs[G2D_MAX_PLANES];
+	uint64_t	ts_start	= 0;
+	uint64_t	ns		= 0;
+	uint64_t	max_ns		= 0;
+	uint64_t	total_ns	= 0;
+	uint64_t	gbps_milli	= 0;
+	uint32_t	size		= 0;
+	uint32_t	idx		= 0;
+	int32_t		ret		= 0;
+
+	size = v4l2_get_v4l2_sizeimage(fmt->fourcc, width, height);
+	g2d_get_plane_addrs(fmt, src, width, height, src_addrs);
+	g2d_get_plane_addrs(fmt, dst, width, height, dst_addrs);
+	g2d_job_init(&job, fmt->fourcc, width, height);
+	job.angle = angle;
+	g2d_job_fill(&grp_arg, &job, src_addrs[0], src_addrs[1], src_addrs[2],
+		dst_addrs[0], dst_addrs[1], dst_addrs[2]);
+
+	for (idx = 0; (ret == 0) && (idx < G2D_BENCH_FRAMES); idx++) {
+		ts_start = latency_get_time_ns();
+		ret = g2d_rotation_do(dev, &grp_arg);
+		ns = latency_get_time_ns() - ts_start;
+		total_ns += ns;
+		max_ns = (ns > max_ns) ? ns : max_ns;
+	}
+	ns = (ret == 0) ? (total_ns / G2D_BENCH_FRAMES) : 0U;
+	/* bytes per nanosecond are gigabytes per second, read and written */
+	gbps_milli = (ns > 0U) ? (((uint64_t)size * 2U * 1000U) / ns) : 0U;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "\n  {\"format\": \"%s\", \"angle\": %u, \"ok\": %u, "
+		"\"ms\": %llu.%03llu, \"max_ms\": %llu.%03llu, \"bytes\": %u, "
+		"\"bytes_vs_rgb32\": %u, \"gbps\": %llu.%03llu}",
+		v4l2_get_format_name_by_v4l2_format(fmt->fourcc), degree,
+		(ret == 0) ? 1U : 0U,
+		(unsigned long long)(ns / 1000000U), (unsigned long long)((ns / 1000U) % 1000U),
+		(unsigned long long)(max_ns / 1000000U),
+		(unsigned long long)((max_ns / 1000U) % 1000U),
+		size * 2U, (size * 100U) / (width * height * 4U),
+		(unsigned long long)(gbps_milli / 1000U), (unsigned long long)(gbps_milli % 1000U));
+}
+
+/**
+ * @brief Time the rotations of every format G2D supports
+ *
+ * The frames are rotated from the start of the pmap into the frame after
+ * it, so the pmap must not be shown while it runs. "ms" and "max_ms" are
+ * the mean and the worst latency of a job, "bytes" what a job reads and
+ * writes, and "bytes_vs_rgb32" that in percent of rgb32.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int32_t g2d_dump_bench(struct graphic2d *dev, const char *path,
+	uint32_t width, uint32_t height)
+{
+	const uint32_t	angles[4]	= {
+		(uint32_t)NOOP, (uint32_t)ROTATE_90, (uint32_t)ROTATE_180, (uint32_t)ROTATE_270
+	};
+	struct pmap	g2d_pmap;
+	uint32_t	size		= 0;
+	uint32_t	idx		= 0;
+	uint32_t	angle		= 0;
+	int		fd		= -1;
+	int32_t		ret		= 0;
+
+	(void)memset((void *)&g2d_pmap, 0, sizeof(g2d_pmap));
+	ret = pmap_get_info(GRAPHIC_PMAP, &g2d_pmap);
+
+	/* rgb32 is the largest */
+	size = width * height * 4U;
+	if ((ret < 0) || ((size * 2U) > g2d_pmap.size)) {
+		loge("pmap(%s) - ret: %d, size: 0x%08x < 0x%08x\n", GRAPHIC_PMAP, ret,
+			g2d_pmap.size, size * 2U);
+		ret = -1;
+	} else if (dev->is_busy == 1U) {
+		loge("g2d%d is busy\n", dev->id);
+		ret = -1;
+	} else {
+		/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			loge("Failed to open %s\n", path);
+			ret = -1;
+		}
+	}
+
+	if (fd >= 0) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"width\": %u, \"height\": %u, \"frames\": %u,\n"
+			" \"rotations\": [", width, height, G2D_BENCH_FRAMES);
+
+		for (idx = 0; idx < (sizeof(g2d_format_table) / sizeof(g2d_format_table[0])); idx++) {
+			for (angle = 0; angle < 4U; angle++) {
+				if ((idx != 0U) || (angle != 0U)) {
+					/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+					(void)dprintf(fd, ",");
+				}
+				g2d_bench_one(dev, fd, &g2d_format_table[idx], g2d_pmap.base,
+					g2d_pmap.base + size, width, height, angles[angle], angle * 90U);
+			}
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+		(void)close(fd);
+	}
+
+	return ret;
+}
+
+/* the degrees of a ch_mode */
+static uint32_t g2d_get_degree(uint32_t angle)
+{
+	uint32_t	degree	= 0;
+
+	if (angle == (uint32_t)ROTATE_90) {
+		degree = 90U;
+	} else if (angle == (uint32_t)ROTATE_180) {
+		degree = 180U;
+	} else if (angle == (uint32_t)ROTATE_270) {
+		degree = 270U;
+	} else {
+		/* NOOP */
+		degree = 0U;
+	}
+
+	return degree;
+}
+
+/* the steps as "crop+scale", or "none" */
+static void g2d_dump_steps(int fd, uint32_t steps)
+{
+	uint32_t	step	= 0;
+	uint32_t	n_steps	= 0;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "\"");
+	for (step = 0; step < G2D_STEP_MAX; step++) {
+		if ((steps & (1U << step)) != 0U) {
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			(void)dprintf(fd, "%s%s", (n_steps > 0U) ? "+" : "", g2d_step_names[step]);
+			n_steps++;
+		}
+	}
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "%s\"", (n_steps > 0U) ? "" : "none");
+}
+
+/* the plan of a job from a format into another, as json */
+static void g2d_dump_plan(int fd, const struct g2d_job *job)
+{
+	struct g2d_plan	plan;
+	uint32_t	captured	= 0;
+	uint32_t	bytes		= 0;
+	uint32_t	idx		= 0;
+	int32_t		ret		= 0;
+
+	ret = g2d_job_plan(job, &plan);
+	/* the frame is written by the capture before it is read by the first pass */
+	captured = v4l2_get_v4l2_sizeimage(job->src_format, job->src_width, job->src_height);
+	bytes = captured;
+	for (idx = 0; idx < plan.n_passes; idx++) {
+		/* read and written */
+		bytes += plan.passes[idx].read_bytes + plan.passes[idx].written_bytes;
+	}
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "\n  {\"src\": \"%s\", \"dst\": \"%s\", \"ok\": %u, \"steps\": ",
+		v4l2_get_format_name_by_v4l2_format(job->src_format),
+		v4l2_get_format_name_by_v4l2_format(job->dst_format), (ret == 0) ? 1U : 0U);
+	g2d_dump_steps(fd, plan.steps);
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, ", \"fused\": %u, \"n_passes\": %u, \"bytes\": %u, "
+		"\"bytes_vs_capture\": %u, \"passes\": [",
+		((plan.n_passes == 1U) && (plan.passes[0].engine == G2D_ENGINE_G2D)) ? 1U : 0U,
+		plan.n_passes, bytes, (captured > 0U) ? ((bytes * 100U) / captured) : 0U);
+	for (idx = 0; idx < plan.n_passes; idx++) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "%s{\"engine\": \"%s\", \"steps\": ", (idx > 0U) ? ", " : "",
+			g2d_engine_names[plan.passes[idx].engine]);
+		g2d_dump_steps(fd, plan.passes[idx].steps);
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, ", \"read\": %u, \"written\": %u}",
+			plan.passes[idx].read_bytes, plan.passes[idx].written_bytes);
+	}
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)dprintf(fd, "]}");
+}
+
+/**
+ * @brief Dump the passes of a job between every two formats G2D supports
+ *
+ * The crop, the scale and the angle of the job are kept, and its formats
+ * are replaced. "fused" is 1 if the job is done by a single
+ * TCC_GRP_COMMON_IOCTRL, and "bytes" is what the capture writes and every
+ * pass reads and writes, which "bytes_vs_capture" is in percent of the
+ * capture. A frame scaled by the capture instead needs no pass of the
+ * scaler.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int32_t g2d_dump_plans(const char *path, const struct g2d_job *job)
+{
+	struct g2d_job	each;
+	uint32_t	n_formats	= sizeof(g2d_format_table) / sizeof(g2d_format_table[0]);
+	uint32_t	src		= 0;
+	uint32_t	dst		= 0;
+	int		fd		= -1;
+	int32_t		ret		= 0;
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		loge("Failed to open %s\n", path);
+		ret = -1;
+	} else {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"width\": %u, \"height\": %u, \"crop\": [%u, %u, %u, %u], "
+			"\"scale\": [%u, %u], \"angle\": %u,\n \"plans\": [",
+			job->src_width, job->src_height, job->crop_offx, job->crop_offy,
+			job->crop_imgx, job->crop_imgy, job->scale_imgx, job->scale_imgy,
+			g2d_get_degree(job->angle));
+
+		for (src = 0; src < n_formats; src++) {
+			for (dst = 0; dst < n_formats; dst++) {
+				if ((src != 0U) || (dst != 0U)) {
+					/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+					(void)dprintf(fd, ",");
+				}
+				each		= *job;
+				each.src_format	= g2d_format_table[src].fourcc;
+				each.dst_format	= g2d_format_table[dst].fourcc;
+				g2d_dump_plan(fd, &each);
+			}
+		}
+
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "\n ]\n}\n");
+		(void)close(fd);
+	}
+
+	return ret;
+}
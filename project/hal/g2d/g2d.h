@@ -9,24 +9,121 @@
 #include <stdint.h>
 #include "tcc_grp_ioctrl.h"
 
+/*
+ * the rotated frames are written into a ring of buffers, so the buffer shown
+ * and the one shown before, which may still be scanned out until the next
+ * vsync, are never written by the job in flight
+ */
+#define G2D_DST_BUFS		(3U)
+
+/* a job which is not done in this time is given up */
+#define G2D_TIMEOUT_MS		(400)
+
+#define G2D_MAX_PLANES		(3U)
+
+/* default file to dump the latency and the bandwidth of every format as json */
+#define G2D_BENCH_PATH		("/tmp/camera_app_g2d.json")
+
+/* default file to dump the passes of a job between every two formats as json */
+#define G2D_PLAN_PATH		("/tmp/camera_app_g2d_plan.json")
+
+/* the steps of a job, which are applied in this order */
+#define G2D_STEP_CROP		(1U << 0)
+#define G2D_STEP_SCALE		(1U << 1)
+#define G2D_STEP_ROTATE		(1U << 2)
+#define G2D_STEP_CONVERT	(1U << 3)
+#define G2D_STEP_MAX		(4U)
+
+/* the engines a pass over the memory is done by */
+enum g2d_engine {
+	/* crops, rotates and converts in one TCC_GRP_COMMON_IOCTRL */
+	G2D_ENGINE_G2D,
+	/* the m2m scaler of VIOC, which crops, scales and converts */
+	G2D_ENGINE_SCALER,
+	G2D_ENGINE_MAX,
+};
+
+/*
+ * a frame cropped, scaled, rotated and converted, in this order. The crop
+ * is scaled to scale_imgx x scale_imgy before it is rotated.
+ */
+struct g2d_job {
+	uint32_t		src_format;
+	uint32_t		src_width;
+	uint32_t		src_height;
+	uint32_t		crop_offx;
+	uint32_t		crop_offy;
+	uint32_t		crop_imgx;
+	uint32_t		crop_imgy;
+	uint32_t		scale_imgx;
+	uint32_t		scale_imgy;
+	uint32_t		angle;
+	uint32_t		dst_format;
+};
+
+/* a pass over the memory, which reads a frame and writes another */
+struct g2d_pass {
+	enum g2d_engine		engine;
+	uint32_t		steps;
+	uint32_t		read_bytes;
+	uint32_t		written_bytes;
+};
+
+/* the fewest passes which do the steps of a job */
+struct g2d_plan {
+	uint32_t		steps;
+	uint32_t		n_passes;
+	struct g2d_pass		passes[G2D_STEP_MAX];
+};
+
 struct graphic2d {
 	int32_t			id;
 	int32_t			fd;
 
 	uint32_t		phy_addr;
+
+	/* v4l2 format of the frames rotated, and the planes of the ring */
+	uint32_t		format;
+	uint32_t		dst_addrs[G2D_DST_BUFS][G2D_MAX_PLANES];
+	/* the last rotated, and the one the job in flight writes */
+	uint32_t		shown_idx;
+	uint32_t		dst_idx;
+	/* one job is in flight at a time, with the tag of its source */
+	uint32_t		is_busy;
+	uint32_t		tag;
+	uint64_t		submitted_ns;
 };
 
 extern int32_t g2d_memory_allocate(struct graphic2d *dev,
-	uint32_t width, uint32_t height, uint32_t depth);
+	uint32_t width, uint32_t height, uint32_t format);
 extern int32_t g2d_memory_deallocate(struct graphic2d *dev);
-extern uint32_t g2d_get_memory_address(struct graphic2d *dev);
-extern int32_t g2d_rotation(struct graphic2d *dev,
+extern uint32_t g2d_get_memory_address(const struct graphic2d *dev);
+extern uint32_t g2d_get_plane_address(const struct graphic2d *dev, uint32_t plane);
+extern int32_t g2d_is_format_supported(uint32_t format);
+extern int32_t g2d_rotation(struct graphic2d *dev, uint32_t format,
 	uint32_t src_y, uint32_t src_u, uint32_t src_v,
 	uint32_t dst_y, uint32_t dst_u, uint32_t dst_v,
 	uint32_t width, uint32_t height,
 	uint32_t crop_offx, uint32_t crop_offy,
 	uint32_t crop_imgx, uint32_t crop_imgy,
 	uint32_t angle);
+extern void g2d_job_init(struct g2d_job *job, uint32_t format,
+	uint32_t width, uint32_t height);
+extern int32_t g2d_job_plan(const struct g2d_job *job, struct g2d_plan *plan);
+extern int32_t g2d_job_submit(struct graphic2d *dev, const struct g2d_job *job,
+	uint32_t src_y, uint32_t src_u, uint32_t src_v, uint32_t tag);
+extern int32_t g2d_dump_plans(const char *path, const struct g2d_job *job);
+extern int32_t g2d_rotation_submit(struct graphic2d *dev,
+	uint32_t src_y, uint32_t src_u, uint32_t src_v,
+	uint32_t width, uint32_t height,
+	uint32_t crop_offx, uint32_t crop_offy,
+	uint32_t crop_imgx, uint32_t crop_imgy,
+	uint32_t angle, uint32_t tag);
+extern int32_t g2d_rotation_reap(struct graphic2d *dev, uint32_t *tag);
+extern void g2d_rotation_wait_idle(const struct graphic2d *dev);
+extern int32_t g2d_get_fd(const struct graphic2d *dev);
+extern int32_t g2d_dump_bench(struct graphic2d *dev, const char *path,
+	uint32_t width, uint32_t height);
 extern int32_t g2d_is_available(struct graphic2d *dev);
 extern int32_t g2d_open(struct graphic2d *dev);
 extern int32_t g2d_close(struct graphic2d *dev);
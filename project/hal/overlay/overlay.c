@@ -15,6 +15,7 @@
 #include "log.h"
 #include "v4l2.h"
 #include "overlay.h"
+#include "ioctl_trace.h"
 #include "basic_operation.h"
 
 #define DEVICE_NAME			("/dev/overlay")
@@ -118,7 +119,8 @@ int overlay_get_default_ovps(struct overlay *dev)
 		loge("fd(%d) is wrong\n", dev->fd);
 		ret = -1;
 	} else {
-		ret = ioctl(dev->fd, OVERLAY_GET_LAYER, &dev->rdma_layer);
+		ret = trace_ioctl(IOCTL_TRACE_OVERLAY_GET_LAYER, dev->fd,
+			OVERLAY_GET_LAYER, &dev->rdma_layer);
 		if (ret < 0) {
 			loge("ret: %d\n", ret);
 			ret = -1;
@@ -168,7 +170,8 @@ int overlay_qbuf(const struct overlay *dev, overlay_video_buffer_t *buf)
 		loge("buf is NULL\n");
 		ret = -1;
 	} else {
-		ret = ioctl(dev->fd, OVERLAY_PUSH_VIDEO_BUFFER, buf);
+		ret = trace_ioctl(IOCTL_TRACE_OVERLAY_PUSH_VIDEO_BUFFER, dev->fd,
+			OVERLAY_PUSH_VIDEO_BUFFER, buf);
 		if (ret < 0) {
 			loge("ret: %d\n", ret);
 			ret = -1;
@@ -187,7 +190,8 @@ int overlay_get_ovp(const struct overlay *dev, int *ovp)
 		loge("dev is NULL\n");
 		ret = -1;
 	} else {
-		ret = ioctl(dev->fd, OVERLAY_GET_OVP, &arg);
+		ret = trace_ioctl(IOCTL_TRACE_OVERLAY_GET_OVP, dev->fd,
+			OVERLAY_GET_OVP, &arg);
 		if (ret < 0) {
 			loge("ret: %d\n", ret);
 			ret = -1;
@@ -210,7 +214,8 @@ int overlay_set_ovp(const struct overlay *dev, int ovp)
 		ret = -1;
 	} else {
 		arg = s32_to_u32(ovp);
-		ret = ioctl(dev->fd, OVERLAY_SET_OVP, &arg);
+		ret = trace_ioctl(IOCTL_TRACE_OVERLAY_SET_OVP, dev->fd,
+			OVERLAY_SET_OVP, &arg);
 		if (ret < 0) {
 			loge("ret: %d\n", ret);
 			ret = -1;
@@ -229,7 +234,8 @@ int overlay_disable_layer(const struct overlay *dev)
 		loge("dev is NULL\n");
 		ret = -1;
 	} else {
-		ret = ioctl(dev->fd, OVERLAY_DISALBE_LAYER, &arg);
+		ret = trace_ioctl(IOCTL_TRACE_OVERLAY_DISABLE_LAYER, dev->fd,
+			OVERLAY_DISALBE_LAYER, &arg);
 		if (ret < 0) {
 			loge("ret: %d\n", ret);
 			ret = -1;
@@ -0,0 +1,680 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+/*
+ * Software overlay of the camera_app_sim build. The buffers pushed by
+ * video_output are looked up in the sim memory and composited into a
+ * framebuffer of the panel as the display hardware would do: the window
+ * is placed at posx/posy, the pixel format is converted to XRGB8888, and
+ * the window is hidden while the ovp does not put its layer on top.
+ *
+ * The overlay is configured by the environment:
+ *  FAKE_OVL_DUMP_EVERY:	dump the framebuffer every N pushes, 0 never
+ *  FAKE_OVL_DUMP_RAW:		1 to dump XRGB8888 instead of PPM
+ *  FAKE_OVL_DUMP_DIR:		directory of the dumps (default /tmp)
+ *  FAKE_OVL_REPORT:		file the statistics are written to on close
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <tcc_types.h>
+
+#include "log.h"
+#include "overlay.h"
+#include "sim_memory.h"
+#include "latency.h"
+
+#define FAKE_DEVICE_NAME		("/dev/null")
+
+/* DISPLAY_SCREEN_WIDTH * DISPLAY_SCREEN_HEIGHT of the camera */
+#define FAKE_SCREEN_WIDTH		(1920U)
+#define FAKE_SCREEN_HEIGHT		(720U)
+
+/* the layers of the other applications are drawn as one solid plane */
+#define FAKE_BACKGROUND_COLOR		(0x00202020U)
+
+/* the layer the overlay driver reports on the reference board */
+#define FAKE_RDMA_LAYER			(1U)
+#define FAKE_DEFAULT_OVP		(24)
+#define FAKE_NUM_OF_OVPS		(30)
+
+#define FAKE_DUMP_DIR			("/tmp")
+#define FAKE_REPORT_PATH		("/tmp/camera_app_sim_overlay.json")
+
+/* the order of the layers of each ovp, the top layer in the msb */
+static const unsigned int fake_ovp_list[FAKE_NUM_OF_OVPS] = {
+	[0]  = 0x3012,
+	[1]  = 0x3102,
+	[2]  = 0x3021,
+	[3]  = 0x3201,
+	[4]  = 0x3120,
+	[5]  = 0x3210,
+
+	[8]  = 0x2013,
+	[9]  = 0x2103,
+	[10] = 0x2031,
+	[11] = 0x2301,
+	[12] = 0x2130,
+	[13] = 0x2310,
+
+	[16] = 0x1023,
+	[17] = 0x1203,
+	[18] = 0x1203,
+	[19] = 0x1302,
+	[20] = 0x1230,
+	[21] = 0x1320,
+
+	[24] = 0x0123,
+	[25] = 0x0213,
+	[26] = 0x0132,
+	[27] = 0x0312,
+	[28] = 0x0231,
+	[29] = 0x0321,
+};
+
+struct fake_overlay_stats {
+	unsigned long long		pushes;
+	unsigned long long		composed;
+	unsigned long long		hidden;
+	unsigned long long		unresolved;
+	unsigned long long		unsupported;
+	unsigned long long		dumps;
+	uint64_t			cost_sum_ns;
+	uint64_t			cost_max_ns;
+	uint64_t			cost_last_ns;
+};
+
+struct fake_overlay {
+	uint32_t			*fb;
+	int				ovp;
+	unsigned int			is_disabled;
+	overlay_config_t		window;
+	/* of the last frame on the panel before the layer is disabled */
+	uint32_t			checksum;
+
+	unsigned int			dump_every;
+	unsigned int			dump_raw;
+	const char			*dump_dir;
+
+	struct fake_overlay_stats	stats;
+};
+
+/* the byte offsets of y0, u, y1 and v in a pixel pair of packed yuv */
+struct fake_yuv_order {
+	unsigned int			y0;
+	unsigned int			u;
+	unsigned int			y1;
+	unsigned int			v;
+};
+
+/* the layout of the chroma of planar and semi-planar yuv */
+struct fake_chroma {
+	const unsigned char		*u;
+	const unsigned char		*v;
+	/* bytes between the chroma of two pixel pairs */
+	unsigned int			step;
+	unsigned int			stride;
+	/* 1 if a chroma row is shared by two rows */
+	unsigned int			vshift;
+};
+
+static struct fake_overlay	fake;
+
+static unsigned int fake_get_env(const char *name, unsigned int def)
+{
+	const char			*value		= NULL;
+	unsigned int			ret		= def;
+
+	value = getenv(name);
+	if (value != NULL) {
+		/* coverity[misra_c_2012_rule_21_7_violation : FALSE] */
+		ret = (unsigned int)strtoul(value, NULL, 0);
+	}
+
+	return ret;
+}
+
+static void fake_clear_screen(void)
+{
+	size_t				idx		= 0;
+
+	for (idx = 0; idx < ((size_t)FAKE_SCREEN_WIDTH * FAKE_SCREEN_HEIGHT); idx++) {
+		/* background */
+		fake.fb[idx] = FAKE_BACKGROUND_COLOR;
+	}
+}
+
+int overlay_open_device(struct overlay *dev)
+{
+	const char			*dir		= NULL;
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is null\n");
+		ret = -1;
+	} else if (dev->fd != 0) {
+		loge("fd(%d) is wrong\n", dev->fd);
+		ret = -1;
+	} else {
+		(void)memset(&fake, 0, sizeof(fake));
+		fake.ovp		= FAKE_DEFAULT_OVP;
+		fake.dump_every		= fake_get_env("FAKE_OVL_DUMP_EVERY", 0U);
+		fake.dump_raw		= fake_get_env("FAKE_OVL_DUMP_RAW", 0U);
+		dir			= getenv("FAKE_OVL_DUMP_DIR");
+		fake.dump_dir		= (dir != NULL) ? dir : FAKE_DUMP_DIR;
+
+		/* coverity[misra_c_2012_rule_21_3_violation : FALSE] */
+		fake.fb = (uint32_t *)malloc((size_t)FAKE_SCREEN_WIDTH * FAKE_SCREEN_HEIGHT *
+			sizeof(uint32_t));
+		if (fake.fb == NULL) {
+			loge("Failed to allocate the framebuffer\n");
+			ret = -1;
+		} else {
+			fake_clear_screen();
+
+			/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+			dev->fd = open(FAKE_DEVICE_NAME, O_RDWR | O_CLOEXEC);
+			if (dev->fd < 0) {
+				loge("fd(%d) is wrong", dev->fd);
+				ret = -1;
+			}
+		}
+	}
+
+	return ret;
+}
+
+/* fnv-1a of the panel to catch changes of the geometry and the conversion */
+static uint32_t fake_get_checksum(void)
+{
+	uint32_t			checksum	= 2166136261U;
+	size_t				idx		= 0;
+
+	for (idx = 0; idx < ((size_t)FAKE_SCREEN_WIDTH * FAKE_SCREEN_HEIGHT); idx++) {
+		checksum ^= fake.fb[idx];
+		checksum *= 16777619U;
+	}
+
+	return checksum;
+}
+
+static void fake_write_report(void)
+{
+	const struct fake_overlay_stats	*stats		= &fake.stats;
+	const char			*path		= NULL;
+	int				fd		= -1;
+
+	path = getenv("FAKE_OVL_REPORT");
+	if (path == NULL) {
+		/* default */
+		path = FAKE_REPORT_PATH;
+	}
+
+	if (fake.is_disabled == 0U) {
+		/* still shown */
+		fake.checksum = fake_get_checksum();
+	}
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		/* error */
+		loge("Failed to open %s\n", path);
+	} else {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"screen\": [%u, %u], \"ovp\": %d,\n"
+			" \"window\": {\"sx\": %u, \"sy\": %u, \"width\": %u, \"height\": %u, "
+			"\"format\": %u},\n"
+			" \"pushes\": %llu, \"composed\": %llu, \"hidden\": %llu, "
+			"\"unresolved\": %llu, \"unsupported\": %llu, \"dumps\": %llu,\n"
+			" \"push_cost_us\": {\"avg\": %llu, \"max\": %llu, \"last\": %llu},\n"
+			" \"checksum\": \"0x%08x\"}\n",
+			FAKE_SCREEN_WIDTH, FAKE_SCREEN_HEIGHT, fake.ovp,
+			fake.window.sx, fake.window.sy, fake.window.width, fake.window.height,
+			fake.window.format,
+			stats->pushes, stats->composed, stats->hidden,
+			stats->unresolved, stats->unsupported, stats->dumps,
+			(unsigned long long)((stats->pushes > 0U) ?
+				(stats->cost_sum_ns / stats->pushes / 1000U) : 0U),
+			(unsigned long long)(stats->cost_max_ns / 1000U),
+			(unsigned long long)(stats->cost_last_ns / 1000U),
+			fake.checksum);
+
+		(void)close(fd);
+	}
+}
+
+int overlay_close_device(const struct overlay *dev)
+{
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is NULL\n");
+		ret = -1;
+	} else if (dev->fd <= 0) {
+		loge("fd(%d) is wrong\n", dev->fd);
+		ret = -1;
+	} else {
+		fake_write_report();
+
+		/* coverity[misra_c_2012_rule_21_3_violation : FALSE] */
+		free(fake.fb);
+		fake.fb = NULL;
+
+		ret = close(dev->fd);
+	}
+
+	return ret;
+}
+
+int overlay_get_default_ovps(struct overlay *dev)
+{
+	int				ret		= 0;
+
+	if (dev->fd <= 0) {
+		loge("fd(%d) is wrong\n", dev->fd);
+		ret = -1;
+	} else {
+		dev->rdma_layer	= FAKE_RDMA_LAYER;
+		dev->wmix_bovp	= FAKE_DEFAULT_OVP;
+		/* the ovp which puts the rdma layer on top */
+		dev->wmix_fovp	= 16;
+	}
+
+	return ret;
+}
+
+static unsigned int fake_is_window_on_top(void)
+{
+	unsigned int			top		= 0;
+
+	if ((fake.ovp >= 0) && (fake.ovp < FAKE_NUM_OF_OVPS)) {
+		/* the top layer */
+		top = (fake_ovp_list[fake.ovp] >> 12U) & 0xFU;
+	}
+
+	return ((fake.is_disabled == 0U) && (top == (FAKE_RDMA_LAYER % 4U))) ? 1U : 0U;
+}
+
+static uint8_t fake_clamp(int value)
+{
+	return (value < 0) ? 0U : ((value > 255) ? 255U : (uint8_t)value);
+}
+
+/* bt.601 limited range */
+static uint32_t fake_yuv_to_xrgb(int y, int u, int v)
+{
+	int				c		= (y - 16) * 298;
+	int				d		= u - 128;
+	int				e		= v - 128;
+
+	return ((uint32_t)fake_clamp((c + (409 * e) + 128) >> 8) << 16U) |
+	       ((uint32_t)fake_clamp((c - (100 * d) - (208 * e) + 128) >> 8) << 8U) |
+	       (uint32_t)fake_clamp((c + (516 * d) + 128) >> 8);
+}
+
+static void fake_compose_rgb(const unsigned char *src, const overlay_config_t *cfg,
+	unsigned int width, unsigned int height, unsigned int bpp)
+{
+	const unsigned char		*line		= NULL;
+	uint32_t			*dst		= NULL;
+	unsigned int			row		= 0;
+	unsigned int			col		= 0;
+
+	for (row = 0; row < height; row++) {
+		line	= &src[(size_t)row * cfg->width * bpp];
+		dst	= &fake.fb[((size_t)(cfg->sy + row) * FAKE_SCREEN_WIDTH) + cfg->sx];
+		if (bpp == 4U) {
+			/* A 31:24, R 23:16, G 15:8, B 7:0 is xrgb already */
+			(void)memcpy(dst, line, (size_t)width * 4U);
+		} else {
+			for (col = 0; col < width; col++) {
+				/* R, G, B */
+				dst[col] = ((uint32_t)line[col * 3U] << 16U) |
+					   ((uint32_t)line[(col * 3U) + 1U] << 8U) |
+					   (uint32_t)line[(col * 3U) + 2U];
+			}
+		}
+	}
+}
+
+static void fake_compose_packed_yuv(const unsigned char *src, const overlay_config_t *cfg,
+	unsigned int width, unsigned int height, const struct fake_yuv_order *order)
+{
+	const unsigned char		*pair		= NULL;
+	uint32_t			*dst		= NULL;
+	unsigned int			row		= 0;
+	unsigned int			col		= 0;
+
+	for (row = 0; row < height; row++) {
+		dst = &fake.fb[((size_t)(cfg->sy + row) * FAKE_SCREEN_WIDTH) + cfg->sx];
+		for (col = 0; (col + 1U) < width; col += 2U) {
+			pair = &src[((size_t)row * cfg->width * 2U) + ((size_t)col * 2U)];
+			dst[col]	= fake_yuv_to_xrgb((int)pair[order->y0],
+				(int)pair[order->u], (int)pair[order->v]);
+			dst[col + 1U]	= fake_yuv_to_xrgb((int)pair[order->y1],
+				(int)pair[order->u], (int)pair[order->v]);
+		}
+	}
+}
+
+static void fake_compose_yuv_planes(const unsigned char *luma, const struct fake_chroma *chroma,
+	const overlay_config_t *cfg, unsigned int width, unsigned int height)
+{
+	const unsigned char		*line		= NULL;
+	size_t				offset		= 0;
+	uint32_t			*dst		= NULL;
+	unsigned int			row		= 0;
+	unsigned int			col		= 0;
+
+	for (row = 0; row < height; row++) {
+		line	= &luma[(size_t)row * cfg->width];
+		dst	= &fake.fb[((size_t)(cfg->sy + row) * FAKE_SCREEN_WIDTH) + cfg->sx];
+		for (col = 0; col < width; col++) {
+			offset = ((size_t)(row >> chroma->vshift) * chroma->stride) +
+				((size_t)(col / 2U) * chroma->step);
+			dst[col] = fake_yuv_to_xrgb((int)line[col],
+				(int)chroma->u[offset], (int)chroma->v[offset]);
+		}
+	}
+}
+
+/*
+ * The chroma of the separate planes follows the luma when the address of
+ * a plane is not given, as in a contiguous buffer.
+ */
+static const unsigned char *fake_get_plane(uint32_t paddr, uint32_t paddr_prev,
+	size_t size_prev, size_t size)
+{
+	uint32_t			addr		= paddr;
+
+	if (addr == 0U) {
+		/* contiguous */
+		addr = paddr_prev + (uint32_t)size_prev;
+	}
+
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	return (const unsigned char *)sim_memory_lookup(addr, size);
+}
+
+/* 0 if composed, -1 if the memory is not found, -2 if the format is not supported */
+static int fake_compose_window(const overlay_video_buffer_t *buf,
+	unsigned int width, unsigned int height)
+{
+	static const struct fake_yuv_order	order_uyvy	= { 1, 0, 3, 2 };
+	static const struct fake_yuv_order	order_vyuy	= { 1, 2, 3, 0 };
+	static const struct fake_yuv_order	order_yuyv	= { 0, 1, 2, 3 };
+	static const struct fake_yuv_order	order_yvyu	= { 0, 3, 2, 1 };
+	const overlay_config_t		*cfg		= &buf->cfg;
+	const unsigned char		*luma		= NULL;
+	const unsigned char		*cb		= NULL;
+	const unsigned char		*cr		= NULL;
+	struct fake_chroma		chroma		= { 0, };
+	size_t				size_luma	= 0;
+	size_t				size_chroma	= 0;
+	int				ret		= 0;
+
+	size_luma = (size_t)cfg->width * cfg->height;
+
+	switch (cfg->format) {
+	case TCC_LCDC_IMG_FMT_RGB888:
+	case TCC_LCDC_IMG_FMT_RGB888_3:
+		luma = fake_get_plane(buf->addr, 0, 0, size_luma *
+			((cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_RGB888) ? 4U : 3U));
+		if (luma != NULL) {
+			fake_compose_rgb(luma, cfg, width, height,
+				(cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_RGB888) ? 4U : 3U);
+		}
+		break;
+	case TCC_LCDC_IMG_FMT_UYVY:
+	case TCC_LCDC_IMG_FMT_VYUY:
+	case TCC_LCDC_IMG_FMT_YUYV:
+	case TCC_LCDC_IMG_FMT_YVYU:
+		luma = fake_get_plane(buf->addr, 0, 0, size_luma * 2U);
+		if (luma != NULL) {
+			fake_compose_packed_yuv(luma, cfg, width, height,
+				(cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_UYVY) ? &order_uyvy :
+				(cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_VYUY) ? &order_vyuy :
+				(cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_YUYV) ? &order_yuyv :
+				&order_yvyu);
+		}
+		break;
+	case TCC_LCDC_IMG_FMT_YUV420ITL0:
+	case TCC_LCDC_IMG_FMT_YUV420ITL1:
+	case TCC_LCDC_IMG_FMT_YUV422ITL0:
+	case TCC_LCDC_IMG_FMT_YUV422ITL1:
+		/* semi-planar: one plane of interleaved chroma */
+		chroma.vshift	= ((cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_YUV420ITL0) ||
+				   (cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_YUV420ITL1)) ? 1U : 0U;
+		chroma.step	= 2;
+		chroma.stride	= cfg->width;
+		size_chroma	= (size_t)cfg->width * (cfg->height >> chroma.vshift);
+		luma	= fake_get_plane(buf->addr, 0, 0, size_luma);
+		cb	= fake_get_plane(buf->addr1, buf->addr, size_luma, size_chroma);
+		if ((luma != NULL) && (cb != NULL)) {
+			chroma.u = ((cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_YUV420ITL0) ||
+				    (cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_YUV422ITL0)) ?
+				cb : &cb[1];
+			chroma.v = (chroma.u == cb) ? &cb[1] : cb;
+			fake_compose_yuv_planes(luma, &chroma, cfg, width, height);
+		} else {
+			/* not found */
+			luma = NULL;
+		}
+		break;
+	case TCC_LCDC_IMG_FMT_YUV420SP:
+	case TCC_LCDC_IMG_FMT_YUV422SP:
+		/* planar: separate planes of cb and cr */
+		chroma.vshift	= (cfg->format == (unsigned int)TCC_LCDC_IMG_FMT_YUV420SP) ? 1U : 0U;
+		chroma.step	= 1;
+		chroma.stride	= cfg->width / 2U;
+		size_chroma	= (size_t)chroma.stride * (cfg->height >> chroma.vshift);
+		luma	= fake_get_plane(buf->addr, 0, 0, size_luma);
+		cb	= fake_get_plane(buf->addr1, buf->addr, size_luma, size_chroma);
+		cr	= fake_get_plane(buf->addr2, (buf->addr1 != 0U) ? buf->addr1 :
+			(buf->addr + (uint32_t)size_luma), size_chroma, size_chroma);
+		if ((luma != NULL) && (cb != NULL) && (cr != NULL)) {
+			chroma.u = cb;
+			chroma.v = cr;
+			fake_compose_yuv_planes(luma, &chroma, cfg, width, height);
+		} else {
+			/* not found */
+			luma = NULL;
+		}
+		break;
+	default:
+		loge("format(%u) is not supported\n", cfg->format);
+		ret = -2;
+		break;
+	}
+
+	if ((ret == 0) && (luma == NULL)) {
+		/* not in the sim memory */
+		ret = -1;
+	}
+
+	return ret;
+}
+
+static void fake_dump_screen(void)
+{
+	char				path[PATH_MAX]	= "";
+	unsigned char			line[FAKE_SCREEN_WIDTH * 3U];
+	const uint32_t			*pixels		= NULL;
+	unsigned int			row		= 0;
+	unsigned int			col		= 0;
+	int				fd		= -1;
+
+	/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+	(void)snprintf(path, sizeof(path), "%s/overlay_fb.%06llu.%s", fake.dump_dir,
+		fake.stats.pushes, (fake.dump_raw == 1U) ? "xrgb" : "ppm");
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		/* error */
+		loge("Failed to open %s\n", path);
+	} else {
+		if (fake.dump_raw == 1U) {
+			/* as it is */
+			(void)write(fd, fake.fb,
+				(size_t)FAKE_SCREEN_WIDTH * FAKE_SCREEN_HEIGHT * sizeof(uint32_t));
+		} else {
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			(void)dprintf(fd, "P6\n%u %u\n255\n", FAKE_SCREEN_WIDTH, FAKE_SCREEN_HEIGHT);
+			for (row = 0; row < FAKE_SCREEN_HEIGHT; row++) {
+				pixels = &fake.fb[(size_t)row * FAKE_SCREEN_WIDTH];
+				for (col = 0; col < FAKE_SCREEN_WIDTH; col++) {
+					line[col * 3U]		= (unsigned char)(pixels[col] >> 16U);
+					line[(col * 3U) + 1U]	= (unsigned char)(pixels[col] >> 8U);
+					line[(col * 3U) + 2U]	= (unsigned char)pixels[col];
+				}
+				(void)write(fd, line, sizeof(line));
+			}
+		}
+		(void)close(fd);
+
+		fake.stats.dumps++;
+	}
+}
+
+static void fake_compose(const overlay_video_buffer_t *buf)
+{
+	const overlay_config_t		*cfg		= &buf->cfg;
+	unsigned int			width		= 0;
+	unsigned int			height		= 0;
+	int				ret		= 0;
+
+	if ((cfg->sx != fake.window.sx) || (cfg->sy != fake.window.sy) ||
+	    (cfg->width != fake.window.width) || (cfg->height != fake.window.height)) {
+		/* the old window is not covered any more */
+		fake_clear_screen();
+	}
+	fake.window = *cfg;
+
+	if (fake_is_window_on_top() == 0U) {
+		/* the other layers cover the window */
+		fake.stats.hidden++;
+	} else if ((cfg->sx < FAKE_SCREEN_WIDTH) && (cfg->sy < FAKE_SCREEN_HEIGHT)) {
+		/* clip to the panel */
+		width	= ((cfg->sx + cfg->width)  > FAKE_SCREEN_WIDTH) ?
+			(FAKE_SCREEN_WIDTH - cfg->sx) : cfg->width;
+		height	= ((cfg->sy + cfg->height) > FAKE_SCREEN_HEIGHT) ?
+			(FAKE_SCREEN_HEIGHT - cfg->sy) : cfg->height;
+
+		ret = fake_compose_window(buf, width, height);
+		if (ret == 0) {
+			/* shown */
+			fake.stats.composed++;
+		} else if (ret == -1) {
+			/* not in the sim memory */
+			fake.stats.unresolved++;
+		} else {
+			fake.stats.unsupported++;
+		}
+	} else {
+		/* out of the panel */
+		logd("window(%u, %u) is out of the panel\n", cfg->sx, cfg->sy);
+	}
+}
+
+int overlay_qbuf(const struct overlay *dev, overlay_video_buffer_t *buf)
+{
+	uint64_t			ts_begin	= 0;
+	uint64_t			cost		= 0;
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is NULL\n");
+		ret = -1;
+	} else if (buf == NULL) {
+		loge("buf is NULL\n");
+		ret = -1;
+	} else if (fake.fb == NULL) {
+		loge("the device is not opened\n");
+		ret = -1;
+	} else {
+		ts_begin = latency_get_time_ns();
+
+		/* a push enables the layer again */
+		fake.is_disabled = 0;
+		fake_compose(buf);
+
+		cost = latency_get_time_ns() - ts_begin;
+		fake.stats.pushes++;
+		fake.stats.cost_sum_ns	+= cost;
+		fake.stats.cost_last_ns	= cost;
+		if (cost > fake.stats.cost_max_ns) {
+			/* the most expensive push */
+			fake.stats.cost_max_ns = cost;
+		}
+
+		if ((fake.dump_every > 0U) && ((fake.stats.pushes % fake.dump_every) == 0U)) {
+			/* not counted in the cost */
+			fake_dump_screen();
+		}
+	}
+
+	return ret;
+}
+
+int overlay_get_ovp(const struct overlay *dev, int *ovp)
+{
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is NULL\n");
+		ret = -1;
+	} else {
+		/* the last one set */
+		*ovp = fake.ovp;
+	}
+
+	return ret;
+}
+
+int overlay_set_ovp(const struct overlay *dev, int ovp)
+{
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is NULL\n");
+		ret = -1;
+	} else if ((ovp < 0) || (ovp >= FAKE_NUM_OF_OVPS) || (fake_ovp_list[ovp] == 0U)) {
+		loge("ovp(%d) is wrong\n", ovp);
+		ret = -1;
+	} else {
+		/* kept */
+		fake.ovp = ovp;
+	}
+
+	return ret;
+}
+
+int overlay_disable_layer(const struct overlay *dev)
+{
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is NULL\n");
+		ret = -1;
+	} else {
+		if ((fake.fb != NULL) && (fake.is_disabled == 0U)) {
+			fake.checksum = fake_get_checksum();
+			fake_clear_screen();
+		}
+		/* nothing is shown until the next push */
+		fake.is_disabled = 1;
+	}
+
+	return ret;
+}
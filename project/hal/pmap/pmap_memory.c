@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif//defined(HAVE_CONFIG_H)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "log.h"
+#include "pmap_memory.h"
+
+#if defined(HAVE_LIBPMAP)
+#include "pmap.h"
+
+#define PMAP_MEMORY_DEVICE		("/dev/mem")
+
+/**
+ * @brief Map the start of a pmap
+ *
+ * The mapping is not cached, so the frames written through it are seen by
+ * the display hardware without flushing the cache.
+ *
+ * @param name name of the pmap
+ * @param size size to map, which must fit in the pmap
+ * @return 0 on success, -1 on failure
+ */
+int pmap_memory_map(struct pmap_memory *mem, const char *name, size_t size)
+{
+	struct pmap			info;
+	void				*vaddr		= MAP_FAILED;
+	int				fd		= -1;
+	int				ret		= 0;
+
+	(void)memset((void *)mem, 0, sizeof(*mem));
+	(void)memset((void *)&info, 0, sizeof(info));
+
+	ret = pmap_get_info(name, &info);
+	if ((ret < 0) || ((size_t)info.size < size)) {
+		loge("pmap(%s) - ret: %d, size: 0x%08x < 0x%08zx\n", name, ret, info.size, size);
+		ret = -1;
+	} else {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fd = open(PMAP_MEMORY_DEVICE, O_RDWR | O_SYNC | O_CLOEXEC);
+		if (fd < 0) {
+			loge("open(%s), errno: %d\n", PMAP_MEMORY_DEVICE, errno);
+			ret = -1;
+		} else {
+			/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+			vaddr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+				(off_t)info.base);
+			(void)close(fd);
+		}
+	}
+
+	if ((ret == 0) && (vaddr == MAP_FAILED)) {
+		loge("mmap(0x%08x, %zu), errno: %d\n", info.base, size, errno);
+		ret = -1;
+	} else if (ret == 0) {
+		mem->paddr	= info.base;
+		mem->vaddr	= vaddr;
+		mem->size	= size;
+		logd("pmap(%s) - 0x%08x, %zu bytes\n", name, mem->paddr, mem->size);
+	} else {
+		/* nothing is mapped */
+		logd("pmap(%s) is not mapped\n", name);
+	}
+
+	return ret;
+}
+#else
+int pmap_memory_map(struct pmap_memory *mem, const char *name, size_t size)
+{
+	(void)name;
+	(void)size;
+	(void)memset((void *)mem, 0, sizeof(*mem));
+
+	loge("pmap(%s) of %zu bytes - libpmap is not found\n", name, size);
+
+	return -1;
+}
+#endif//defined(HAVE_LIBPMAP)
+
+void pmap_memory_unmap(struct pmap_memory *mem)
+{
+	if (mem->vaddr != NULL) {
+		/* mapped */
+		(void)munmap(mem->vaddr, mem->size);
+	}
+
+	(void)memset((void *)mem, 0, sizeof(*mem));
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef PMAP_MEMORY_H
+#define PMAP_MEMORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * a physically contiguous memory reserved by a pmap and mapped to be
+ * written by the cpu, for frames the display hardware reads by their
+ * physical address
+ */
+struct pmap_memory {
+	uint32_t		paddr;
+	void			*vaddr;
+	size_t			size;
+};
+
+extern int pmap_memory_map(struct pmap_memory *mem, const char *name, size_t size);
+extern void pmap_memory_unmap(struct pmap_memory *mem);
+
+#endif//PMAP_MEMORY_H
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+/*
+ * pmap memory of the camera_app_sim build. Anonymous memory is registered
+ * in the sim memory, so the fake overlay finds the frames written into it
+ * by their physical addresses.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "log.h"
+#include "sim_memory.h"
+#include "pmap_memory.h"
+
+int pmap_memory_map(struct pmap_memory *mem, const char *name, size_t size)
+{
+	void				*vaddr		= MAP_FAILED;
+	int				ret		= 0;
+
+	(void)name;
+	(void)memset((void *)mem, 0, sizeof(*mem));
+
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	vaddr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (vaddr == MAP_FAILED) {
+		loge("mmap(%zu), errno: %d\n", size, errno);
+		ret = -1;
+	} else {
+		mem->paddr = sim_memory_register(vaddr, size);
+		if (mem->paddr == 0U) {
+			/* no address */
+			(void)munmap(vaddr, size);
+			ret = -1;
+		} else {
+			mem->vaddr	= vaddr;
+			mem->size	= size;
+			logd("pmap(%s) - 0x%08x, %zu bytes\n", name, mem->paddr, mem->size);
+		}
+	}
+
+	return ret;
+}
+
+void pmap_memory_unmap(struct pmap_memory *mem)
+{
+	if (mem->vaddr != NULL) {
+		sim_memory_unregister(mem->paddr);
+		(void)munmap(mem->vaddr, mem->size);
+	}
+
+	(void)memset((void *)mem, 0, sizeof(*mem));
+}
@@ -5,44 +5,151 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/ioctl.h>
+#include <linux/gpio.h>
 #include <misc/switch.h>
 
 #include "log.h"
 #include "switch.h"
+#include "latency.h"
 
 #define DEVICE_NAME			("/dev/switch_gpio_reverse")
+#define GPIO_DEVICE_NAME		("/dev/gpiochip")
+#define GPIO_CONSUMER_NAME		("rvc")
 
-int switch_open_device(struct switch_t *dev)
+/* the number of edges the kernel keeps until they are read */
+#define GPIO_EVENT_BUFFER_SIZE		(16U)
+
+static int switch_open_misc_device(struct switch_t *dev)
 {
 	char				name[1024]	= "";
 	int				ret		= 0;
 
-	if (dev == NULL) {
-		loge("dev is null\n");
+	if (dev->id == 0) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		ret = sprintf(name, "%s", DEVICE_NAME);
+	} else {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		ret = sprintf(name, "%s%d", DEVICE_NAME, dev->id);
+	}
+	if (ret < 0) {
+		loge("sprintf, ret: %d\n", ret);
 		ret = -1;
-	} else if (dev->fd != 0) {
-		loge("fd(%d) is wrong\n", dev->fd);
+	} else {
+		logd("device name: %s\n", name);
+		dev->fd = open(name, O_RDWR);
+		if (dev->fd < 0) {
+			loge("fd(%d) is wrong", dev->fd);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+static int switch_request_gpio_line(struct switch_t *dev, int chip_fd)
+{
+	struct gpio_v2_line_request	req		= { 0, };
+	int				ret		= 0;
+
+	(void)memset(&req, 0, sizeof(req));
+
+	req.offsets[0]		= dev->gpio_line;
+	req.num_lines		= 1;
+	req.event_buffer_size	= GPIO_EVENT_BUFFER_SIZE;
+	/* edges are timestamped with CLOCK_MONOTONIC by default */
+	req.config.flags	= (uint64_t)GPIO_V2_LINE_FLAG_INPUT |
+				  (uint64_t)GPIO_V2_LINE_FLAG_EDGE_RISING |
+				  (uint64_t)GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	if (dev->active_low == 1U) {
+		/* rising is the edge from inactive to active */
+		req.config.flags |= (uint64_t)GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+	}
+	(void)strncpy(req.consumer, GPIO_CONSUMER_NAME, sizeof(req.consumer) - 1U);
+
+	ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+	if (ret < 0) {
+		loge("GPIO_V2_GET_LINE_IOCTL(%u), errno: %d\n", dev->gpio_line, errno);
 		ret = -1;
 	} else {
-		if (dev->id == 0) {
-			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
-			ret = sprintf(name, "%s", DEVICE_NAME);
-		} else {
-			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
-			ret = sprintf(name, "%s%d", DEVICE_NAME, dev->id);
+		dev->fd = req.fd;
+
+		/* the queued edges are read until EAGAIN, so the line must not block */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		ret = fcntl(dev->fd, F_SETFL, O_NONBLOCK);
+		if (ret < 0) {
+			loge("fcntl(O_NONBLOCK), errno: %d\n", errno);
+			(void)close(dev->fd);
+			dev->fd = 0;
+			ret = -1;
 		}
+	}
+
+	return ret;
+}
+
+/*
+ * The fake event source is a file or a fifo of gpio_v2_line_event records.
+ * A fifo is opened for writing as well not to get POLLHUP whenever its
+ * writer closes. A record of timestamp 0 is stamped when it is read, so a
+ * script can write the edges without the clock of the kernel.
+ */
+static int switch_open_event_source(struct switch_t *dev, const char *path)
+{
+	int				ret		= 0;
+
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	dev->fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (dev->fd < 0) {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		dev->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	}
+
+	if (dev->fd < 0) {
+		loge("Failed to open %s, errno: %d\n", path, errno);
+		ret = -1;
+	} else {
+		logi("switch events are read from %s\n", path);
+		dev->raw_state = 0;
+	}
+
+	return ret;
+}
+
+static int switch_open_gpio_device(struct switch_t *dev)
+{
+	char				name[64]	= "";
+	const char			*path		= NULL;
+	int				chip_fd		= -1;
+	int				ret		= 0;
+
+	path = getenv(SWITCH_GPIO_EVENT_SOURCE);
+	if (path != NULL) {
+		/* fake event source */
+		ret = switch_open_event_source(dev, path);
+	} else {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		ret = snprintf(name, sizeof(name), "%s%d", GPIO_DEVICE_NAME, dev->gpio_chip);
 		if (ret < 0) {
-			loge("sprintf, ret: %d\n", ret);
+			loge("snprintf, ret: %d\n", ret);
 			ret = -1;
 		} else {
 			logd("device name: %s\n", name);
-			dev->fd = open(name, O_RDWR);
-			if (dev->fd < 0) {
-				loge("fd(%d) is wrong", dev->fd);
+			/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+			chip_fd = open(name, O_RDONLY | O_CLOEXEC);
+			if (chip_fd < 0) {
+				loge("Failed to open %s, errno: %d\n", name, errno);
 				ret = -1;
+			} else {
+				/* the line stays requested after the chip is closed */
+				ret = switch_request_gpio_line(dev, chip_fd);
+				(void)close(chip_fd);
 			}
 		}
 	}
@@ -50,6 +157,33 @@ int switch_open_device(struct switch_t *dev)
 	return ret;
 }
 
+int switch_open_device(struct switch_t *dev)
+{
+	int				ret		= 0;
+
+	if (dev == NULL) {
+		loge("dev is null\n");
+		ret = -1;
+	} else if (dev->fd != 0) {
+		loge("fd(%d) is wrong\n", dev->fd);
+		ret = -1;
+	} else {
+		dev->state		= -1;
+		dev->raw_state		= -1;
+		dev->last_edge_ns	= 0;
+		dev->is_confirm_needed	= 0;
+
+		if (dev->gpio_chip >= 0) {
+			/* gpio character device */
+			ret = switch_open_gpio_device(dev);
+		} else {
+			ret = switch_open_misc_device(dev);
+		}
+	}
+
+	return ret;
+}
+
 int switch_close_device(const struct switch_t *dev)
 {
 	int				ret		= 0;
@@ -68,6 +202,31 @@ int switch_close_device(const struct switch_t *dev)
 	return ret;
 }
 
+static int switch_get_gpio_state(const struct switch_t *dev)
+{
+	struct gpio_v2_line_values	values		= { 0, };
+	int				ret		= 0;
+
+	if (getenv(SWITCH_GPIO_EVENT_SOURCE) != NULL) {
+		/* the fake event source has no level to read */
+		ret = dev->raw_state;
+	} else {
+		(void)memset(&values, 0, sizeof(values));
+		values.mask = 1;
+
+		ret = ioctl(dev->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values);
+		if (ret < 0) {
+			loge("GPIO_V2_LINE_GET_VALUES_IOCTL, errno: %d\n", errno);
+			ret = -1;
+		} else {
+			/* the value is active-high or active-low already */
+			ret = ((values.bits & 1ULL) != 0ULL) ? 1 : 0;
+		}
+	}
+
+	return ret;
+}
+
 int switch_get_state(const struct switch_t *dev)
 {
 	int				arg		= 0;
@@ -76,6 +235,9 @@ int switch_get_state(const struct switch_t *dev)
 	if (dev == NULL) {
 		loge("dev is NULL\n");
 		ret = -1;
+	} else if (dev->gpio_chip >= 0) {
+		/* gpio character device */
+		ret = switch_get_gpio_state(dev);
 	} else {
 		ret = ioctl(dev->fd, SWITCH_IOCTL_CMD_GET_STATE, &arg);
 		if (ret < 0) {
@@ -89,3 +251,125 @@ int switch_get_state(const struct switch_t *dev)
 
 	return ret;
 }
+
+int switch_is_enabled(const struct switch_t *dev)
+{
+	return ((dev->id >= 0) || (dev->gpio_chip >= 0)) ? 1 : 0;
+}
+
+static int switch_update_state(struct switch_t *dev, int state,
+	uint64_t timestamp_ns, struct switch_event *ev)
+{
+	int				ret		= 0;
+
+	if ((state >= 0) && (state != dev->state)) {
+		dev->state		= state;
+		dev->last_edge_ns	= timestamp_ns;
+
+		ev->state		= state;
+		ev->timestamp_ns	= timestamp_ns;
+		ret = 1;
+	}
+
+	return ret;
+}
+
+/*
+ * leading-edge debounce: the first edge which changes the state is taken at
+ * once, and the edges in the debounce window after it are bounces. As the
+ * last bounce may leave the line in the other state, the level is confirmed
+ * by switch_confirm_state() when the window is over.
+ */
+static int switch_handle_gpio_event(struct switch_t *dev,
+	const struct gpio_v2_line_event *event, struct switch_event *ev)
+{
+	uint64_t			debounce_ns	= 0;
+	int				state		= 0;
+	int				ret		= 0;
+
+	debounce_ns	= (uint64_t)dev->debounce_ms * 1000000ULL;
+	state		= (event->id == (uint32_t)GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+
+	logd("edge: %d, timestamp: %llu, seqno: %u\n", state,
+		(unsigned long long)event->timestamp_ns, event->line_seqno);
+
+	dev->raw_state = state;
+
+	if ((event->timestamp_ns - dev->last_edge_ns) < debounce_ns) {
+		/* bounce */
+		dev->is_confirm_needed = 1;
+	} else {
+		ret = switch_update_state(dev, state, event->timestamp_ns, ev);
+		if ((ret == 1) && (debounce_ns > 0ULL)) {
+			/* check the level after the window */
+			dev->is_confirm_needed = 1;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Read the pending edges of the switch
+ *
+ * The state is read at once if it is not known yet. The gpio backend reads
+ * all the queued line events and debounces them, and the misc backend
+ * reads the state of the device.
+ *
+ * @param dev switch device instance
+ * @param ev the latest change of the debounced state
+ * @return 1 if the debounced state is changed, 0 if not, -1 on error
+ */
+int switch_read_event(struct switch_t *dev, struct switch_event *ev)
+{
+	struct gpio_v2_line_event	event		= { 0, };
+	ssize_t				len		= 0;
+	int				ret		= 0;
+
+	if ((dev->state < 0) || (dev->gpio_chip < 0)) {
+		/* the current state */
+		ret = switch_update_state(dev, switch_get_state(dev), latency_get_time_ns(), ev);
+		if (dev->raw_state < 0) {
+			/* no edge is received yet */
+			dev->raw_state = dev->state;
+		}
+	}
+
+	while (dev->gpio_chip >= 0) {
+		len = read(dev->fd, &event, sizeof(event));
+		if (len != (ssize_t)sizeof(event)) {
+			if ((len < 0) && (errno != EAGAIN)) {
+				/* error */
+				loge("read(switch), errno: %d\n", errno);
+				ret = -1;
+			}
+			break;
+		}
+
+		if ((event.timestamp_ns == 0ULL) && (getenv(SWITCH_GPIO_EVENT_SOURCE) != NULL)) {
+			/* the fake event source leaves the edge to be stamped when it is read */
+			event.timestamp_ns = latency_get_time_ns();
+		}
+
+		if (switch_handle_gpio_event(dev, &event, ev) == 1) {
+			/* changed */
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Take the level of the switch after the debounce window
+ *
+ * @param dev switch device instance
+ * @param ev the change of the debounced state
+ * @return 1 if the debounced state is changed, 0 if not
+ */
+int switch_confirm_state(struct switch_t *dev, struct switch_event *ev)
+{
+	dev->is_confirm_needed = 0;
+
+	return switch_update_state(dev, switch_get_state(dev), latency_get_time_ns(), ev);
+}
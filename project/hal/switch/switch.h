@@ -8,13 +8,39 @@
 
 #include <stdint.h>
 
+/* the records of gpio_v2_line_event are read from this file if it is set */
+#define SWITCH_GPIO_EVENT_SOURCE	("SWITCH_GPIO_EVENT_SOURCE")
+
+struct switch_event {
+	int		state;
+	/* CLOCK_MONOTONIC timestamp of the edge */
+	uint64_t	timestamp_ns;
+};
+
 struct switch_t {
 	int		id;
 	int		fd;
+
+	/* gpio character device backend, used if gpio_chip is not negative */
+	int		gpio_chip;
+	unsigned int	gpio_line;
+	unsigned int	active_low;
+	unsigned int	debounce_ms;
+
+	/* debounced state, -1 if it is not read yet */
+	int		state;
+	/* state of the last edge including the bounces */
+	int		raw_state;
+	uint64_t	last_edge_ns;
+	/* an edge is ignored in the debounce window, so check the level later */
+	unsigned int	is_confirm_needed;
 };
 
 extern int switch_open_device(struct switch_t *dev);
 extern int switch_close_device(const struct switch_t *dev);
 extern int switch_get_state(const struct switch_t *dev);
+extern int switch_is_enabled(const struct switch_t *dev);
+extern int switch_read_event(struct switch_t *dev, struct switch_event *ev);
+extern int switch_confirm_state(struct switch_t *dev, struct switch_event *ev);
 
 #endif//REVERSE_SWITCH_H
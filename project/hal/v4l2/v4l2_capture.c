@@ -11,8 +11,10 @@
 #include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include "log.h"
+#include "ioctl_trace.h"
 #include "v4l2_capture.h"
 #include "basic_operation.h"
 
@@ -77,7 +79,8 @@ int v4l2_capture_query_capabilities(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_QUERYCAP, cap);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_QUERYCAP, dev->fd,
+			VIDIOC_QUERYCAP, cap);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -98,7 +101,7 @@ int v4l2_capture_set_format(const struct v4l2_capture *dev, struct v4l2_format *
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_S_FMT, fmt);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_S_FMT, dev->fd, VIDIOC_S_FMT, fmt);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -120,7 +123,8 @@ int v4l2_capture_reqbufs(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_REQBUFS, req);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_REQBUFS, dev->fd,
+			VIDIOC_REQBUFS, req);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -142,7 +146,8 @@ int v4l2_capture_querybuf(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_QUERYBUF, buf);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_QUERYBUF, dev->fd,
+			VIDIOC_QUERYBUF, buf);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -164,7 +169,7 @@ int v4l2_capture_qbuf(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_QBUF, buf);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_QBUF, dev->fd, VIDIOC_QBUF, buf);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -186,7 +191,7 @@ int v4l2_capture_expbuf(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_EXPBUF, buf);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_EXPBUF, dev->fd, VIDIOC_EXPBUF, buf);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -207,7 +212,7 @@ int v4l2_capture_dqbuf(const struct v4l2_capture *dev, struct v4l2_buffer *buf)
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_DQBUF, buf);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_DQBUF, dev->fd, VIDIOC_DQBUF, buf);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -228,7 +233,8 @@ int v4l2_capture_streamon(const struct v4l2_capture *dev, int *arg)
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_STREAMON, arg);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_STREAMON, dev->fd,
+			VIDIOC_STREAMON, arg);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -249,7 +255,8 @@ int v4l2_capture_streamoff(const struct v4l2_capture *dev, int *arg)
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_STREAMOFF, arg);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_STREAMOFF, dev->fd,
+			VIDIOC_STREAMOFF, arg);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -271,7 +278,8 @@ int v4l2_capture_enuminput(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_ENUMINPUT, input);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_ENUMINPUT, dev->fd,
+			VIDIOC_ENUMINPUT, input);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -292,7 +300,8 @@ int v4l2_capture_g_input(const struct v4l2_capture *dev, int *index)
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_G_INPUT, index);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_G_INPUT, dev->fd,
+			VIDIOC_G_INPUT, index);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -314,7 +323,8 @@ int v4l2_capture_s_selection(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_S_SELECTION, sel);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_S_SELECTION, dev->fd,
+			VIDIOC_S_SELECTION, sel);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -336,7 +346,8 @@ int v4l2_capture_g_parm(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_G_PARM, parm);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_G_PARM, dev->fd,
+			VIDIOC_G_PARM, parm);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -358,7 +369,8 @@ int v4l2_capture_s_parm(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_S_PARM, parm);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_S_PARM, dev->fd,
+			VIDIOC_S_PARM, parm);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -380,7 +392,8 @@ int v4l2_capture_enum_framesize(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_ENUM_FRAMESIZES, frmsizeenum);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_ENUM_FRAMESIZES, dev->fd,
+			VIDIOC_ENUM_FRAMESIZES, frmsizeenum);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -402,7 +415,8 @@ int v4l2_capture_enum_frameintervals(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_ENUM_FRAMEINTERVALS, frmivalenum);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_ENUM_FRAMEINTERVALS, dev->fd,
+			VIDIOC_ENUM_FRAMEINTERVALS, frmivalenum);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -424,7 +438,8 @@ int v4l2_capture_check_v4l2_dev_status(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_CHECK_PATH_STATUS, status);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_CHECK_PATH_STATUS, dev->fd,
+			VIDIOC_CHECK_PATH_STATUS, status);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -446,7 +461,8 @@ int v4l2_capture_g_lastframe_addrs(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_G_LASTFRAME_ADDRS, addrs);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_G_LASTFRAME_ADDRS, dev->fd,
+			VIDIOC_G_LASTFRAME_ADDRS, addrs);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -468,7 +484,8 @@ int v4l2_capture_create_lastframe(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_CREATE_LASTFRAME, addrs);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_CREATE_LASTFRAME, dev->fd,
+			VIDIOC_CREATE_LASTFRAME, addrs);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -490,7 +507,8 @@ int v4l2_capture_s_handover(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_S_HANDOVER, handover);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_S_HANDOVER, dev->fd,
+			VIDIOC_S_HANDOVER, handover);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -512,7 +530,7 @@ int v4l2_capture_s_lut(const struct v4l2_capture *dev,
 		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_10_4_violation : FALSE] */
 		/* coverity[misra_c_2012_rule_12_2_violation : FALSE] */
-		ret = ioctl(dev->fd, VIDIOC_S_LUT, lut);
+		ret = trace_ioctl(IOCTL_TRACE_VIDIOC_S_LUT, dev->fd, VIDIOC_S_LUT, lut);
 		if (ret < 0) {
 			/* error */
 			loge("Failed on ioctl: %s\n", strerror(errno));
@@ -546,3 +564,19 @@ int v4l2_capture_poll(const struct v4l2_capture *dev, int event, int timeout)
 
 	return ret;
 }
+
+void *v4l2_capture_mmap(const struct v4l2_capture *dev, size_t length, unsigned int offset)
+{
+	void				*addr		= MAP_FAILED;
+
+	if (dev == NULL) {
+		/* error */
+		loge("dev is NULL\n");
+	} else {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+			dev->fd, (off_t)offset);
+	}
+
+	return addr;
+}
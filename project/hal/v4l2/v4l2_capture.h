@@ -63,5 +63,7 @@ extern int v4l2_capture_s_lut(const struct v4l2_capture *dev,
 	struct vin_lut *lut);
 extern int v4l2_capture_poll(const struct v4l2_capture *dev,
 	int event, int timeout);
+extern void *v4l2_capture_mmap(const struct v4l2_capture *dev,
+	size_t length, unsigned int offset);
 
 #endif//V4L2_CAPTURE_H
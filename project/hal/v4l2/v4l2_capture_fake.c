@@ -0,0 +1,1273 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+/*
+ * In-process emulation of the v4l2 capture device for the camera_app_sim
+ * build. The buffers are memfds which a generator thread fills at the
+ * configured frame rate, and the fd of the device is an eventfd which
+ * counts the filled buffers, so poll() and epoll work on it as on
+ * /dev/videoN. The buffers get addresses in the sim memory to be shown by
+ * the fake overlay.
+ *
+ * The source is configured by the environment:
+ *  FAKE_VIN_FPS:		frames per second of the source (default 30)
+ *  FAKE_VIN_JITTER_US:		max random delay of each frame
+ *  FAKE_VIN_DROP_EVERY:	drop every Nth frame, 0 not to drop
+ *  FAKE_VIN_LOSS_AFTER:	lose the source after every N frames, 0 never
+ *  FAKE_VIN_LOSS_MS:		how long the source is lost (default 1000)
+ *  FAKE_VIN_FREEZE_AFTER:	repeat the same image after N frames of each
+ *				stream, as a stuck serializer does, 0 never
+ *  FAKE_VIN_REPORT:		file the statistics are written to on close
+ *
+ * The frames can be replayed from a recording or from frame dumps instead of
+ * being generated, to measure what the application costs per frame with the
+ * same frames every run:
+ *  FAKE_VIN_REPLAY:		a recording, a frame dump, or a pattern of
+ *				frame dumps such as "video_capture.%u"
+ *  FAKE_VIN_REPLAY_PACE:	0 at the recorded timestamps, 1 at FAKE_VIN_FPS,
+ *				2 as soon as a buffer is queued
+ *  FAKE_VIN_REPLAY_LOOP:	1 to start over after the last frame (default),
+ *				0 to stop delivering
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/poll.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <limits.h>
+#include "log.h"
+#include "v4l2.h"
+#include "v4l2_capture.h"
+#include "v4l2_replay.h"
+#include "sim_memory.h"
+#include "basic_operation.h"
+#include "latency.h"
+
+#define FAKE_MAX_DEVICES		(8)
+#define FAKE_MAX_BUFFERS		(32U)
+
+#define FAKE_DEFAULT_FPS		(30U)
+#define FAKE_DEFAULT_LOSS_MS		(1000U)
+#define FAKE_REPORT_PATH		("/tmp/camera_app_sim.json")
+
+/* the number of dqbuf latencies the percentiles are taken from */
+#define FAKE_LATENCY_SAMPLES		(1024U)
+
+/* mem_offset of a plane is a cookie of its buffer and plane */
+#define FAKE_OFFSET_UNIT		(4096U)
+
+enum fake_replay_pace {
+	FAKE_REPLAY_PACE_RECORDED,
+	FAKE_REPLAY_PACE_FIXED,
+	FAKE_REPLAY_PACE_FAST,
+};
+
+enum fake_buffer_state {
+	FAKE_BUFFER_DEQUEUED,
+	FAKE_BUFFER_QUEUED,
+	FAKE_BUFFER_DONE,
+};
+
+struct fake_buffer {
+	int				memfd[VIDEO_MAX_PLANES];
+	void				*addr[VIDEO_MAX_PLANES];
+	unsigned long			userptr[VIDEO_MAX_PLANES];
+	uint32_t			paddr[VIDEO_MAX_PLANES];
+	unsigned int			length[VIDEO_MAX_PLANES];
+	unsigned int			state;
+	unsigned int			sequence;
+	uint64_t			done_ns;
+};
+
+struct fake_stats {
+	uint64_t			generated;
+	uint64_t			delivered;
+	uint64_t			dequeued;
+	uint64_t			dropped_injected;
+	uint64_t			dropped_starved;
+	uint64_t			losses;
+	uint64_t			frozen;
+	uint64_t			replayed;
+	uint64_t			streaming_ns;
+	/* the time the buffers are filled in, the replay overhead */
+	uint64_t			fill_sum_ns;
+	uint64_t			fill_max_ns;
+	uint64_t			latency_max_ns;
+	uint64_t			latency_sum_ns;
+	uint64_t			latencies[FAKE_LATENCY_SAMPLES];
+};
+
+struct fake_capture {
+	pthread_mutex_t			lock;
+	pthread_cond_t			cond;
+	pthread_t			thread;
+	int				efd;
+
+	struct v4l2_pix_format_mplane	fmt;
+	struct v4l2_fract		timeperframe;
+	unsigned int			memory;
+	unsigned int			n_buffers;
+	struct fake_buffer		buffers[FAKE_MAX_BUFFERS];
+
+	/* fifos of buffer indexes */
+	unsigned int			queued[FAKE_MAX_BUFFERS];
+	unsigned int			n_queued;
+	unsigned int			done[FAKE_MAX_BUFFERS];
+	unsigned int			n_done;
+
+	unsigned int			is_streaming;
+	unsigned int			sequence;
+	uint64_t			ts_streamon;
+	uint64_t			loss_end_ns;
+	unsigned int			frames_since_loss;
+	unsigned int			frames_since_streamon;
+	/* the last image before the source freezes */
+	unsigned int			frozen_sequence;
+
+	unsigned int			jitter_us;
+	unsigned int			drop_every;
+	unsigned int			loss_after;
+	unsigned int			loss_ms;
+	unsigned int			freeze_after;
+
+	unsigned int			is_replay;
+	unsigned int			replay_pace;
+	unsigned int			replay_loop;
+	struct v4l2_replay		replay;
+
+	struct fake_stats		stats;
+};
+
+static struct fake_capture	fakes[FAKE_MAX_DEVICES];
+
+static unsigned int fake_get_env(const char *name, unsigned int def)
+{
+	const char			*value		= NULL;
+	unsigned int			ret		= def;
+
+	value = getenv(name);
+	if (value != NULL) {
+		/* coverity[misra_c_2012_rule_21_7_violation : FALSE] */
+		ret = (unsigned int)strtoul(value, NULL, 0);
+	}
+
+	return ret;
+}
+
+static struct fake_capture *fake_get(const struct v4l2_capture *dev)
+{
+	struct fake_capture		*fake		= NULL;
+
+	if (dev == NULL) {
+		/* error */
+		loge("dev is NULL\n");
+	} else if ((dev->id < 0) || (dev->id >= FAKE_MAX_DEVICES)) {
+		/* error */
+		loge("id(%d) is wrong\n", dev->id);
+	} else {
+		fake = &fakes[dev->id];
+	}
+
+	return fake;
+}
+
+/* the fifos keep the order in which the buffers are queued and filled */
+static void fifo_push(unsigned int *fifo, unsigned int *count, unsigned int index)
+{
+	fifo[*count] = index;
+	(*count)++;
+}
+
+static unsigned int fifo_pop(unsigned int *fifo, unsigned int *count)
+{
+	unsigned int			index		= fifo[0];
+
+	(*count)--;
+	(void)memmove(&fifo[0], &fifo[1], (size_t)*count * sizeof(fifo[0]));
+
+	return index;
+}
+
+int v4l2_capture_open_device(struct v4l2_capture *dev)
+{
+	struct fake_capture		*fake		= NULL;
+	const char			*path		= NULL;
+	unsigned int			fps		= 0;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		(void)memset(fake, 0, sizeof(*fake));
+		(void)pthread_mutex_init(&fake->lock, NULL);
+		(void)pthread_cond_init(&fake->cond, NULL);
+
+		fps = fake_get_env("FAKE_VIN_FPS", FAKE_DEFAULT_FPS);
+		fake->timeperframe.numerator	= 1;
+		fake->timeperframe.denominator	= (fps == 0U) ? FAKE_DEFAULT_FPS : fps;
+		fake->jitter_us		= fake_get_env("FAKE_VIN_JITTER_US", 0U);
+		fake->drop_every	= fake_get_env("FAKE_VIN_DROP_EVERY", 0U);
+		fake->loss_after	= fake_get_env("FAKE_VIN_LOSS_AFTER", 0U);
+		fake->loss_ms		= fake_get_env("FAKE_VIN_LOSS_MS", FAKE_DEFAULT_LOSS_MS);
+		fake->freeze_after	= fake_get_env("FAKE_VIN_FREEZE_AFTER", 0U);
+		fake->replay_pace	= (unsigned int)FAKE_REPLAY_PACE_FIXED;
+
+		path = getenv("FAKE_VIN_REPLAY");
+		if (path != NULL) {
+			ret = v4l2_replay_open(&fake->replay, path);
+			if (ret == 0) {
+				fake->is_replay		= 1;
+				fake->replay_pace	= fake_get_env("FAKE_VIN_REPLAY_PACE",
+					(unsigned int)FAKE_REPLAY_PACE_RECORDED);
+				fake->replay_loop	= fake_get_env("FAKE_VIN_REPLAY_LOOP", 1U);
+				logi("fake video%d: replay of %u frames, pace: %u, loop: %u\n",
+					dev->id, fake->replay.n_frames, fake->replay_pace, fake->replay_loop);
+			}
+		}
+
+		/* readable while a filled buffer is waiting to be dequeued */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		fake->efd = (ret < 0) ? -1 : eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC | EFD_SEMAPHORE);
+		if (ret < 0) {
+			/* nothing to replay */
+			loge("Failed to replay %s\n", path);
+		} else if (fake->efd < 0) {
+			loge("eventfd, errno: %d\n", errno);
+			v4l2_replay_close(&fake->replay);
+			ret = -1;
+		} else {
+			logi("fake video%d: %u fps, jitter: %u us, drop every: %u, loss after: %u\n",
+				dev->id, fake->timeperframe.denominator, fake->jitter_us,
+				fake->drop_every, fake->loss_after);
+			dev->fd = fake->efd;
+		}
+	}
+
+	return ret;
+}
+
+static uint64_t fake_percentile(const uint64_t *samples, unsigned int count, unsigned int pct)
+{
+	uint64_t			sorted[FAKE_LATENCY_SAMPLES];
+	uint64_t			value		= 0;
+	unsigned int			idx		= 0;
+	unsigned int			pos		= 0;
+	unsigned int			rank		= 0;
+
+	if (count > 0U) {
+		/* insertion sort of a copy */
+		for (idx = 0; idx < count; idx++) {
+			value = samples[idx];
+			for (pos = idx; (pos > 0U) && (sorted[pos - 1U] > value); pos--) {
+				/* shift */
+				sorted[pos] = sorted[pos - 1U];
+			}
+			sorted[pos] = value;
+		}
+
+		/* nearest rank */
+		rank	= ((count * pct) + 99U) / 100U;
+		value	= sorted[(rank > 0U) ? (rank - 1U) : 0U];
+	}
+
+	return value;
+}
+
+static void fake_write_report(const struct fake_capture *fake, int id)
+{
+	const struct fake_stats		*stats		= &fake->stats;
+	const char			*path		= NULL;
+	unsigned int			count		= 0;
+	uint64_t			fps_milli	= 0;
+	int				fd		= -1;
+
+	path = getenv("FAKE_VIN_REPORT");
+	if (path == NULL) {
+		/* default */
+		path = FAKE_REPORT_PATH;
+	}
+
+	count = (stats->dequeued < FAKE_LATENCY_SAMPLES) ?
+		(unsigned int)stats->dequeued : FAKE_LATENCY_SAMPLES;
+	if (stats->streaming_ns > 0U) {
+		/* frames per second in 1/1000 */
+		fps_milli = (stats->dequeued * 1000000000000ULL) / stats->streaming_ns;
+	}
+
+	/* coverity[misra_c_2012_rule_7_1_violation : FALSE] */
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		/* error */
+		loge("Failed to open %s\n", path);
+	} else {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		(void)dprintf(fd, "{\"device\": %d, \"fps\": %u, \"format\": \"%s\", "
+			"\"width\": %u, \"height\": %u,\n"
+			" \"streaming_ms\": %llu, \"generated\": %llu, \"delivered\": %llu, "
+			"\"dequeued\": %llu,\n"
+			" \"dropped_injected\": %llu, \"dropped_starved\": %llu, \"losses\": %llu, "
+			"\"frozen\": %llu,\n"
+			" \"throughput_fps\": %llu.%03llu,\n"
+			" \"replay_frames\": %u, \"replay_pace\": %u, \"replayed\": %llu,\n"
+			" \"fill_us\": {\"avg\": %llu, \"max\": %llu},\n"
+			" \"dqbuf_latency_us\": {\"avg\": %llu, \"p50\": %llu, \"p99\": %llu, "
+			"\"max\": %llu}}\n",
+			id, fake->timeperframe.denominator,
+			v4l2_get_format_name_by_v4l2_format(fake->fmt.pixelformat),
+			fake->fmt.width, fake->fmt.height,
+			(unsigned long long)(stats->streaming_ns / 1000000U),
+			(unsigned long long)stats->generated,
+			(unsigned long long)stats->delivered,
+			(unsigned long long)stats->dequeued,
+			(unsigned long long)stats->dropped_injected,
+			(unsigned long long)stats->dropped_starved,
+			(unsigned long long)stats->losses,
+			(unsigned long long)stats->frozen,
+			(unsigned long long)(fps_milli / 1000U),
+			(unsigned long long)(fps_milli % 1000U),
+			fake->replay.n_frames, fake->replay_pace,
+			(unsigned long long)stats->replayed,
+			(unsigned long long)((stats->delivered > 0U) ?
+				(stats->fill_sum_ns / stats->delivered / 1000U) : 0U),
+			(unsigned long long)(stats->fill_max_ns / 1000U),
+			(unsigned long long)((stats->dequeued > 0U) ?
+				(stats->latency_sum_ns / stats->dequeued / 1000U) : 0U),
+			(unsigned long long)(fake_percentile(stats->latencies, count, 50U) / 1000U),
+			(unsigned long long)(fake_percentile(stats->latencies, count, 99U) / 1000U),
+			(unsigned long long)(stats->latency_max_ns / 1000U));
+
+		(void)close(fd);
+	}
+}
+
+static void fake_free_buffers(struct fake_capture *fake)
+{
+	struct fake_buffer		*buf		= NULL;
+	unsigned int			idxBuf		= 0;
+	unsigned int			idxpln		= 0;
+
+	for (idxBuf = 0; idxBuf < fake->n_buffers; idxBuf++) {
+		buf = &fake->buffers[idxBuf];
+		for (idxpln = 0; idxpln < (unsigned int)VIDEO_MAX_PLANES; idxpln++) {
+			if (buf->paddr[idxpln] != 0U) {
+				/* given to the overlay */
+				sim_memory_unregister(buf->paddr[idxpln]);
+			}
+			if (buf->addr[idxpln] != NULL) {
+				/* mapped for the generator */
+				(void)munmap(buf->addr[idxpln], buf->length[idxpln]);
+			}
+			if (buf->memfd[idxpln] > 0) {
+				/* allocated */
+				(void)close(buf->memfd[idxpln]);
+			}
+		}
+	}
+
+	(void)memset(fake->buffers, 0, sizeof(fake->buffers));
+	fake->n_buffers		= 0;
+	fake->n_queued		= 0;
+	fake->n_done		= 0;
+}
+
+static void fake_stop_streaming(struct fake_capture *fake)
+{
+	uint64_t			value		= 0;
+	unsigned int			idxBuf		= 0;
+
+	(void)pthread_mutex_lock(&fake->lock);
+	if (fake->is_streaming == 1U) {
+		fake->is_streaming = 0;
+		(void)pthread_cond_signal(&fake->cond);
+		(void)pthread_mutex_unlock(&fake->lock);
+
+		(void)pthread_join(fake->thread, NULL);
+
+		(void)pthread_mutex_lock(&fake->lock);
+		fake->stats.streaming_ns += latency_get_time_ns() - fake->ts_streamon;
+	}
+
+	/* streamoff returns every buffer to the application */
+	for (idxBuf = 0; idxBuf < fake->n_buffers; idxBuf++) {
+		/* dequeued */
+		fake->buffers[idxBuf].state = (unsigned int)FAKE_BUFFER_DEQUEUED;
+	}
+	fake->n_queued	= 0;
+	fake->n_done	= 0;
+	while (read(fake->efd, &value, sizeof(value)) > 0) {
+		/* drain */
+		logd("drained\n");
+	}
+	(void)pthread_mutex_unlock(&fake->lock);
+}
+
+int v4l2_capture_close_device(const struct v4l2_capture *dev)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if (fake->efd <= 0) {
+		loge("fd(%d) is wrong\n", fake->efd);
+		ret = -1;
+	} else {
+		fake_stop_streaming(fake);
+		fake_write_report(fake, dev->id);
+		fake_free_buffers(fake);
+		if (fake->is_replay == 1U) {
+			/* unmap */
+			v4l2_replay_close(&fake->replay);
+			fake->is_replay = 0;
+		}
+
+		ret = close(fake->efd);
+		fake->efd = -1;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_query_capabilities(const struct v4l2_capture *dev,
+	struct v4l2_capability *cap)
+{
+	int				ret		= 0;
+
+	if (fake_get(dev) == NULL) {
+		ret = -1;
+	} else {
+		(void)memset(cap, 0, sizeof(*cap));
+		(void)strncpy((char *)cap->driver, "fake-vin", sizeof(cap->driver) - 1U);
+		(void)strncpy((char *)cap->card, "fake-vin", sizeof(cap->card) - 1U);
+		cap->capabilities	= (unsigned int)V4L2_CAP_VIDEO_CAPTURE_MPLANE |
+					  (unsigned int)V4L2_CAP_STREAMING;
+		cap->device_caps	= cap->capabilities;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_set_format(const struct v4l2_capture *dev, struct v4l2_format *fmt)
+{
+	struct fake_capture		*fake		= NULL;
+	struct v4l2_pix_format_mplane	*pix		= NULL;
+	unsigned int			sizeimage	= 0;
+	unsigned int			idxpln		= 0;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		pix = &fmt->fmt.pix_mp;
+		sizeimage = v4l2_get_v4l2_sizeimage(pix->pixelformat, pix->width, pix->height);
+		if ((sizeimage == 0U) || (pix->num_planes == 0U) ||
+		    (pix->num_planes > (unsigned char)VIDEO_MAX_PLANES)) {
+			loge("format(0x%08x) is not supported\n", pix->pixelformat);
+			errno = EINVAL;
+			ret = -1;
+		} else {
+			for (idxpln = 0; idxpln < pix->num_planes; idxpln++) {
+				if (pix->plane_fmt[idxpln].sizeimage == 0U) {
+					/* the driver decides */
+					pix->plane_fmt[idxpln].sizeimage = sizeimage;
+				}
+				pix->plane_fmt[idxpln].bytesperline =
+					pix->width * v4l2_get_color_depth_by_v4l2_format(pix->pixelformat);
+			}
+			fake->fmt = *pix;
+		}
+	}
+
+	return ret;
+}
+
+static int fake_alloc_plane(struct fake_buffer *buf, unsigned int idxpln, unsigned int length)
+{
+	int				ret		= 0;
+
+	buf->length[idxpln]	= length;
+	buf->memfd[idxpln]	= memfd_create("fake-vin", MFD_CLOEXEC);
+	if (buf->memfd[idxpln] < 0) {
+		loge("memfd_create, errno: %d\n", errno);
+		buf->memfd[idxpln] = 0;
+		ret = -1;
+	} else if (ftruncate(buf->memfd[idxpln], (off_t)length) < 0) {
+		loge("ftruncate, errno: %d\n", errno);
+		ret = -1;
+	} else {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		buf->addr[idxpln] = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+			buf->memfd[idxpln], 0);
+		if (buf->addr[idxpln] == MAP_FAILED) {
+			loge("mmap, errno: %d\n", errno);
+			buf->addr[idxpln] = NULL;
+			ret = -1;
+		} else {
+			/* the address the overlay is given */
+			buf->paddr[idxpln] = sim_memory_register(buf->addr[idxpln], length);
+		}
+	}
+
+	return ret;
+}
+
+int v4l2_capture_reqbufs(const struct v4l2_capture *dev,
+	struct v4l2_requestbuffers *req)
+{
+	struct fake_capture		*fake		= NULL;
+	unsigned int			idxBuf		= 0;
+	unsigned int			idxpln		= 0;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if (fake->is_streaming == 1U) {
+		loge("the device is streaming\n");
+		errno = EBUSY;
+		ret = -1;
+	} else {
+		fake_free_buffers(fake);
+
+		fake->memory	= req->memory;
+		req->count	= (req->count > FAKE_MAX_BUFFERS) ? FAKE_MAX_BUFFERS : req->count;
+		fake->n_buffers	= req->count;
+		for (idxBuf = 0; (ret == 0) && (idxBuf < fake->n_buffers); idxBuf++) {
+			for (idxpln = 0; (ret == 0) && (idxpln < fake->fmt.num_planes); idxpln++) {
+				if (req->memory == (unsigned int)V4L2_MEMORY_MMAP) {
+					ret = fake_alloc_plane(&fake->buffers[idxBuf], idxpln,
+						fake->fmt.plane_fmt[idxpln].sizeimage);
+				} else {
+					/* the application gives the memory on qbuf */
+					fake->buffers[idxBuf].length[idxpln] =
+						fake->fmt.plane_fmt[idxpln].sizeimage;
+				}
+			}
+		}
+
+		if (ret < 0) {
+			fake_free_buffers(fake);
+			errno = ENOMEM;
+		}
+	}
+
+	return ret;
+}
+
+int v4l2_capture_querybuf(const struct v4l2_capture *dev,
+	struct v4l2_buffer *buf)
+{
+	struct fake_capture		*fake		= NULL;
+	unsigned int			idxpln		= 0;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if ((buf->index >= fake->n_buffers) || (buf->m.planes == NULL)) {
+		errno = EINVAL;
+		ret = -1;
+	} else {
+		buf->memory	= fake->memory;
+		buf->length	= fake->fmt.num_planes;
+		for (idxpln = 0; idxpln < buf->length; idxpln++) {
+			buf->m.planes[idxpln].length		=
+				fake->buffers[buf->index].length[idxpln];
+			buf->m.planes[idxpln].m.mem_offset	=
+				((buf->index * (unsigned int)VIDEO_MAX_PLANES) + idxpln) *
+				FAKE_OFFSET_UNIT;
+			/* 0 in V4L2_MEMORY_USERPTR */
+			buf->m.planes[idxpln].reserved[0]	=
+				fake->buffers[buf->index].paddr[idxpln];
+		}
+	}
+
+	return ret;
+}
+
+int v4l2_capture_qbuf(const struct v4l2_capture *dev,
+	struct v4l2_buffer *buf)
+{
+	struct fake_capture		*fake		= NULL;
+	struct fake_buffer		*fbuf		= NULL;
+	unsigned int			idxpln		= 0;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		(void)pthread_mutex_lock(&fake->lock);
+		if ((buf->index >= fake->n_buffers) ||
+		    (fake->buffers[buf->index].state != (unsigned int)FAKE_BUFFER_DEQUEUED)) {
+			errno = EINVAL;
+			ret = -1;
+		} else {
+			fbuf = &fake->buffers[buf->index];
+			if ((fake->memory == (unsigned int)V4L2_MEMORY_USERPTR) &&
+			    (buf->m.planes != NULL)) {
+				for (idxpln = 0; idxpln < fake->fmt.num_planes; idxpln++) {
+					/* filled in place */
+					fbuf->userptr[idxpln] = buf->m.planes[idxpln].m.userptr;
+				}
+			}
+			fbuf->state = (unsigned int)FAKE_BUFFER_QUEUED;
+			fifo_push(fake->queued, &fake->n_queued, buf->index);
+			if (fake->replay_pace == (unsigned int)FAKE_REPLAY_PACE_FAST) {
+				/* the generator waits for a buffer to fill */
+				(void)pthread_cond_signal(&fake->cond);
+			}
+		}
+		(void)pthread_mutex_unlock(&fake->lock);
+	}
+
+	return ret;
+}
+
+int v4l2_capture_expbuf(const struct v4l2_capture *dev,
+	struct v4l2_exportbuffer *buf)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if ((buf->index >= fake->n_buffers) ||
+		   (buf->plane >= fake->fmt.num_planes) ||
+		   (fake->buffers[buf->index].memfd[buf->plane] <= 0)) {
+		errno = EINVAL;
+		ret = -1;
+	} else {
+		/* the memfd stands for the dma-buf */
+		buf->fd = fcntl(fake->buffers[buf->index].memfd[buf->plane], F_DUPFD_CLOEXEC, 0);
+		ret = (buf->fd < 0) ? -1 : 0;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_dqbuf(const struct v4l2_capture *dev,
+	struct v4l2_buffer *buf)
+{
+	struct fake_capture		*fake		= NULL;
+	struct fake_buffer		*fbuf		= NULL;
+	uint64_t			value		= 0;
+	uint64_t			latency		= 0;
+	unsigned int			idxpln		= 0;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		(void)pthread_mutex_lock(&fake->lock);
+		if (fake->n_done == 0U) {
+			errno = EAGAIN;
+			ret = -1;
+		} else {
+			(void)read(fake->efd, &value, sizeof(value));
+
+			buf->index	= fifo_pop(fake->done, &fake->n_done);
+			fbuf		= &fake->buffers[buf->index];
+			fbuf->state	= (unsigned int)FAKE_BUFFER_DEQUEUED;
+
+			buf->memory		= fake->memory;
+			buf->sequence		= fbuf->sequence;
+			buf->flags		= (unsigned int)V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+			buf->timestamp.tv_sec	= (long)(fbuf->done_ns / 1000000000U);
+			buf->timestamp.tv_usec	= (long)((fbuf->done_ns % 1000000000U) / 1000U);
+			if (buf->m.planes != NULL) {
+				buf->length = fake->fmt.num_planes;
+				for (idxpln = 0; idxpln < buf->length; idxpln++) {
+					buf->m.planes[idxpln].bytesused	= fbuf->length[idxpln];
+					buf->m.planes[idxpln].length	= fbuf->length[idxpln];
+				}
+			}
+
+			latency = latency_get_time_ns() - fbuf->done_ns;
+			fake->stats.latencies[fake->stats.dequeued % FAKE_LATENCY_SAMPLES] = latency;
+			fake->stats.latency_sum_ns += latency;
+			if (latency > fake->stats.latency_max_ns) {
+				/* the longest wait */
+				fake->stats.latency_max_ns = latency;
+			}
+			fake->stats.dequeued++;
+		}
+		(void)pthread_mutex_unlock(&fake->lock);
+	}
+
+	return ret;
+}
+
+/* rows get a gradient which moves every frame not to look blank or frozen */
+static void fake_fill_plane(unsigned char *addr, unsigned int length,
+	unsigned int height, unsigned int sequence)
+{
+	unsigned int			stride		= 0;
+	unsigned int			row		= 0;
+
+	stride = (height > 0U) ? (length / height) : length;
+	for (row = 0; (stride > 0U) && (row < (length / stride)); row++) {
+		/* row */
+		(void)memset(&addr[row * stride], (int)((row + sequence) & 0xFFU), stride);
+	}
+}
+
+static unsigned char *fake_get_plane_addr(const struct fake_capture *fake,
+	const struct fake_buffer *fbuf, unsigned int idxpln)
+{
+	/* coverity[misra_c_2012_rule_11_4_violation : FALSE] */
+	return (fake->memory == (unsigned int)V4L2_MEMORY_USERPTR) ?
+		(unsigned char *)fbuf->userptr[idxpln] : (unsigned char *)fbuf->addr[idxpln];
+}
+
+/*
+ * the planes of the recorded frame are copied one after another into the
+ * planes of the buffer, so a frame dumped with contiguous planes fills a
+ * buffer with separate ones and the other way around
+ */
+static void fake_replay_fill_buffer(const struct fake_capture *fake,
+	const struct fake_buffer *fbuf, unsigned int content)
+{
+	const struct frame_dump_header	*header		= NULL;
+	const unsigned char		*src		= NULL;
+	unsigned char			*addr		= NULL;
+	size_t				left		= 0;
+	size_t				size		= 0;
+	unsigned int			idxpln		= 0;
+
+	src = v4l2_replay_get_frame(&fake->replay, content % fake->replay.n_frames, &header);
+	if (src != NULL) {
+		for (idxpln = 0; (idxpln < header->n_planes) && (idxpln < FRAME_DUMP_MAX_PLANES); idxpln++) {
+			/* the payload */
+			left += header->sizes[idxpln];
+		}
+	}
+
+	for (idxpln = 0; (left > 0U) && (idxpln < fake->fmt.num_planes); idxpln++) {
+		size = (left < (size_t)fbuf->length[idxpln]) ? left : (size_t)fbuf->length[idxpln];
+		addr = fake_get_plane_addr(fake, fbuf, idxpln);
+		if (addr != NULL) {
+			/* copy */
+			(void)memcpy(addr, src, size);
+		}
+		src	= &src[size];
+		left	-= size;
+	}
+}
+
+static void fake_fill_buffer(const struct fake_capture *fake, const struct fake_buffer *fbuf,
+	unsigned int sequence)
+{
+	unsigned char			*addr		= NULL;
+	unsigned int			idxpln		= 0;
+
+	if (fake->is_replay == 1U) {
+		/* recorded */
+		fake_replay_fill_buffer(fake, fbuf, sequence);
+	} else {
+		for (idxpln = 0; idxpln < fake->fmt.num_planes; idxpln++) {
+			addr = fake_get_plane_addr(fake, fbuf, idxpln);
+			if (addr != NULL) {
+				/* fill */
+				fake_fill_plane(addr, fbuf->length[idxpln], fake->fmt.height, sequence);
+			}
+		}
+	}
+}
+
+/* 1 if every recorded frame is delivered and the replay does not loop */
+static unsigned int fake_replay_is_over(const struct fake_capture *fake)
+{
+	return ((fake->is_replay == 1U) && (fake->replay_loop == 0U) &&
+		(fake->sequence >= fake->replay.n_frames)) ? 1U : 0U;
+}
+
+/*
+ * the time from the frame before in the recording, or period_ns for the
+ * first frame of each pass
+ */
+static uint64_t fake_replay_get_period_ns(const struct fake_capture *fake,
+	unsigned int sequence, uint64_t period_ns)
+{
+	const struct frame_dump_header	*cur		= NULL;
+	const struct frame_dump_header	*prev		= NULL;
+	unsigned int			idx		= 0;
+	uint64_t			ret		= period_ns;
+
+	idx = sequence % fake->replay.n_frames;
+	if ((idx > 0U) &&
+	    (v4l2_replay_get_frame(&fake->replay, idx, &cur) != NULL) &&
+	    (v4l2_replay_get_frame(&fake->replay, idx - 1U, &prev) != NULL) &&
+	    (cur->timestamp_us > prev->timestamp_us)) {
+		/* recorded */
+		ret = (cur->timestamp_us - prev->timestamp_us) * 1000ULL;
+	}
+
+	return ret;
+}
+
+/* called with the lock held, 1 if the frame is delivered */
+static int fake_produce_frame(struct fake_capture *fake, uint64_t now)
+{
+	struct fake_buffer		*fbuf		= NULL;
+	unsigned int			index		= 0;
+	unsigned int			sequence	= 0;
+	unsigned int			content		= 0;
+	uint64_t			value		= 1;
+	uint64_t			fill_ns		= 0;
+	int				ret		= 0;
+
+	if (now < fake->loss_end_ns) {
+		/* no signal */
+		logd("the source is lost\n");
+	} else if (fake_replay_is_over(fake) == 1U) {
+		/* no more frame */
+		logd("the replay is over\n");
+	} else {
+		sequence = fake->sequence;
+		fake->sequence++;
+		fake->stats.generated++;
+		fake->frames_since_loss++;
+
+		content = sequence;
+		if ((fake->freeze_after > 0U) && (fake->frames_since_streamon >= fake->freeze_after)) {
+			/* the image stops moving until the stream is restarted */
+			content = fake->frozen_sequence;
+			fake->stats.frozen++;
+		} else {
+			fake->frames_since_streamon++;
+			fake->frozen_sequence = sequence;
+		}
+
+		if ((fake->loss_after > 0U) && (fake->frames_since_loss >= fake->loss_after)) {
+			/* the source is lost from the next frame */
+			fake->loss_end_ns	= now + ((uint64_t)fake->loss_ms * 1000000ULL);
+			fake->frames_since_loss	= 0;
+			fake->stats.losses++;
+		}
+
+		if ((fake->drop_every > 0U) && (((sequence + 1U) % fake->drop_every) == 0U)) {
+			/* injected */
+			fake->stats.dropped_injected++;
+		} else if (fake->n_queued == 0U) {
+			/* no buffer to fill */
+			fake->stats.dropped_starved++;
+		} else {
+			index	= fifo_pop(fake->queued, &fake->n_queued);
+			fbuf	= &fake->buffers[index];
+
+			/* the buffer belongs to the driver while it is filled */
+			(void)pthread_mutex_unlock(&fake->lock);
+			fill_ns = latency_get_time_ns();
+			fake_fill_buffer(fake, fbuf, content);
+			(void)pthread_mutex_lock(&fake->lock);
+
+			fbuf->sequence	= sequence;
+			fbuf->done_ns	= latency_get_time_ns();
+			fill_ns		= fbuf->done_ns - fill_ns;
+			fake->stats.fill_sum_ns += fill_ns;
+			if (fill_ns > fake->stats.fill_max_ns) {
+				/* the longest fill */
+				fake->stats.fill_max_ns = fill_ns;
+			}
+			if (fake->is_replay == 1U) {
+				/* recorded */
+				fake->stats.replayed++;
+			}
+			fbuf->state	= (unsigned int)FAKE_BUFFER_DONE;
+			fifo_push(fake->done, &fake->n_done, index);
+			fake->stats.delivered++;
+
+			(void)write(fake->efd, &value, sizeof(value));
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+static void fake_add_ns(struct timespec *ts, uint64_t ns)
+{
+	uint64_t			nsec		= 0;
+
+	nsec		= (uint64_t)ts->tv_nsec + ns;
+	ts->tv_sec	+= (time_t)(nsec / 1000000000U);
+	ts->tv_nsec	= (long)(nsec % 1000000000U);
+}
+
+static void *fake_generator_thread(void *arg)
+{
+	struct fake_capture		*fake		= NULL;
+	struct timespec			ts_next		= { 0, };
+	struct timespec			ts_wait		= { 0, };
+	unsigned int			seed		= 0;
+	uint64_t			period_ns	= 0;
+	uint64_t			jitter_ns	= 0;
+	int				ret		= 0;
+
+	fake = (struct fake_capture *)arg;
+
+	period_ns = ((uint64_t)fake->timeperframe.numerator * 1000000000ULL) /
+		fake->timeperframe.denominator;
+	seed = (unsigned int)latency_get_time_ns();
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts_next);
+
+	(void)pthread_mutex_lock(&fake->lock);
+	while (fake->is_streaming == 1U) {
+		if ((fake->replay_pace == (unsigned int)FAKE_REPLAY_PACE_FAST) &&
+		    (latency_get_time_ns() >= fake->loss_end_ns)) {
+			while ((fake->is_streaming == 1U) &&
+			       ((fake->n_queued == 0U) || (fake_replay_is_over(fake) == 1U))) {
+				/* wait for a buffer or streamoff */
+				(void)pthread_cond_wait(&fake->cond, &fake->lock);
+			}
+			/* a lost source is waited for at the period from here */
+			(void)clock_gettime(CLOCK_MONOTONIC, &ts_next);
+		} else {
+			/* frames keep the nominal period, only their delivery jitters */
+			fake_add_ns(&ts_next,
+				(fake->replay_pace == (unsigned int)FAKE_REPLAY_PACE_RECORDED) ?
+				fake_replay_get_period_ns(fake, fake->sequence, period_ns) : period_ns);
+			ts_wait = ts_next;
+			if (fake->jitter_us > 0U) {
+				jitter_ns = ((uint64_t)rand_r(&seed) % ((uint64_t)fake->jitter_us + 1U)) * 1000U;
+				fake_add_ns(&ts_wait, jitter_ns);
+			}
+
+			ret = 0;
+			while ((fake->is_streaming == 1U) && (ret != ETIMEDOUT)) {
+				/* wait for the frame or streamoff */
+				ret = pthread_cond_timedwait(&fake->cond, &fake->lock, &ts_wait);
+			}
+		}
+
+		if (fake->is_streaming == 1U) {
+			/* frame */
+			(void)fake_produce_frame(fake, latency_get_time_ns());
+		}
+	}
+	(void)pthread_mutex_unlock(&fake->lock);
+
+	return NULL;
+}
+
+int v4l2_capture_streamon(const struct v4l2_capture *dev,
+	int *arg)
+{
+	struct fake_capture		*fake		= NULL;
+	const struct frame_dump_header	*header		= NULL;
+	pthread_condattr_t		attr;
+	int				ret		= 0;
+
+	(void)arg;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if (fake->is_streaming == 1U) {
+		/* already */
+		logd("already streaming\n");
+	} else {
+		if ((fake->is_replay == 1U) &&
+		    (v4l2_replay_get_frame(&fake->replay, 0U, &header) != NULL) &&
+		    ((header->fourcc != fake->fmt.pixelformat) ||
+		     (header->width != fake->fmt.width) || (header->height != fake->fmt.height))) {
+			/* the bytes are copied as they are */
+			logw("the frames are recorded in %s %ux%u, not in %s %ux%u\n",
+				v4l2_get_format_name_by_v4l2_format(header->fourcc),
+				header->width, header->height,
+				v4l2_get_format_name_by_v4l2_format(fake->fmt.pixelformat),
+				fake->fmt.width, fake->fmt.height);
+		}
+
+		/* the generator waits on CLOCK_MONOTONIC */
+		(void)pthread_cond_destroy(&fake->cond);
+		(void)pthread_condattr_init(&attr);
+		(void)pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		(void)pthread_cond_init(&fake->cond, &attr);
+		(void)pthread_condattr_destroy(&attr);
+
+		fake->is_streaming		= 1;
+		fake->ts_streamon		= latency_get_time_ns();
+		fake->frames_since_streamon	= 0;
+		ret = pthread_create(&fake->thread, NULL, fake_generator_thread, fake);
+		if (ret != 0) {
+			loge("pthread_create, ret: %d\n", ret);
+			fake->is_streaming = 0;
+			errno = ret;
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+int v4l2_capture_streamoff(const struct v4l2_capture *dev,
+	int *arg)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	(void)arg;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		/* stop */
+		fake_stop_streaming(fake);
+	}
+
+	return ret;
+}
+
+static unsigned int fake_is_source_lost(struct fake_capture *fake)
+{
+	unsigned int			ret		= 0;
+
+	(void)pthread_mutex_lock(&fake->lock);
+	ret = (latency_get_time_ns() < fake->loss_end_ns) ? 1U : 0U;
+	(void)pthread_mutex_unlock(&fake->lock);
+
+	return ret;
+}
+
+int v4l2_capture_enuminput(const struct v4l2_capture *dev,
+	struct v4l2_input *input)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if (input->index != 0U) {
+		errno = EINVAL;
+		ret = -1;
+	} else {
+		(void)strncpy((char *)input->name, "fake", sizeof(input->name) - 1U);
+		input->type	= (unsigned int)V4L2_INPUT_TYPE_CAMERA;
+		input->status	= (fake_is_source_lost(fake) == 1U) ?
+			(unsigned int)V4L2_IN_ST_NO_POWER : 0U;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_g_input(const struct v4l2_capture *dev,
+	int *index)
+{
+	int				ret		= 0;
+
+	if (fake_get(dev) == NULL) {
+		ret = -1;
+	} else {
+		/* one input */
+		*index = 0;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_s_selection(const struct v4l2_capture *dev,
+	struct v4l2_selection *sel)
+{
+	(void)sel;
+
+	return (fake_get(dev) == NULL) ? -1 : 0;
+}
+
+int v4l2_capture_g_parm(const struct v4l2_capture *dev,
+	struct v4l2_streamparm *parm)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		parm->parm.capture.capability	= (unsigned int)V4L2_CAP_TIMEPERFRAME;
+		parm->parm.capture.timeperframe	= fake->timeperframe;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_s_parm(const struct v4l2_capture *dev,
+	struct v4l2_streamparm *parm)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		/* the source runs in a fixed mode, so the rate it has is returned */
+		parm->parm.capture.capability	= (unsigned int)V4L2_CAP_TIMEPERFRAME;
+		parm->parm.capture.timeperframe	= fake->timeperframe;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_enum_framesize(const struct v4l2_capture *dev,
+	struct v4l2_frmsizeenum *frmsizeenum)
+{
+	int				ret		= 0;
+
+	if (fake_get(dev) == NULL) {
+		ret = -1;
+	} else if (frmsizeenum->index != 0U) {
+		errno = EINVAL;
+		ret = -1;
+	} else {
+		/* any size */
+		frmsizeenum->type			= (unsigned int)V4L2_FRMSIZE_TYPE_CONTINUOUS;
+		frmsizeenum->stepwise.min_width		= 1;
+		frmsizeenum->stepwise.max_width		= 4096;
+		frmsizeenum->stepwise.step_width	= 1;
+		frmsizeenum->stepwise.min_height	= 1;
+		frmsizeenum->stepwise.max_height	= 4096;
+		frmsizeenum->stepwise.step_height	= 1;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_enum_frameintervals(const struct v4l2_capture *dev,
+	struct v4l2_frmivalenum *frmivalenum)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else if (frmivalenum->index != 0U) {
+		errno = EINVAL;
+		ret = -1;
+	} else {
+		frmivalenum->type	= (unsigned int)V4L2_FRMIVAL_TYPE_DISCRETE;
+		frmivalenum->discrete	= fake->timeperframe;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_check_v4l2_dev_status(const struct v4l2_capture *dev,
+	int *status)
+{
+	struct fake_capture		*fake		= NULL;
+	int				ret		= 0;
+
+	fake = fake_get(dev);
+	if (fake == NULL) {
+		ret = -1;
+	} else {
+		/* 1 if the path is working */
+		*status = ((fake->is_streaming == 1U) && (fake_is_source_lost(fake) == 0U)) ? 1 : 0;
+	}
+
+	return ret;
+}
+
+int v4l2_capture_g_lastframe_addrs(const struct v4l2_capture *dev,
+	unsigned int *addrs)
+{
+	(void)addrs;
+
+	return (fake_get(dev) == NULL) ? -1 : 0;
+}
+
+int v4l2_capture_create_lastframe(const struct v4l2_capture *dev,
+	unsigned int *addrs)
+{
+	(void)addrs;
+
+	return (fake_get(dev) == NULL) ? -1 : 0;
+}
+
+int v4l2_capture_s_handover(const struct v4l2_capture *dev,
+	int *handover)
+{
+	(void)handover;
+
+	return (fake_get(dev) == NULL) ? -1 : 0;
+}
+
+int v4l2_capture_s_lut(const struct v4l2_capture *dev,
+	struct vin_lut *lut)
+{
+	(void)lut;
+
+	return (fake_get(dev) == NULL) ? -1 : 0;
+}
+
+int v4l2_capture_poll(const struct v4l2_capture *dev, int event, int timeout)
+{
+	struct pollfd			pfd;
+	int				ret		= 0;
+
+	if (fake_get(dev) == NULL) {
+		ret = -1;
+	} else {
+		/* set pfd */
+		(void)memset((void *)&pfd, 0, sizeof(pfd));
+		pfd.fd		= dev->fd;
+		pfd.events	= u32_to_s16(event);
+
+		ret = poll(&pfd, 1, timeout);
+		if (ret > 0) {
+			/* return revents */
+			ret = (int)pfd.revents;
+		}
+	}
+
+	return ret;
+}
+
+void *v4l2_capture_mmap(const struct v4l2_capture *dev, size_t length, unsigned int offset)
+{
+	struct fake_capture		*fake		= NULL;
+	unsigned int			cookie		= 0;
+	unsigned int			idxBuf		= 0;
+	unsigned int			idxpln		= 0;
+	void				*addr		= MAP_FAILED;
+
+	fake = fake_get(dev);
+	if (fake != NULL) {
+		cookie	= offset / FAKE_OFFSET_UNIT;
+		idxBuf	= cookie / (unsigned int)VIDEO_MAX_PLANES;
+		idxpln	= cookie % (unsigned int)VIDEO_MAX_PLANES;
+		if ((idxBuf < fake->n_buffers) && (fake->buffers[idxBuf].memfd[idxpln] > 0)) {
+			/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+			addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+				fake->buffers[idxBuf].memfd[idxpln], 0);
+		} else {
+			/* no such plane */
+			errno = EINVAL;
+		}
+	}
+
+	return addr;
+}
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "v4l2_replay.h"
+
+/* map a frame dump and check its header, NULL if it is not one */
+static const unsigned char *v4l2_replay_map_dump(const char *path, size_t *size)
+{
+	const struct frame_dump_header	*header		= NULL;
+	const unsigned char		*ret		= NULL;
+	struct stat			st;
+	void				*base		= MAP_FAILED;
+	uint64_t			length		= 0;
+	unsigned int			idx		= 0;
+	int				fd		= -1;
+
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if ((fd >= 0) && (fstat(fd, &st) == 0) &&
+	    ((size_t)st.st_size >= sizeof(struct frame_dump_header))) {
+		/* the pages are read in now, not while the frames are replayed */
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+	}
+	if (fd >= 0) {
+		/* the mapping keeps the file */
+		(void)close(fd);
+	}
+
+	if (base != MAP_FAILED) {
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		header = (const struct frame_dump_header *)base;
+		length = sizeof(*header);
+		for (idx = 0; (idx < header->n_planes) && (idx < FRAME_DUMP_MAX_PLANES); idx++) {
+			/* the planes follow the header */
+			length += header->sizes[idx];
+		}
+
+		if ((header->magic != FRAME_DUMP_MAGIC) ||
+		    (header->header_size != (uint16_t)sizeof(*header)) ||
+		    (header->n_planes > FRAME_DUMP_MAX_PLANES) ||
+		    (length > (uint64_t)st.st_size)) {
+			loge("%s is not a frame dump\n", path);
+			(void)munmap(base, (size_t)st.st_size);
+		} else {
+			/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+			ret	= (const unsigned char *)base;
+			*size	= (size_t)st.st_size;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * map video_capture.0, video_capture.1, ... until one is missing. The path
+ * is not a format: the index is put in place of its only "%u", and any
+ * other '%' is a part of the name.
+ */
+static int v4l2_replay_open_dumps(struct v4l2_replay *replay, const char *path)
+{
+	struct v4l2_replay_dump		*dump		= NULL;
+	const char			*index		= NULL;
+	char				name[256]	= "";
+	unsigned int			idx		= 0;
+	int				ret		= 0;
+
+	index = strstr(path, "%u");
+	if (index == NULL) {
+		/* one frame */
+		dump = &replay->dumps[0];
+		dump->base = v4l2_replay_map_dump(path, &dump->size);
+		replay->n_frames = (dump->base != NULL) ? 1U : 0U;
+	} else if (strstr(&index[2], "%u") != NULL) {
+		/* which one is the index */
+		loge("%s has more than one %%u\n", path);
+	} else {
+		for (idx = 0; idx < V4L2_REPLAY_MAX_DUMPS; idx++) {
+			/* coverity[misra_c_2012_rule_18_2_violation : FALSE] */
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			ret = snprintf(name, sizeof(name), "%.*s%u%s", (int)(index - path), path,
+				idx, &index[2]);
+			if ((ret < 0) || ((size_t)ret >= sizeof(name)) || (access(name, R_OK) != 0)) {
+				/* the end of the dumps */
+				break;
+			}
+
+			dump = &replay->dumps[idx];
+			dump->base = v4l2_replay_map_dump(name, &dump->size);
+			if (dump->base == NULL) {
+				/* a file of something else ends the dumps too */
+				break;
+			}
+			replay->n_frames = idx + 1U;
+		}
+	}
+
+	return (replay->n_frames > 0U) ? 0 : -1;
+}
+
+/**
+ * @brief Map the frames to replay
+ *
+ * @param path a recording, a frame dump, or a pattern of frame dumps such
+ * as "video_capture.%u"
+ * @return 0 on success, -1 if there is no frame to replay
+ */
+int v4l2_replay_open(struct v4l2_replay *replay, const char *path)
+{
+	int				ret		= 0;
+
+	(void)memset(replay, 0, sizeof(*replay));
+
+	if ((strstr(path, "%u") == NULL) && (frame_record_map_file(&replay->record, path) == 0)) {
+		replay->is_record	= 1;
+		replay->n_frames	= replay->record.header->n_frames;
+		/* coverity[misra_c_2012_rule_11_8_violation : FALSE] */
+		(void)madvise((void *)replay->record.base, replay->record.size, MADV_WILLNEED);
+		ret = (replay->n_frames > 0U) ? 0 : -1;
+	} else {
+		ret = v4l2_replay_open_dumps(replay, path);
+	}
+
+	if (ret < 0) {
+		loge("no frame to replay in %s\n", path);
+		v4l2_replay_close(replay);
+	} else {
+		logi("replay: %u frames from %s\n", replay->n_frames, path);
+	}
+
+	return ret;
+}
+
+void v4l2_replay_close(struct v4l2_replay *replay)
+{
+	unsigned int			idx		= 0;
+
+	if (replay->is_record == 1U) {
+		/* a recording */
+		frame_record_unmap(&replay->record);
+	} else {
+		for (idx = 0; idx < replay->n_frames; idx++) {
+			/* coverity[misra_c_2012_rule_11_8_violation : FALSE] */
+			(void)munmap((void *)replay->dumps[idx].base, replay->dumps[idx].size);
+		}
+	}
+
+	(void)memset(replay, 0, sizeof(*replay));
+}
+
+/**
+ * @brief Look a frame up by its position
+ *
+ * @return the planes of the frame one after another, or NULL if idx is out
+ * of the frames
+ */
+const unsigned char *v4l2_replay_get_frame(const struct v4l2_replay *replay,
+	unsigned int idx, const struct frame_dump_header **header)
+{
+	const struct frame_record_entry	*entry		= NULL;
+	const unsigned char		*ret		= NULL;
+
+	if (idx >= replay->n_frames) {
+		/* out of the frames */
+		logd("frame(%u) is out of %u frames\n", idx, replay->n_frames);
+	} else if (replay->is_record == 1U) {
+		/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+		ret = (const unsigned char *)frame_record_get_frame(&replay->record, idx, &entry);
+		if (ret != NULL) {
+			/* the index has the header */
+			*header = &entry->frame;
+		}
+	} else {
+		/* coverity[misra_c_2012_rule_11_3_violation : FALSE] */
+		*header	= (const struct frame_dump_header *)replay->dumps[idx].base;
+		ret	= &replay->dumps[idx].base[sizeof(struct frame_dump_header)];
+	}
+
+	return ret;
+}
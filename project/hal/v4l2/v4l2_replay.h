@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) Telechips Inc.
+ */
+
+#ifndef V4L2_REPLAY_H
+#define V4L2_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "frame_dump.h"
+#include "frame_record.h"
+
+/* the dump files which a pattern of paths can map */
+#define V4L2_REPLAY_MAX_DUMPS		(1024U)
+
+struct v4l2_replay_dump {
+	const unsigned char		*base;
+	size_t				size;
+};
+
+/*
+ * recorded frames to be fed to the emulated capture device, from a
+ * recording, from a frame dump, or from the dumps of a pattern with "%u" in
+ * it. Everything is mapped read-only and prefetched when it is opened, so
+ * looking a frame up does not read the storage.
+ */
+struct v4l2_replay {
+	unsigned int			is_record;
+	struct frame_record_map		record;
+	struct v4l2_replay_dump		dumps[V4L2_REPLAY_MAX_DUMPS];
+	unsigned int			n_frames;
+};
+
+extern int v4l2_replay_open(struct v4l2_replay *replay, const char *path);
+extern void v4l2_replay_close(struct v4l2_replay *replay);
+extern const unsigned char *v4l2_replay_get_frame(const struct v4l2_replay *replay,
+	unsigned int idx, const struct frame_dump_header **header);
+
+#endif//V4L2_REPLAY_H
@@ -14,17 +14,26 @@
 #include <signal.h>
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 
 #include "log.h"
 #include "klog.h"
+#include "latency.h"
+#include "ioctl_trace.h"
 #include "v4l2.h"
 #include "switch.h"
 #include "cm4_manager.h"
 #include "camera.h"
 #include "basic_operation.h"
+#if defined(CAMERA_APP_SIM)
+#include "sim_bench.h"
+#endif//defined(CAMERA_APP_SIM)
 
 static struct camera	g_dev;
-static int32_t		is_suspended;
 static pthread_t	hndThread;
 
 static void help_msg(void)
@@ -34,10 +43,36 @@ static void help_msg(void)
 		"\n"
 		" --switch={decimal}: reverse switch device number\n"
 		"  . ex) --switch=0 or --switch=1\n"
+		" --switch_gpio_chip={decimal}: gpio chip of the reverse switch (gpio character device)\n"
+		"  . the line events are read from $SWITCH_GPIO_EVENT_SOURCE if it is set,\n"
+		"    and an event of timestamp 0 is stamped when it is read\n"
+		"  . ex) --switch_gpio_chip=0\n"
+		" --switch_gpio_line={decimal}: gpio line offset of the reverse switch\n"
+		"  . ex) --switch_gpio_line=12\n"
+		" --switch_active_low={decimal}: the reverse switch is active low\n"
+		"  . ex) --switch_active_low=1\n"
+		" --switch_debounce_ms={decimal}: debounce window of the reverse switch\n"
+		"  . ex) --switch_debounce_ms=20\n"
 		" --videoinput={decimal}: video-input path(v4l2 capture) device number\n"
 		"  . ex) --videoinput=0\n"
 		" --capture={decimal}: set the number of frames to write into files\n"
 		"  . ex) --capture=3\n"
+		" --capture_record={decimal}: write the frames to capture into one recording\n"
+		"  . options\n"
+		"   + 0: write each frame into video_capture.N\n"
+		"   + 1: append the frames to video_capture.rec with an index to look them up\n"
+		"  . ex) --capture_record=1\n"
+		" --record_budget_mb={decimal}: memory of the ring keeping the last frames for the record commands\n"
+		"  . options\n"
+		"   + 0: disable the record commands\n"
+		"   + N: keep as many frames as N MiB holds\n"
+		"  . ex) --record_budget_mb=256\n"
+		"  . the 'snapshot' command persists the pre-roll and the post-roll into video_record.N.rec\n"
+		"  . the 'rec_start' and 'rec_stop' commands persist the pre-roll, the frames in between and the post-roll\n"
+		" --record_preroll_ms={decimal}: time before a record command to persist (default is 3000)\n"
+		"  . ex) --record_preroll_ms=5000\n"
+		" --record_postroll_ms={decimal}: time after a record command to persist (default is 2000)\n"
+		"  . ex) --record_postroll_ms=1000\n"
 		" --compose_flags={decimal}: composition flag (refer to v4l2 selection flag)\n"
 		"  . ex) --compose_flags=0\n"
 		" --compose_posx={decimal}: x axis of composition\n"
@@ -66,6 +101,23 @@ static void help_msg(void)
 		"  . ex) --preview_height=480\n"
 		" --preview_format={string}: preview format\n"
 		"  . ex) --preview_format=rgb32\n"
+		" --display_format={string}: format shown by display-output (default is the preview format)\n"
+		"  . the frames are converted by the cpu if it is not the preview format\n"
+		"    or by the job of G2D which rotates them\n"
+		"  . the cpu writes them into the pmap \"overlay_rot\", so camera_app must be built with\n"
+		"    libpmap: without it, they are always shown as captured\n"
+		"  . ex) --display_format=rgb32\n"
+		" --color_matrix={decimal}: color matrix of the yuv formats to convert\n"
+		"  . options\n"
+		"   + 0: BT.601\n"
+		"   + 1: BT.709\n"
+		"  . ex) --color_matrix=1\n"
+		" --color_range={decimal}: quantization range of the yuv formats to convert\n"
+		"  . options\n"
+		"   + 0: limited range\n"
+		"   + 1: full range\n"
+		"  . ex) --color_range=1\n"
+		"  . the throughput of every conversion is dumped as json by the 'colorconv' command\n"
 		" --preview_method={decimal}: preview method (supported in the telechips's customized v4l2 standard)\n"
 		"  . options\n"
 		"   + 0: v4l2 buffer switching method\n"
@@ -75,11 +127,32 @@ static void help_msg(void)
 		"  . options\n"
 		"   + degree: 0, 90, 180, 270\n"
 		"  . ex) --preview_rot=90\n"
+		"  . the frames are rotated by the cpu if G2D is not available,\n"
+		"    which needs libpmap as --display_format does\n"
+		"  . the throughput of every rotation is dumped as json by the 'rotate' command\n"
+		"  . the latency and the bandwidth of G2D in every format are dumped as json by the 'g2d' command\n"
+		"    while preview is stopped, and the passes over the memory of the rotation and the\n"
+		"    conversion of the preview between every two formats in any case\n"
+		" --preview_mirror={decimal}: preview mirror, after the rotation (done by the cpu)\n"
+		"  . options\n"
+		"   + 0: no mirror\n"
+		"   + 1: horizontal mirror\n"
+		"   + 2: vertical mirror\n"
+		"  . ex) --preview_mirror=1\n"
 		" --io-mode={string}: v4l2 memory allocation method\n"
 		"  . options\n"
 		"   + mmap: memory allocated in v4l2-capture driver\n"
-		"   + userptr: memory allocated in user space\n"
-		"  . ex) --io-mode=0 or --io-mode=1\n"
+		"   + userptr: memory allocated in user space (one prefaulted and locked arena)\n"
+		"   + dmabuf: memory allocated in v4l2-capture driver and exported as dma-buf fds\n"
+		"  . the values of enum v4l2_memory are taken as well: 1 (mmap), 2 (userptr), 4 (dmabuf)\n"
+		"  . ex) --io-mode=mmap or --io-mode=dmabuf\n"
+		" --export_frames={decimal}: hand the frames to another process as dma-buf fds\n"
+		"  . options\n"
+		"   + 0: do not export the frames\n"
+		"   + 1: send the frames to the client of /tmp/camera_app_frames.sock (dmabuf io-mode only)\n"
+		"  . a frame is sent as its frame dump header with the fds of its planes attached,\n"
+		"    and its buffer is requeued once the client sends the sequence of the header back\n"
+		"  . ex) --export_frames=1\n"
 		" --videooutput={decimal}: display-output path device number\n"
 		"  . ex) --videooutput=0\n"
 		" --foreground_ovp={decimal}: foreground ovp of display-output path's wmixer\n"
@@ -96,6 +169,16 @@ static void help_msg(void)
 		"   + 0: ignore to recovery\n"
 		"   + 1: recovery video-input path if it's not working\n"
 		"  . ex) --recovery=0\n"
+		" --frozen_frames={decimal}: frames in a row with the same content which make the feed frozen\n"
+		"  . options\n"
+		"   + 0: do not check if the feed is frozen\n"
+		"   + N: report the feed as frozen after N repeated frames\n"
+		"  . ex) --frozen_frames=60\n"
+		" --frozen_recovery={decimal}: recover the video-input path when the feed is frozen\n"
+		"  . options\n"
+		"   + 0: only report the frozen feed\n"
+		"   + 1: restart the video-input path\n"
+		"  . ex) --frozen_recovery=1\n"
 		" --use_cm4={decimal}: ignore to recovery video-input path\n"
 		"  . options\n"
 		"   + 0: use not cm4\n"
@@ -106,6 +189,31 @@ static void help_msg(void)
 		"   + 0: show boot profile\n"
 		"   + 1: hide boot profile\n"
 		"  . ex) --boot_profile=1\n"
+		"  . the boot timeline is dumped as chrome trace json by the 'profile' command\n"
+		"  . the reverse latency is dumped as json by the 'latency' command\n"
+		"  . the ioctl statistics are dumped as json by the 'ioctl' command\n"
+#if defined(CAMERA_APP_SIM)
+		"  . the round trips of the command queue and of pipes are dumped as json by the 'msgq' command\n"
+#endif//defined(CAMERA_APP_SIM)
+		" --buffer_pool={decimal}: keep the video-input buffers across stop/start preview\n"
+		"  . options\n"
+		"   + 0: allocate the buffers whenever starting preview\n"
+		"   + 1: keep the buffers allocated and mapped while the format is not changed\n"
+		"  . ex) --buffer_pool=1\n"
+		" --standby={decimal}: keep the video-input path streaming while preview is hidden\n"
+		"  . options\n"
+		"   + 0: start and stop streaming with preview\n"
+		"   + 1: stream from handover and only show or hide the video-output path\n"
+		"  . ex) --standby=1\n"
+		" --userptr_hugepage={decimal}: back the userptr io-mode buffers with hugepages\n"
+		"  . options\n"
+		"   + 0: use normal pages\n"
+		"   + 1: use hugetlb pages if reserved, or transparent hugepages\n"
+		"  . ex) --userptr_hugepage=1\n"
+#if defined(CAMERA_APP_SIM)
+		"  . the page faults and the copy throughput of the frames of the mmap and the\n"
+		"    userptr io-modes are dumped as json by the 'userptr' command\n"
+#endif//defined(CAMERA_APP_SIM)
 		"\n\n");
 }
 
@@ -113,7 +221,7 @@ static void help_msg(void)
  * According to MISRA2012 ruleset, we need to avoid dynamic memory allocation
  * using heap.
  */
-#define NUM_OPTIONS 30
+#define NUM_OPTIONS 48
 
 /*
  * According to MISRA2012 ruleset, the object pointer must be matched or cast,
@@ -124,8 +232,16 @@ static int32_t parse_args(int32_t argc, char * const argv[], struct camera *dev)
 	const struct option		long_options[NUM_OPTIONS] = {
 		// long-name,		name,			variable,			short-name or init-val
 		{"switch",		required_argument,	&dev->sw.id,			0},
+		{"switch_gpio_chip",	required_argument,	&dev->sw.gpio_chip,		0},
+		{"switch_gpio_line",	required_argument,	&dev->sw.gpio_line,		0},
+		{"switch_active_low",	required_argument,	&dev->sw.active_low,		0},
+		{"switch_debounce_ms",	required_argument,	&dev->sw.debounce_ms,		0},
 		{"videoinput",		required_argument,	&dev->vin.capture.id,		0},
 		{"capture",		required_argument,	&dev->cnt_to_capture,		0},
+		{"capture_record",	required_argument,	&dev->capture_record,		0},
+		{"record_budget_mb",	required_argument,	&dev->record_budget_mb,		0},
+		{"record_preroll_ms",	required_argument,	&dev->record_preroll_ms,	0},
+		{"record_postroll_ms",	required_argument,	&dev->record_postroll_ms,	0},
 		{"compose_flags",	required_argument,	&dev->vin.comp_flags,		0},
 		{"compose_posx",	required_argument,	&dev->vin.comp.left,		0},
 		{"compose_posy",	required_argument,	&dev->vin.comp.top,		0},
@@ -136,21 +252,31 @@ static int32_t parse_args(int32_t argc, char * const argv[], struct camera *dev)
 		{"crop_width",		required_argument,	&dev->vin.crop.width,		0},
 		{"crop_height",		required_argument,	&dev->vin.crop.height,		0},
 		{"io-mode",		required_argument,	&dev->vin.io_mode,		0},
+		{"export_frames",	required_argument,	&dev->export_frames,		0},
 		{"preview_posx",	required_argument,	&dev->preview_posx,		0},
 		{"preview_posy",	required_argument,	&dev->preview_posy,		0},
 		{"preview_width",	required_argument,	&dev->preview_width,		0},
 		{"preview_height",	required_argument,	&dev->preview_height,		0},
 		{"preview_format",	required_argument,	&dev->preview_format,		0},
+		{"display_format",	required_argument,	&dev->display_format,		0},
+		{"color_matrix",	required_argument,	&dev->color_matrix,		0},
+		{"color_range",		required_argument,	&dev->color_range,		0},
 		{"preview_method",	required_argument,	&dev->preview_method,		0},
 		{"preview_rot",		required_argument,	&dev->preview_rot,		0},
+		{"preview_mirror",	required_argument,	&dev->preview_mirror,		0},
 		{"videooutput",		required_argument,	&dev->vout.ovl.id,		0},
 		{"application_mode",	required_argument,	&dev->application_mode,		0},
 		{"foreground_ovp",	required_argument,	&dev->vout.ovl.wmix_fovp,	0},
 		{"background_ovp",	required_argument,	&dev->vout.ovl.wmix_bovp,	0},
 		{"ignore_ovp",		required_argument,	&dev->vout.ignore_ovp,		0},
 		{"recovery",		required_argument,	&dev->recovery,			0},
+		{"frozen_frames",	required_argument,	&dev->frozen.window,		0},
+		{"frozen_recovery",	required_argument,	&dev->frozen_recovery,		0},
 		{"use_cm4",		required_argument,	&dev->use_cm4,			0},
 		{"boot_profile",	required_argument,	&g_log_level,			0},
+		{"buffer_pool",		required_argument,	&dev->vin.pool.enable,		0},
+		{"standby",		required_argument,	&dev->standby,			0},
+		{"userptr_hugepage",	required_argument,	&dev->vin.use_hugepage,		0},
 		{NULL,			0,			NULL,				0},
 		{NULL,			0,			NULL,				0},
 	};
@@ -169,8 +295,18 @@ static int32_t parse_args(int32_t argc, char * const argv[], struct camera *dev)
 			break;
 		} else {
 			uint32_t u_opt_idx = s32_to_u32(option_index);
-			if (strcmp(long_options[u_opt_idx].name, "preview_format") == 0) {
+			if ((strcmp(long_options[u_opt_idx].name, "preview_format") == 0) ||
+			    (strcmp(long_options[u_opt_idx].name, "display_format") == 0)) {
 				*long_options[u_opt_idx].flag = u32_to_s32(v4l2_get_v4l2_format_by_name(optarg));
+			} else if (strcmp(long_options[u_opt_idx].name, "io-mode") == 0) {
+				*long_options[u_opt_idx].flag = u32_to_s32(v4l2_get_v4l2_memory_by_name(optarg));
+				if (*long_options[u_opt_idx].flag == 0) {
+					loge("io-mode(%s) is wrong\n", optarg);
+					/* coverity[misra_c_2012_rule_2_2_violation : FALSE] */
+					help_msg();
+					ret = -1;
+					break;
+				}
 			} else {
 				/* coverity[cert_err34_c_violation : FALSE] */
 				/* coverity[misra_c_2012_rule_21_7_violation : FALSE] */
@@ -179,6 +315,11 @@ static int32_t parse_args(int32_t argc, char * const argv[], struct camera *dev)
 		}
 	}
 
+	if (dev->preview_mirror >= (uint32_t)FRAME_ROTATE_MIRROR_MAX) {
+		loge("preview_mirror(%u) is wrong\n", dev->preview_mirror);
+		ret = -1;
+	}
+
 #if defined(USE_G2D)
 	/*
 	 *	In case of 90 or 270 rotation
@@ -213,172 +354,527 @@ static int32_t parse_args(int32_t argc, char * const argv[], struct camera *dev)
 		ret = -1;
 		break;
 	}
+#else
+	if ((dev->preview_rot != 0U) && (dev->preview_rot != 90U) &&
+	    (dev->preview_rot != 180U) && (dev->preview_rot != 270U)) {
+		loge("preview_rot(%u) is wrong\n", dev->preview_rot);
+		ret = -1;
+	}
 #endif//defined(USE_G2D)
 
 	return ret;
 }
 
-static void doOnStatus(const void *data)
+/*
+ * The preview state which is requested to the camera thread is not known
+ * until the first command is sent.
+ */
+#define PREVIEW_STATE_UNKNOWN		(2U)
+
+/* the switch is polled in this interval if its device can not be waited on */
+#define SWITCH_POLL_INTERVAL_MS		(10)
+#define SUPERVISOR_MAX_EVENTS		(6)
+
+enum supervisor_source {
+	SUPERVISOR_SOURCE_STDIN,
+	SUPERVISOR_SOURCE_SWITCH,
+	SUPERVISOR_SOURCE_SWITCH_TIMER,
+	SUPERVISOR_SOURCE_DEBOUNCE,
+	SUPERVISOR_SOURCE_SIGNAL,
+	SUPERVISOR_SOURCE_ACK,
+};
+
+struct supervisor {
+	int				epoll_fd;
+	int				signal_fd;
+	int				timer_fd;
+	/* expires when the debounce window of the switch is over */
+	int				debounce_fd;
+
+	/* preview state which is wanted, and which is requested last */
+	unsigned int			want_preview;
+	unsigned int			req_preview;
+	/* a command is sent and its ack is not received yet */
+	unsigned int			is_busy;
+
+	unsigned int			is_suspended;
+	unsigned int			is_quitting;
+	unsigned int			is_running;
+
+	/* when the last switch edge occurs, in CLOCK_MONOTONIC */
+	uint64_t			edge_ns;
+	unsigned int			is_edge_pending;
+};
+
+static struct supervisor	g_sv;
+
+static int32_t supervisor_add_source(const struct supervisor *sv, int32_t fd,
+	uint32_t source)
 {
-	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
-	const struct camera		*dev		=
-		(const struct camera *)data;
+	struct epoll_event		event		= { 0, };
 	int32_t				ret		= 0;
 
-	if (dev == NULL) {
-		loge("dev is NULL\n");
-		ret = -1;
-	} else {
-		ret = camera_start_preview(dev);
-	}
+	(void)memset((void *)&event, 0, sizeof(event));
 
+	event.events	= (uint32_t)EPOLLIN;
+	event.data.u32	= source;
+
+	ret = epoll_ctl(sv->epoll_fd, EPOLL_CTL_ADD, fd, &event);
 	if (ret < 0) {
-		loge("Failed on doOnStatus\n");
+		logd("epoll_ctl(ADD, %d), errno: %d\n", fd, errno);
+		ret = -1;
 	}
+
+	return ret;
 }
 
-static void doOffStatus(const void *data)
+/*
+ * Only one command is in flight. The edges which come while it is handled
+ * are coalesced into want_preview and sent after its ack.
+ */
+static void supervisor_dispatch(const struct camera *dev, struct supervisor *sv)
 {
-	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
-	const struct camera		*dev		=
-		(const struct camera *)data;
 	int32_t				ret		= 0;
 
-	if (dev == NULL) {
-		loge("dev is NULL\n");
-		ret = -1;
+	if (sv->is_busy == 1U) {
+		/* wait for the ack */
+		logd("a command is in flight\n");
+	} else if ((sv->want_preview != PREVIEW_STATE_UNKNOWN) &&
+		   (sv->want_preview != sv->req_preview)) {
+		ret = camera_request_preview(dev, sv->want_preview);
+		if (ret < 0) {
+			loge("camera_request_preview, ret: %d\n", ret);
+		} else {
+			sv->req_preview	= sv->want_preview;
+			sv->is_busy	= 1;
+		}
+	} else if (sv->is_quitting == 1U) {
+		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+		logi("terminated\n");
+		sv->is_running = 0;
+	} else if ((sv->is_suspended == 1U) && (sv->req_preview == 0U)) {
+		/* preview is stopped, so stop the process */
+		ret = raise(SIGSTOP);
+		if (ret != 0) {
+			loge("Failed on raise SIGSTOP\n");
+		}
 	} else {
-		ret = camera_stop_preview(dev);
+		/* nothing to do */
+		logd("preview: %u\n", sv->req_preview);
 	}
+}
 
-	if (ret < 0) {
-		loge("Failed on doOffStatus\n");
+static void supervisor_apply_switch(const struct camera *dev, struct supervisor *sv,
+	const struct switch_event *ev)
+{
+	if (sv->is_suspended == 0U) {
+		logd("sw state: %d\n", ev->state);
+		sv->want_preview	= (ev->state > 0) ? 1U : 0U;
+		if (sv->want_preview == 1U) {
+			/* engage */
+			latency_begin(ev->timestamp_ns);
+		}
+
+		/* the timestamp of the edge is the start of the latency */
+		sv->edge_ns		= ev->timestamp_ns;
+		sv->is_edge_pending	= 1;
+
+		supervisor_dispatch(dev, sv);
+	}
+}
+
+/*
+ * The window ends debounce_ms after the edge which is taken, so the bounces
+ * after it do not put the confirmation off. The edges are timestamped with
+ * CLOCK_MONOTONIC, the clock of the timer, and a window already over fires
+ * at once.
+ */
+static void supervisor_arm_debounce(const struct camera *dev, const struct supervisor *sv)
+{
+	struct itimerspec		its		= { 0, };
+	uint64_t			end_ns		= 0;
+
+	end_ns = dev->sw.last_edge_ns + ((uint64_t)dev->sw.debounce_ms * 1000000ULL);
+
+	(void)memset((void *)&its, 0, sizeof(its));
+	its.it_value.tv_sec	= (time_t)(end_ns / 1000000000ULL);
+	its.it_value.tv_nsec	= (long)(end_ns % 1000000000ULL);
+
+	if (timerfd_settime(sv->debounce_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		/* error */
+		loge("timerfd_settime, errno: %d\n", errno);
 	}
 }
 
-static void signal_handler(int sig)
+static void supervisor_handle_switch(struct camera *dev, struct supervisor *sv)
 {
-	/* coverity[cert_sig31_c_violation : FALSE] */
-	const struct camera		*dev		= &g_dev;
-	int32_t				ret;
-
-	logi("Get Signal %d\n", sig);
-	switch (sig) {
-	case SIGTSTP:
-		logi("SIGTSTP\n");
-		is_suspended = 1;
-		/* coverity[cert_sig30_c_violation : FALSE] */
-		ret = camera_stop_preview(dev);
-		if (ret != 0) {
-			loge("Failed on camera_stop_preview\n");
-		}
-		/* coverity[cert_sig30_c_violation : FALSE] */
-		ret = raise(SIGSTOP);
-		if (ret != 0) {
-			loge("Failed on raise SIGSTOP\n");
+	struct switch_event		ev		= { 0, };
+
+	if (switch_read_event(&dev->sw, &ev) == 1) {
+		/* the debounced state is changed */
+		supervisor_apply_switch(dev, sv, &ev);
+	}
+
+	if (dev->sw.is_confirm_needed == 1U) {
+		/* the window of the edge taken */
+		supervisor_arm_debounce(dev, sv);
+	}
+}
+
+static void supervisor_handle_debounce(struct camera *dev, struct supervisor *sv)
+{
+	struct switch_event		ev		= { 0, };
+	uint64_t			expirations	= 0;
+
+	if (read(sv->debounce_fd, &expirations, sizeof(expirations)) > 0) {
+		if (switch_confirm_state(&dev->sw, &ev) == 1) {
+			/* the last bounce left the switch in the other state */
+			supervisor_apply_switch(dev, sv, &ev);
 		}
-		break;
-	case SIGCONT:
-		is_suspended = 0;
-		break;
-	default:
-		loge("signal is wrong\n");
-		break;
 	}
 }
 
-static int32_t process_command(const void *data, const char *cmdline)
+static void supervisor_handle_switch_timer(struct camera *dev, struct supervisor *sv)
 {
+	uint64_t			expirations	= 0;
+
+	if (read(sv->timer_fd, &expirations, sizeof(expirations)) > 0) {
+		/* poll the switch */
+		supervisor_handle_switch(dev, sv);
+	}
+}
+
+/* the benchmark takes seconds, so it runs aside not to hold the switch up */
+static atomic_uint	g_is_benchmarking;
+
+static void *threadColorconvBench(void *param)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const struct camera		*dev		= (const struct camera *)param;
+
+	(void)colorconv_dump_bench(COLORCONV_BENCH_PATH, dev->preview_width, dev->preview_height);
+	atomic_store(&g_is_benchmarking, 0U);
+
+	return NULL;
+}
+
+static void *threadRotateBench(void *param)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const struct camera		*dev		= (const struct camera *)param;
+
+	(void)frame_rotate_dump_bench(FRAME_ROTATE_BENCH_PATH, dev->preview_width,
+		dev->preview_height);
+	atomic_store(&g_is_benchmarking, 0U);
+
+	return NULL;
+}
+
+#if defined(CAMERA_APP_SIM)
+static void *threadUserptrBench(void *param)
+{
+	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
+	const struct camera		*dev		= (const struct camera *)param;
+
+	(void)frame_arena_dump_bench(FRAME_ARENA_BENCH_PATH, dev->preview_width,
+		dev->preview_height);
+	atomic_store(&g_is_benchmarking, 0U);
+
+	return NULL;
+}
+
+static void *threadMessageQueueBench(void *param)
+{
+	(void)param;
+
+	(void)message_queue_dump_bench(MESSAGE_QUEUE_BENCH_PATH);
+	atomic_store(&g_is_benchmarking, 0U);
+
+	return NULL;
+}
+#endif//defined(CAMERA_APP_SIM)
+
+static void start_bench(const struct camera *dev, void *(*bench)(void *))
+{
+	pthread_t			thread;
 	int32_t				ret		= 0;
 
+	if (atomic_exchange(&g_is_benchmarking, 1U) == 1U) {
+		/* one at a time */
+		logw("the benchmark is running\n");
+	} else {
+		/* coverity[misra_c_2012_rule_11_8_violation : FALSE] */
+		ret = pthread_create(&thread, NULL, bench, (void *)dev);
+		if (ret != 0) {
+			loge("pthread_create, ret: %d\n", ret);
+			atomic_store(&g_is_benchmarking, 0U);
+		} else {
+			/* nobody joins it */
+			(void)pthread_detach(thread);
+		}
+	}
+}
+
+static void process_command(const struct camera *dev, struct supervisor *sv,
+	const char *cmdline)
+{
 	if (strncmp("start", cmdline, 5) == 0) {
-		doOnStatus(data);
+		sv->want_preview = 1;
+		latency_begin(0);
 	} else if (strncmp("stop", cmdline, 4) == 0) {
-		doOffStatus(data);
+		sv->want_preview = 0;
+	} else if (strncmp("snapshot", cmdline, 8) == 0) {
+		(void)camera_request_record(dev, FRAME_RING_TRIGGER_SNAPSHOT);
+	} else if (strncmp("rec_start", cmdline, 9) == 0) {
+		(void)camera_request_record(dev, FRAME_RING_TRIGGER_START);
+	} else if (strncmp("rec_stop", cmdline, 8) == 0) {
+		(void)camera_request_record(dev, FRAME_RING_TRIGGER_STOP);
+	} else if (strncmp("profile", cmdline, 7) == 0) {
+		(void)klog_dump_trace(KLOG_TRACE_PATH);
+	} else if (strncmp("latency", cmdline, 7) == 0) {
+		(void)latency_dump(LATENCY_DUMP_PATH);
+	} else if (strncmp("ioctl", cmdline, 5) == 0) {
+		(void)ioctl_trace_dump(IOCTL_TRACE_DUMP_PATH);
+	} else if (strncmp("g2d", cmdline, 3) == 0) {
+		(void)camera_request_g2d_bench(dev);
+	} else if (strncmp("colorconv", cmdline, 9) == 0) {
+		start_bench(dev, &threadColorconvBench);
+	} else if (strncmp("rotate", cmdline, 6) == 0) {
+		start_bench(dev, &threadRotateBench);
+#if defined(CAMERA_APP_SIM)
+	} else if (strncmp("userptr", cmdline, 7) == 0) {
+		start_bench(dev, &threadUserptrBench);
+	} else if (strncmp("msgq", cmdline, 4) == 0) {
+		start_bench(dev, &threadMessageQueueBench);
+#endif//defined(CAMERA_APP_SIM)
 	} else if (strncmp("quit", cmdline, 4) == 0) {
-		doOffStatus(data);
-		ret = -1;
+		sv->want_preview = 0;
+		sv->is_quitting = 1;
 	} else {
 		loge("invalid input\n\n");
 	}
 
-	return ret;
+	supervisor_dispatch(dev, sv);
 }
 
-/* coverity[misra_c_2012_rule_8_13_violation : FALSE] */
-static void cleanup_switch_manager(void *data)
+static void supervisor_handle_stdin(const struct camera *dev, struct supervisor *sv)
 {
-	char		cmdline[1024]	= "";
-	int32_t		ret		= 0;
+	char				cmdline[1024]	= "";
+	int32_t				ret		= 0;
 
-	while (true) {
-		/*
-		 * clear the command string
-		 */
-		(void)memset(cmdline, 0, sizeof(cmdline));
-
-		/*
-		 * read a command
-		 */
-		ret = s64_to_s32(read(STDIN_FILENO, cmdline, sizeof(cmdline)));
-		if (ret == 0) {
-			continue;
-		}
+	ret = s64_to_s32(read(STDIN_FILENO, cmdline, sizeof(cmdline) - 1U));
+	if (ret <= 0) {
+		/* stop waiting on the closed stdin not to spin on it */
+		(void)epoll_ctl(sv->epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+	} else {
+		process_command(dev, sv, cmdline);
+	}
+}
 
-		ret = process_command(data, cmdline);
-		if (ret < 0) {
-			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
-			logi("terminated\n");
+static void supervisor_handle_signal(struct camera *dev, struct supervisor *sv)
+{
+	struct signalfd_siginfo		info		= { 0, };
+
+	while (read(sv->signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+		logi("Get Signal %u\n", info.ssi_signo);
+		switch (info.ssi_signo) {
+		case (uint32_t)SIGTSTP:
+			/* stop preview, and then the process */
+			sv->is_suspended	= 1;
+			sv->want_preview	= 0;
+			break;
+		case (uint32_t)SIGCONT:
+			sv->is_suspended	= 0;
+			/* read the switch again */
+			dev->sw.state		= -1;
+			if (switch_is_enabled(&dev->sw) == 1) {
+				/* switch mode */
+				supervisor_handle_switch(dev, sv);
+			}
+			break;
+		case (uint32_t)SIGTERM:
+		case (uint32_t)SIGINT:
+			sv->want_preview	= 0;
+			sv->is_quitting		= 1;
+			break;
+		default:
+			loge("signal is wrong\n");
 			break;
 		}
+	}
+
+	supervisor_dispatch(dev, sv);
+}
+
+static void supervisor_handle_ack(const struct camera *dev, struct supervisor *sv)
+{
+	if (camera_receive_acks(dev) > 0) {
+		sv->is_busy = 0;
 
-		(void)usleep(100 * 1000);
+		if (sv->is_edge_pending == 1U) {
+			/* dumped by the 'latency' command */
+			latency_add_span((unsigned int)LATENCY_SPAN_SWITCH_EDGE_TO_ACK, sv->edge_ns);
+			sv->is_edge_pending = 0;
+		}
+
+		supervisor_dispatch(dev, sv);
 	}
 }
 
-/* coverity[misra_c_2012_rule_8_13_violation : FALSE] */
-static void detect_switch_changed(const struct camera *dev, void *data)
+static int32_t supervisor_watch_switch(const struct camera *dev, struct supervisor *sv)
 {
-	int32_t				sw_prev		= -1;
-	int32_t				sw_curr		= -1;
+	struct itimerspec		its		= { 0, };
+	int32_t				ret		= 0;
 
-	while (true) {
-		if (is_suspended == 1) {
-			/* coverity[assigned_value : FALSE] */
-			sw_prev = -1;
-			sw_curr = -1;
+	/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+	sv->debounce_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if ((sv->debounce_fd < 0) ||
+	    (supervisor_add_source(sv, sv->debounce_fd, (uint32_t)SUPERVISOR_SOURCE_DEBOUNCE) < 0)) {
+		loge("Failed to watch the debounce timer\n");
+	}
+
+	ret = supervisor_add_source(sv, dev->sw.fd, (uint32_t)SUPERVISOR_SOURCE_SWITCH);
+	if (ret < 0) {
+		/* the switch driver does not support poll */
+		logi("switch is polled every %d ms\n", SWITCH_POLL_INTERVAL_MS);
+
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		sv->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+		if (sv->timer_fd < 0) {
+			loge("timerfd_create, errno: %d\n", errno);
+			ret = -1;
 		} else {
-			sw_prev = sw_curr;
-			sw_curr = switch_get_state(&dev->sw);
-			if (sw_prev != sw_curr) {
-				if (sw_curr > 0) {
-					logd("sw state: %d -> %d\n",
-					     sw_prev, sw_curr);
-					doOnStatus(data);
-				} else {
-					logd("sw state: %d -> %d\n",
-					     sw_prev, sw_curr);
-					doOffStatus(data);
-				}
+			(void)memset((void *)&its, 0, sizeof(its));
+			its.it_value.tv_nsec	= (long)SWITCH_POLL_INTERVAL_MS * 1000L * 1000L;
+			its.it_interval		= its.it_value;
+
+			ret = timerfd_settime(sv->timer_fd, 0, &its, NULL);
+			if (ret == 0) {
+				ret = supervisor_add_source(sv, sv->timer_fd,
+					(uint32_t)SUPERVISOR_SOURCE_SWITCH_TIMER);
+			}
+		}
+	}
+
+	return ret;
+}
+
+static int32_t supervisor_open(const struct camera *dev, struct supervisor *sv)
+{
+	int32_t				ret		= 0;
+
+	sv->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (sv->epoll_fd < 0) {
+		loge("epoll_create1, errno: %d\n", errno);
+		ret = -1;
+	} else if ((supervisor_add_source(sv, sv->signal_fd,
+			(uint32_t)SUPERVISOR_SOURCE_SIGNAL) < 0) ||
+		   (supervisor_add_source(sv, camera_get_ack_fd(dev),
+			(uint32_t)SUPERVISOR_SOURCE_ACK) < 0)) {
+		loge("Failed to add event sources\n");
+		ret = -1;
+	} else {
+		if (supervisor_add_source(sv, STDIN_FILENO,
+				(uint32_t)SUPERVISOR_SOURCE_STDIN) < 0) {
+			/* run without commands */
+			logw("stdin can not be waited on\n");
+		}
+
+		if (switch_is_enabled(&dev->sw) == 1) {
+			/* switch mode */
+			ret = supervisor_watch_switch(dev, sv);
+		}
+	}
+
+	return ret;
+}
+
+static void supervisor_close(struct supervisor *sv)
+{
+	if (sv->timer_fd >= 0) {
+		/* close */
+		(void)close(sv->timer_fd);
+		sv->timer_fd = -1;
+	}
+
+	if (sv->debounce_fd >= 0) {
+		/* close */
+		(void)close(sv->debounce_fd);
+		sv->debounce_fd = -1;
+	}
+
+	if (sv->epoll_fd >= 0) {
+		/* close */
+		(void)close(sv->epoll_fd);
+		sv->epoll_fd = -1;
+	}
+}
+
+static void supervisor_run(struct camera *dev, struct supervisor *sv)
+{
+	struct epoll_event		events[SUPERVISOR_MAX_EVENTS];
+	int32_t				nevents		= 0;
+	int32_t				idx		= 0;
+
+	if (switch_is_enabled(&dev->sw) == 1) {
+		/* apply the current switch state */
+		supervisor_handle_switch(dev, sv);
+	}
+
+	while (sv->is_running == 1U) {
+		nevents = epoll_wait(sv->epoll_fd, events, SUPERVISOR_MAX_EVENTS, -1);
+		if (nevents < 0) {
+			if (errno != EINTR) {
+				/* error */
+				loge("epoll_wait, errno: %d\n", errno);
+			}
+			continue;
+		}
+
+		for (idx = 0; idx < nevents; idx++) {
+			switch (events[idx].data.u32) {
+			case (uint32_t)SUPERVISOR_SOURCE_STDIN:
+				supervisor_handle_stdin(dev, sv);
+				break;
+			case (uint32_t)SUPERVISOR_SOURCE_SWITCH:
+				supervisor_handle_switch(dev, sv);
+				break;
+			case (uint32_t)SUPERVISOR_SOURCE_SWITCH_TIMER:
+				supervisor_handle_switch_timer(dev, sv);
+				break;
+			case (uint32_t)SUPERVISOR_SOURCE_DEBOUNCE:
+				supervisor_handle_debounce(dev, sv);
+				break;
+			case (uint32_t)SUPERVISOR_SOURCE_SIGNAL:
+				supervisor_handle_signal(dev, sv);
+				break;
+			case (uint32_t)SUPERVISOR_SOURCE_ACK:
+				supervisor_handle_ack(dev, sv);
+				break;
+			default:
+				loge("event source(%u) is wrong\n", events[idx].data.u32);
+				break;
 			}
 		}
-		(void)usleep(100 * 1000);
 	}
 }
 
 static void *threadSwitchManager(void *data)
 {
 	/* coverity[misra_c_2012_rule_11_5_violation : FALSE] */
-	const struct camera		*dev		=
-		(const struct camera *)data;
-
+	struct camera			*dev		=
+		(struct camera *)data;
+	struct supervisor		*sv		= &g_sv;
 
-	if ((dev == NULL) || (dev->sw.id < 0)) {
-		cleanup_switch_manager(data);
+	if (supervisor_open(dev, sv) < 0) {
+		/* error */
+		loge("Failed to open the supervisor\n");
 	} else {
-		detect_switch_changed(dev, data);
+		supervisor_run(dev, sv);
 	}
 
+	supervisor_close(sv);
+
 	return NULL;
 }
 
@@ -411,28 +907,46 @@ static int32_t app_initialize(struct camera *dev)
 	return ret;
 }
 
+/*
+ * The signals are received by the signalfd of the supervisor, not by a
+ * handler, so they are blocked before any thread is created to be inherited.
+ */
 /* coverity[misra_c_2012_rule_8_13_violation : FALSE] */
 static int32_t app_reg_sighandler(struct camera *dev)
 {
+	sigset_t			mask;
 	int32_t				ret		= 0;
 
 	(void)dev;
 
-	// register signal handler
-	/* coverity[cert_int36_c_violation : FALSE] */
-	/* coverity[misra_c_2012_rule_11_1_violation : FALSE] */
-	if (signal(SIGTSTP, &signal_handler) == SIG_ERR) {
+	g_sv.epoll_fd		= -1;
+	g_sv.timer_fd		= -1;
+	g_sv.debounce_fd	= -1;
+	g_sv.want_preview	= PREVIEW_STATE_UNKNOWN;
+	g_sv.req_preview	= PREVIEW_STATE_UNKNOWN;
+	g_sv.is_running		= 1;
+
+	(void)sigemptyset(&mask);
+	(void)sigaddset(&mask, SIGTSTP);
+	(void)sigaddset(&mask, SIGCONT);
+	(void)sigaddset(&mask, SIGTERM);
+	(void)sigaddset(&mask, SIGINT);
+
+	ret = pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	if (ret != 0) {
 		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
-		loge("Failed on signal(SIGTSTP)\n");
-	}
-
-	/* coverity[cert_int36_c_violation : FALSE] */
-	if (signal(SIGCONT, &signal_handler) == SIG_ERR) {
-		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
-		loge("Failed on signal(SIGCONT)\n");
+		loge("Failed on pthread_sigmask, ret: %d\n", ret);
+		ret = -1;
+	} else {
+		/* coverity[misra_c_2012_rule_10_1_violation : FALSE] */
+		g_sv.signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+		if (g_sv.signal_fd < 0) {
+			/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
+			loge("Failed on signalfd, errno: %d\n", errno);
+			ret = -1;
+		}
 	}
 
-
 	return ret;
 }
 
@@ -443,7 +957,7 @@ static int32_t app_finalize(struct camera *dev)
 	// create & start
 	ret = pthread_create(&hndThread, NULL, &threadSwitchManager,
 			     (void *)dev);
-	if (ret < 0) {
+	if (ret != 0) {
 		/* coverity[misra_c_2012_rule_21_6_violation : FALSE] */
 		perror("ERROR: pthread_create");
 	} else {
@@ -454,14 +968,19 @@ static int32_t app_finalize(struct camera *dev)
 		}
 	}
 
+	(void)camera_destroy_camera_thread(dev);
+	camera_close_devices(dev);
+
+	(void)close(g_sv.signal_fd);
+
 	return ret;
 }
 
 #define NUM_INIT_FUNC	3
 
 static int32_t (*init_funcs[NUM_INIT_FUNC])(struct camera *dev) = {
-	app_initialize,
 	app_reg_sighandler,
+	app_initialize,
 	app_finalize
 };
 
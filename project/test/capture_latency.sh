@@ -0,0 +1,58 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Show the preview of camera_app_sim at 60 fps for a few seconds and check
+# how long a frame waits in the fake capture until it is dequeued: the
+# camera thread sleeps on the capture fd, so a frame is to be dequeued as
+# soon as it is done, not at the next tick of a fixed sleep.
+
+SIM=${SIM:-./camera_app_sim}
+# a frame period at 60 fps; the 16 ms sleep of a tick used to add up to it
+MAX_P99_US=${MAX_P99_US:-16666}
+MAX_P50_US=${MAX_P50_US:-2000}
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/stdin" || exit 1
+
+FAKE_VIN_FPS=60 FAKE_VIN_REPORT="$dir/report.json" "$SIM" --switch=-1 \
+	< "$dir/stdin" > "$dir/log" 2>&1 &
+pid=$!
+
+exec 3<> "$dir/stdin"
+sleep 1
+echo start >&3
+sleep 3
+echo stop >&3
+sleep 1
+echo quit >&3
+exec 3>&-
+wait "$pid"
+
+if [ ! -s "$dir/report.json" ]; then
+	echo "FAIL: no statistics are written by the fake capture"
+	cat "$dir/log"
+	exit 1
+fi
+cat "$dir/report.json"
+
+dequeued=$(sed -n 's/.*"dequeued": \([0-9]*\).*/\1/p' "$dir/report.json")
+p50=$(sed -n 's/.*"dqbuf_latency_us":.*"p50": \([0-9]*\).*/\1/p' "$dir/report.json")
+p99=$(sed -n 's/.*"dqbuf_latency_us":.*"p99": \([0-9]*\).*/\1/p' "$dir/report.json")
+
+rc=0
+if [ -z "$dequeued" ] || [ "$dequeued" -lt 60 ]; then
+	echo "FAIL: only '$dequeued' frames are dequeued"
+	rc=1
+fi
+if [ -z "$p50" ] || [ "$p50" -gt "$MAX_P50_US" ]; then
+	echo "FAIL: p50 of done to dequeued is '$p50' us, over $MAX_P50_US us"
+	rc=1
+fi
+if [ -z "$p99" ] || [ "$p99" -gt "$MAX_P99_US" ]; then
+	echo "FAIL: p99 of done to dequeued is '$p99' us, over $MAX_P99_US us"
+	rc=1
+fi
+
+[ "$rc" -eq 0 ] && echo "PASS: $dequeued frames, done to dequeued p50 $p50 us, p99 $p99 us"
+exit "$rc"
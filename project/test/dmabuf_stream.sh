@@ -0,0 +1,106 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Stream the preview of camera_app_sim with the dmabuf io-mode and take the
+# exported frames in another process: each frame is received as its header
+# with the dma-buf fds of its planes, which are mapped and checked against
+# the sizes of the header before the frame is given back.
+
+SIM=${SIM:-./camera_app_sim}
+PYTHON=${PYTHON:-python3}
+SOCK=/tmp/camera_app_frames.sock
+MIN_FRAMES=${MIN_FRAMES:-10}
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/stdin" || exit 1
+
+FAKE_VIN_FPS=60 FAKE_VIN_REPORT="$dir/report.json" "$SIM" --switch=-1 \
+	--io-mode=dmabuf --export_frames=1 < "$dir/stdin" > "$dir/log" 2>&1 &
+pid=$!
+
+exec 3<> "$dir/stdin"
+sleep 1
+echo start >&3
+sleep 1
+
+has_client=0
+if command -v "$PYTHON" > /dev/null 2>&1; then
+	has_client=1
+	"$PYTHON" - "$SOCK" > "$dir/client" 2>&1 <<'EOF'
+import array, mmap, os, socket, struct, sys, time
+
+HEADER = struct.Struct("<IHHIIIIIIQ3I3I")
+sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+for _ in range(50):
+    try:
+        sock.connect(sys.argv[1])
+        break
+    except OSError:
+        time.sleep(0.1)
+sock.settimeout(1.0)
+frames = bad = 0
+end = time.monotonic() + 2.0
+while time.monotonic() < end:
+    try:
+        data, anc, _, _ = sock.recvmsg(HEADER.size, socket.CMSG_SPACE(3 * 4))
+    except socket.timeout:
+        continue
+    if not data:
+        break
+    fds = array.array("i")
+    for level, kind, payload in anc:
+        if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+            fds.frombytes(payload[:len(payload) - len(payload) % 4])
+    h = HEADER.unpack(data)
+    n_planes, sequence, sizes = h[6], h[7], h[13:16]
+    if h[0] != 0x504d4446 or len(fds) != n_planes:
+        bad += 1
+    else:
+        for idx in range(n_planes):
+            if os.fstat(fds[idx]).st_size < sizes[idx]:
+                bad += 1
+                break
+            with mmap.mmap(fds[idx], sizes[idx], prot=mmap.PROT_READ) as m:
+                m[sizes[idx] - 1]
+    for fd in fds:
+        os.close(fd)
+    frames += 1
+    sock.send(struct.pack("<I", sequence))
+print("frames %d bad %d" % (frames, bad))
+EOF
+fi
+
+sleep 1
+echo stop >&3
+sleep 1
+echo quit >&3
+exec 3>&-
+wait "$pid"
+
+dequeued=$(sed -n 's/.*"dequeued": \([0-9]*\).*/\1/p' "$dir/report.json" 2> /dev/null)
+
+rc=0
+if [ -z "$dequeued" ] || [ "$dequeued" -lt 60 ]; then
+	echo "FAIL: only '$dequeued' frames are dequeued with the dmabuf io-mode"
+	cat "$dir/log"
+	rc=1
+fi
+if [ "$has_client" -eq 1 ]; then
+	cat "$dir/client"
+	frames=$(sed -n 's/^frames \([0-9]*\) bad \([0-9]*\)$/\1/p' "$dir/client")
+	bad=$(sed -n 's/^frames \([0-9]*\) bad \([0-9]*\)$/\2/p' "$dir/client")
+	if [ -z "$frames" ] || [ "$frames" -lt "$MIN_FRAMES" ]; then
+		echo "FAIL: only '$frames' frames are exported to the client"
+		rc=1
+	fi
+	if [ -z "$bad" ] || [ "$bad" -ne 0 ]; then
+		echo "FAIL: '$bad' frames are exported without their planes"
+		rc=1
+	fi
+else
+	echo "$PYTHON is not found, the exported frames are not checked"
+fi
+
+[ "$rc" -eq 0 ] && echo "PASS: $dequeued frames dequeued, ${frames:-no} frames exported"
+exit "$rc"
@@ -0,0 +1,53 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Let the fake capture of camera_app_sim repeat the same image after a few
+# frames of each stream, as a stuck serializer does, and check that the
+# frozen feed is detected and recovered: each restart of the stream gives
+# fresh frames again, so fewer frames are frozen than if it were never
+# restarted.
+
+SIM=${SIM:-./camera_app_sim}
+FREEZE_AFTER=30
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/stdin" || exit 1
+
+FAKE_VIN_FPS=60 FAKE_VIN_FREEZE_AFTER=$FREEZE_AFTER FAKE_VIN_REPORT="$dir/report.json" \
+	"$SIM" --switch=-1 --preview_width=320 --preview_height=240 \
+	--frozen_frames=20 --frozen_recovery=1 < "$dir/stdin" > "$dir/log" 2>&1 &
+pid=$!
+
+exec 3<> "$dir/stdin"
+sleep 1
+echo start >&3
+sleep 3
+echo stop >&3
+sleep 1
+echo quit >&3
+exec 3>&-
+wait "$pid"
+
+if [ ! -s "$dir/report.json" ]; then
+	echo "FAIL: no statistics are written by the fake capture"
+	cat "$dir/log"
+	exit 1
+fi
+cat "$dir/report.json"
+
+delivered=$(sed -n 's/.*"delivered": \([0-9]*\).*/\1/p' "$dir/report.json")
+frozen=$(sed -n 's/.*"frozen": \([0-9]*\).*/\1/p' "$dir/report.json")
+
+rc=0
+if [ -z "$frozen" ] || [ "$frozen" -eq 0 ]; then
+	echo "FAIL: the fake capture does not freeze"
+	rc=1
+elif [ "$frozen" -gt $((delivered - 2 * FREEZE_AFTER)) ]; then
+	# a stream which is never restarted freezes after its first frames
+	echo "FAIL: $frozen of $delivered frames are frozen, the stream is not restarted"
+	rc=1
+fi
+
+[ "$rc" -eq 0 ] && echo "PASS: $frozen of $delivered frames are frozen with the recovery"
+exit "$rc"
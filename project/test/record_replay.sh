@@ -0,0 +1,116 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Record a few frames of camera_app_sim into video_capture.rec, replay the
+# recording as the fake capture of a second run which dumps the frames it
+# captures into video_capture.N, and check that every frame dumped is one of
+# the recorded frames byte for byte. Twice as many frames as recorded are
+# dumped, so the replay loops, and the frames the fake capture generates
+# itself cannot pass for the recorded ones.
+
+SIM=${SIM:-./camera_app_sim}
+FRAMES=8
+SIZE_ARGS="--preview_width=320 --preview_height=240"
+
+case "$SIM" in
+/*) ;;
+*) SIM=$(pwd)/$SIM ;;
+esac
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/stdin" || exit 1
+mkdir "$dir/record" "$dir/replay" || exit 1
+
+# run the sim in $1 with the rest of the arguments, and preview for a second
+run_sim() {
+	(cd "$1" && shift && exec "$SIM" --switch=-1 $SIZE_ARGS "$@") \
+		< "$dir/stdin" >> "$dir/log" 2>&1 &
+	pid=$!
+
+	exec 3<> "$dir/stdin"
+	sleep 1
+	echo start >&3
+	sleep 1
+	echo stop >&3
+	sleep 1
+	echo quit >&3
+	exec 3>&-
+	wait "$pid"
+}
+
+u32() {
+	od -An -t u4 -j "$2" -N 4 "$1" | tr -d ' '
+}
+
+u64() {
+	od -An -t u8 -j "$2" -N 8 "$1" | tr -d ' '
+}
+
+FAKE_VIN_FPS=60
+export FAKE_VIN_FPS
+
+run_sim "$dir/record" --capture=$FRAMES --capture_record=1
+rec="$dir/record/video_capture.rec"
+if [ ! -s "$rec" ]; then
+	echo "FAIL: nothing is recorded"
+	cat "$dir/log"
+	exit 1
+fi
+
+FAKE_VIN_REPLAY="$rec"
+export FAKE_VIN_REPLAY
+run_sim "$dir/replay" --capture=$((FRAMES * 2))
+
+# struct frame_record_header and struct frame_record_entry
+entry_size=$(u32 "$rec" 8)
+n_frames=$(u32 "$rec" 16)
+index_offset=$(u64 "$rec" 24)
+
+rc=0
+if [ "$n_frames" -ne "$FRAMES" ]; then
+	echo "FAIL: $n_frames frames are recorded, not $FRAMES"
+	rc=1
+fi
+
+dumped=0
+matched=""
+idx=0
+while [ -f "$dir/replay/video_capture.$idx" ]; do
+	dump="$dir/replay/video_capture.$idx"
+	# the planes follow the 64 bytes of struct frame_dump_header
+	length=$(($(wc -c < "$dump") - 64))
+	found=""
+	frame=0
+	while [ -z "$found" ] && [ "$frame" -lt "$n_frames" ]; do
+		entry=$((index_offset + frame * entry_size))
+		offset=$(u64 "$rec" "$entry")
+		if [ "$(u64 "$rec" $((entry + 8)))" -eq "$length" ] &&
+		   cmp -s -i "64:$offset" -n "$length" "$dump" "$rec"; then
+			found=$frame
+		fi
+		frame=$((frame + 1))
+	done
+	if [ -z "$found" ]; then
+		echo "FAIL: video_capture.$idx of the replay is none of the recorded frames"
+		rc=1
+	else
+		matched="$matched $found"
+	fi
+	dumped=$((dumped + 1))
+	idx=$((idx + 1))
+done
+
+distinct=$(echo $matched | tr ' ' '\n' | sort -u | grep -c .)
+if [ "$dumped" -ne $((FRAMES * 2)) ]; then
+	echo "FAIL: $dumped frames are dumped from the replay, not $((FRAMES * 2))"
+	rc=1
+fi
+if [ "$distinct" -lt 2 ]; then
+	echo "FAIL: the frames dumped from the replay are all recorded frame$matched"
+	rc=1
+fi
+
+[ "$rc" -ne 0 ] && cat "$dir/log"
+[ "$rc" -eq 0 ] && echo "PASS: the $dumped frames replayed are recorded frames$matched"
+exit "$rc"
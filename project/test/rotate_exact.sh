@@ -0,0 +1,55 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Run the 'rotate' command of camera_app_sim, which rotates and mirrors a
+# frame of every format in every way by the cpu, and check that each result
+# matches the reference rotation pixel for pixel.
+
+SIM=${SIM:-./camera_app_sim}
+JSON=/tmp/camera_app_rotate.json
+TIMEOUT_S=${TIMEOUT_S:-120}
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/stdin" || exit 1
+rm -f "$JSON"
+
+"$SIM" --switch=-1 --preview_width=640 --preview_height=360 \
+	< "$dir/stdin" > "$dir/log" 2>&1 &
+pid=$!
+
+exec 3<> "$dir/stdin"
+sleep 1
+echo rotate >&3
+# the json is complete once its closing brace is written
+waited=0
+while [ "$(tail -n 1 "$JSON" 2> /dev/null)" != "}" ] && [ "$waited" -lt "$TIMEOUT_S" ]; do
+	sleep 1
+	waited=$((waited + 1))
+done
+echo quit >&3
+exec 3>&-
+wait "$pid"
+
+if [ "$(tail -n 1 "$JSON" 2> /dev/null)" != "}" ]; then
+	echo "FAIL: $JSON is not written in $TIMEOUT_S s"
+	cat "$dir/log"
+	exit 1
+fi
+
+total=$(grep -c '"exact": ' "$JSON")
+wrong=$(grep '"exact": 0' "$JSON")
+
+rc=0
+if [ "$total" -eq 0 ]; then
+	echo "FAIL: no rotation is checked"
+	rc=1
+fi
+if [ -n "$wrong" ]; then
+	echo "FAIL: the rotations below differ from the reference"
+	echo "$wrong"
+	rc=1
+fi
+
+[ "$rc" -eq 0 ] && echo "PASS: $total rotations match the reference"
+exit "$rc"
@@ -0,0 +1,84 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Keep the last frames of camera_app_sim in the pre-trigger ring and send the
+# 'snapshot' command: video_record.0.rec is to hold the frames of the
+# pre-roll before the command as well as those of the post-roll after it,
+# in the order they are captured.
+
+SIM=${SIM:-./camera_app_sim}
+FPS=60
+PREROLL_MS=500
+POSTROLL_MS=500
+
+case "$SIM" in
+/*) ;;
+*) SIM=$(pwd)/$SIM ;;
+esac
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/stdin" || exit 1
+
+(cd "$dir" && FAKE_VIN_FPS=$FPS exec "$SIM" --switch=-1 \
+	--preview_width=320 --preview_height=240 --record_budget_mb=16 \
+	--record_preroll_ms=$PREROLL_MS --record_postroll_ms=$POSTROLL_MS) \
+	< "$dir/stdin" > "$dir/log" 2>&1 &
+pid=$!
+
+exec 3<> "$dir/stdin"
+sleep 1
+echo start >&3
+# longer than the pre-roll, so the ring is full when the command comes
+sleep 2
+echo snapshot >&3
+sleep 2
+echo stop >&3
+sleep 1
+echo quit >&3
+exec 3>&-
+wait "$pid"
+
+rec="$dir/video_record.0.rec"
+if [ ! -s "$rec" ]; then
+	echo "FAIL: the snapshot is not persisted"
+	cat "$dir/log"
+	exit 1
+fi
+
+u32() {
+	od -An -t u4 -j "$2" -N 4 "$1" | tr -d ' '
+}
+
+u64() {
+	od -An -t u8 -j "$2" -N 8 "$1" | tr -d ' '
+}
+
+# struct frame_record_header, and the sequence of struct frame_dump_header
+# in each struct frame_record_entry
+entry_size=$(u32 "$rec" 8)
+n_frames=$(u32 "$rec" 16)
+index_offset=$(u64 "$rec" 24)
+expected=$(((PREROLL_MS + POSTROLL_MS) * FPS / 1000))
+
+rc=0
+if [ "$n_frames" -ne "$expected" ]; then
+	echo "FAIL: $n_frames frames are persisted, not $expected of the pre-roll and the post-roll"
+	rc=1
+fi
+
+prev=""
+frame=0
+while [ "$frame" -lt "$n_frames" ]; do
+	sequence=$(u32 "$rec" $((index_offset + frame * entry_size + 16 + 24)))
+	if [ -n "$prev" ] && [ "$sequence" -le "$prev" ]; then
+		echo "FAIL: frame $frame of sequence $sequence is persisted after sequence $prev"
+		rc=1
+	fi
+	prev=$sequence
+	frame=$((frame + 1))
+done
+
+[ "$rc" -ne 0 ] && cat "$dir/log"
+[ "$rc" -eq 0 ] && echo "PASS: $n_frames frames of the pre-roll and the post-roll are persisted"
+exit "$rc"
@@ -0,0 +1,79 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Engage the reverse gear of camera_app_sim by a rising edge written into
+# a fifo of gpio line events, and check the latency it dumps: the command
+# is to be sent as soon as the edge is read, its ack is to be measured, and
+# the first frame is to be shown.
+
+SIM=${SIM:-./camera_app_sim}
+DUMP=/tmp/camera_app_latency.json
+# the switch used to be polled every 100 ms
+MAX_EDGE_TO_COMMAND_US=${MAX_EDGE_TO_COMMAND_US:-20000}
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+mkfifo "$dir/switch" "$dir/stdin" || exit 1
+rm -f "$DUMP"
+
+# a gpio_v2_line_event: timestamp 0 (stamped when read), rising edge,
+# offset 0, seqno 1, line_seqno 1 and the padding
+rising_edge() {
+	head -c 8 /dev/zero
+	printf '\001\000\000\000\000\000\000\000\001\000\000\000\001\000\000\000'
+	head -c 24 /dev/zero
+}
+
+SWITCH_GPIO_EVENT_SOURCE="$dir/switch" "$SIM" --switch_gpio_chip=0 \
+	< "$dir/stdin" > "$dir/log" 2>&1 &
+pid=$!
+
+# opened for reading as well not to block if the sim is gone
+exec 3<> "$dir/stdin" 4<> "$dir/switch"
+# the switch is read as disengaged at first
+sleep 1
+# written at once, as the sim reads a whole event or nothing
+rising_edge > "$dir/edge"
+cat "$dir/edge" >&4
+sleep 1
+echo latency >&3
+sleep 1
+echo quit >&3
+exec 3>&- 4>&-
+wait "$pid"
+
+if [ ! -s "$DUMP" ]; then
+	echo "FAIL: no latency is dumped into $DUMP"
+	cat "$dir/log"
+	exit 1
+fi
+cat "$DUMP"
+
+# switch_edge, command_enqueued, command_dequeued, ..., first_overlay_qbuf
+record=$(sed -n '/"records_us"/{n;p;}' "$DUMP" | tr -d ' []')
+enqueued=$(echo "$record" | cut -d, -f2)
+dequeued=$(echo "$record" | cut -d, -f3)
+shown=$(echo "$record" | cut -d, -f12)
+acks=$(sed -n 's/.*"switch_edge_to_ack", "count": \([0-9]*\).*/\1/p' "$DUMP")
+
+rc=0
+if [ -z "$enqueued" ] || [ "$enqueued" -lt 0 ] ||
+   [ "$enqueued" -gt "$MAX_EDGE_TO_COMMAND_US" ]; then
+	echo "FAIL: edge to command is '$enqueued' us, over $MAX_EDGE_TO_COMMAND_US us"
+	rc=1
+fi
+if [ -z "$dequeued" ] || [ "$dequeued" -lt "$enqueued" ]; then
+	echo "FAIL: the command is dequeued at '$dequeued' us, before it is enqueued"
+	rc=1
+fi
+if [ -z "$shown" ] || [ "$shown" -lt 0 ]; then
+	echo "FAIL: the first frame is not shown"
+	rc=1
+fi
+if [ -z "$acks" ] || [ "$acks" -lt 1 ]; then
+	echo "FAIL: no ack of the edge is measured"
+	rc=1
+fi
+
+[ "$rc" -eq 0 ] && echo "PASS: edge to command $enqueued us, to the first frame $shown us"
+exit "$rc"